@@ -0,0 +1,514 @@
+#include "BakedVolume.h"
+#include "CpuRenderer.h"
+#include "Headless.h"
+#include "Image.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static const char kVolumeMagic[4] = { 'E', 'X', 'B', 'V' };
+static const uint kVolumeVersion = 1;
+
+VolumeBakeSettings::VolumeBakeSettings()
+    : resolution(64)
+    , brickSize(8)
+    , format(kBakedVolumeRGBA8)
+    , numFrames(16)
+    , timeStart(0.0f)
+    , timeEnd(16.0f)
+{
+}
+
+BakedExplosionVolume::BakedExplosionVolume()
+    : m_Resolution(0)
+    , m_BrickSize(0)
+    , m_BricksPerAxis(0)
+    , m_Format(kBakedVolumeRGBA8)
+    , m_TimeStart(0)
+    , m_TimeEnd(0)
+    , m_MinWS(0.0f)
+    , m_CellSizeWS(0)
+{
+}
+
+//--------------------------------------------------------------------------------------
+// Serialisation
+//--------------------------------------------------------------------------------------
+namespace
+{
+    template<typename T> bool WriteValue( FILE* pFile, const T& value ) { return fwrite( &value, sizeof(T), 1, pFile ) == 1; }
+    template<typename T> bool ReadValue( FILE* pFile, T& value ) { return fread( &value, sizeof(T), 1, pFile ) == 1; }
+
+    template<typename T> bool WriteArray( FILE* pFile, const std::vector<T>& values )
+    {
+        const uint count = (uint)values.size();
+        return WriteValue( pFile, count ) && (count == 0 || fwrite( &values[0], sizeof(T), count, pFile ) == count);
+    }
+
+    template<typename T> bool ReadArray( FILE* pFile, std::vector<T>& values )
+    {
+        uint count;
+        if( !ReadValue( pFile, count ) ) return false;
+        values.resize( count );
+        return count == 0 || fread( &values[0], sizeof(T), count, pFile ) == count;
+    }
+}
+
+bool BakedExplosionVolume::Save( const char* pFileName ) const
+{
+    FILE* pFile = fopen( pFileName, "wb" );
+    if( !pFile ) return false;
+
+    const uint format = m_Format;
+    bool succeeded = fwrite( kVolumeMagic, 1, 4, pFile ) == 4;
+    succeeded = succeeded && WriteValue( pFile, kVolumeVersion );
+    succeeded = succeeded && WriteValue( pFile, m_Resolution );
+    succeeded = succeeded && WriteValue( pFile, m_BrickSize );
+    succeeded = succeeded && WriteValue( pFile, format );
+    succeeded = succeeded && WriteValue( pFile, m_TimeStart );
+    succeeded = succeeded && WriteValue( pFile, m_TimeEnd );
+    succeeded = succeeded && WriteValue( pFile, m_MinWS );
+    succeeded = succeeded && WriteValue( pFile, m_CellSizeWS );
+    succeeded = succeeded && WriteValue( pFile, (uint)m_Frames.size() );
+    for(size_t i=0 ; i<m_Frames.size() && succeeded ; i++)
+    {
+        succeeded = WriteArray( pFile, m_Frames[i].brickOffsets ) && WriteArray( pFile, m_Frames[i].texels );
+    }
+
+    fclose( pFile );
+    return succeeded;
+}
+
+bool BakedExplosionVolume::Load( const char* pFileName )
+{
+    FILE* pFile = fopen( pFileName, "rb" );
+    if( !pFile ) return false;
+
+    char magic[4];
+    uint version = 0, format = 0, numFrames = 0;
+    bool succeeded = fread( magic, 1, 4, pFile ) == 4 && memcmp( magic, kVolumeMagic, 4 ) == 0;
+    succeeded = succeeded && ReadValue( pFile, version ) && version == kVolumeVersion;
+    succeeded = succeeded && ReadValue( pFile, m_Resolution );
+    succeeded = succeeded && ReadValue( pFile, m_BrickSize );
+    succeeded = succeeded && ReadValue( pFile, format ) && format <= kBakedVolumeRGBA16F;
+    succeeded = succeeded && ReadValue( pFile, m_TimeStart );
+    succeeded = succeeded && ReadValue( pFile, m_TimeEnd );
+    succeeded = succeeded && ReadValue( pFile, m_MinWS );
+    succeeded = succeeded && ReadValue( pFile, m_CellSizeWS );
+    succeeded = succeeded && ReadValue( pFile, numFrames ) && numFrames > 0;
+    succeeded = succeeded && m_BrickSize > 0 && m_Resolution % m_BrickSize == 0;
+
+    if( succeeded )
+    {
+        m_Format = (BakedVolumeFormat)format;
+        m_BricksPerAxis = m_Resolution / m_BrickSize;
+        m_Frames.resize( numFrames );
+        for(uint i=0 ; i<numFrames && succeeded ; i++)
+        {
+            Frame& frame = m_Frames[i];
+            succeeded = ReadArray( pFile, frame.brickOffsets ) && ReadArray( pFile, frame.texels )
+                     && frame.brickOffsets.size() == GetNumBricks();
+
+            frame.numStoredBricks = 0;
+            for(size_t b=0 ; b<frame.brickOffsets.size() && succeeded ; b++)
+            {
+                if( frame.brickOffsets[b] == kEmptyBrick ) continue;
+                const size_t brickBytes = (m_BrickSize + 1) * (m_BrickSize + 1) * (m_BrickSize + 1) * GetBytesPerTexel();
+                succeeded = frame.brickOffsets[b] + brickBytes <= frame.texels.size();
+                frame.numStoredBricks++;
+            }
+        }
+    }
+
+    fclose( pFile );
+    if( !succeeded ) m_Frames.clear();
+    return succeeded;
+}
+
+//--------------------------------------------------------------------------------------
+// Playback
+//--------------------------------------------------------------------------------------
+size_t BakedExplosionVolume::GetFrameBytes( uint frame ) const
+{
+    return m_Frames[frame].brickOffsets.size() * sizeof(uint32_t) + m_Frames[frame].texels.size();
+}
+
+size_t BakedExplosionVolume::GetDenseFrameBytes() const
+{
+    return (size_t)(m_Resolution + 1) * (m_Resolution + 1) * (m_Resolution + 1) * GetBytesPerTexel();
+}
+
+uint BakedExplosionVolume::SelectFrame( float time ) const
+{
+    float phase = (time - m_TimeStart) / (m_TimeEnd - m_TimeStart);
+    phase -= floorf( phase );
+    return (uint)(phase * GetNumFrames() + 0.5f) % GetNumFrames();
+}
+
+float BakedExplosionVolume::GetFrameTime( uint frame ) const
+{
+    return Lerp( m_TimeStart, m_TimeEnd, (float)frame / GetNumFrames() );
+}
+
+Vec4 BakedExplosionVolume::FetchTexel( const uint8_t* pTexel ) const
+{
+    if( m_Format == kBakedVolumeRGBA8 )
+    {
+        return Vec4( pTexel[0], pTexel[1], pTexel[2], pTexel[3] ) * (1.0f / 255.0f);
+    }
+
+    const uint16_t* pHalf = (const uint16_t*)pTexel;
+    return Vec4( HalfToFloat( pHalf[0] ), HalfToFloat( pHalf[1] ), HalfToFloat( pHalf[2] ), HalfToFloat( pHalf[3] ) );
+}
+
+Vec4 BakedExplosionVolume::Sample( uint frame, const Vec3& posWS ) const
+{
+    const Vec3 gridPos = (posWS - m_MinWS) / m_CellSizeWS;
+    if( gridPos.x < 0.0f || gridPos.y < 0.0f || gridPos.z < 0.0f ) return Vec4( 0.0f );
+
+    const uint cellX = (uint)gridPos.x, cellY = (uint)gridPos.y, cellZ = (uint)gridPos.z;
+    if( cellX >= m_Resolution || cellY >= m_Resolution || cellZ >= m_Resolution ) return Vec4( 0.0f );
+
+    const uint brickX = cellX / m_BrickSize, brickY = cellY / m_BrickSize, brickZ = cellZ / m_BrickSize;
+    const uint32_t brickOffset = m_Frames[frame].brickOffsets[(brickZ * m_BricksPerAxis + brickY) * m_BricksPerAxis + brickX];
+    if( brickOffset == kEmptyBrick ) return Vec4( 0.0f );
+
+    // Corner samples of the cell within the brick.
+    const uint brickSamples = m_BrickSize + 1;
+    const uint texelSize = GetBytesPerTexel();
+    const uint strideY = brickSamples * texelSize;
+    const uint strideZ = brickSamples * strideY;
+    const uint8_t* p = &m_Frames[frame].texels[brickOffset]
+                     + (cellZ - brickZ * m_BrickSize) * strideZ
+                     + (cellY - brickY * m_BrickSize) * strideY
+                     + (cellX - brickX * m_BrickSize) * texelSize;
+
+    const float tx = gridPos.x - cellX, ty = gridPos.y - cellY, tz = gridPos.z - cellZ;
+
+    const Vec4 c00 = Lerp( FetchTexel( p ), FetchTexel( p + texelSize ), tx );
+    const Vec4 c10 = Lerp( FetchTexel( p + strideY ), FetchTexel( p + strideY + texelSize ), tx );
+    const Vec4 c01 = Lerp( FetchTexel( p + strideZ ), FetchTexel( p + strideZ + texelSize ), tx );
+    const Vec4 c11 = Lerp( FetchTexel( p + strideZ + strideY ), FetchTexel( p + strideZ + strideY + texelSize ), tx );
+
+    return Lerp( Lerp( c00, c10, ty ), Lerp( c01, c11, ty ), tz );
+}
+
+//--------------------------------------------------------------------------------------
+// Baking
+//--------------------------------------------------------------------------------------
+bool BakedExplosionVolume::Bake( const ExplosionSettings& settings, const SceneTextures& textures, const VolumeBakeSettings& bakeSettings, ThreadPool& pool )
+{
+    if( bakeSettings.brickSize == 0 || bakeSettings.resolution % bakeSettings.brickSize != 0 || bakeSettings.numFrames == 0 ) return false;
+
+    m_Resolution = bakeSettings.resolution;
+    m_BrickSize = bakeSettings.brickSize;
+    m_BricksPerAxis = m_Resolution / m_BrickSize;
+    m_Format = bakeSettings.format;
+    m_TimeStart = bakeSettings.timeStart;
+    m_TimeEnd = bakeSettings.timeEnd;
+    m_Frames.resize( bakeSettings.numFrames );
+
+    const float largestAbsoluteNoiseValue = textures.noiseVolume.GetLargestAbsoluteValue();
+    const uint numSamples = m_Resolution + 1;
+    const uint brickSamples = m_BrickSize + 1;
+    const uint texelSize = GetBytesPerTexel();
+
+    std::vector<Vec4> samples( numSamples * numSamples * numSamples );
+
+    for(uint f=0 ; f<bakeSettings.numFrames ; f++)
+    {
+        // The camera does not affect SceneFunction; only the time does.
+        ExplosionParams params;
+        BuildExplosionParams( settings, OrbitCamera(), GetFrameTime( f ), 1, 1, largestAbsoluteNoiseValue, params );
+        const ExplosionEvaluator evaluator( params, textures );
+
+        const float boundingRadius = GetExplosionBoundingRadius( params );
+        m_MinWS = evaluator.GetExplosionPositionWS() - Vec3( boundingRadius );
+        m_CellSizeWS = 2.0f * boundingRadius / m_Resolution;
+
+        pool.ParallelFor( numSamples, [&]( uint z, uint )
+        {
+            for(uint y=0 ; y<numSamples ; y++)
+            {
+                for(uint x=0 ; x<numSamples ; x++)
+                {
+                    const Vec3 posWS = m_MinWS + Vec3( (float)x, (float)y, (float)z ) * m_CellSizeWS;
+                    samples[(z * numSamples + y) * numSamples + x] = evaluator.SceneFunction( posWS );
+                }
+            }
+        } );
+
+        // Quantise into bricks, dropping those that filter to zero opacity everywhere.
+        Frame& frame = m_Frames[f];
+        frame.brickOffsets.assign( GetNumBricks(), (uint32_t)kEmptyBrick );
+        frame.texels.clear();
+        frame.numStoredBricks = 0;
+
+        std::vector<uint8_t> brick( brickSamples * brickSamples * brickSamples * texelSize );
+        for(uint b=0 ; b<GetNumBricks() ; b++)
+        {
+            const uint x0 = (b % m_BricksPerAxis) * m_BrickSize;
+            const uint y0 = ((b / m_BricksPerAxis) % m_BricksPerAxis) * m_BrickSize;
+            const uint z0 = (b / (m_BricksPerAxis * m_BricksPerAxis)) * m_BrickSize;
+
+            bool isEmpty = true;
+            uint8_t* pTexel = &brick[0];
+            for(uint z=z0 ; z<=z0 + m_BrickSize ; z++)
+            {
+                for(uint y=y0 ; y<=y0 + m_BrickSize ; y++)
+                {
+                    for(uint x=x0 ; x<=x0 + m_BrickSize ; x++, pTexel += texelSize)
+                    {
+                        const Vec4& colour = samples[(z * numSamples + y) * numSamples + x];
+                        if( m_Format == kBakedVolumeRGBA8 )
+                        {
+                            pTexel[0] = (uint8_t)(Saturate( colour.x ) * 255.0f + 0.5f);
+                            pTexel[1] = (uint8_t)(Saturate( colour.y ) * 255.0f + 0.5f);
+                            pTexel[2] = (uint8_t)(Saturate( colour.z ) * 255.0f + 0.5f);
+                            pTexel[3] = (uint8_t)(Saturate( colour.w ) * 255.0f + 0.5f);
+                            isEmpty = isEmpty && pTexel[3] == 0;
+                        }
+                        else
+                        {
+                            uint16_t* pHalf = (uint16_t*)pTexel;
+                            pHalf[0] = FloatToHalf( colour.x );
+                            pHalf[1] = FloatToHalf( colour.y );
+                            pHalf[2] = FloatToHalf( colour.z );
+                            pHalf[3] = FloatToHalf( colour.w );
+                            isEmpty = isEmpty && HalfToFloat( pHalf[3] ) == 0.0f;
+                        }
+                    }
+                }
+            }
+
+            if( isEmpty ) continue;
+
+            frame.brickOffsets[b] = (uint32_t)frame.texels.size();
+            frame.texels.insert( frame.texels.end(), brick.begin(), brick.end() );
+            frame.numStoredBricks++;
+        }
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// Playback marcher
+//--------------------------------------------------------------------------------------
+Vec4 RayMarchBakedVolume( const BakedExplosionVolume& volume, uint frame, const ExplosionParams& params, const Vec3& rayDirectionWS, float nearD, float farD, uint& stepsTaken )
+{
+    Vec4 output( 0.0f );
+
+    const Vec3 stepAmountWS = rayDirectionWS * params.g_StepSizeWS;
+    const float numSteps = Min( (float)params.g_MaxNumSteps, (farD - nearD) / params.g_StepSizeWS );
+
+    Vec3 posWS = rayDirectionWS * nearD + Vec3( params.g_EyePositionWS );
+
+    float steps = 0;
+    while( steps++ < numSteps && output.w < params.g_Opacity )
+    {
+        output = Blend( output, volume.Sample( frame, posWS ) );
+        posWS += stepAmountWS;
+    }
+
+    stepsTaken = (uint)(steps - 1);
+    output.w *= params.g_Opacity;
+    return output;
+}
+
+void RenderBakedVolumeFrame( const BakedExplosionVolume& volume, uint frame, const ExplosionParams& params, uint tileSize, Image& target, ThreadPool* pPool, RenderStats* pStats )
+{
+    Timer timer;
+
+    const uint width = (uint)params.g_ScreenParams.x;
+    const uint height = (uint)params.g_ScreenParams.y;
+    target.Resize( width, height );
+
+    const uint numTilesX = (width + tileSize - 1) / tileSize;
+    const uint numTilesY = (height + tileSize - 1) / tileSize;
+
+    std::vector<RenderStats> threadStats( pPool ? pPool->GetNumThreads() : 1 );
+
+    auto renderTile = [&]( uint tileIndex, uint threadIndex )
+    {
+        RenderStats& stats = threadStats[threadIndex];
+        const uint x0 = (tileIndex % numTilesX) * tileSize;
+        const uint y0 = (tileIndex / numTilesX) * tileSize;
+        const uint x1 = Min( x0 + tileSize, width ), y1 = Min( y0 + tileSize, height );
+
+        for(uint y=y0 ; y<y1 ; y++)
+        {
+            for(uint x=x0 ; x<x1 ; x++)
+            {
+                Vec4& pixel = target.At( x, y );
+                pixel = Vec4( 0.0f );
+                stats.numPixels++;
+
+                const Vec3 rayDirectionWS = GetRayDirectionWS( params, x + 0.5f, y + 0.5f );
+
+                float nearD, farD;
+                if( !GetAnalyticRayInterval( params, rayDirectionWS, nearD, farD ) ) continue;
+
+                uint stepsTaken;
+                pixel = RayMarchBakedVolume( volume, frame, params, rayDirectionWS, nearD, farD, stepsTaken );
+
+                stats.numRays++;
+                stats.numSteps += stepsTaken;
+            }
+        }
+    };
+
+    if( pPool )
+    {
+        pPool->ParallelFor( numTilesX * numTilesY, renderTile );
+    }
+    else
+    {
+        for(uint i=0 ; i<numTilesX * numTilesY ; i++) renderTile( i, 0 );
+    }
+
+    if( pStats )
+    {
+        RenderStats frameStats;
+        for(size_t i=0 ; i<threadStats.size() ; i++) frameStats.Accumulate( threadStats[i] );
+        frameStats.milliseconds = timer.GetElapsedMilliseconds();
+        *pStats = frameStats;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Headless commands
+//--------------------------------------------------------------------------------------
+int VolumeBakeMain( const CommandLine& commandLine )
+{
+    const char* pFileName = commandLine.GetPositional( 0 );
+    if( !pFileName )
+    {
+        fprintf( stderr, "Usage: volume-bake <out.volume> [-size 64] [-brick 8] [-format rgba8|rgba16f] [-frames 16] [-start 0] [-end 16]\n" );
+        return 1;
+    }
+
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    VolumeBakeSettings bakeSettings;
+    bakeSettings.resolution = commandLine.GetUint( "size", bakeSettings.resolution );
+    bakeSettings.brickSize = commandLine.GetUint( "brick", bakeSettings.brickSize );
+    bakeSettings.numFrames = commandLine.GetUint( "frames", bakeSettings.numFrames );
+    bakeSettings.timeStart = commandLine.GetFloat( "start", bakeSettings.timeStart );
+    bakeSettings.timeEnd = commandLine.GetFloat( "end", bakeSettings.timeEnd );
+
+    const char* pFormat = commandLine.GetString( "format", "rgba8" );
+    if( strcmp( pFormat, "rgba8" ) == 0 )
+    {
+        bakeSettings.format = kBakedVolumeRGBA8;
+    }
+    else if( strcmp( pFormat, "rgba16f" ) == 0 )
+    {
+        bakeSettings.format = kBakedVolumeRGBA16F;
+    }
+    else
+    {
+        fprintf( stderr, "Unknown volume format '%s'.\n", pFormat );
+        return 1;
+    }
+
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+
+    Timer timer;
+    BakedExplosionVolume volume;
+    if( !volume.Bake( ExplosionSettings(), textures, bakeSettings, pool ) || !volume.Save( pFileName ) )
+    {
+        fprintf( stderr, "Failed to bake %s (the brick size must divide the size).\n", pFileName );
+        return 1;
+    }
+    const double seconds = timer.GetElapsedSeconds();
+
+    size_t totalBytes = 0;
+    uint totalBricks = 0;
+    for(uint f=0 ; f<volume.GetNumFrames() ; f++)
+    {
+        totalBytes += volume.GetFrameBytes( f );
+        totalBricks += volume.GetNumStoredBricks( f );
+    }
+
+    printf( "Baked %u frames of %u^3 %s in %.2fs on %u threads.\n", volume.GetNumFrames(), volume.GetResolution(), pFormat, seconds, pool.GetNumThreads() );
+    printf( "Per frame: %.1f KB bricked (%.1f%% of %u bricks stored) vs %.1f KB dense.\n",
+            totalBytes / 1024.0 / volume.GetNumFrames(), 100.0 * totalBricks / ((double)volume.GetNumBricks() * volume.GetNumFrames()),
+            volume.GetNumBricks(), volume.GetDenseFrameBytes() / 1024.0 );
+    return 0;
+}
+
+int VolumeBenchMain( const CommandLine& commandLine )
+{
+    const char* pFileName = commandLine.GetPositional( 0 );
+    BakedExplosionVolume volume;
+    if( !pFileName || !volume.Load( pFileName ) )
+    {
+        fprintf( stderr, "Usage: volume-bench <file.volume> [-time 3.3] [-width 800] [-height 640] [-radius 10] [-output prefix]\n" );
+        return 1;
+    }
+
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+
+    // Compare at the exact time of the nearest baked frame, so only the baking
+    //  itself contributes to the error.
+    const uint frame = volume.SelectFrame( commandLine.GetFloat( "time", 3.3f ) );
+    const float time = volume.GetFrameTime( frame );
+
+    OrbitCamera camera;
+    camera.phi = PI * 0.5f;
+    camera.radius = commandLine.GetFloat( "radius", camera.radius );
+
+    ExplosionParams params;
+    BuildExplosionParams( ExplosionSettings(), camera, time, commandLine.GetUint( "width", kResolutionX ), commandLine.GetUint( "height", kResolutionY ),
+                          textures.noiseVolume.GetLargestAbsoluteValue(), params );
+
+    const CpuRenderSettings renderSettings;
+    const CpuRenderer renderer( renderSettings );
+
+    Image liveImage, bakedImage;
+    RenderStats liveStats, bakedStats;
+    renderer.RenderFrame( params, textures, liveImage, &pool, &liveStats );
+    RenderBakedVolumeFrame( volume, frame, params, renderSettings.tileSize, bakedImage, &pool, &bakedStats );
+
+    // Error in the colour the sample would present.
+    double sumSquaredError = 0;
+    float maxError = 0;
+    for(uint y=0 ; y<liveImage.GetHeight() ; y++)
+    {
+        for(uint x=0 ; x<liveImage.GetWidth() ; x++)
+        {
+            const Vec3 difference = ResolveOverBlack( liveImage.At( x, y ) ) - ResolveOverBlack( bakedImage.At( x, y ) );
+            sumSquaredError += Dot( difference, difference ) / 3.0f;
+            maxError = Max( maxError, Max( fabsf( difference.x ), Max( fabsf( difference.y ), fabsf( difference.z ) ) ) );
+        }
+    }
+    const double rmse = sqrt( sumSquaredError / ((double)liveImage.GetWidth() * liveImage.GetHeight()) );
+
+    printf( "Frame %u (time %.2f), %u^3 %s, %.1f KB per frame (%u of %u bricks).\n", frame, time, volume.GetResolution(),
+            volume.GetFormat() == kBakedVolumeRGBA8 ? "rgba8" : "rgba16f", volume.GetFrameBytes( frame ) / 1024.0,
+            volume.GetNumStoredBricks( frame ), volume.GetNumBricks() );
+    printf( "Live:  %9.2f ms, %llu steps, %.1f ns per step\n", liveStats.milliseconds, (unsigned long long)liveStats.numSteps,
+            liveStats.milliseconds * 1e6 / Max( (float)liveStats.numSteps, 1.0f ) );
+    printf( "Baked: %9.2f ms, %llu steps, %.1f ns per step (%.1fx faster)\n", bakedStats.milliseconds, (unsigned long long)bakedStats.numSteps,
+            bakedStats.milliseconds * 1e6 / Max( (float)bakedStats.numSteps, 1.0f ), liveStats.milliseconds / bakedStats.milliseconds );
+    printf( "Error: RMSE %.4f, max %.4f (8-bit steps: %.2f, %.0f)\n", rmse, maxError, rmse * 255.0, maxError * 255.0f );
+
+    const char* pOutput = commandLine.GetString( "output", nullptr );
+    if( pOutput )
+    {
+        const std::string liveFileName = std::string( pOutput ) + "_live.ppm";
+        const std::string bakedFileName = std::string( pOutput ) + "_baked.ppm";
+        liveImage.WritePPM( liveFileName.c_str() );
+        bakedImage.WritePPM( bakedFileName.c_str() );
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+#ifndef BAKED_VOLUME_H
+#define BAKED_VOLUME_H
+
+//--------------------------------------------------------------------------------------
+// Baked explosion volumes.  SceneFunction's colour and opacity are sampled on a
+//  regular grid over the explosion's bounding cube, once per animation frame, so
+//  that playback costs one filtered fetch per step instead of g_NumOctaves noise
+//  fetches, the primitive's SDF and the gradient lookup.
+//
+//  Each frame is stored in bricks of brickSize^3 cells.  A brick keeps the
+//  (brickSize+1)^3 samples at its corners, duplicating the face it shares with its
+//  neighbours, so trilinear filtering never has to look outside it.  Bricks whose
+//  samples are all transparent are omitted and read back as zero.
+//--------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <vector>
+
+#include "ExplosionSettings.h"
+#include "CpuMath.h"
+
+class CommandLine;
+class Image;
+class ThreadPool;
+struct RenderStats;
+struct SceneTextures;
+
+enum BakedVolumeFormat
+{
+    kBakedVolumeRGBA8,
+    kBakedVolumeRGBA16F
+};
+
+struct VolumeBakeSettings
+{
+    uint resolution;            // Cells along each axis of the bounding cube.
+    uint brickSize;             // Cells along each axis of a brick; must divide resolution.
+    BakedVolumeFormat format;
+    uint numFrames;
+    float timeStart, timeEnd;
+
+    VolumeBakeSettings();
+};
+
+class BakedExplosionVolume
+{
+public:
+    BakedExplosionVolume();
+
+    bool Save( const char* pFileName ) const;
+    bool Load( const char* pFileName );
+
+    uint GetResolution() const { return m_Resolution; }
+    uint GetBrickSize() const { return m_BrickSize; }
+    BakedVolumeFormat GetFormat() const { return m_Format; }
+    uint GetNumFrames() const { return (uint)m_Frames.size(); }
+    uint GetNumBricks() const { return m_BricksPerAxis * m_BricksPerAxis * m_BricksPerAxis; }
+    uint GetNumStoredBricks( uint frame ) const { return m_Frames[frame].numStoredBricks; }
+    uint GetBytesPerTexel() const { return m_Format == kBakedVolumeRGBA8 ? 4 : 8; }
+
+    // Storage for one frame: brick table plus stored bricks, and the same frame as a
+    //  dense (resolution+1)^3 volume for comparison.
+    size_t GetFrameBytes( uint frame ) const;
+    size_t GetDenseFrameBytes() const;
+
+    // The baked frame nearest to an animation time (looping, like the flipbook).
+    uint SelectFrame( float time ) const;
+    float GetFrameTime( uint frame ) const;
+
+    // Trilinear filtered colour and opacity at a world space position; zero outside
+    //  the bounds and in omitted bricks.
+    Vec4 Sample( uint frame, const Vec3& posWS ) const;
+
+    // Samples SceneFunction for every frame, slices spread across the pool.
+    bool Bake( const ExplosionSettings& settings, const SceneTextures& textures, const VolumeBakeSettings& bakeSettings, ThreadPool& pool );
+
+private:
+    static const uint kEmptyBrick = 0xFFFFFFFF;
+
+    struct Frame
+    {
+        std::vector<uint32_t> brickOffsets;     // Byte offset into texels, or kEmptyBrick.
+        std::vector<uint8_t> texels;
+        uint numStoredBricks;
+    };
+
+    Vec4 FetchTexel( const uint8_t* pTexel ) const;
+
+    uint m_Resolution;
+    uint m_BrickSize;
+    uint m_BricksPerAxis;
+    BakedVolumeFormat m_Format;
+    float m_TimeStart, m_TimeEnd;
+    Vec3 m_MinWS;
+    float m_CellSizeWS;
+    std::vector<Frame> m_Frames;
+};
+
+// RenderExplosionPS with SceneFunction replaced by a fetch from the baked volume.
+Vec4 RayMarchBakedVolume( const BakedExplosionVolume& volume, uint frame, const ExplosionParams& params, const Vec3& rayDirectionWS, float nearD, float farD, uint& stepsTaken );
+
+// CpuRenderer::RenderFrame for the baked volume.
+void RenderBakedVolumeFrame( const BakedExplosionVolume& volume, uint frame, const ExplosionParams& params, uint tileSize, Image& target, ThreadPool* pPool, RenderStats* pStats );
+
+int VolumeBakeMain( const CommandLine& commandLine );
+int VolumeBenchMain( const CommandLine& commandLine );
+
+#endif // BAKED_VOLUME_H
@@ -0,0 +1,401 @@
+#include "BatchRenderer.h"
+#include "CpuRenderer.h"
+#include "Headless.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+
+//--------------------------------------------------------------------------------------
+// Sweepable parameters
+//--------------------------------------------------------------------------------------
+namespace
+{
+    void SetEdgeSoftness( ExplosionSettings& s, float v )       { s.edgeSoftness = v; }
+    void SetRadius( ExplosionSettings& s, float v )             { s.explosionRadius = v; }
+    void SetDisplacement( ExplosionSettings& s, float v )       { s.displacementAmount = v; }
+    void SetAmplitudeFactor( ExplosionSettings& s, float v )    { s.noiseAmplitudeFactor = v; }
+    void SetFrequencyFactor( ExplosionSettings& s, float v )    { s.noiseFrequencyFactor = v; }
+    void SetNoiseScale( ExplosionSettings& s, float v )         { s.noiseScale = v; }
+    void SetUvScale( ExplosionSettings& s, float v )            { s.uvScaleBias.x = v; }
+    void SetUvBias( ExplosionSettings& s, float v )             { s.uvScaleBias.y = v; }
+    void SetTightHull( ExplosionSettings& s, float v )          { s.enableHullShrinking = v != 0.0f; }
+    void SetAdaptiveHull( ExplosionSettings& s, float v )       { s.adaptiveHullShrinking = v != 0.0f; }
+    void SetAdaptiveSteps( ExplosionSettings& s, float v )      { s.adaptiveStepping = v != 0.0f; }
+    void SetOctaveCulling( ExplosionSettings& s, float v )      { s.octaveCulling = v != 0.0f; }
+    void SetDitheredStart( ExplosionSettings& s, float v )      { s.ditheredStart = v != 0.0f; }
+    void SetStepScale( ExplosionSettings& s, float v )          { s.stepSizeScale = v; }
+    void SetPrimitive( ExplosionSettings& s, float v )          { s.primitive = (PrimitiveType)(int)Clamp( v, (float)kPrimitiveSphere, (float)kPrimitiveBox ); }
+
+    struct SweepParameterDesc
+    {
+        const char* pName;
+        void (*pApply)( ExplosionSettings& settings, float value );
+    };
+
+    const SweepParameterDesc kSweepParameters[] =
+    {
+        { "EdgeSoftness",       SetEdgeSoftness },
+        { "Radius",             SetRadius },
+        { "Displacement",       SetDisplacement },
+        { "AmplitudeFactor",    SetAmplitudeFactor },
+        { "FrequencyFactor",    SetFrequencyFactor },
+        { "NoiseScale",         SetNoiseScale },
+        { "UvScale",            SetUvScale },
+        { "UvBias",             SetUvBias },
+        { "TightHull",          SetTightHull },
+        { "AdaptiveHull",       SetAdaptiveHull },
+        { "AdaptiveSteps",      SetAdaptiveSteps },
+        { "OctaveCulling",      SetOctaveCulling },
+        { "DitheredStart",      SetDitheredStart },
+        { "StepScale",          SetStepScale },
+        { "Primitive",          SetPrimitive },
+    };
+    const uint kNumSweepParameters = sizeof(kSweepParameters) / sizeof(kSweepParameters[0]);
+
+    // Parses either a list of values or "range <start> <end> <count>".
+    bool ParseValues( std::istringstream& line, std::vector<float>& values )
+    {
+        values.clear();
+
+        std::string token;
+        if( !(line >> token) ) return false;
+
+        if( token == "range" )
+        {
+            float start, end;
+            uint count;
+            if( !(line >> start >> end >> count) || count == 0 ) return false;
+            for(uint i=0 ; i<count ; i++)
+            {
+                values.push_back( count == 1 ? start : Lerp( start, end, (float)i / (count - 1) ) );
+            }
+            return true;
+        }
+
+        do
+        {
+            char* pEnd;
+            const float value = (float)strtod( token.c_str(), &pEnd );
+            if( *pEnd != '\0' ) return false;
+            values.push_back( value );
+        }
+        while( line >> token );
+
+        return true;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Job file
+//--------------------------------------------------------------------------------------
+BatchJobFile::BatchJobFile()
+    : outputDirectory("batch_output")
+    , width(200)
+    , height(160)
+    , numThreads(0)
+    , tileSize(16)
+    , marchMode(kMarchTiles)
+{
+}
+
+bool BatchJobFile::Load( const char* pFileName, std::string& error )
+{
+    std::ifstream f( pFileName );
+    if( !f.is_open() )
+    {
+        error = std::string( "cannot open " ) + pFileName;
+        return false;
+    }
+
+    uint lineNumber = 0;
+    std::string text;
+    while( std::getline( f, text ) )
+    {
+        lineNumber++;
+
+        const size_t comment = text.find( '#' );
+        if( comment != std::string::npos ) text.erase( comment );
+
+        std::istringstream line( text );
+        std::string keyword;
+        if( !(line >> keyword) ) continue;
+
+        bool valid = true;
+        if( keyword == "output" )
+        {
+            valid = !!(line >> outputDirectory);
+        }
+        else if( keyword == "resolution" )
+        {
+            valid = !!(line >> width >> height) && width > 0 && height > 0;
+        }
+        else if( keyword == "threads" )
+        {
+            valid = !!(line >> numThreads);
+        }
+        else if( keyword == "tile" )
+        {
+            valid = !!(line >> tileSize) && tileSize > 0;
+        }
+        else if( keyword == "march" )
+        {
+            std::string mode;
+            valid = !!(line >> mode) && (mode == "tiles" || mode == "wavefront");
+            marchMode = mode == "wavefront" ? kMarchWavefront : kMarchTiles;
+        }
+        else if( keyword == "camera" )
+        {
+            float thetaDegrees, phiDegrees;
+            OrbitCamera camera;
+            valid = !!(line >> thetaDegrees >> phiDegrees >> camera.radius);
+            camera.theta = thetaDegrees * PI / 180.0f;
+            camera.phi = phiDegrees * PI / 180.0f;
+            cameras.push_back( camera );
+        }
+        else if( keyword == "time" )
+        {
+            std::vector<float> values;
+            valid = ParseValues( line, values );
+            times.insert( times.end(), values.begin(), values.end() );
+        }
+        else
+        {
+            uint descIndex = 0;
+            while( descIndex < kNumSweepParameters && keyword != kSweepParameters[descIndex].pName ) descIndex++;
+            if( descIndex == kNumSweepParameters )
+            {
+                std::ostringstream message;
+                message << pFileName << "(" << lineNumber << "): unknown keyword '" << keyword << "'";
+                error = message.str();
+                return false;
+            }
+
+            BatchParameter parameter;
+            parameter.descIndex = descIndex;
+            valid = ParseValues( line, parameter.values );
+            parameters.push_back( parameter );
+        }
+
+        if( !valid )
+        {
+            std::ostringstream message;
+            message << pFileName << "(" << lineNumber << "): malformed '" << keyword << "' line";
+            error = message.str();
+            return false;
+        }
+    }
+
+    if( cameras.empty() ) cameras.push_back( OrbitCamera() );
+    if( times.empty() ) times.push_back( 0.0f );
+
+    return true;
+}
+
+uint BatchJobFile::GetNumJobs() const
+{
+    uint numJobs = 1;
+    for(size_t i=0 ; i<parameters.size() ; i++) numJobs *= (uint)parameters[i].values.size();
+    return numJobs;
+}
+
+void BatchJobFile::GetJobSettings( uint jobIndex, ExplosionSettings& settings, std::vector<float>& values ) const
+{
+    // The last parameter in the file varies fastest.
+    settings = baseSettings;
+    values.resize( parameters.size() );
+    for(size_t i=parameters.size() ; i-- > 0 ; )
+    {
+        const BatchParameter& parameter = parameters[i];
+        const uint count = (uint)parameter.values.size();
+
+        values[i] = parameter.values[jobIndex % count];
+        kSweepParameters[parameter.descIndex].pApply( settings, values[i] );
+        jobIndex /= count;
+    }
+}
+
+const char* BatchJobFile::GetParameterName( uint parameterIndex ) const
+{
+    return kSweepParameters[parameters[parameterIndex].descIndex].pName;
+}
+
+//--------------------------------------------------------------------------------------
+// Rendering
+//--------------------------------------------------------------------------------------
+namespace
+{
+    struct BatchJobState
+    {
+        Image contactSheet;
+        uint framesRemaining;
+        RenderStats stats;
+        double minMilliseconds, maxMilliseconds;
+    };
+
+    std::string MakeOutputPath( const BatchJobFile& jobFile, const char* pName )
+    {
+        return jobFile.outputDirectory + "/" + pName;
+    }
+}
+
+bool RunBatch( const BatchJobFile& jobFile, const SceneTextures& textures, ThreadPool& pool )
+{
+    if( !EnsureDirectory( jobFile.outputDirectory.c_str() ) )
+    {
+        fprintf( stderr, "Cannot create output directory '%s'.\n", jobFile.outputDirectory.c_str() );
+        return false;
+    }
+
+    const uint numJobs = jobFile.GetNumJobs();
+    const uint numSamples = jobFile.GetNumSamplesPerJob();
+    const uint numTimes = (uint)jobFile.times.size();
+    const uint numFrames = numJobs * numSamples;
+
+    printf( "Batch: %u jobs x %u samples = %u frames at %ux%u on %u threads.\n",
+            numJobs, numSamples, numFrames, jobFile.width, jobFile.height, pool.GetNumThreads() );
+
+    std::vector<BatchJobState> jobs( numJobs );
+    for(uint i=0 ; i<numJobs ; i++)
+    {
+        jobs[i].framesRemaining = numSamples;
+        jobs[i].minMilliseconds = 1e30;
+        jobs[i].maxMilliseconds = 0;
+    }
+
+    // The overview holds a half resolution thumbnail of the first sample of every job.
+    const uint overviewColumns = (uint)ceilf( sqrtf( (float)numJobs ) );
+    const uint overviewRows = (numJobs + overviewColumns - 1) / overviewColumns;
+    const uint thumbnailWidth = (jobFile.width + 1) / 2;
+    const uint thumbnailHeight = (jobFile.height + 1) / 2;
+    Image overview( overviewColumns * thumbnailWidth, overviewRows * thumbnailHeight );
+    overview.Clear( Vec4( 0.0f ) );
+
+    const float largestAbsoluteNoiseValue = textures.noiseVolume.GetLargestAbsoluteValue();
+
+    CpuRenderSettings renderSettings;
+    renderSettings.tileSize = jobFile.tileSize;
+    renderSettings.marchMode = jobFile.marchMode;
+    const CpuRenderer renderer( renderSettings );
+
+    // Frames are the unit of work: each one is rendered start to finish by a single
+    //  thread, which keeps all the cores busy without any per-tile synchronisation.
+    std::vector<Image> threadImages( pool.GetNumThreads() );
+    std::mutex jobMutex;
+    bool succeeded = true;
+
+    Timer batchTimer;
+    pool.ParallelFor( numFrames, [&]( uint frameIndex, uint threadIndex )
+    {
+        const uint jobIndex = frameIndex / numSamples;
+        const uint sampleIndex = frameIndex % numSamples;
+        const uint cameraIndex = sampleIndex / numTimes;
+        const uint timeIndex = sampleIndex % numTimes;
+
+        ExplosionSettings settings;
+        std::vector<float> values;
+        jobFile.GetJobSettings( jobIndex, settings, values );
+
+        ExplosionParams params;
+        BuildExplosionParams( settings, jobFile.cameras[cameraIndex], jobFile.times[timeIndex], jobFile.width, jobFile.height,
+                              largestAbsoluteNoiseValue, params );
+
+        Image& frame = threadImages[threadIndex];
+        RenderStats stats;
+        renderer.RenderFrame( params, textures, frame, nullptr, &stats );
+
+        std::lock_guard<std::mutex> lock( jobMutex );
+
+        BatchJobState& job = jobs[jobIndex];
+        job.stats.Accumulate( stats );
+        if( stats.milliseconds < job.minMilliseconds ) job.minMilliseconds = stats.milliseconds;
+        if( stats.milliseconds > job.maxMilliseconds ) job.maxMilliseconds = stats.milliseconds;
+
+        if( job.contactSheet.GetWidth() == 0 )
+        {
+            job.contactSheet.Resize( numTimes * jobFile.width, (uint)jobFile.cameras.size() * jobFile.height );
+        }
+        job.contactSheet.BlitScaled( frame, timeIndex * jobFile.width, cameraIndex * jobFile.height, jobFile.width, jobFile.height );
+
+        if( sampleIndex == 0 )
+        {
+            overview.BlitScaled( frame, (jobIndex % overviewColumns) * thumbnailWidth, (jobIndex / overviewColumns) * thumbnailHeight,
+                                 thumbnailWidth, thumbnailHeight );
+        }
+
+        if( --job.framesRemaining == 0 )
+        {
+            char name[64];
+            sprintf( name, "job_%04u.ppm", jobIndex );
+            if( !job.contactSheet.WritePPM( MakeOutputPath( jobFile, name ).c_str() ) ) succeeded = false;
+
+            // Release the sheet; only the jobs in flight hold one.
+            Image empty;
+            std::swap( job.contactSheet, empty );
+        }
+    } );
+    const double batchSeconds = batchTimer.GetElapsedSeconds();
+
+    if( !overview.WritePPM( MakeOutputPath( jobFile, "overview.ppm" ).c_str() ) ) succeeded = false;
+
+    FILE* pTiming = fopen( MakeOutputPath( jobFile, "timing.csv" ).c_str(), "w" );
+    if( pTiming )
+    {
+        fprintf( pTiming, "job" );
+        for(uint i=0 ; i<jobFile.parameters.size() ; i++) fprintf( pTiming, ",%s", jobFile.GetParameterName( i ) );
+        fprintf( pTiming, ",frames,total_ms,mean_ms,min_ms,max_ms,rays,steps,steps_per_ray\n" );
+
+        for(uint jobIndex=0 ; jobIndex<numJobs ; jobIndex++)
+        {
+            ExplosionSettings settings;
+            std::vector<float> values;
+            jobFile.GetJobSettings( jobIndex, settings, values );
+
+            const BatchJobState& job = jobs[jobIndex];
+            fprintf( pTiming, "%u", jobIndex );
+            for(size_t i=0 ; i<values.size() ; i++) fprintf( pTiming, ",%g", values[i] );
+            fprintf( pTiming, ",%u,%.3f,%.3f,%.3f,%.3f,%llu,%llu,%.2f\n",
+                     numSamples, job.stats.milliseconds, job.stats.milliseconds / numSamples, job.minMilliseconds, job.maxMilliseconds,
+                     (unsigned long long)job.stats.numRays, (unsigned long long)job.stats.numSteps,
+                     job.stats.numRays ? (double)job.stats.numSteps / job.stats.numRays : 0.0 );
+        }
+        fclose( pTiming );
+    }
+    else
+    {
+        succeeded = false;
+    }
+
+    printf( "Rendered %u frames in %.2fs (%.2f frames/s).  Results written to %s.\n",
+            numFrames, batchSeconds, numFrames / batchSeconds, jobFile.outputDirectory.c_str() );
+
+    return succeeded;
+}
+
+int BatchMain( const CommandLine& commandLine )
+{
+    const char* pJobFileName = commandLine.GetPositional( 0 );
+    if( !pJobFileName )
+    {
+        fprintf( stderr, "Usage: batch <jobfile>\n" );
+        return 1;
+    }
+
+    BatchJobFile jobFile;
+    std::string error;
+    if( !jobFile.Load( pJobFileName, error ) )
+    {
+        fprintf( stderr, "%s\n", error.c_str() );
+        return 1;
+    }
+
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    ThreadPool pool( commandLine.GetUint( "threads", jobFile.numThreads ) );
+    return RunBatch( jobFile, textures, pool ) ? 0 : 1;
+}
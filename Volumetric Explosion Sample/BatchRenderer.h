@@ -0,0 +1,75 @@
+#ifndef BATCH_RENDERER_H
+#define BATCH_RENDERER_H
+
+//--------------------------------------------------------------------------------------
+// Parameter sweep renderer.  A job file describes a grid of explosion parameters
+//  plus the camera and time samples to render for every point on the grid, e.g.
+//
+//      # Lines starting with '#' are comments.
+//      output      sweep
+//      resolution  200 160
+//      march       wavefront               # or tiles (the default)
+//      EdgeSoftness 0.02 0.05 0.1          # explicit values
+//      NoiseScale   range 0.02 0.06 3      # start, end, count
+//      camera      0 60 10                 # theta and phi in degrees, radius
+//      camera      90 60 10
+//      time        range 0 4 5
+//
+//  Each point on the grid is a job.  A job renders every camera/time pair into a
+//  contact sheet (one row per camera, one column per time) and all jobs are
+//  summarised in overview.ppm and timing.csv.
+//
+//  Sweepable parameters, named after the AntTweakBar controls: EdgeSoftness, Radius,
+//  Displacement, AmplitudeFactor, FrequencyFactor, NoiseScale, UvScale, UvBias,
+//  TightHull, AdaptiveHull, AdaptiveSteps, OctaveCulling, DitheredStart, StepScale and
+//  Primitive (0-4, see PrimitiveType).
+//--------------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+
+#include "CpuRenderer.h"
+#include "ExplosionSettings.h"
+
+class CommandLine;
+class ThreadPool;
+struct SceneTextures;
+
+struct BatchParameter
+{
+    uint descIndex;
+    std::vector<float> values;
+};
+
+struct BatchJobFile
+{
+    std::string outputDirectory;
+    uint width, height;
+    uint numThreads;
+    uint tileSize;
+    CpuMarchMode marchMode;
+
+    ExplosionSettings baseSettings;
+    std::vector<BatchParameter> parameters;
+    std::vector<OrbitCamera> cameras;
+    std::vector<float> times;
+
+    BatchJobFile();
+
+    // Returns false and fills in the error on a malformed file.
+    bool Load( const char* pFileName, std::string& error );
+
+    uint GetNumJobs() const;
+    uint GetNumSamplesPerJob() const { return (uint)(cameras.size() * times.size()); }
+
+    // The settings for one point of the parameter grid.
+    void GetJobSettings( uint jobIndex, ExplosionSettings& settings, std::vector<float>& values ) const;
+
+    const char* GetParameterName( uint parameterIndex ) const;
+};
+
+// Renders every job on the pool, sharing the scene textures between all of them.
+bool RunBatch( const BatchJobFile& jobFile, const SceneTextures& textures, ThreadPool& pool );
+
+int BatchMain( const CommandLine& commandLine );
+
+#endif // BATCH_RENDERER_H
@@ -0,0 +1,324 @@
+#include "BlueNoise.h"
+#include "CpuMath.h"
+#include "Headless.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <utility>
+
+// Standard deviation of the Gaussian, in texels, that measures how crowded a texel's
+//  neighbourhood is; Ulichney's 1.5.
+static const float kClusterSigma = 1.5f;
+
+// Share of the texels set in the initial binary pattern.
+static const float kInitialDensity = 0.1f;
+
+namespace
+{
+    uint32_t NextRandom( uint32_t& state )
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // A binary pattern and the energy of every texel: the sum of a toroidal Gaussian
+    //  about each set texel.  The tightest cluster is the set texel of highest
+    //  energy, the largest void the clear texel of lowest.
+    class EnergyField
+    {
+    public:
+        EnergyField( uint size, ThreadPool* pPool )
+            : m_Size(size)
+            , m_Mask(size - 1)
+            , m_pPool(pPool)
+            , m_NumBands(pPool ? std::min( pPool->GetNumThreads() * 4, size ) : 1)
+            , m_Kernel(size * size)
+            , m_Energy(size * size, 0.0f)
+            , m_Pattern(size * size, 0)
+            , m_BandBest(m_NumBands)
+        {
+            for(uint y=0 ; y<size ; y++)
+            {
+                for(uint x=0 ; x<size ; x++)
+                {
+                    const float dx = (float)std::min( x, size - x );
+                    const float dy = (float)std::min( y, size - y );
+                    m_Kernel[y * size + x] = expf( -(dx * dx + dy * dy) / (2.0f * kClusterSigma * kClusterSigma) );
+                }
+            }
+        }
+
+        bool IsSet( uint index ) const { return m_Pattern[index] != 0; }
+
+        void Toggle( uint index )
+        {
+            const uint qx = index & m_Mask, qy = index / m_Size;
+            const float sign = m_Pattern[index] ? -1.0f : 1.0f;
+            m_Pattern[index] ^= 1;
+
+            ForEachBand( [&]( uint y0, uint y1, uint )
+            {
+                for(uint y=y0 ; y<y1 ; y++)
+                {
+                    const float* pKernelRow = &m_Kernel[((y - qy) & m_Mask) * m_Size];
+                    float* pEnergyRow = &m_Energy[y * m_Size];
+                    for(uint x=0 ; x<m_Size ; x++) pEnergyRow[x] += sign * pKernelRow[(x - qx) & m_Mask];
+                }
+            } );
+        }
+
+        uint FindTightestCluster() { return FindExtreme( true ); }
+        uint FindLargestVoid() { return FindExtreme( false ); }
+
+    private:
+        // The set texel of highest energy, or the clear texel of lowest; ties go to
+        //  the first in raster order, so the mask does not depend on the thread count.
+        uint FindExtreme( bool findCluster )
+        {
+            ForEachBand( [&]( uint y0, uint y1, uint band )
+            {
+                uint bestIndex = m_Size * m_Size;
+                float bestEnergy = 0;
+                for(uint index=y0*m_Size ; index<y1*m_Size ; index++)
+                {
+                    if( (m_Pattern[index] != 0) != findCluster ) continue;
+
+                    const float energy = findCluster ? m_Energy[index] : -m_Energy[index];
+                    if( bestIndex == m_Size * m_Size || energy > bestEnergy )
+                    {
+                        bestIndex = index;
+                        bestEnergy = energy;
+                    }
+                }
+                m_BandBest[band] = std::make_pair( bestIndex, bestEnergy );
+            } );
+
+            uint bestIndex = m_Size * m_Size;
+            float bestEnergy = 0;
+            for(uint band=0 ; band<m_NumBands ; band++)
+            {
+                if( m_BandBest[band].first == m_Size * m_Size ) continue;
+                if( bestIndex == m_Size * m_Size || m_BandBest[band].second > bestEnergy )
+                {
+                    bestIndex = m_BandBest[band].first;
+                    bestEnergy = m_BandBest[band].second;
+                }
+            }
+            return bestIndex;
+        }
+
+        // Splits the rows into m_NumBands bands and calls job( y0, y1, band ) for each.
+        template<typename Job>
+        void ForEachBand( const Job& job )
+        {
+            if( !m_pPool )
+            {
+                job( 0, m_Size, 0 );
+                return;
+            }
+
+            const uint size = m_Size, numBands = m_NumBands;
+            m_pPool->ParallelFor( numBands, [&]( uint band, uint )
+            {
+                job( band * size / numBands, (band + 1) * size / numBands, band );
+            } );
+        }
+
+        uint m_Size;
+        uint m_Mask;
+        ThreadPool* m_pPool;
+        uint m_NumBands;
+        std::vector<float> m_Kernel;
+        std::vector<float> m_Energy;
+        std::vector<uint8_t> m_Pattern;
+        std::vector<std::pair<uint, float> > m_BandBest;
+    };
+}
+
+BlueNoiseMask::BlueNoiseMask()
+    : m_Size(0)
+    , m_Mask(0)
+{
+}
+
+void BlueNoiseMask::SetRanks( uint size, const std::vector<uint>& ranks )
+{
+    m_Size = size;
+    m_Mask = size - 1;
+    m_Texels.resize( size * size );
+    for(uint i=0 ; i<size*size ; i++) m_Texels[i] = (uint8_t)((uint64_t)ranks[i] * 256 / (size * size));
+}
+
+bool BlueNoiseMask::Generate( uint size, ThreadPool* pPool )
+{
+    if( size < 4 || (size & (size - 1)) != 0 ) return false;
+
+    const uint numTexels = size * size;
+    const uint numInitial = std::max( (uint)(numTexels * kInitialDensity), 1u );
+    EnergyField field( size, pPool );
+
+    // Initial binary pattern: random texels, then repeatedly move the tightest
+    //  cluster into the largest void until the move would put it back.
+    uint32_t randomState = 0x9E3779B9;
+    for(uint numSet=0 ; numSet<numInitial ; )
+    {
+        const uint index = NextRandom( randomState ) % numTexels;
+        if( field.IsSet( index ) ) continue;
+        field.Toggle( index );
+        numSet++;
+    }
+    for(uint i=0 ; i<numTexels ; i++)
+    {
+        const uint cluster = field.FindTightestCluster();
+        field.Toggle( cluster );
+        const uint largestVoid = field.FindLargestVoid();
+        field.Toggle( largestVoid );
+        if( largestVoid == cluster ) break;
+    }
+
+    std::vector<uint> ranks( numTexels );
+
+    // Ranks below the initial pattern's: take away the tightest cluster each time.
+    EnergyField removing = field;
+    for(uint rank=numInitial ; rank-->0 ; )
+    {
+        const uint cluster = removing.FindTightestCluster();
+        removing.Toggle( cluster );
+        ranks[cluster] = rank;
+    }
+
+    // Ranks above: fill in the largest void each time.  Ulichney switches to
+    //  removing clusters of clear texels past half way, but the Gaussians over all
+    //  texels sum to a constant, so that cluster is this void.
+    for(uint rank=numInitial ; rank<numTexels ; rank++)
+    {
+        const uint largestVoid = field.FindLargestVoid();
+        field.Toggle( largestVoid );
+        ranks[largestVoid] = rank;
+    }
+
+    SetRanks( size, ranks );
+    return true;
+}
+
+bool BlueNoiseMask::GenerateWhiteNoise( uint size, uint32_t seed )
+{
+    if( size < 4 || (size & (size - 1)) != 0 ) return false;
+
+    std::vector<uint> ranks( size * size );
+    for(uint i=0 ; i<size*size ; i++) ranks[i] = i;
+
+    uint32_t randomState = seed ? seed : 1;
+    for(uint i=size*size-1 ; i>0 ; i--) std::swap( ranks[i], ranks[NextRandom( randomState ) % (i + 1)] );
+
+    SetRanks( size, ranks );
+    return true;
+}
+
+bool BlueNoiseMask::Save( const char* pFileName ) const
+{
+    if( m_Texels.empty() ) return false;
+
+    FILE* pFile = fopen( pFileName, "wb" );
+    if( !pFile ) return false;
+
+    fprintf( pFile, "P5\n%u %u\n255\n", m_Size, m_Size );
+    const bool succeeded = fwrite( &m_Texels[0], 1, m_Texels.size(), pFile ) == m_Texels.size();
+
+    fclose( pFile );
+    return succeeded;
+}
+
+bool BlueNoiseMask::Load( const char* pFileName )
+{
+    FILE* pFile = fopen( pFileName, "rb" );
+    if( !pFile ) return false;
+
+    uint width = 0, height = 0, maxValue = 0;
+    bool succeeded = fscanf( pFile, "P5 %u %u %u", &width, &height, &maxValue ) == 3 && fgetc( pFile ) != EOF;
+    succeeded = succeeded && width == height && width >= 4 && (width & (width - 1)) == 0 && maxValue == 255;
+
+    std::vector<uint8_t> texels( width * height );
+    succeeded = succeeded && fread( &texels[0], 1, texels.size(), pFile ) == texels.size();
+    fclose( pFile );
+
+    if( !succeeded ) return false;
+
+    m_Size = width;
+    m_Mask = width - 1;
+    m_Texels.swap( texels );
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// Headless tool
+//--------------------------------------------------------------------------------------
+
+// Standard deviation of the mask after a (2r+1)^2 box filter, with wrap addressing.
+//  White noise keeps 1/(2r+1) of its spread; blue noise, with little energy at low
+//  frequencies, far less.
+static float GetFilteredDeviation( const BlueNoiseMask& mask, int radius )
+{
+    const int size = (int)mask.GetSize();
+    const float normalisation = 1.0f / ((2 * radius + 1) * (2 * radius + 1));
+
+    double sum = 0, sumSquares = 0;
+    for(int y=0 ; y<size ; y++)
+    {
+        for(int x=0 ; x<size ; x++)
+        {
+            float filtered = 0;
+            for(int dy=-radius ; dy<=radius ; dy++)
+            {
+                for(int dx=-radius ; dx<=radius ; dx++) filtered += mask.Fetch( (uint)(x + dx + size), (uint)(y + dy + size) );
+            }
+            filtered *= normalisation;
+            sum += filtered;
+            sumSquares += filtered * filtered;
+        }
+    }
+
+    const double mean = sum / (size * size);
+    return (float)sqrt( Max( (float)(sumSquares / (size * size) - mean * mean), 0.0f ) );
+}
+
+int BlueNoiseMain( const CommandLine& commandLine )
+{
+    const char* pOutputFileName = commandLine.GetPositional( 0 );
+    if( !pOutputFileName )
+    {
+        fprintf( stderr, "Usage: blue-noise <output.pgm> [-size n]\n" );
+        return 1;
+    }
+
+    const uint size = commandLine.GetUint( "size", BLUE_NOISE_SIZE );
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+
+    Timer timer;
+    BlueNoiseMask blueNoise;
+    if( !blueNoise.Generate( size, &pool ) )
+    {
+        fprintf( stderr, "The mask size must be a power of two, at least 4.\n" );
+        return 1;
+    }
+    const double milliseconds = timer.GetElapsedMilliseconds();
+
+    BlueNoiseMask whiteNoise;
+    whiteNoise.GenerateWhiteNoise( size, 1 );
+
+    printf( "%ux%u void-and-cluster mask in %.1f ms on %u threads\n", size, size, milliseconds, pool.GetNumThreads() );
+    printf( "Filtered deviation, blue / white: 3x3 %.4f / %.4f, 5x5 %.4f / %.4f\n", GetFilteredDeviation( blueNoise, 1 ), GetFilteredDeviation( whiteNoise, 1 ),
+            GetFilteredDeviation( blueNoise, 2 ), GetFilteredDeviation( whiteNoise, 2 ) );
+
+    if( !blueNoise.Save( pOutputFileName ) )
+    {
+        fprintf( stderr, "Failed to write '%s'.\n", pOutputFileName );
+        return 1;
+    }
+    return 0;
+}
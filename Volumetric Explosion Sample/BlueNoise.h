@@ -0,0 +1,62 @@
+#ifndef BLUE_NOISE_H
+#define BLUE_NOISE_H
+
+//--------------------------------------------------------------------------------------
+// Tileable blue-noise dither mask for offsetting the start of each pixel's ray
+//  march (g_DitheredStart).  Every ray starting exactly on the hull makes the steps
+//  line up into visible slices once the step is more than a fraction of the
+//  detail; a per-pixel offset of a random fraction of a step breaks the slices up
+//  into noise, and blue noise keeps that noise at high frequencies, where it is
+//  least visible and blurs away.
+//
+//  The mask is built with Ulichney's void-and-cluster method: every texel gets a
+//  distinct rank, placed in the largest gap (void) left by the texels ranked
+//  before it, measured by a toroidal Gaussian so that the mask tiles.
+//--------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <vector>
+
+#include "Common.h"
+
+class CommandLine;
+class ThreadPool;
+
+class BlueNoiseMask
+{
+public:
+    BlueNoiseMask();
+
+    // Runs void-and-cluster for a size x size mask; size must be a power of two.
+    //  The energy updates are spread across the pool when one is given.
+    bool Generate( uint size, ThreadPool* pPool );
+
+    // The same ranks in a random order: white noise with the mask's histogram,
+    //  for comparison.
+    bool GenerateWhiteNoise( uint size, uint32_t seed );
+
+    // Binary PGM of the R8_UNORM texels, so that the mask can be cached and viewed.
+    bool Save( const char* pFileName ) const;
+    bool Load( const char* pFileName );
+
+    uint GetSize() const { return m_Size; }
+
+    // R8_UNORM texels, row by row, for uploading.
+    const uint8_t* GetTexels() const { return m_Texels.empty() ? nullptr : &m_Texels[0]; }
+
+    // The texel covering pixel (x, y) with wrap addressing, read as UNORM.
+    float Fetch( uint x, uint y ) const
+    {
+        return m_Texels[(y & m_Mask) * m_Size + (x & m_Mask)] * (1.0f / 255.0f);
+    }
+
+private:
+    void SetRanks( uint size, const std::vector<uint>& ranks );
+
+    uint m_Size;
+    uint m_Mask;
+    std::vector<uint8_t> m_Texels;
+};
+
+int BlueNoiseMain( const CommandLine& commandLine );
+
+#endif // BLUE_NOISE_H
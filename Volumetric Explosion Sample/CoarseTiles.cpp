@@ -0,0 +1,145 @@
+#include "CoarseTiles.h"
+#include "CpuRenderer.h"
+#include "FrameArena.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <math.h>
+
+// Share of the full displacement that the octaves from g_NumHullOctaves on can add.
+//  Every octave peaks at the same largest noise value, so it cancels.
+static float GetRemainingDisplacementFraction( const ExplosionParams& params )
+{
+    float amplitude = params.g_NoiseInitialAmplitude;
+    float sumAll = 0, sumRemaining = 0;
+    for(uint i=0 ; i<params.g_NumOctaves ; i++)
+    {
+        sumAll += amplitude;
+        if( i >= params.g_NumHullOctaves ) sumRemaining += amplitude;
+        amplitude *= params.g_NoiseAmplitudeFactor;
+    }
+    return sumAll > 0.0f ? sumRemaining / sumAll : 0.0f;
+}
+
+CoarseTile ClassifyCoarseTile( const ExplosionEvaluator& evaluator, uint x0, uint y0, uint x1, uint y1, uint& coarseSteps )
+{
+    const ExplosionParams& params = evaluator.GetParams();
+
+    CoarseTile tile;
+    tile.tileClass = kCoarseTileEmpty;
+    tile.nearD = tile.farD = 0.0f;
+
+    float nearD, farD;
+    if( !GetTileRayInterval( params, x0, y0, x1, y1, nearD, farD ) ) return tile;
+
+    // Every ray of the tile lies within depth * halfDiagonalPerDepth of the centre ray.
+    const Vec3 rayDirectionWS = GetRayDirectionWS( params, (x0 + x1) * 0.5f, (y0 + y1) * 0.5f );
+    const Vec3 eyePositionWS( params.g_EyePositionWS );
+    const float halfDiagonalPerDepth = 0.5f * sqrtf( (float)((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0)) ) * params.g_PixelSizePerDepthWS;
+
+    const float stepD = params.g_StepSizeWS * kCoarseStepScale;
+    const float halfStepWS = 0.5f * stepD * Length( rayDirectionWS );
+    const float remainingWS = GetRemainingDisplacementFraction( params ) * fabsf( params.g_DisplacementWS );
+    const float edgeOuter = 0.5f + params.g_EdgeSoftness;
+    const float edgeInner = 0.5f - params.g_EdgeSoftness;
+    const float opaqueAlpha = kCoarseOpaqueAlpha * params.g_Opacity;
+    const float stepOpacityScale = kCoarseStepScale * params.g_StepOpacityScale;
+
+    // Each sample stands for the interval of half a coarse step either side of it.
+    float firstNearD = -1.0f, lastNearD = -1.0f;
+    float minAlpha = 0;
+    for(float depth=nearD+0.5f*stepD ; depth<farD+0.5f*stepD ; depth+=stepD)
+    {
+        coarseSteps++;
+
+        float displacement;
+        const float distance = evaluator.DisplacedPrimitive( rayDirectionWS * depth + eyePositionWS, evaluator.GetExplosionPositionWS(),
+                                                             evaluator.GetInnerRadius(), params.g_DisplacementWS, params.g_NumHullOctaves, displacement );
+        const float reachWS = kCoarseDistanceSlope * (depth * halfDiagonalPerDepth + halfStepWS);
+
+        if( distance - remainingWS - reachWS <= edgeOuter )
+        {
+            if( firstNearD < 0.0f ) firstNearD = depth - 0.5f * stepD;
+            lastNearD = depth + 0.5f * stepD;
+        }
+
+        // The least alpha any ray of the tile gathers over the interval: the
+        //  remaining octaves only add displacement, so only the reach thins it.
+        const float edgeFade = Smoothstep( edgeOuter, edgeInner, distance + reachWS );
+        if( edgeFade > 0.0f )
+        {
+            const float alpha = evaluator.MapDisplacementToColour( displacement, Vec2( params.g_UvScaleBias.x, params.g_UvScaleBias.y ) ).w * edgeFade;
+            minAlpha = 1.0f - (1.0f - minAlpha) * (1.0f - AdjustAlphaForStep( alpha, stepOpacityScale ));
+            if( minAlpha >= opaqueAlpha )
+            {
+                tile.tileClass = kCoarseTileOpaque;
+                tile.nearD = Max( firstNearD, nearD );
+                tile.farD = depth + 0.5f * stepD;
+                return tile;
+            }
+        }
+    }
+
+    if( firstNearD >= 0.0f )
+    {
+        tile.tileClass = kCoarseTileComplex;
+        tile.nearD = Max( firstNearD, nearD );
+        tile.farD = Min( lastNearD, farD );
+    }
+    return tile;
+}
+
+CoarseTileMap::CoarseTileMap()
+    : m_NumTilesX(0)
+    , m_NumTilesY(0)
+    , m_pTiles(nullptr)
+    , m_NumCoarseSteps(0)
+{
+}
+
+void CoarseTileMap::Classify( const ExplosionEvaluator& evaluator, ThreadPool* pPool, LinearArena& arena )
+{
+    const uint width = (uint)evaluator.GetParams().g_ScreenParams.x;
+    const uint height = (uint)evaluator.GetParams().g_ScreenParams.y;
+    m_NumTilesX = (width + kCoarseTileSize - 1) / kCoarseTileSize;
+    m_NumTilesY = (height + kCoarseTileSize - 1) / kCoarseTileSize;
+    m_pTiles = arena.AllocateArray<CoarseTile>( m_NumTilesX * m_NumTilesY );
+
+    const uint numThreads = pPool ? pPool->GetNumThreads() : 1;
+    uint64_t* pThreadSteps = arena.AllocateArray<uint64_t>( numThreads );
+
+    auto classifyRow = [&]( uint tileY, uint threadIndex )
+    {
+        const uint y0 = tileY * kCoarseTileSize;
+        const uint y1 = std::min( y0 + kCoarseTileSize, height );
+        uint coarseSteps = 0;
+        for(uint tileX=0 ; tileX<m_NumTilesX ; tileX++)
+        {
+            const uint x0 = tileX * kCoarseTileSize;
+            m_pTiles[tileY * m_NumTilesX + tileX] = ClassifyCoarseTile( evaluator, x0, y0, std::min( x0 + kCoarseTileSize, width ), y1, coarseSteps );
+        }
+        pThreadSteps[threadIndex] += coarseSteps;
+    };
+
+    if( pPool )
+    {
+        pPool->ParallelFor( m_NumTilesY, classifyRow );
+    }
+    else
+    {
+        for(uint tileY=0 ; tileY<m_NumTilesY ; tileY++) classifyRow( tileY, 0 );
+    }
+
+    m_NumCoarseSteps = 0;
+    for(uint i=0 ; i<numThreads ; i++) m_NumCoarseSteps += pThreadSteps[i];
+}
+
+uint CoarseTileMap::GetNumTiles( CoarseTileClass tileClass ) const
+{
+    uint numTiles = 0;
+    for(uint i=0 ; i<m_NumTilesX * m_NumTilesY ; i++)
+    {
+        if( m_pTiles[i].tileClass == tileClass ) numTiles++;
+    }
+    return numTiles;
+}
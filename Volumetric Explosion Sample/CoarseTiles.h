@@ -0,0 +1,81 @@
+#ifndef COARSE_TILES_H
+#define COARSE_TILES_H
+
+//--------------------------------------------------------------------------------------
+// Coarse pass for the CPU renderer.  Before any pixel is marched, one ray through
+//  the centre of every kCoarseTileSize^2 pixel tile is marched with g_NumHullOctaves
+//  octaves at kCoarseStepScale times the step.  Each sample bounds what any ray of
+//  the tile can see nearby: the octaves left out can only pull the surface in by
+//  their largest displacement, and moving across the tile or along the step can
+//  change the distance by at most kCoarseDistanceSlope times as far.
+//
+//  A tile is then
+//   - empty, if no sample could come within the soft edge: the fine pass skips it;
+//   - opaque, if even the thinnest ray of the tile is opaque by some depth: the
+//     fine pass marches only from the first sample near the surface to that depth;
+//   - complex otherwise: the fine pass marches the full interval, trimmed to the
+//     samples near the surface.
+//--------------------------------------------------------------------------------------
+#include <stdint.h>
+
+#include "CpuExplosion.h"
+
+class LinearArena;
+class ThreadPool;
+
+const uint kCoarseTileSize = 8;
+const float kCoarseStepScale = 2.0f;
+
+// Largest change in the hull octaves' distance per world unit moved.  The primitive
+//  on its own changes by one; the first octaves' noise adds at most as much again.
+const float kCoarseDistanceSlope = 2.0f;
+
+// Accumulated alpha, as a share of g_Opacity, past which a tile counts as opaque.
+//  The fine march stops there, dropping what lies behind: at most the remainder.
+const float kCoarseOpaqueAlpha = 0.99f;
+
+enum CoarseTileClass
+{
+    kCoarseTileEmpty,
+    kCoarseTileOpaque,
+    kCoarseTileComplex
+};
+
+// A tile's class and the view depth interval its rays need to march.
+struct CoarseTile
+{
+    CoarseTileClass tileClass;
+    float nearD, farD;
+};
+
+// Classifies the tile [x0, x1) x [y0, y1) with one coarse ray, adding the samples
+//  it took to coarseSteps.
+CoarseTile ClassifyCoarseTile( const ExplosionEvaluator& evaluator, uint x0, uint y0, uint x1, uint y1, uint& coarseSteps );
+
+class CoarseTileMap
+{
+public:
+    CoarseTileMap();
+
+    // Classifies every tile of the frame in g_ScreenParams, rows of tiles spread
+    //  across the pool when one is given.  The tiles are allocated from the arena
+    //  and valid until it is reset.
+    void Classify( const ExplosionEvaluator& evaluator, ThreadPool* pPool, LinearArena& arena );
+
+    uint GetNumTilesX() const { return m_NumTilesX; }
+    uint GetNumTilesY() const { return m_NumTilesY; }
+    const CoarseTile& GetTile( uint tileX, uint tileY ) const { return m_pTiles[tileY * m_NumTilesX + tileX]; }
+    const CoarseTile& GetPixelTile( uint x, uint y ) const { return GetTile( x / kCoarseTileSize, y / kCoarseTileSize ); }
+
+    uint GetNumTiles( CoarseTileClass tileClass ) const;
+
+    // Coarse samples taken by the last Classify.
+    uint64_t GetNumCoarseSteps() const { return m_NumCoarseSteps; }
+
+private:
+    uint m_NumTilesX, m_NumTilesY;
+    CoarseTile* m_pTiles;
+    uint64_t m_NumCoarseSteps;
+};
+
+#endif // COARSE_TILES_H
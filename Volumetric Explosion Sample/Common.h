@@ -8,15 +8,36 @@
 #define S_BILINEAR_WRAPPED_SAMPLER      1
 
 #define B_EXPLOSION_PARAMS              0
+#define B_IMPOSTOR_PARAMS               1
 #define T_NOISE_VOLUME                  0
 #define T_GRADIENT_TEX                  1
+#define T_IMPOSTOR_COLOUR               2
+#define T_IMPOSTOR_DEPTH                3
+#define T_TRANSMITTANCE_VOLUME          4
+#define T_BLUE_NOISE                    5
+#define T_NOISE_VALUE_GRADIENT_VOLUME   6
 
 #define PI      (3.14159265359f)
 
-#ifdef WIN32
+// Width and height of the tileable blue-noise mask offsetting ray starts (g_DitheredStart).
+#define BLUE_NOISE_SIZE                 64
+
+// Adaptive ray marching (g_AdaptiveStepping), as multiples of g_StepSizeWS.
+#define ADAPTIVE_MIN_STEP_SCALE         (0.5f)      // Across the soft edge band.
+#define ADAPTIVE_MAX_STEP_SCALE         (4.0f)      // Through empty space and once nearly opaque.
+#define ADAPTIVE_EMPTY_STEP_FRACTION    (0.5f)      // Share of the distance to the edge band skipped per step.
+#define ADAPTIVE_OPAQUE_ALPHA           (0.8f)      // Accumulated alpha, over g_Opacity, at which steps start to grow.
+
+// Octave culling (g_OctaveCulling).  An octave is skipped once its relative amplitude
+//  times the ray's remaining transmittance falls below this.
+#define OCTAVE_CULL_MIN_CONTRIBUTION    (0.02f)
+
+#if defined(WIN32) || defined(_WIN32)
 // =======================================================================
 // C++ ONLY
 // =======================================================================
+#include <directxmath.h>
+
 #define CONSTANT_BUFFER( name, reg ) __declspec(align(16)) struct name
 
 typedef DirectX::XMFLOAT4X4 float4x4;
@@ -30,6 +51,24 @@ typedef DirectX::XMUINT3 uint3;
 typedef DirectX::XMUINT2 uint2;
 typedef unsigned int uint;
 
+#elif !HLSL
+// =======================================================================
+// C++ ONLY (portable)
+// The headless CPU tools also build on non-Windows hosts, where DirectXMath
+//  is unavailable.  These mirror the layout of the XMFLOAT* types above.
+// =======================================================================
+#define CONSTANT_BUFFER( name, reg ) struct __attribute__((aligned(16))) name
+
+struct float2 { float x, y; float2() {} float2( float _x, float _y ) : x(_x), y(_y) {} };
+struct float3 { float x, y, z; float3() {} float3( float _x, float _y, float _z ) : x(_x), y(_y), z(_z) {} };
+struct float4 { float x, y, z, w; float4() {} float4( float _x, float _y, float _z, float _w ) : x(_x), y(_y), z(_z), w(_w) {} };
+struct float4x4 { float m[4][4]; };
+
+struct uint2 { unsigned int x, y; };
+struct uint3 { unsigned int x, y, z; };
+struct uint4 { unsigned int x, y, z, w; };
+typedef unsigned int uint;
+
 #endif 
 
 
@@ -99,6 +138,47 @@ CONSTANT_BUFFER( ExplosionParams, B_EXPLOSION_PARAMS )
     uint g_NumHullOctaves;
     uint g_NumHullSteps;
     float g_TessellationFactor;
+
+    float3 g_LightDirectionWS;
+    float g_SelfShadowing;
+
+    float3 g_TransmittanceMinWS;
+    float g_TransmittanceInvSizeWS;
+
+    float2 g_NoiseValueScaleBias;       // Dequantises the noise volume; (1, 0) for R16_FLOAT.
+    float g_HullConvergenceWS;          // Shrink-wrapping stops once a step is shorter; 0 always takes g_NumHullSteps.
+    uint g_AdaptiveStepping;            // 1 varies the march step with density, see AdaptiveStepScale.
+
+    uint g_OctaveCulling;               // 1 skips octaves a step cannot show, see SelectNumOctaves.
+    float g_PixelSizePerDepthWS;        // World space height of a pixel per unit of view depth.
+    float g_NoiseTexelSizeWS;           // World space size of a noise texel in the first octave.
+    float g_NoiseMeanAbsValue;          // Mean absolute noise texel, standing in for skipped octaves.
+
+    uint g_DitheredStart;               // 1 starts each pixel's march a blue-noise fraction of a step in.
+    float g_StepOpacityScale;           // g_StepSizeWS over kStepSize; each step's alpha is stretched to match.
+    float2 g_DitherPadding;
+};
+
+// Billboard drawn in place of the volume once the explosion covers little of the screen.
+CONSTANT_BUFFER( ImpostorParams, B_IMPOSTOR_PARAMS )
+{
+    float4x4 g_ImpostorWorldToProjectionMatrix;
+
+    float3 g_ImpostorCentreWS;
+    float g_ImpostorHalfExtentWS;
+
+    float3 g_ImpostorRightWS;
+    float g_ImpostorFrameBlend;
+
+    float3 g_ImpostorUpWS;
+    float g_ImpostorNearDepthVS;
+
+    float4 g_ImpostorFrame0ScaleBias;
+    float4 g_ImpostorFrame1ScaleBias;
+    float4 g_ImpostorProjectionParams;
+
+    float g_ImpostorDepthRangeVS;
+    float3 g_ImpostorPadding;
 };
 
 
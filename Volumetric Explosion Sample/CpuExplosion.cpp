@@ -0,0 +1,254 @@
+#include "CpuExplosion.h"
+#include "TransmittanceVolume.h"
+
+float Box( const Vec3& relativePosWS, const Vec3& b )
+{
+    const Vec3 d = Abs( relativePosWS ) - b;
+    return Min( Max( d.x, Max( d.y, d.z ) ), 0.0f ) + Length( Max( d, 0.0f ) );
+}
+
+float Torus( const Vec3& relativePosWS, float radiusWS )
+{
+    const Vec2 t( radiusWS, radiusWS * 0.01f );
+    const Vec2 q( Length( Vec2( relativePosWS.x, relativePosWS.z ) ) - t.x, relativePosWS.y );
+    return Length( q ) - t.y;
+}
+
+float Cone( const Vec3& relativePosWS, float radiusWS )
+{
+    float d = Length( Vec2( relativePosWS.x, relativePosWS.z ) ) - Lerp( radiusWS*0.5f, 0, (radiusWS + relativePosWS.y) / (radiusWS) );
+    d = Max( d,-relativePosWS.y - radiusWS );
+    d = Max( d, relativePosWS.y - radiusWS );
+
+    return d;
+}
+
+float Cylinder( const Vec3& relativePosWS, float radiusWS )
+{
+    const Vec2 h( radiusWS * 0.7f, radiusWS );
+    const Vec2 d( fabsf( Length( Vec2( relativePosWS.x, relativePosWS.z ) ) ) - h.x, fabsf( relativePosWS.y ) - h.y );
+    return Min( Max( d.x, d.y ), 0.0f ) + Length( Vec2( Max( d.x, 0.0f ), Max( d.y, 0.0f ) ) );
+}
+
+float Sphere( const Vec3& relativePosWS, float radiusWS )
+{
+    return Length( relativePosWS ) - radiusWS;
+}
+
+ExplosionEvaluator::ExplosionEvaluator( const ExplosionParams& params, const SceneTextures& textures, NoisePrecision noisePrecision )
+    : m_Params(params)
+    , m_Textures(textures)
+    , m_NoisePrecision(noisePrecision)
+    , m_pNoiseTrace(nullptr)
+    , m_Animation(Vec3( params.g_NoiseAnimationSpeed ) * params.g_Time)
+    , m_ExplosionPositionWS(params.g_ExplosionPositionWS)
+    , m_UvScaleBias(params.g_UvScaleBias.x, params.g_UvScaleBias.y)
+    , m_InnerRadius(params.g_ExplosionRadiusWS - params.g_DisplacementWS)
+{
+}
+
+float ExplosionEvaluator::FractalNoiseAtPositionWS( const Vec3& posWS, uint numOctaves ) const
+{
+    if( m_NoisePrecision == kNoisePrecisionHalf ) return FractalNoiseAtPositionWSHalf( posWS, numOctaves );
+
+    Vec3 uvw = posWS * m_Params.g_NoiseScale + m_Animation;
+    float amplitude = m_Params.g_NoiseInitialAmplitude;
+
+    float noiseValue = 0;
+    for(uint i=0 ; i<numOctaves ; i++)
+    {
+        noiseValue += fabsf(amplitude * Noise( uvw ));
+        amplitude *= m_Params.g_NoiseAmplitudeFactor;
+        uvw *= m_Params.g_NoiseFrequencyFactor;
+    }
+
+    return noiseValue * m_Params.g_InvMaxNoiseDisplacement;
+}
+
+// The HALF_PRECISION_NOISE version.  The texture coordinates stay fp32: by the last
+//  octave they reach tens of texels' worth of uvw, where a half's spacing is a
+//  sizeable fraction of a texel.
+float ExplosionEvaluator::FractalNoiseAtPositionWSHalf( const Vec3& posWS, uint numOctaves ) const
+{
+    Vec3 uvw = posWS * m_Params.g_NoiseScale + m_Animation;
+    const float amplitudeFactor = RoundToHalf( m_Params.g_NoiseAmplitudeFactor );
+    float amplitude = RoundToHalf( m_Params.g_NoiseInitialAmplitude );
+
+    float noiseValue = 0;
+    for(uint i=0 ; i<numOctaves ; i++)
+    {
+        noiseValue = RoundToHalf( noiseValue + fabsf( RoundToHalf( amplitude * RoundToHalf( Noise( uvw ) ) ) ) );
+        amplitude = RoundToHalf( amplitude * amplitudeFactor );
+        uvw *= m_Params.g_NoiseFrequencyFactor;
+    }
+
+    return RoundToHalf( noiseValue * RoundToHalf( m_Params.g_InvMaxNoiseDisplacement ) );
+}
+
+float ExplosionEvaluator::DisplacedPrimitive( const Vec3& posWS, const Vec3& spherePositionWS, float radiusWS, float displacementWS, uint numOctaves, float& displacementOut ) const
+{
+    const Vec3 relativePosWS = posWS - spherePositionWS;
+
+    displacementOut = FractalNoiseAtPositionWS( posWS, numOctaves );
+
+    float signedDistanceToPrimitive = 0;
+
+    switch(m_Params.g_PrimitiveIdx)
+    {
+    case 0:
+        signedDistanceToPrimitive = Sphere( relativePosWS, radiusWS );
+        break;
+    case 1:
+        signedDistanceToPrimitive = Cylinder( relativePosWS, radiusWS );
+        break;
+    case 2:
+        signedDistanceToPrimitive = Cone( relativePosWS, radiusWS );
+        break;
+    case 3:
+        signedDistanceToPrimitive = Torus( relativePosWS, radiusWS );
+        break;
+    case 4:
+        signedDistanceToPrimitive = Box( relativePosWS, Vec3( sqrtf(radiusWS*radiusWS/2) ) );
+        break;
+    }
+
+    return signedDistanceToPrimitive - displacementOut * displacementWS;
+}
+
+float ExplosionEvaluator::FractalNoiseAndGradientAtPositionWS( const Vec3& posWS, uint numOctaves, Vec3& gradientWS ) const
+{
+    Vec3 uvw = posWS * m_Params.g_NoiseScale + m_Animation;
+    float uvwPerWS = m_Params.g_NoiseScale;
+    float amplitude = m_Params.g_NoiseInitialAmplitude;
+
+    float noiseValue = 0;
+    Vec3 gradient( 0.0f );
+    for(uint i=0 ; i<numOctaves ; i++)
+    {
+        const Vec4 valueGradient = m_Textures.noiseVolume.SampleValueGradient( uvw );
+
+        // d|a n| = a sign(n) dn, and the octave's uvw changes uvwPerWS per world unit.
+        const float signedAmplitude = valueGradient.x < 0.0f ? -amplitude : amplitude;
+        noiseValue += fabsf(amplitude * valueGradient.x);
+        gradient += Vec3( valueGradient.y, valueGradient.z, valueGradient.w ) * (signedAmplitude * uvwPerWS);
+
+        amplitude *= m_Params.g_NoiseAmplitudeFactor;
+        uvw *= m_Params.g_NoiseFrequencyFactor;
+        uvwPerWS *= m_Params.g_NoiseFrequencyFactor;
+    }
+
+    gradientWS = gradient * m_Params.g_InvMaxNoiseDisplacement;
+    return noiseValue * m_Params.g_InvMaxNoiseDisplacement;
+}
+
+float ExplosionEvaluator::DisplacedPrimitiveAndGradient( const Vec3& posWS, const Vec3& spherePositionWS, float radiusWS, float displacementWS, uint numOctaves,
+                                                         float& displacementOut, Vec3& gradientOut ) const
+{
+    // With no octaves DisplacedPrimitive is the bare shape.
+    const float epsilonWS = radiusWS * 1e-3f + 1e-4f;
+    float unused;
+    const Vec3 primitiveGradient = Vec3(
+        DisplacedPrimitive( posWS + Vec3( epsilonWS, 0, 0 ), spherePositionWS, radiusWS, 0, 0, unused ) - DisplacedPrimitive( posWS - Vec3( epsilonWS, 0, 0 ), spherePositionWS, radiusWS, 0, 0, unused ),
+        DisplacedPrimitive( posWS + Vec3( 0, epsilonWS, 0 ), spherePositionWS, radiusWS, 0, 0, unused ) - DisplacedPrimitive( posWS - Vec3( 0, epsilonWS, 0 ), spherePositionWS, radiusWS, 0, 0, unused ),
+        DisplacedPrimitive( posWS + Vec3( 0, 0, epsilonWS ), spherePositionWS, radiusWS, 0, 0, unused ) - DisplacedPrimitive( posWS - Vec3( 0, 0, epsilonWS ), spherePositionWS, radiusWS, 0, 0, unused ) ) * (0.5f / epsilonWS);
+
+    Vec3 noiseGradient;
+    displacementOut = FractalNoiseAndGradientAtPositionWS( posWS, numOctaves, noiseGradient );
+    gradientOut = primitiveGradient - noiseGradient * displacementWS;
+
+    return DisplacedPrimitive( posWS, spherePositionWS, radiusWS, 0, 0, unused ) - displacementOut * displacementWS;
+}
+
+Vec4 ExplosionEvaluator::MapDisplacementToColour( float displacement, const Vec2& uvScaleBias ) const
+{
+    float texcoord = Saturate( displacement * uvScaleBias.x + uvScaleBias.y );
+    texcoord = 1-(1-texcoord)*(1-texcoord); // These adjustments should be made in the texture itself.
+
+    Vec4 colour = m_Textures.gradient.Sample( texcoord, texcoord );
+
+    // Apply some more adjustments to the colour post sample.  Again, these should be made in the texture itself.
+    colour = colour * colour;
+    colour.w = 0.5f;
+
+    return colour;
+}
+
+float ExplosionEvaluator::SkippedOctavesDisplacement( uint numOctaves ) const
+{
+    float amplitude = m_Params.g_NoiseInitialAmplitude * powf( m_Params.g_NoiseAmplitudeFactor, (float)numOctaves );
+    float sumAmplitudes = 0;
+    for(uint i=numOctaves ; i<m_Params.g_NumOctaves ; i++)
+    {
+        sumAmplitudes += amplitude;
+        amplitude *= m_Params.g_NoiseAmplitudeFactor;
+    }
+
+    // g_NoiseMeanAbsValue is only set by the sample, so read the volume's own mean.
+    return sumAmplitudes * m_Textures.noiseVolume.GetMeanAbsoluteValue() * m_Params.g_InvMaxNoiseDisplacement;
+}
+
+Vec4 ExplosionEvaluator::SceneFunction( const Vec3& posWS, const Vec3& spherePositionWS, float radiusWS, float displacementWS, const Vec2& uvScaleBias, uint numOctaves, float& distance ) const
+{
+    float displacementOut;
+    distance = DisplacedPrimitive( posWS, spherePositionWS, radiusWS, displacementWS, numOctaves, displacementOut );
+
+    // Stand in for any octaves skipped by SelectNumOctaves with their mean, so that
+    //  culling does not pull the surface in.
+    if( numOctaves < m_Params.g_NumOctaves )
+    {
+        const float skippedDisplacement = SkippedOctavesDisplacement( numOctaves );
+        displacementOut += skippedDisplacement;
+        distance -= skippedDisplacement * displacementWS;
+    }
+    Vec4 colour = MapDisplacementToColour( displacementOut, uvScaleBias );
+
+    // Rather than just using a binary in/out metric, we smooth the edge of the volume using a smoothstep so that we get soft edges.
+    const float edgeFade = Smoothstep( 0.5f + m_Params.g_EdgeSoftness, 0.5f - m_Params.g_EdgeSoftness, distance );
+
+    colour.w *= edgeFade;
+    return colour;
+}
+
+float ExplosionEvaluator::AdaptiveStepScale( float distance, float alpha ) const
+{
+    const float edgeOuter = 0.5f + m_Params.g_EdgeSoftness;
+    const float edgeInner = 0.5f - m_Params.g_EdgeSoftness;
+    if( distance > edgeOuter )
+    {
+        return Clamp( (distance - edgeOuter) * ADAPTIVE_EMPTY_STEP_FRACTION / m_Params.g_StepSizeWS, 1.0f, ADAPTIVE_MAX_STEP_SCALE );
+    }
+    if( distance > edgeInner )
+    {
+        return ADAPTIVE_MIN_STEP_SCALE;
+    }
+    return Lerp( 1.0f, ADAPTIVE_MAX_STEP_SCALE, Saturate( (alpha / m_Params.g_Opacity - ADAPTIVE_OPAQUE_ALPHA) / (1.0f - ADAPTIVE_OPAQUE_ALPHA) ) );
+}
+
+uint ExplosionEvaluator::SelectNumOctaves( float viewDepth, float alpha ) const
+{
+    if( !m_Params.g_OctaveCulling ) return m_Params.g_NumOctaves;
+
+    const float footprintWS = viewDepth * m_Params.g_PixelSizePerDepthWS;
+    float texelSizeWS = m_Params.g_NoiseTexelSizeWS;
+    float contribution = 1.0f - alpha / m_Params.g_Opacity;
+
+    uint numOctaves = 1;
+    while( numOctaves < m_Params.g_NumOctaves )
+    {
+        texelSizeWS /= m_Params.g_NoiseFrequencyFactor;
+        contribution *= m_Params.g_NoiseAmplitudeFactor;
+        if( texelSizeWS < footprintWS || contribution < OCTAVE_CULL_MIN_CONTRIBUTION ) break;
+        numOctaves++;
+    }
+    return numOctaves;
+}
+
+float ExplosionEvaluator::SelfShadowing( const Vec3& posWS ) const
+{
+    // An unbound SRV reads as zero on the GPU, but the sample only enables self
+    //  shadowing once the volume exists.
+    if( !m_Textures.pTransmittanceVolume ) return 1.0f;
+
+    const Vec3 uvw = (posWS - Vec3( m_Params.g_TransmittanceMinWS )) * m_Params.g_TransmittanceInvSizeWS;
+    return Lerp( 1.0f, m_Textures.pTransmittanceVolume->Sample( uvw ), m_Params.g_SelfShadowing );
+}
@@ -0,0 +1,131 @@
+#ifndef CPU_EXPLOSION_H
+#define CPU_EXPLOSION_H
+
+//--------------------------------------------------------------------------------------
+// CPU replica of RenderExplosion.hlsli.  Every function keeps the name and
+//  argument order of its HLSL counterpart so the two can be diffed side by side;
+//  any change made to one should be mirrored in the other.
+//--------------------------------------------------------------------------------------
+#include <vector>
+
+#include "CpuMath.h"
+#include "CpuTextures.h"
+
+float Box( const Vec3& relativePosWS, const Vec3& b );
+float Torus( const Vec3& relativePosWS, float radiusWS );
+float Cone( const Vec3& relativePosWS, float radiusWS );
+float Cylinder( const Vec3& relativePosWS, float radiusWS );
+float Sphere( const Vec3& relativePosWS, float radiusWS );
+
+inline Vec4 Blend( const Vec4& src, const Vec4& dst )
+{
+    const float weight = dst.w - dst.w * src.w;
+    return Vec4( dst.x * weight + src.x, dst.y * weight + src.y, dst.z * weight + src.z, weight + src.w );
+}
+
+inline float AdjustAlphaForStep( float alpha, float stepScale )
+{
+    return 1.0f - powf( 1.0f - alpha, stepScale );
+}
+
+// How the noise octaves are evaluated.  The shaders use fp32 unless
+//  HALF_PRECISION_NOISE is set in RenderExplosion.hlsli.
+enum NoisePrecision
+{
+    kNoisePrecisionFloat,           // fp32 texels and arithmetic.
+    kNoisePrecisionHalfTexels,      // Half texels (NoiseVolume::SampleHalf), fp32 arithmetic; identical results.
+    kNoisePrecisionHalf,            // Also rounds the octave sum to half after every operation, like min16float.
+    kNoisePrecisionUnorm8Texels     // 8-bit texels (NoiseVolume::SampleUnorm8), dequantised after filtering.
+};
+
+// Binds an ExplosionParams constant buffer and the scene textures, playing the
+//  role of the shader's globals.
+class ExplosionEvaluator
+{
+public:
+    ExplosionEvaluator( const ExplosionParams& params, const SceneTextures& textures, NoisePrecision noisePrecision = kNoisePrecisionFloat );
+
+    const ExplosionParams& GetParams() const { return m_Params; }
+    const SceneTextures& GetTextures() const { return m_Textures; }
+
+    // Records every noise lookup's uvw, for replaying real access patterns in the
+    //  fetch benchmarks.  Only for evaluators used by a single thread.
+    void SetNoiseTrace( std::vector<Vec3>* pNoiseTrace ) { m_pNoiseTrace = pNoiseTrace; }
+
+    float Noise( const Vec3& uvw ) const
+    {
+        if( m_pNoiseTrace ) m_pNoiseTrace->push_back( uvw );
+
+        switch( m_NoisePrecision )
+        {
+        case kNoisePrecisionFloat:          return m_Textures.noiseVolume.Sample( uvw );
+        case kNoisePrecisionUnorm8Texels:   return m_Textures.noiseVolume.SampleUnorm8( uvw );
+        default:                            return m_Textures.noiseVolume.SampleHalf( uvw );
+        }
+    }
+
+    float FractalNoiseAtPositionWS( const Vec3& posWS, uint numOctaves ) const;
+    float DisplacedPrimitive( const Vec3& posWS, const Vec3& spherePositionWS, float radiusWS, float displacementWS, uint numOctaves, float& displacementOut ) const;
+
+    // FractalNoiseAtPositionWS and its gradient with respect to posWS, from the
+    //  value+gradient volume (NoiseVolume::SampleValueGradient, the shader's RGBA16F
+    //  g_NoiseValueGradientVolumeRO), so one fetch per octave as for the value
+    //  alone.  Always fp32 arithmetic on half texels.
+    float FractalNoiseAndGradientAtPositionWS( const Vec3& posWS, uint numOctaves, Vec3& gradientWS ) const;
+
+    // DisplacedPrimitive with the gradient of its distance, the unnormalised surface
+    //  normal.  The primitive's own gradient is taken by central differences of the
+    //  undisplaced shape, which needs no noise fetches.
+    float DisplacedPrimitiveAndGradient( const Vec3& posWS, const Vec3& spherePositionWS, float radiusWS, float displacementWS, uint numOctaves,
+                                         float& displacementOut, Vec3& gradientOut ) const;
+    Vec4 MapDisplacementToColour( float displacement, const Vec2& uvScaleBias ) const;
+    Vec4 SceneFunction( const Vec3& posWS, const Vec3& spherePositionWS, float radiusWS, float displacementWS, const Vec2& uvScaleBias, uint numOctaves, float& distance ) const;
+    Vec4 SceneFunction( const Vec3& posWS, const Vec3& spherePositionWS, float radiusWS, float displacementWS, const Vec2& uvScaleBias, float& distance ) const
+    {
+        return SceneFunction( posWS, spherePositionWS, radiusWS, displacementWS, uvScaleBias, m_Params.g_NumOctaves, distance );
+    }
+    Vec4 SceneFunction( const Vec3& posWS, const Vec3& spherePositionWS, float radiusWS, float displacementWS, const Vec2& uvScaleBias ) const
+    {
+        float distance;
+        return SceneFunction( posWS, spherePositionWS, radiusWS, displacementWS, uvScaleBias, distance );
+    }
+    float AdaptiveStepScale( float distance, float alpha ) const;
+    uint SelectNumOctaves( float viewDepth, float alpha ) const;
+    float SkippedOctavesDisplacement( uint numOctaves ) const;
+    float SelfShadowing( const Vec3& posWS ) const;
+
+    // Convenience wrappers passing the arguments RenderExplosionPS uses.
+    Vec4 SceneFunction( const Vec3& posWS ) const
+    {
+        return SceneFunction( posWS, m_ExplosionPositionWS, m_InnerRadius, m_Params.g_DisplacementWS, m_UvScaleBias );
+    }
+    Vec4 SceneFunction( const Vec3& posWS, float& distance ) const
+    {
+        return SceneFunction( posWS, m_ExplosionPositionWS, m_InnerRadius, m_Params.g_DisplacementWS, m_UvScaleBias, distance );
+    }
+    Vec4 SceneFunction( const Vec3& posWS, uint numOctaves, float& distance ) const
+    {
+        return SceneFunction( posWS, m_ExplosionPositionWS, m_InnerRadius, m_Params.g_DisplacementWS, m_UvScaleBias, numOctaves, distance );
+    }
+
+    const Vec3& GetExplosionPositionWS() const { return m_ExplosionPositionWS; }
+    float GetInnerRadius() const { return m_InnerRadius; }
+
+private:
+    float FractalNoiseAtPositionWSHalf( const Vec3& posWS, uint numOctaves ) const;
+
+    const ExplosionParams& m_Params;
+    const SceneTextures& m_Textures;
+    NoisePrecision m_NoisePrecision;
+    std::vector<Vec3>* m_pNoiseTrace;
+
+    // Values the shaders recompute per invocation.
+    Vec3 m_Animation;
+    Vec3 m_ExplosionPositionWS;
+    Vec2 m_UvScaleBias;
+    float m_InnerRadius;
+
+    ExplosionEvaluator& operator=( const ExplosionEvaluator& );
+};
+
+#endif // CPU_EXPLOSION_H
@@ -0,0 +1,79 @@
+#include "CpuHull.h"
+
+namespace
+{
+    // The shrink-wrapping loop shared by both halves of the hull.
+    Vec3 ShrinkWrap( const ExplosionEvaluator& evaluator, const Vec3& startPosWS, const Vec3& dirWS, uint& stepsTaken, float& residual )
+    {
+        const ExplosionParams& params = evaluator.GetParams();
+        const Vec3& explosionPositionWS = evaluator.GetExplosionPositionWS();
+        const float innerRadius = evaluator.GetInnerRadius();
+
+        Vec3 posWS = startPosWS;
+        float displacementOut; // na
+        float lastDist = 1e30f;
+        stepsTaken = 0;
+        for(uint i=0 ; i<params.g_NumHullSteps ; i++)
+        {
+            const float dist = evaluator.DisplacedPrimitive( posWS, explosionPositionWS, innerRadius, params.g_DisplacementWS, params.g_NumHullOctaves, displacementOut );
+            stepsTaken++;
+            if( params.g_HullConvergenceWS > 0.0f && fabsf( dist ) > lastDist ) break;
+            posWS -= dirWS * dist;
+            if( fabsf( dist ) < params.g_HullConvergenceWS ) break;
+            lastDist = fabsf( dist );
+        }
+
+        // Not part of the shader; how far from the surface the iterations left the vertex.
+        residual = fabsf( evaluator.DisplacedPrimitive( posWS, explosionPositionWS, innerRadius, params.g_DisplacementWS, params.g_NumHullOctaves, displacementOut ) );
+        return posWS;
+    }
+}
+
+HullVertex EvaluateHullVertex( const ExplosionEvaluator& evaluator, float u, float v, bool legacyBackDirection )
+{
+    const ExplosionParams& params = evaluator.GetParams();
+
+    const Vec2 posClipSpace( u * 2.0f - 1.0f, v * 2.0f - 1.0f );
+    const float maxLen = Max( fabsf( posClipSpace.x ), fabsf( posClipSpace.y ) );
+    const Vec3 dir = Normalize( Vec3( posClipSpace.x, posClipSpace.y, maxLen - 1.0f ) );
+
+    HullVertex vertex;
+
+    const Vec3 frontPosStartWS = TransformDirection( params.g_ViewToWorldMatrix, dir ) * params.g_ExplosionRadiusWS + evaluator.GetExplosionPositionWS();
+    const Vec3 frontDirWS = Normalize( frontPosStartWS - evaluator.GetExplosionPositionWS() );
+    vertex.frontPosWS = ShrinkWrap( evaluator, frontPosStartWS, frontDirWS, vertex.numFrontSteps, vertex.frontResidual );
+    vertex.frontPosWS += frontDirWS * params.g_SkinThickness;
+
+    const Vec3 backPosStartWS = TransformDirection( params.g_ViewToWorldMatrix, dir * Vec3( 1, 1, -1 ) ) * params.g_ExplosionRadiusWS + evaluator.GetExplosionPositionWS();
+    const Vec3 backDirWS = Normalize( legacyBackDirection ? vertex.frontPosWS : backPosStartWS - evaluator.GetExplosionPositionWS() );
+    vertex.backPosWS = ShrinkWrap( evaluator, backPosStartWS, backDirWS, vertex.numBackSteps, vertex.backResidual );
+    vertex.backPosWS += backDirWS * params.g_SkinThickness;
+
+    vertex.nearD = Transform( params.g_WorldToViewMatrix, Vec4( vertex.frontPosWS, 1.0f ) ).z;
+    vertex.farD = Transform( params.g_WorldToViewMatrix, Vec4( vertex.backPosWS, 1.0f ) ).z;
+    return vertex;
+}
+
+uint GetNumHullVertices( const ExplosionParams& params )
+{
+    const uint numSegments = (uint)params.g_TessellationFactor;
+    return (numSegments + 1) * (numSegments + 1);
+}
+
+void EvaluateHull( const ExplosionEvaluator& evaluator, std::vector<HullVertex>& vertices, bool legacyBackDirection )
+{
+    vertices.resize( GetNumHullVertices( evaluator.GetParams() ) );
+    EvaluateHull( evaluator, &vertices[0], legacyBackDirection );
+}
+
+void EvaluateHull( const ExplosionEvaluator& evaluator, HullVertex* pVertices, bool legacyBackDirection )
+{
+    const uint numSegments = (uint)evaluator.GetParams().g_TessellationFactor;
+    for(uint y=0 ; y<=numSegments ; y++)
+    {
+        for(uint x=0 ; x<=numSegments ; x++)
+        {
+            pVertices[y * (numSegments + 1) + x] = EvaluateHullVertex( evaluator, (float)x / numSegments, (float)y / numSegments, legacyBackDirection );
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef CPU_HULL_H
+#define CPU_HULL_H
+
+//--------------------------------------------------------------------------------------
+// CPU replica of RenderExplosionDS: the hull that bounds every ray march.  The
+//  single patch is tessellated into (g_TessellationFactor+1)^2 vertices, each of
+//  which is moved in from the bounding sphere onto the displaced primitive by
+//  sphere tracing with the hull octaves, then pushed back out by g_SkinThickness.
+//  The front and back halves give the near and far view depths that the pixel
+//  shader marches between.
+//--------------------------------------------------------------------------------------
+#include <vector>
+
+#include "CpuExplosion.h"
+
+struct HullVertex
+{
+    Vec3 frontPosWS, backPosWS;
+    float nearD, farD;                      // rayHitNearFar.
+    uint numFrontSteps, numBackSteps;       // Shrink-wrapping iterations (DisplacedPrimitive calls) taken.
+    float frontResidual, backResidual;      // |DisplacedPrimitive| where the iterations stopped.
+};
+
+// RenderExplosionDS at one domain location, uv in [0, 1]^2.  legacyBackDirection
+//  shrinks the back vertices along normalize(frontPosWS), as the shader did before
+//  they were moved along their own radius, for comparison.
+HullVertex EvaluateHullVertex( const ExplosionEvaluator& evaluator, float u, float v, bool legacyBackDirection = false );
+
+// Vertices of the tessellated patch: (g_TessellationFactor+1)^2.
+uint GetNumHullVertices( const ExplosionParams& params );
+
+// Every vertex of the tessellated patch, row by row.
+void EvaluateHull( const ExplosionEvaluator& evaluator, std::vector<HullVertex>& vertices, bool legacyBackDirection = false );
+
+// The same into GetNumHullVertices vertices of the caller's.
+void EvaluateHull( const ExplosionEvaluator& evaluator, HullVertex* pVertices, bool legacyBackDirection = false );
+
+#endif // CPU_HULL_H
@@ -0,0 +1,172 @@
+#include "CpuMath.h"
+
+#include <string.h>
+
+void MatrixIdentity( float4x4& out )
+{
+    memset( &out, 0, sizeof(out) );
+    out.m[0][0] = out.m[1][1] = out.m[2][2] = out.m[3][3] = 1.0f;
+}
+
+void MatrixMultiply( const float4x4& a, const float4x4& b, float4x4& out )
+{
+    float4x4 result;
+    for(int r=0 ; r<4 ; r++)
+    {
+        for(int c=0 ; c<4 ; c++)
+        {
+            result.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c] + a.m[r][3] * b.m[3][c];
+        }
+    }
+    out = result;
+}
+
+bool MatrixInverse( const float4x4& m, float4x4& out )
+{
+    // Gauss-Jordan elimination with partial pivoting.
+    float a[4][8];
+    for(int r=0 ; r<4 ; r++)
+    {
+        for(int c=0 ; c<4 ; c++)
+        {
+            a[r][c] = m.m[r][c];
+            a[r][c+4] = (r == c) ? 1.0f : 0.0f;
+        }
+    }
+
+    for(int c=0 ; c<4 ; c++)
+    {
+        int pivot = c;
+        for(int r=c+1 ; r<4 ; r++)
+        {
+            if( fabsf( a[r][c] ) > fabsf( a[pivot][c] ) ) pivot = r;
+        }
+        if( a[pivot][c] == 0.0f ) return false;
+
+        if( pivot != c )
+        {
+            for(int k=0 ; k<8 ; k++)
+            {
+                const float t = a[c][k]; a[c][k] = a[pivot][k]; a[pivot][k] = t;
+            }
+        }
+
+        const float invPivot = 1.0f / a[c][c];
+        for(int k=0 ; k<8 ; k++) a[c][k] *= invPivot;
+
+        for(int r=0 ; r<4 ; r++)
+        {
+            if( r == c ) continue;
+            const float f = a[r][c];
+            for(int k=0 ; k<8 ; k++) a[r][k] -= f * a[c][k];
+        }
+    }
+
+    for(int r=0 ; r<4 ; r++)
+    {
+        for(int c=0 ; c<4 ; c++) out.m[r][c] = a[r][c+4];
+    }
+    return true;
+}
+
+void MatrixLookAtLH( const Vec3& eye, const Vec3& lookAt, const Vec3& up, float4x4& out )
+{
+    const Vec3 zAxis = Normalize( lookAt - eye );
+    const Vec3 xAxis = Normalize( Cross( up, zAxis ) );
+    const Vec3 yAxis = Cross( zAxis, xAxis );
+
+    out.m[0][0] = xAxis.x; out.m[0][1] = yAxis.x; out.m[0][2] = zAxis.x; out.m[0][3] = 0.0f;
+    out.m[1][0] = xAxis.y; out.m[1][1] = yAxis.y; out.m[1][2] = zAxis.y; out.m[1][3] = 0.0f;
+    out.m[2][0] = xAxis.z; out.m[2][1] = yAxis.z; out.m[2][2] = zAxis.z; out.m[2][3] = 0.0f;
+    out.m[3][0] = -Dot( xAxis, eye );
+    out.m[3][1] = -Dot( yAxis, eye );
+    out.m[3][2] = -Dot( zAxis, eye );
+    out.m[3][3] = 1.0f;
+}
+
+void MatrixPerspectiveFovLH( float fovY, float aspect, float nearZ, float farZ, float4x4& out )
+{
+    const float height = 1.0f / tanf( 0.5f * fovY );
+    const float width = height / aspect;
+    const float range = farZ / (farZ - nearZ);
+
+    memset( &out, 0, sizeof(out) );
+    out.m[0][0] = width;
+    out.m[1][1] = height;
+    out.m[2][2] = range;
+    out.m[2][3] = 1.0f;
+    out.m[3][2] = -range * nearZ;
+}
+
+float HalfToFloat( uint16_t h )
+{
+    const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1F;
+    uint32_t mantissa = h & 0x3FF;
+
+    uint32_t bits;
+    if( exponent == 0x1F )
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else if( exponent != 0 )
+    {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else if( mantissa != 0 )
+    {
+        // Denormal, renormalise it.
+        exponent = 113;
+        while( (mantissa & 0x400) == 0 )
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+    else
+    {
+        bits = sign;
+    }
+
+    float f;
+    memcpy( &f, &bits, sizeof(f) );
+    return f;
+}
+
+uint16_t FloatToHalf( float f )
+{
+    uint32_t bits;
+    memcpy( &bits, &f, sizeof(bits) );
+
+    const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    const int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if( ((bits >> 23) & 0xFF) == 0xFF )
+    {
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+    }
+    if( exponent >= 0x1F )
+    {
+        return sign | 0x7C00;
+    }
+    if( exponent <= 0 )
+    {
+        if( exponent < -10 ) return sign;
+
+        // Denormal result, round to nearest even.
+        mantissa |= 0x800000;
+        const uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if( remainder > halfway || (remainder == halfway && (half & 1)) ) half++;
+        return sign | (uint16_t)half;
+    }
+
+    uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+    const uint32_t remainder = mantissa & 0x1FFF;
+    if( remainder > 0x1000 || (remainder == 0x1000 && (half & 1)) ) half++;
+    return sign | (uint16_t)half;
+}
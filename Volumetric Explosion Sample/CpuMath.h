@@ -0,0 +1,160 @@
+#ifndef CPU_MATH_H
+#define CPU_MATH_H
+
+//--------------------------------------------------------------------------------------
+// Small vector library used by the CPU replica of the explosion shaders.  The
+//  function names deliberately follow their HLSL intrinsic counterparts so that
+//  the CPU code reads the same as RenderExplosion.hlsli.
+//--------------------------------------------------------------------------------------
+#include <math.h>
+#include <stdint.h>
+
+#include "Common.h"
+
+// F16C half conversions are used when the compiler targets them: -mf16c with GCC
+//  and Clang, or /arch:AVX plus EXPLOSION_USE_F16C with MSVC (which has no macro
+//  for it, and Sandy Bridge has AVX without F16C).
+#if defined(__F16C__) || defined(EXPLOSION_USE_F16C)
+#define CPU_MATH_F16C 1
+#include <immintrin.h>
+#else
+#define CPU_MATH_F16C 0
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CPU_MATH_SSE2 1
+#include <emmintrin.h>
+#else
+#define CPU_MATH_SSE2 0
+#endif
+
+struct Vec2
+{
+    float x, y;
+
+    Vec2() {}
+    Vec2( float _x, float _y ) : x(_x), y(_y) {}
+};
+
+struct Vec3
+{
+    float x, y, z;
+
+    Vec3() {}
+    Vec3( float _x, float _y, float _z ) : x(_x), y(_y), z(_z) {}
+    explicit Vec3( float s ) : x(s), y(s), z(s) {}
+    explicit Vec3( const float3& v ) : x(v.x), y(v.y), z(v.z) {}
+
+    Vec3 operator-() const { return Vec3( -x, -y, -z ); }
+    Vec3& operator+=( const Vec3& v ) { x += v.x; y += v.y; z += v.z; return *this; }
+    Vec3& operator-=( const Vec3& v ) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+    Vec3& operator*=( float s ) { x *= s; y *= s; z *= s; return *this; }
+};
+
+struct Vec4
+{
+    float x, y, z, w;
+
+    Vec4() {}
+    Vec4( float _x, float _y, float _z, float _w ) : x(_x), y(_y), z(_z), w(_w) {}
+    Vec4( const Vec3& v, float _w ) : x(v.x), y(v.y), z(v.z), w(_w) {}
+    explicit Vec4( float s ) : x(s), y(s), z(s), w(s) {}
+
+    Vec3 xyz() const { return Vec3( x, y, z ); }
+};
+
+inline Vec3 operator+( const Vec3& a, const Vec3& b ) { return Vec3( a.x + b.x, a.y + b.y, a.z + b.z ); }
+inline Vec3 operator-( const Vec3& a, const Vec3& b ) { return Vec3( a.x - b.x, a.y - b.y, a.z - b.z ); }
+inline Vec3 operator*( const Vec3& a, const Vec3& b ) { return Vec3( a.x * b.x, a.y * b.y, a.z * b.z ); }
+inline Vec3 operator*( const Vec3& a, float s ) { return Vec3( a.x * s, a.y * s, a.z * s ); }
+inline Vec3 operator*( float s, const Vec3& a ) { return Vec3( a.x * s, a.y * s, a.z * s ); }
+inline Vec3 operator/( const Vec3& a, float s ) { return a * (1.0f / s); }
+
+inline Vec4 operator+( const Vec4& a, const Vec4& b ) { return Vec4( a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w ); }
+inline Vec4 operator-( const Vec4& a, const Vec4& b ) { return Vec4( a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w ); }
+inline Vec4 operator*( const Vec4& a, const Vec4& b ) { return Vec4( a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w ); }
+inline Vec4 operator*( const Vec4& a, float s ) { return Vec4( a.x * s, a.y * s, a.z * s, a.w * s ); }
+
+inline float Dot( const Vec3& a, const Vec3& b ) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 Cross( const Vec3& a, const Vec3& b ) { return Vec3( a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x ); }
+inline float Length( const Vec3& a ) { return sqrtf( Dot( a, a ) ); }
+inline float Length( const Vec2& a ) { return sqrtf( a.x * a.x + a.y * a.y ); }
+inline Vec3 Normalize( const Vec3& a ) { return a * (1.0f / Length( a )); }
+inline Vec3 Abs( const Vec3& a ) { return Vec3( fabsf( a.x ), fabsf( a.y ), fabsf( a.z ) ); }
+inline Vec3 Max( const Vec3& a, float b ) { return Vec3( a.x > b ? a.x : b, a.y > b ? a.y : b, a.z > b ? a.z : b ); }
+inline Vec3 Floor( const Vec3& a ) { return Vec3( floorf( a.x ), floorf( a.y ), floorf( a.z ) ); }
+
+inline float Min( float a, float b ) { return a < b ? a : b; }
+inline float Max( float a, float b ) { return a > b ? a : b; }
+inline float Clamp( float v, float lo, float hi ) { return Min( Max( v, lo ), hi ); }
+inline float Saturate( float v ) { return Clamp( v, 0.0f, 1.0f ); }
+inline float Lerp( float a, float b, float t ) { return a + (b - a) * t; }
+inline Vec4 Lerp( const Vec4& a, const Vec4& b, float t ) { return a + (b - a) * t; }
+
+// Matches the HLSL smoothstep, including the reversed edge form used by SceneFunction.
+inline float Smoothstep( float edge0, float edge1, float x )
+{
+    const float t = Saturate( (x - edge0) / (edge1 - edge0) );
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// HLSL's mul( M, v ) where M was uploaded from a DirectXMath (row-vector) matrix,
+//  i.e. v * M in DirectXMath terms.
+inline Vec4 Transform( const float4x4& m, const Vec4& v )
+{
+    return Vec4( v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0] + v.w * m.m[3][0],
+                 v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1] + v.w * m.m[3][1],
+                 v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] + v.w * m.m[3][2],
+                 v.x * m.m[0][3] + v.y * m.m[1][3] + v.z * m.m[2][3] + v.w * m.m[3][3] );
+}
+
+inline Vec3 TransformPoint( const float4x4& m, const Vec3& p ) { return Transform( m, Vec4( p, 1.0f ) ).xyz(); }
+inline Vec3 TransformDirection( const float4x4& m, const Vec3& d ) { return Transform( m, Vec4( d, 0.0f ) ).xyz(); }
+
+// Portable replacements for the DirectXMath matrix helpers, so ExplosionParams can
+//  be built without the Windows SDK.
+void MatrixIdentity( float4x4& out );
+void MatrixMultiply( const float4x4& a, const float4x4& b, float4x4& out );
+bool MatrixInverse( const float4x4& m, float4x4& out );
+void MatrixLookAtLH( const Vec3& eye, const Vec3& lookAt, const Vec3& up, float4x4& out );
+void MatrixPerspectiveFovLH( float fovY, float aspect, float nearZ, float farZ, float4x4& out );
+
+// IEEE half <-> float conversion, as used by the R16_FLOAT noise volume.
+float HalfToFloat( uint16_t h );
+uint16_t FloatToHalf( float f );
+
+// Converts eight halves at once.
+inline void HalfToFloat8( const uint16_t* pHalves, float* pFloats )
+{
+#if CPU_MATH_F16C
+    _mm256_storeu_ps( pFloats, _mm256_cvtph_ps( _mm_loadu_si128( (const __m128i*)pHalves ) ) );
+#else
+    for(uint i=0 ; i<8 ; i++) pFloats[i] = HalfToFloat( pHalves[i] );
+#endif
+}
+
+// Converts eight UNORM8 values to [0, 1] floats at once.
+inline void Unorm8ToFloat8( const uint8_t* pValues, float* pFloats )
+{
+#if CPU_MATH_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i words = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i*)pValues ), zero );
+    const __m128 scale = _mm_set1_ps( 1.0f / 255.0f );
+    _mm_storeu_ps( pFloats, _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( words, zero ) ), scale ) );
+    _mm_storeu_ps( pFloats + 4, _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( words, zero ) ), scale ) );
+#else
+    for(uint i=0 ; i<8 ; i++) pFloats[i] = pValues[i] * (1.0f / 255.0f);
+#endif
+}
+
+// Rounds to the nearest half, the precision a min16float may be computed at.
+inline float RoundToHalf( float f )
+{
+#if CPU_MATH_F16C
+    return _mm_cvtss_f32( _mm_cvtph_ps( _mm_cvtps_ph( _mm_set_ss( f ), 0 ) ) );
+#else
+    return HalfToFloat( FloatToHalf( f ) );
+#endif
+}
+
+#endif // CPU_MATH_H
@@ -0,0 +1,781 @@
+#include "CpuRenderer.h"
+#include "CoarseTiles.h"
+#include "FrameArena.h"
+#include "HullRasteriser.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <string.h>
+
+// Furthest any primitive's surface reaches from its centre, relative to its radius
+//  (the box and cylinder corners sit at ~1.22r).
+static const float kPrimitiveExtent = 1.25f;
+
+// The fractal noise is normalised by the displacement derived from InitDevice's
+//  largest noise value, which slightly underestimates the true largest value.
+static const float kDisplacementMargin = 1.05f;
+
+// Wavefront queue capacity, in batches of simdWidth rays.
+static const uint kWavefrontBatches = 4;
+
+RenderStats::RenderStats()
+    : numPixels(0)
+    , numRays(0)
+    , numSteps(0)
+    , numOctaves(0)
+    , numLaneSlots(0)
+    , milliseconds(0)
+{
+}
+
+void RenderStats::Accumulate( const RenderStats& other )
+{
+    numPixels += other.numPixels;
+    numRays += other.numRays;
+    numSteps += other.numSteps;
+    numOctaves += other.numOctaves;
+    numLaneSlots += other.numLaneSlots;
+    milliseconds += other.milliseconds;
+}
+
+CpuRenderSettings::CpuRenderSettings()
+    : tileSize(16)
+    , marchMode(kMarchTiles)
+    , simdWidth(8)
+    , stepsPerRound(8)
+    , noisePrecision(kNoisePrecisionFloat)
+    , coarseTiles(false)
+    , tileRaySetup(true)
+    , hullBounds(false)
+{
+}
+
+Vec3 GetRayDirectionWS( const ExplosionParams& params, float pixelX, float pixelY )
+{
+    const float ndcX = pixelX * 2.0f * params.g_ScreenParams.z - 1.0f;
+    const float ndcY = 1.0f - pixelY * 2.0f * params.g_ScreenParams.w;
+
+    const Vec4 posVS = Transform( params.g_ProjectionToViewMatrix, Vec4( ndcX, ndcY, 0.0f, 1.0f ) );
+    const Vec3 directionVS = posVS.xyz() / posVS.z;
+
+    return TransformDirection( params.g_ViewToWorldMatrix, directionVS );
+}
+
+float GetExplosionBoundingRadius( const ExplosionParams& params )
+{
+    const float innerRadius = params.g_ExplosionRadiusWS - params.g_DisplacementWS;
+    return fabsf( innerRadius ) * kPrimitiveExtent
+         + fabsf( params.g_DisplacementWS ) * kDisplacementMargin
+         + 0.5f + fabsf( params.g_EdgeSoftness );
+}
+
+bool GetAnalyticRayInterval( const ExplosionParams& params, const Vec3& rayDirectionWS, float& nearD, float& farD )
+{
+    const float radius = GetExplosionBoundingRadius( params );
+    const Vec3 offset = Vec3( params.g_EyePositionWS ) - Vec3( params.g_ExplosionPositionWS );
+
+    const float a = Dot( rayDirectionWS, rayDirectionWS );
+    const float b = Dot( rayDirectionWS, offset );
+    const float c = Dot( offset, offset ) - radius * radius;
+    const float discriminant = b * b - a * c;
+    if( discriminant <= 0.0f ) return false;
+
+    const float root = sqrtf( discriminant );
+    nearD = Max( (-b - root) / a, params.g_ProjectionParams.w );
+    farD = (-b + root) / a;
+
+    return farD > nearD;
+}
+
+bool GetTileRayInterval( const ExplosionParams& params, uint x0, uint y0, uint x1, uint y1, float& nearD, float& farD )
+{
+    const Vec3 rayDirectionWS = GetRayDirectionWS( params, (x0 + x1) * 0.5f, (y0 + y1) * 0.5f );
+
+    // g_PixelSizePerDepthWS is the spread per unit of view depth; the grown sphere
+    //  must hold it at the sphere's far side.
+    const float halfDiagonalPerDepth = 0.5f * sqrtf( (float)((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0)) ) * params.g_PixelSizePerDepthWS;
+    const Vec3 offset = Vec3( params.g_EyePositionWS ) - Vec3( params.g_ExplosionPositionWS );
+    const float boundingRadius = GetExplosionBoundingRadius( params );
+    const float radius = boundingRadius + halfDiagonalPerDepth * (Length( offset ) + boundingRadius);
+
+    const float a = Dot( rayDirectionWS, rayDirectionWS );
+    const float b = Dot( rayDirectionWS, offset );
+    const float c = Dot( offset, offset ) - radius * radius;
+    const float discriminant = b * b - a * c;
+    if( discriminant <= 0.0f ) return false;
+
+    const float root = sqrtf( discriminant );
+    nearD = Max( (-b - root) / a, params.g_ProjectionParams.w );
+    farD = (-b + root) / a;
+
+    return farD > nearD;
+}
+
+uint SetUpRayBatch( const ExplosionParams& params, uint x0, uint y, uint count, RayBatch& batch )
+{
+    uint numHits = 0;
+
+#if CPU_MATH_SSE2
+    // GetRayDirectionWS and GetAnalyticRayInterval with the operations in the same
+    //  order, so that every lane rounds the same way.  Only ndcX varies along the row.
+    const float4x4& toView = params.g_ProjectionToViewMatrix;
+    const float4x4& toWorld = params.g_ViewToWorldMatrix;
+    const float ndcY = 1.0f - (y + 0.5f) * 2.0f * params.g_ScreenParams.w;
+    const __m128 viewX = _mm_set1_ps( ndcY * toView.m[1][0] ), viewY = _mm_set1_ps( ndcY * toView.m[1][1] ), viewZ = _mm_set1_ps( ndcY * toView.m[1][2] );
+
+    const float radius = GetExplosionBoundingRadius( params );
+    const Vec3 offset = Vec3( params.g_EyePositionWS ) - Vec3( params.g_ExplosionPositionWS );
+    const __m128 c = _mm_set1_ps( Dot( offset, offset ) - radius * radius );
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps( 1.0f ), nearClip = _mm_set1_ps( params.g_ProjectionParams.w );
+
+    for(uint i=0 ; i<count ; i+=4)
+    {
+        const __m128 pixelX = _mm_add_ps( _mm_cvtepi32_ps( _mm_setr_epi32( x0 + i, x0 + i + 1, x0 + i + 2, x0 + i + 3 ) ), _mm_set1_ps( 0.5f ) );
+        const __m128 ndcX = _mm_sub_ps( _mm_mul_ps( _mm_mul_ps( pixelX, _mm_set1_ps( 2.0f ) ), _mm_set1_ps( params.g_ScreenParams.z ) ), one );
+
+        // posVS = (ndcX, ndcY, 0, 1) through g_ProjectionToViewMatrix, then / z.
+        __m128 posX = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( ndcX, _mm_set1_ps( toView.m[0][0] ) ), viewX ), zero ), _mm_set1_ps( toView.m[3][0] ) );
+        __m128 posY = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( ndcX, _mm_set1_ps( toView.m[0][1] ) ), viewY ), zero ), _mm_set1_ps( toView.m[3][1] ) );
+        __m128 posZ = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( ndcX, _mm_set1_ps( toView.m[0][2] ) ), viewZ ), zero ), _mm_set1_ps( toView.m[3][2] ) );
+        const __m128 invZ = _mm_div_ps( one, posZ );
+        posX = _mm_mul_ps( posX, invZ );
+        posY = _mm_mul_ps( posY, invZ );
+        posZ = _mm_mul_ps( posZ, invZ );
+
+        __m128 direction[3];
+        for(uint j=0 ; j<3 ; j++)
+        {
+            direction[j] = _mm_add_ps( _mm_add_ps( _mm_mul_ps( posX, _mm_set1_ps( toWorld.m[0][j] ) ), _mm_mul_ps( posY, _mm_set1_ps( toWorld.m[1][j] ) ) ),
+                                       _mm_mul_ps( posZ, _mm_set1_ps( toWorld.m[2][j] ) ) );
+            direction[j] = _mm_add_ps( direction[j], zero );
+        }
+
+        const __m128 a = _mm_add_ps( _mm_add_ps( _mm_mul_ps( direction[0], direction[0] ), _mm_mul_ps( direction[1], direction[1] ) ), _mm_mul_ps( direction[2], direction[2] ) );
+        const __m128 b = _mm_add_ps( _mm_add_ps( _mm_mul_ps( direction[0], _mm_set1_ps( offset.x ) ), _mm_mul_ps( direction[1], _mm_set1_ps( offset.y ) ) ),
+                                     _mm_mul_ps( direction[2], _mm_set1_ps( offset.z ) ) );
+        const __m128 discriminant = _mm_sub_ps( _mm_mul_ps( b, b ), _mm_mul_ps( a, c ) );
+        const __m128 root = _mm_sqrt_ps( _mm_max_ps( discriminant, zero ) );
+        const __m128 minusB = _mm_sub_ps( zero, b );
+        const __m128 nearD = _mm_max_ps( _mm_div_ps( _mm_sub_ps( minusB, root ), a ), nearClip );
+        const __m128 farD = _mm_div_ps( _mm_add_ps( minusB, root ), a );
+        const int hitMask = _mm_movemask_ps( _mm_and_ps( _mm_cmpgt_ps( discriminant, zero ), _mm_cmpgt_ps( farD, nearD ) ) );
+
+        _mm_storeu_ps( &batch.directionX[i], direction[0] );
+        _mm_storeu_ps( &batch.directionY[i], direction[1] );
+        _mm_storeu_ps( &batch.directionZ[i], direction[2] );
+        _mm_storeu_ps( &batch.nearD[i], nearD );
+        _mm_storeu_ps( &batch.farD[i], farD );
+        for(uint lane=0 ; lane<4 && i+lane<count ; lane++)
+        {
+            batch.hits[i + lane] = (hitMask >> lane & 1) != 0;
+            numHits += batch.hits[i + lane];
+        }
+    }
+#else
+    for(uint i=0 ; i<count ; i++)
+    {
+        const Vec3 rayDirectionWS = GetRayDirectionWS( params, x0 + i + 0.5f, y + 0.5f );
+        batch.directionX[i] = rayDirectionWS.x;
+        batch.directionY[i] = rayDirectionWS.y;
+        batch.directionZ[i] = rayDirectionWS.z;
+        batch.hits[i] = GetAnalyticRayInterval( params, rayDirectionWS, batch.nearD[i], batch.farD[i] );
+        numHits += batch.hits[i];
+    }
+#endif
+
+    return numHits;
+}
+
+float GetExplosionScreenCoverage( const ExplosionParams& params )
+{
+    const float radius = GetExplosionBoundingRadius( params );
+    const float distance = Length( Vec3( params.g_EyePositionWS ) - Vec3( params.g_ExplosionPositionWS ) );
+    if( distance <= radius ) return 1.0f;
+
+    // Half height of the projected sphere in NDC, converted to pixels.
+    const float radiusNDC = radius / sqrtf( distance * distance - radius * radius ) * params.g_ViewToProjectionMatrix.m[1][1];
+    const float radiusPixels = radiusNDC * params.g_ScreenParams.y * 0.5f;
+
+    return Min( PI * radiusPixels * radiusPixels * params.g_ScreenParams.z * params.g_ScreenParams.w, 1.0f );
+}
+
+float GetRayStartOffset( const ExplosionEvaluator& evaluator, uint x, uint y )
+{
+    const BlueNoiseMask& blueNoise = evaluator.GetTextures().blueNoise;
+    if( !evaluator.GetParams().g_DitheredStart || blueNoise.GetSize() == 0 ) return 0.0f;
+
+    return evaluator.GetParams().g_StepSizeWS * blueNoise.Fetch( x, y );
+}
+
+Vec4 RayMarchExplosion( const ExplosionEvaluator& evaluator, const Vec3& rayDirectionWS, float nearD, float farD, uint& stepsTaken, float* pDepth,
+                        uint* pNumOctaves, uint* pNumEmptySteps )
+{
+    const ExplosionParams& params = evaluator.GetParams();
+
+    Vec4 output( 0.0f );
+
+    // SceneFunction's edgeFade is zero from here out.
+    const float edgeOuter = 0.5f + params.g_EdgeSoftness;
+    uint emptySteps = 0;
+
+    const Vec3 startWS = rayDirectionWS * nearD + Vec3( params.g_EyePositionWS );
+
+    const Vec3 stepAmountWS = rayDirectionWS * params.g_StepSizeWS;
+    const float numSteps = Min( (float)params.g_MaxNumSteps, (farD - nearD) / params.g_StepSizeWS );
+
+    Vec3 posWS = startWS;
+    uint octavesTaken = 0;
+
+    if( params.g_AdaptiveStepping )
+    {
+        const float intervalD = farD - nearD;
+        float marchedD = 0;
+        float depth = farD;
+        uint adaptiveSteps = 0;
+        while( marchedD < intervalD && adaptiveSteps < params.g_MaxNumSteps && output.w < params.g_Opacity )
+        {
+            adaptiveSteps++;
+            float distance;
+            const uint numOctaves = evaluator.SelectNumOctaves( nearD + marchedD, output.w );
+            Vec4 colour = EvaluateMarchStep( evaluator, posWS, numOctaves, distance );
+            octavesTaken += numOctaves;
+            emptySteps += distance >= edgeOuter ? 1 : 0;
+
+            const float stepScale = evaluator.AdaptiveStepScale( distance, output.w );
+            colour.w = AdjustAlphaForStep( colour.w, stepScale * params.g_StepOpacityScale );
+            output = Blend( output, colour );
+
+            if( pDepth && depth == farD && output.w >= kDepthAlphaThreshold )
+            {
+                depth = nearD + marchedD;
+            }
+
+            posWS += stepAmountWS * stepScale;
+            marchedD += params.g_StepSizeWS * stepScale;
+        }
+
+        stepsTaken = adaptiveSteps;
+        if( pDepth ) *pDepth = depth;
+        if( pNumOctaves ) *pNumOctaves = octavesTaken;
+        if( pNumEmptySteps ) *pNumEmptySteps = emptySteps;
+        output.w *= params.g_Opacity;
+        return output;
+    }
+
+    float depth = farD;
+    float steps = 0;
+    while( steps++ < numSteps && output.w < params.g_Opacity )
+    {
+        float distance;
+        const uint numOctaves = evaluator.SelectNumOctaves( nearD + (steps - 1) * params.g_StepSizeWS, output.w );
+        Vec4 colour = EvaluateMarchStep( evaluator, posWS, numOctaves, distance );
+        if( params.g_StepOpacityScale != 1.0f ) colour.w = AdjustAlphaForStep( colour.w, params.g_StepOpacityScale );
+        output = Blend( output, colour );
+        octavesTaken += numOctaves;
+        emptySteps += distance >= edgeOuter ? 1 : 0;
+
+        if( pDepth && depth == farD && output.w >= kDepthAlphaThreshold )
+        {
+            depth = nearD + (steps - 1) * params.g_StepSizeWS;
+        }
+
+        posWS += stepAmountWS;
+    }
+
+    stepsTaken = (uint)(steps - 1);
+    if( pDepth ) *pDepth = depth;
+    if( pNumOctaves ) *pNumOctaves = octavesTaken;
+    if( pNumEmptySteps ) *pNumEmptySteps = emptySteps;
+    output.w *= params.g_Opacity;
+    return output;
+}
+
+CpuRenderer::CpuRenderer( const CpuRenderSettings& settings )
+    : m_Settings(settings)
+{
+}
+
+void CpuRenderer::RenderFrame( const ExplosionParams& params, const SceneTextures& textures, Image& target, ThreadPool* pPool, RenderStats* pStats,
+                               FrameArenas* pArenas ) const
+{
+    Timer timer;
+
+    FrameArenas localArenas;
+    FrameArenas& arenas = pArenas ? *pArenas : localArenas;
+    const uint numThreads = pPool ? pPool->GetNumThreads() : 1;
+    arenas.Prepare( numThreads );
+    LinearArena& frameArena = arenas.GetFrameArena();
+
+    const uint width = (uint)params.g_ScreenParams.x;
+    const uint height = (uint)params.g_ScreenParams.y;
+    target.Resize( width, height );
+
+    const ExplosionEvaluator evaluator( params, textures, m_Settings.noisePrecision );
+
+    const uint tileSize = m_Settings.tileSize;
+    const uint numTilesX = (width + tileSize - 1) / tileSize;
+    const uint numTilesY = (height + tileSize - 1) / tileSize;
+
+    RenderStats* pThreadStats = frameArena.AllocateArray<RenderStats>( numThreads );
+
+    const bool isWavefront = m_Settings.marchMode == kMarchWavefront;
+
+    CoarseTileMap coarseTiles;
+    const CoarseTileMap* pCoarseTiles = nullptr;
+    if( m_Settings.coarseTiles && !isWavefront )
+    {
+        coarseTiles.Classify( evaluator, pPool, frameArena );
+        pCoarseTiles = &coarseTiles;
+    }
+
+    HullDepthBuffer hullDepths;
+    const HullDepthBuffer* pHullDepths = nullptr;
+    if( m_Settings.hullBounds && !isWavefront )
+    {
+        const uint numHullVertices = GetNumHullVertices( params );
+        HullVertex* pHullVertices = frameArena.AllocateArray<HullVertex>( numHullVertices );
+        EvaluateHull( evaluator, pHullVertices );
+        // With the camera close enough for the hull to reach behind the near plane
+        //  the rasterised depths have holes, so march the sphere's interval instead.
+        if( RasteriseHull( params, pHullVertices, numHullVertices, pPool, hullDepths, frameArena ) ) pHullDepths = &hullDepths;
+    }
+
+    const CpuRenderer& renderer = *this;
+    auto renderTile = [&]( uint tileIndex, uint threadIndex )
+    {
+        const uint x0 = (tileIndex % numTilesX) * tileSize;
+        const uint y0 = (tileIndex / numTilesX) * tileSize;
+        renderer.RenderTile( evaluator, x0, y0, Min( x0 + tileSize, width ), Min( y0 + tileSize, height ), target, pThreadStats[threadIndex], pCoarseTiles,
+                             pHullDepths );
+    };
+
+    // Wavefront marching runs one job per thread, each pulling tiles as it needs pixels.
+    std::atomic<uint> nextTile( 0 );
+    auto renderWavefront = [&]( uint, uint threadIndex )
+    {
+        renderer.RenderWavefront( evaluator, nextTile, target, pThreadStats[threadIndex], arenas.GetScratchArena( threadIndex ) );
+    };
+
+    if( pPool )
+    {
+        if( isWavefront )
+        {
+            pPool->ParallelFor( pPool->GetNumThreads(), renderWavefront );
+        }
+        else
+        {
+            pPool->ParallelFor( numTilesX * numTilesY, renderTile );
+        }
+    }
+    else if( isWavefront )
+    {
+        renderWavefront( 0, 0 );
+    }
+    else
+    {
+        for(uint i=0 ; i<numTilesX * numTilesY ; i++) renderTile( i, 0 );
+    }
+
+    if( pStats )
+    {
+        RenderStats frameStats;
+        for(uint i=0 ; i<numThreads ; i++) frameStats.Accumulate( pThreadStats[i] );
+        frameStats.milliseconds = timer.GetElapsedMilliseconds();
+        *pStats = frameStats;
+    }
+
+    arenas.Reset();
+}
+
+void CpuRenderer::RenderTile( const ExplosionEvaluator& evaluator, uint x0, uint y0, uint x1, uint y1, Image& target, RenderStats& stats,
+                              const CoarseTileMap* pCoarseTiles, const HullDepthBuffer* pHullDepths ) const
+{
+    const ExplosionParams& params = evaluator.GetParams();
+    const uint simdWidth = m_Settings.simdWidth;
+    const bool isTileSetup = m_Settings.tileRaySetup;
+
+    // No ray of the tile can reach the bounds: clear it without setting any up.
+    //  The hull is rasterised from its own sphere, so it is left to cull its pixels.
+    float tileNearD, tileFarD;
+    if( isTileSetup && !pHullDepths && !GetTileRayInterval( params, x0, y0, x1, y1, tileNearD, tileFarD ) )
+    {
+        for(uint y=y0 ; y<y1 ; y++)
+        {
+            for(uint x=x0 ; x<x1 ; x++) target.At( x, y ) = Vec4( 0.0f );
+        }
+        stats.numPixels += (x1 - x0) * (y1 - y0);
+        return;
+    }
+
+    RayBatch batch;
+    for(uint y=y0 ; y<y1 ; y++)
+    {
+        // Had runs of simdWidth pixels been marched in lockstep, each run would last
+        //  as long as its longest ray.
+        uint runMaxSteps = 0;
+
+        for(uint x=x0 ; x<x1 ; x++)
+        {
+            Vec4& pixel = target.At( x, y );
+            pixel = Vec4( 0.0f );
+            stats.numPixels++;
+
+            const CoarseTile* pCoarseTile = pCoarseTiles ? &pCoarseTiles->GetPixelTile( x, y ) : nullptr;
+            const bool isEmptyTile = pCoarseTile && pCoarseTile->tileClass == kCoarseTileEmpty;
+
+            Vec3 rayDirectionWS;
+            float nearD, farD;
+            bool isHit;
+            if( isTileSetup )
+            {
+                const uint lane = (x - x0) % kRayBatchSize;
+                if( lane == 0 ) SetUpRayBatch( params, x, y, std::min( x1 - x, kRayBatchSize ), batch );
+
+                rayDirectionWS = Vec3( batch.directionX[lane], batch.directionY[lane], batch.directionZ[lane] );
+                nearD = batch.nearD[lane];
+                farD = batch.farD[lane];
+                isHit = batch.hits[lane];
+            }
+            else
+            {
+                rayDirectionWS = GetRayDirectionWS( params, x + 0.5f, y + 0.5f );
+                isHit = GetAnalyticRayInterval( params, rayDirectionWS, nearD, farD );
+            }
+
+            if( pHullDepths )
+            {
+                isHit = pHullDepths->IsCovered( x, y );
+                nearD = pHullDepths->GetNearD( x, y );
+                farD = pHullDepths->GetFarD( x, y );
+            }
+
+            if( !isEmptyTile && isHit )
+            {
+                nearD += GetRayStartOffset( evaluator, x, y );
+                if( pCoarseTile )
+                {
+                    // Skip whole steps, so that the samples land where they would have.
+                    if( pCoarseTile->nearD > nearD ) nearD += floorf( (pCoarseTile->nearD - nearD) / params.g_StepSizeWS ) * params.g_StepSizeWS;
+                    farD = Min( farD, pCoarseTile->farD );
+                }
+
+                uint stepsTaken, octavesTaken;
+                pixel = RayMarchExplosion( evaluator, rayDirectionWS, nearD, farD, stepsTaken, nullptr, &octavesTaken );
+
+                stats.numRays++;
+                stats.numSteps += stepsTaken;
+                stats.numOctaves += octavesTaken;
+                runMaxSteps = stepsTaken > runMaxSteps ? stepsTaken : runMaxSteps;
+            }
+
+            if( (x - x0) % simdWidth == simdWidth - 1 || x == x1 - 1 )
+            {
+                stats.numLaneSlots += (uint64_t)runMaxSteps * simdWidth;
+                runMaxSteps = 0;
+            }
+        }
+    }
+}
+
+// A wavefront queue's ray states, structure of arrays so that lanes load four at
+//  a time.  Each array has three lanes spare at the end for the last group.
+struct WavefrontLanes
+{
+    float *positionX, *positionY, *positionZ;
+    float *stepX, *stepY, *stepZ;
+    float *outputR, *outputG, *outputB, *outputA;
+    float *numSteps, *intervalD, *marchedD, *nearD;
+    uint *stepsTaken, *octavesTaken, *pixelIndex;
+
+    // The round's current step: ~0 for lanes that take it, with their sample and step scale.
+    uint* isActive;
+    float *colourR, *colourG, *colourB, *colourA, *stepScale;
+
+    WavefrontLanes( uint capacity, LinearArena& scratch )
+    {
+        float** floatArrays[] = { &positionX, &positionY, &positionZ, &stepX, &stepY, &stepZ, &outputR, &outputG, &outputB, &outputA,
+                                  &numSteps, &intervalD, &marchedD, &nearD, &colourR, &colourG, &colourB, &colourA, &stepScale };
+        for(size_t i=0 ; i<sizeof(floatArrays)/sizeof(floatArrays[0]) ; i++)
+        {
+            *floatArrays[i] = scratch.AllocateArray<float>( capacity + 3 );
+            memset( *floatArrays[i], 0, (capacity + 3) * sizeof(float) );
+        }
+        uint** uintArrays[] = { &stepsTaken, &octavesTaken, &pixelIndex, &isActive };
+        for(size_t i=0 ; i<sizeof(uintArrays)/sizeof(uintArrays[0]) ; i++)
+        {
+            *uintArrays[i] = scratch.AllocateArray<uint>( capacity + 3 );
+            memset( *uintArrays[i], 0, (capacity + 3) * sizeof(uint) );
+        }
+    }
+
+    // Moves a ray's state; the per-step values are rebuilt every step.
+    void Move( uint from, uint to )
+    {
+        positionX[to] = positionX[from]; positionY[to] = positionY[from]; positionZ[to] = positionZ[from];
+        stepX[to] = stepX[from]; stepY[to] = stepY[from]; stepZ[to] = stepZ[from];
+        outputR[to] = outputR[from]; outputG[to] = outputG[from]; outputB[to] = outputB[from]; outputA[to] = outputA[from];
+        numSteps[to] = numSteps[from];
+        intervalD[to] = intervalD[from];
+        marchedD[to] = marchedD[from];
+        nearD[to] = nearD[from];
+        stepsTaken[to] = stepsTaken[from];
+        octavesTaken[to] = octavesTaken[from];
+        pixelIndex[to] = pixelIndex[from];
+    }
+};
+
+// RayMarchExplosion's loop conditions.  Adaptive steps stop at the end of the
+//  interval or after g_MaxNumSteps; fixed ones after numSteps.
+static bool IsLaneFinished( const ExplosionParams& params, const WavefrontLanes& lanes, uint lane )
+{
+    if( lanes.outputA[lane] >= params.g_Opacity ) return true;
+    return params.g_AdaptiveStepping ? lanes.marchedD[lane] >= lanes.intervalD[lane] || lanes.stepsTaken[lane] >= params.g_MaxNumSteps
+                                     : lanes.stepsTaken[lane] >= lanes.numSteps[lane];
+}
+
+// Sets isActive for the unfinished lanes in [begin, end), and clears it for the
+//  rest of the last group of four.  Returns how many lanes are active.
+static uint FindActiveLanes( const ExplosionParams& params, WavefrontLanes& lanes, uint begin, uint end )
+{
+    uint numActive = 0;
+
+#if CPU_MATH_SSE2
+    // IsLaneFinished four lanes at a time; the step counts convert exactly.
+    const __m128 opacity = _mm_set1_ps( params.g_Opacity ), maxNumSteps = _mm_set1_ps( (float)params.g_MaxNumSteps );
+    const __m128i laneIndices = _mm_setr_epi32( 0, 1, 2, 3 );
+
+    for(uint i=begin ; i<end ; i+=4)
+    {
+        const __m128 stepsTaken = _mm_cvtepi32_ps( _mm_loadu_si128( (const __m128i*)&lanes.stepsTaken[i] ) );
+        __m128 isFinished = params.g_AdaptiveStepping
+            ? _mm_or_ps( _mm_cmpge_ps( _mm_loadu_ps( &lanes.marchedD[i] ), _mm_loadu_ps( &lanes.intervalD[i] ) ), _mm_cmpge_ps( stepsTaken, maxNumSteps ) )
+            : _mm_cmpge_ps( stepsTaken, _mm_loadu_ps( &lanes.numSteps[i] ) );
+        isFinished = _mm_or_ps( isFinished, _mm_cmpge_ps( _mm_loadu_ps( &lanes.outputA[i] ), opacity ) );
+
+        const __m128i isInRange = _mm_cmplt_epi32( laneIndices, _mm_set1_epi32( (int)(end - i) ) );
+        const __m128i isActive = _mm_andnot_si128( _mm_castps_si128( isFinished ), isInRange );
+        _mm_storeu_si128( (__m128i*)&lanes.isActive[i], isActive );
+
+        const int activeMask = _mm_movemask_ps( _mm_castsi128_ps( isActive ) );
+        for(uint lane=0 ; lane<4 ; lane++)
+        {
+            numActive += activeMask >> lane & 1;
+        }
+    }
+#else
+    for(uint lane=begin ; lane<end ; lane++)
+    {
+        lanes.isActive[lane] = IsLaneFinished( params, lanes, lane ) ? 0 : ~0u;
+        numActive += lanes.isActive[lane] & 1;
+    }
+#endif
+
+    return numActive;
+}
+
+// Blends each active lane's sample into its output and moves it on by stepScale
+//  steps, as RayMarchExplosion does.  Runs to the end of the last group of four.
+static void AdvanceLanes( const ExplosionParams& params, WavefrontLanes& lanes, uint begin, uint end )
+{
+#if CPU_MATH_SSE2
+    // Blend and the Vec3 updates with the operations in the same order, so that
+    //  every lane rounds the same way.  Inactive lanes keep their state.
+    const __m128 stepSize = _mm_set1_ps( params.g_StepSizeWS );
+    float* const outputs[] = { lanes.outputR, lanes.outputG, lanes.outputB };
+    float* const colours[] = { lanes.colourR, lanes.colourG, lanes.colourB };
+    float* const positions[] = { lanes.positionX, lanes.positionY, lanes.positionZ };
+    float* const steps[] = { lanes.stepX, lanes.stepY, lanes.stepZ };
+
+    for(uint i=begin ; i<end ; i+=4)
+    {
+        const __m128i isActiveInt = _mm_loadu_si128( (const __m128i*)&lanes.isActive[i] );
+        const __m128 isActive = _mm_castsi128_ps( isActiveInt );
+        auto select = [&]( __m128 value, __m128 previous ) { return _mm_or_ps( _mm_and_ps( isActive, value ), _mm_andnot_ps( isActive, previous ) ); };
+
+        const __m128 colourA = _mm_loadu_ps( &lanes.colourA[i] );
+        const __m128 outputA = _mm_loadu_ps( &lanes.outputA[i] );
+        const __m128 weight = _mm_sub_ps( colourA, _mm_mul_ps( colourA, outputA ) );
+        for(uint j=0 ; j<3 ; j++)
+        {
+            const __m128 output = _mm_loadu_ps( &outputs[j][i] );
+            _mm_storeu_ps( &outputs[j][i], select( _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( &colours[j][i] ), weight ), output ), output ) );
+        }
+        _mm_storeu_ps( &lanes.outputA[i], select( _mm_add_ps( weight, outputA ), outputA ) );
+
+        const __m128 stepScale = _mm_loadu_ps( &lanes.stepScale[i] );
+        for(uint j=0 ; j<3 ; j++)
+        {
+            const __m128 position = _mm_loadu_ps( &positions[j][i] );
+            _mm_storeu_ps( &positions[j][i], select( _mm_add_ps( position, _mm_mul_ps( _mm_loadu_ps( &steps[j][i] ), stepScale ) ), position ) );
+        }
+        const __m128 marchedD = _mm_loadu_ps( &lanes.marchedD[i] );
+        _mm_storeu_ps( &lanes.marchedD[i], select( _mm_add_ps( marchedD, _mm_mul_ps( stepSize, stepScale ) ), marchedD ) );
+
+        // isActive is ~0, so subtracting it counts the step.
+        const __m128i stepsTaken = _mm_loadu_si128( (const __m128i*)&lanes.stepsTaken[i] );
+        _mm_storeu_si128( (__m128i*)&lanes.stepsTaken[i], _mm_sub_epi32( stepsTaken, isActiveInt ) );
+    }
+#else
+    for(uint lane=begin ; lane<end ; lane++)
+    {
+        if( !lanes.isActive[lane] ) continue;
+
+        const Vec4 output = Blend( Vec4( lanes.outputR[lane], lanes.outputG[lane], lanes.outputB[lane], lanes.outputA[lane] ),
+                                   Vec4( lanes.colourR[lane], lanes.colourG[lane], lanes.colourB[lane], lanes.colourA[lane] ) );
+        lanes.outputR[lane] = output.x;
+        lanes.outputG[lane] = output.y;
+        lanes.outputB[lane] = output.z;
+        lanes.outputA[lane] = output.w;
+
+        const float stepScale = lanes.stepScale[lane];
+        lanes.positionX[lane] += lanes.stepX[lane] * stepScale;
+        lanes.positionY[lane] += lanes.stepY[lane] * stepScale;
+        lanes.positionZ[lane] += lanes.stepZ[lane] * stepScale;
+        lanes.marchedD[lane] += params.g_StepSizeWS * stepScale;
+        lanes.stepsTaken[lane]++;
+    }
+#endif
+}
+
+void CpuRenderer::RenderWavefront( const ExplosionEvaluator& evaluator, std::atomic<uint>& nextTile, Image& target, RenderStats& stats,
+                                   LinearArena& scratch ) const
+{
+    const ExplosionParams& params = evaluator.GetParams();
+
+    const uint width = target.GetWidth();
+    const uint height = target.GetHeight();
+    const uint tileSize = m_Settings.tileSize;
+    const uint numTilesX = (width + tileSize - 1) / tileSize;
+    const uint numTiles = numTilesX * ((height + tileSize - 1) / tileSize);
+
+    const uint simdWidth = m_Settings.simdWidth;
+    const uint capacity = simdWidth * kWavefrontBatches;
+
+    WavefrontLanes lanes( capacity, scratch );
+    uint numActive = 0;
+
+    const bool isAdaptive = params.g_AdaptiveStepping != 0;
+
+    // The tile currently feeding the queue.
+    uint tileX0 = 0, tileY0 = 0, tileWidth = 0, tilePixels = 0, nextTilePixel = 0;
+    bool hasPixels = true;
+
+    for(;;)
+    {
+        // Refill the queue from new pixels; rays that miss the bounds never enter it.
+        while( numActive < capacity && hasPixels )
+        {
+            if( nextTilePixel == tilePixels )
+            {
+                const uint tile = nextTile++;
+                if( tile >= numTiles )
+                {
+                    hasPixels = false;
+                    break;
+                }
+                tileX0 = (tile % numTilesX) * tileSize;
+                tileY0 = (tile / numTilesX) * tileSize;
+                tileWidth = Min( tileX0 + tileSize, width ) - tileX0;
+                tilePixels = tileWidth * (Min( tileY0 + tileSize, height ) - tileY0);
+                nextTilePixel = 0;
+            }
+
+            const uint x = tileX0 + nextTilePixel % tileWidth;
+            const uint y = tileY0 + nextTilePixel / tileWidth;
+            nextTilePixel++;
+
+            target.At( x, y ) = Vec4( 0.0f );
+            stats.numPixels++;
+
+            const Vec3 rayDirectionWS = GetRayDirectionWS( params, x + 0.5f, y + 0.5f );
+
+            float nearD, farD;
+            if( !GetAnalyticRayInterval( params, rayDirectionWS, nearD, farD ) ) continue;
+            nearD += GetRayStartOffset( evaluator, x, y );
+
+            const Vec3 positionWS = rayDirectionWS * nearD + Vec3( params.g_EyePositionWS );
+            const Vec3 stepWS = rayDirectionWS * params.g_StepSizeWS;
+            lanes.positionX[numActive] = positionWS.x;
+            lanes.positionY[numActive] = positionWS.y;
+            lanes.positionZ[numActive] = positionWS.z;
+            lanes.stepX[numActive] = stepWS.x;
+            lanes.stepY[numActive] = stepWS.y;
+            lanes.stepZ[numActive] = stepWS.z;
+            lanes.outputR[numActive] = lanes.outputG[numActive] = lanes.outputB[numActive] = lanes.outputA[numActive] = 0;
+            lanes.numSteps[numActive] = Min( (float)params.g_MaxNumSteps, (farD - nearD) / params.g_StepSizeWS );
+            lanes.intervalD[numActive] = farD - nearD;
+            lanes.marchedD[numActive] = 0;
+            lanes.nearD[numActive] = nearD;
+            lanes.stepsTaken[numActive] = 0;
+            lanes.octavesTaken[numActive] = 0;
+            lanes.pixelIndex[numActive] = y * width + x;
+            numActive++;
+            stats.numRays++;
+        }
+
+        if( numActive == 0 ) break;
+
+        // Advance each batch in lockstep; lanes whose ray finishes mid-round idle.
+        //  Each step samples the active lanes in turn, then blends and moves them
+        //  on four at a time.
+        for(uint batch=0 ; batch<numActive ; batch+=simdWidth)
+        {
+            const uint batchEnd = std::min( batch + simdWidth, numActive );
+            for(uint step=0 ; step<m_Settings.stepsPerRound ; step++)
+            {
+                if( FindActiveLanes( params, lanes, batch, batchEnd ) == 0 ) break;
+                stats.numLaneSlots += simdWidth;
+
+                for(uint lane=batch ; lane<batchEnd ; lane++)
+                {
+                    if( !lanes.isActive[lane] ) continue;
+
+                    // The view depth of the sample, as RayMarchExplosion works it out.
+                    const float marchedD = isAdaptive ? lanes.marchedD[lane] : lanes.stepsTaken[lane] * params.g_StepSizeWS;
+                    const uint numOctaves = evaluator.SelectNumOctaves( lanes.nearD[lane] + marchedD, lanes.outputA[lane] );
+                    lanes.octavesTaken[lane] += numOctaves;
+
+                    float distance;
+                    const Vec3 positionWS( lanes.positionX[lane], lanes.positionY[lane], lanes.positionZ[lane] );
+                    Vec4 colour = EvaluateMarchStep( evaluator, positionWS, numOctaves, distance );
+                    float stepScale = 1.0f;
+                    if( isAdaptive )
+                    {
+                        stepScale = evaluator.AdaptiveStepScale( distance, lanes.outputA[lane] );
+                        colour.w = AdjustAlphaForStep( colour.w, stepScale * params.g_StepOpacityScale );
+                    }
+                    else if( params.g_StepOpacityScale != 1.0f )
+                    {
+                        colour.w = AdjustAlphaForStep( colour.w, params.g_StepOpacityScale );
+                    }
+                    lanes.colourR[lane] = colour.x;
+                    lanes.colourG[lane] = colour.y;
+                    lanes.colourB[lane] = colour.z;
+                    lanes.colourA[lane] = colour.w;
+                    lanes.stepScale[lane] = stepScale;
+                }
+
+                AdvanceLanes( params, lanes, batch, batchEnd );
+            }
+        }
+
+        // Write out the finished rays and compact the survivors to the front.
+        uint numKept = 0;
+        for(uint lane=0 ; lane<numActive ; lane++)
+        {
+            if( IsLaneFinished( params, lanes, lane ) )
+            {
+                const Vec4 output( lanes.outputR[lane], lanes.outputG[lane], lanes.outputB[lane], lanes.outputA[lane] * params.g_Opacity );
+                target.At( lanes.pixelIndex[lane] % width, lanes.pixelIndex[lane] / width ) = output;
+                stats.numSteps += lanes.stepsTaken[lane];
+                stats.numOctaves += lanes.octavesTaken[lane];
+                continue;
+            }
+
+            if( numKept != lane ) lanes.Move( lane, numKept );
+            numKept++;
+        }
+        numActive = numKept;
+    }
+}
@@ -0,0 +1,161 @@
+#ifndef CPU_RENDERER_H
+#define CPU_RENDERER_H
+
+//--------------------------------------------------------------------------------------
+// Software renderer for the explosion, used by the headless tools.  It reproduces
+//  the output of RenderExplosionPS for every pixel covered by the explosion, with
+//  the ray interval taken from an analytic bounding sphere, or from the tessellated
+//  hull rasterised by HullRasteriser.
+//--------------------------------------------------------------------------------------
+#include <atomic>
+#include <stdint.h>
+
+#include "CpuExplosion.h"
+#include "Image.h"
+
+class CoarseTileMap;
+class FrameArenas;
+class HullDepthBuffer;
+class LinearArena;
+class ThreadPool;
+
+struct RenderStats
+{
+    uint64_t numPixels;
+    uint64_t numRays;       // Pixels whose ray hit the explosion bounds.
+    uint64_t numSteps;      // SceneFunction evaluations.
+    uint64_t numOctaves;    // Noise octaves fetched by those evaluations.
+    uint64_t numLaneSlots;  // Lane-steps issued by simdWidth wide lockstep batches; a wavefront batch stops once all its lanes finish.
+    double milliseconds;
+
+    RenderStats();
+    void Accumulate( const RenderStats& other );
+};
+
+enum CpuMarchMode
+{
+    kMarchTiles,            // Each ray marched to completion, pixel by pixel within a tile.
+    kMarchWavefront         // Rays kept in a queue and advanced in batches, see RenderWavefront.
+};
+
+struct CpuRenderSettings
+{
+    uint tileSize;
+    CpuMarchMode marchMode;
+    uint simdWidth;         // Lanes per batch; tile marching counts lanes over runs of a row.
+    uint stepsPerRound;     // Wavefront steps taken by a batch between compactions.
+    NoisePrecision noisePrecision;
+    bool coarseTiles;       // Classify the frame with CoarseTileMap first; tile marching only.
+    bool tileRaySetup;      // Cull tiles by GetTileRayInterval and set their rays up with SetUpRayBatch.
+    bool hullBounds;        // March between the rasterised hull's depths, as the GPU does; tile marching only.
+
+    CpuRenderSettings();
+};
+
+// The ray direction RenderExplosionDS passes to the pixel shader, scaled so that
+//  its view space z is one; position = eye + direction * viewDepth.
+Vec3 GetRayDirectionWS( const ExplosionParams& params, float pixelX, float pixelY );
+
+// Radius of a sphere about g_ExplosionPositionWS outside which SceneFunction is
+//  guaranteed to return zero opacity, for every primitive.
+float GetExplosionBoundingRadius( const ExplosionParams& params );
+
+// Intersects the ray with the bounding sphere, returning the view depth interval
+//  to march (the equivalent of rayHitNearFar).  Returns false on a miss.
+bool GetAnalyticRayInterval( const ExplosionParams& params, const Vec3& rayDirectionWS, float& nearD, float& farD );
+
+// View depth interval within which every ray through the pixels [x0, x1) x [y0, y1)
+//  meets the bounding sphere: the sphere grown at its far side by how far those
+//  rays spread from the centre one.  Returns false if none of them can hit it.
+bool GetTileRayInterval( const ExplosionParams& params, uint x0, uint y0, uint x1, uint y1, float& nearD, float& farD );
+
+// Directions and analytic intervals of a run of pixels along a row, set up
+//  together.  Each lane gives exactly what GetRayDirectionWS and
+//  GetAnalyticRayInterval would for its pixel.
+const uint kRayBatchSize = 64;
+
+struct RayBatch
+{
+    float directionX[kRayBatchSize], directionY[kRayBatchSize], directionZ[kRayBatchSize];
+    float nearD[kRayBatchSize], farD[kRayBatchSize];
+    bool hits[kRayBatchSize];
+};
+
+// Sets up pixels (x0, y) to (x0 + count - 1, y), count at most kRayBatchSize, four
+//  at a time with SSE2 where it is available.  Returns how many hit the bounds.
+uint SetUpRayBatch( const ExplosionParams& params, uint x0, uint y, uint count, RayBatch& batch );
+
+// Fraction of the screen covered by the projection of the bounding sphere.
+float GetExplosionScreenCoverage( const ExplosionParams& params );
+
+// How far RenderExplosionPS pushes pixel (x, y)'s nearD in with g_DitheredStart:
+//  the blue-noise mask's fraction of a step.
+float GetRayStartOffset( const ExplosionEvaluator& evaluator, uint x, uint y );
+
+// RenderExplosionPS.  If pDepth is given it receives the view depth at which the
+//  accumulated alpha first reached kDepthAlphaThreshold, or farD if it never did.
+//  With g_AdaptiveStepping set the step length follows AdaptiveStepScale; the
+//  wavefront march (RenderWavefront) takes the same steps.  pNumOctaves, if given, receives the noise octaves fetched over all
+//  steps, which g_OctaveCulling lowers from stepsTaken * g_NumOctaves.
+//  pNumEmptySteps, if given, receives the steps taken past the soft edge, where
+//  edgeFade is zero and the step adds nothing.
+Vec4 RayMarchExplosion( const ExplosionEvaluator& evaluator, const Vec3& rayDirectionWS, float nearD, float farD, uint& stepsTaken, float* pDepth = nullptr,
+                        uint* pNumOctaves = nullptr, uint* pNumEmptySteps = nullptr );
+
+const float kDepthAlphaThreshold = 0.5f;
+
+// One iteration of RenderExplosionPS's loop body before the blend.
+inline Vec4 EvaluateMarchStep( const ExplosionEvaluator& evaluator, const Vec3& posWS, uint numOctaves, float& distance )
+{
+    const Vec4 colour = evaluator.SceneFunction( posWS, numOctaves, distance );
+    if( evaluator.GetParams().g_SelfShadowing > 0.0f )
+    {
+        return Vec4( colour.xyz() * evaluator.SelfShadowing( posWS ), colour.w );
+    }
+    return colour;
+}
+
+inline Vec4 EvaluateMarchStep( const ExplosionEvaluator& evaluator, const Vec3& posWS, float& distance )
+{
+    return EvaluateMarchStep( evaluator, posWS, evaluator.GetParams().g_NumOctaves, distance );
+}
+
+inline Vec4 EvaluateMarchStep( const ExplosionEvaluator& evaluator, const Vec3& posWS )
+{
+    float distance;
+    return EvaluateMarchStep( evaluator, posWS, distance );
+}
+
+class CpuRenderer
+{
+public:
+    explicit CpuRenderer( const CpuRenderSettings& settings );
+
+    // Renders a full frame at the resolution in g_ScreenParams.  Tiles are spread
+    //  across the pool when one is given, otherwise the calling thread does all the work.
+    //  Transient data comes from pArenas, reset when the frame is done; pass the same
+    //  arenas every frame and, once they have grown to fit, nothing is allocated.
+    void RenderFrame( const ExplosionParams& params, const SceneTextures& textures, Image& target, ThreadPool* pPool, RenderStats* pStats,
+                      FrameArenas* pArenas = nullptr ) const;
+
+    // With pCoarseTiles, pixels of empty tiles are cleared without a ray and the rest
+    //  march only the interval their tile's coarse ray left them.  With pHullDepths,
+    //  rays march between the hull's depths rather than the bounding sphere's, and
+    //  pixels the hull does not cover are cleared.
+    void RenderTile( const ExplosionEvaluator& evaluator, uint x0, uint y0, uint x1, uint y1, Image& target, RenderStats& stats,
+                     const CoarseTileMap* pCoarseTiles = nullptr, const HullDepthBuffer* pHullDepths = nullptr ) const;
+
+    // Wavefront marching for one thread: keeps a queue of ray states filled from the
+    //  tiles it takes from nextTile, advances them simdWidth at a time for
+    //  stepsPerRound steps, then writes out and compacts away the finished rays.  Each
+    //  step samples the batch's lanes one by one, then tests, blends and moves them
+    //  four at a time with SSE2.  The queue is allocated from the thread's scratch arena.
+    void RenderWavefront( const ExplosionEvaluator& evaluator, std::atomic<uint>& nextTile, Image& target, RenderStats& stats, LinearArena& scratch ) const;
+
+    const CpuRenderSettings& GetSettings() const { return m_Settings; }
+
+private:
+    CpuRenderSettings m_Settings;
+};
+
+#endif // CPU_RENDERER_H
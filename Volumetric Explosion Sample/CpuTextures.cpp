@@ -0,0 +1,477 @@
+#include "CpuTextures.h"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string.h>
+
+//--------------------------------------------------------------------------------------
+// Noise volume
+//--------------------------------------------------------------------------------------
+namespace
+{
+    uint Log2( uint powerOfTwo )
+    {
+        uint shift = 0;
+        while( (1u << shift) < powerOfTwo ) shift++;
+        return shift;
+    }
+}
+
+bool ParseNoiseVolumeLayout( const char* pName, NoiseVolumeLayout& layout )
+{
+    if( strcmp( pName, "linear" ) == 0 ) layout = kNoiseLayoutLinear;
+    else if( strcmp( pName, "bricked" ) == 0 ) layout = kNoiseLayoutBricked;
+    else if( strcmp( pName, "morton" ) == 0 ) layout = kNoiseLayoutMorton;
+    else if( strcmp( pName, "padded" ) == 0 ) layout = kNoiseLayoutPadded;
+    else return false;
+    return true;
+}
+
+NoiseVolume::NoiseVolume()
+    : m_Size(0)
+    , m_Mask(0)
+    , m_Layout(kNoiseLayoutLinear)
+    , m_LargestAbsoluteValue(0)
+    , m_MeanAbsoluteValue(0)
+    , m_UnormScale(0)
+    , m_UnormBias(0)
+{
+}
+
+bool NoiseVolume::LoadFromFile( const char* pFileName, uint size )
+{
+    if( size == 0 || (size & (size - 1)) != 0 ) return false;
+
+    std::fstream f;
+    f.open(pFileName, std::ios::in);
+    if( !f.is_open() ) return false;
+
+    const uint numValues = size * size * size;
+    std::vector<float> values( numValues );
+
+    // InitDevice tracks the min and max of the raw half bit patterns rather than of
+    //  the values they represent.  Do the same so we derive the same displacement bounds.
+    uint16_t maxNoiseValue = 0, minNoiseValue = 0xFFFF;
+    for(uint i=0 ; i<numValues ; i++)
+    {
+        uint16_t noiseValue;
+        f >> noiseValue;
+        if( f.fail() ) return false;
+
+        maxNoiseValue = noiseValue > maxNoiseValue ? noiseValue : maxNoiseValue;
+        minNoiseValue = noiseValue < minNoiseValue ? noiseValue : minNoiseValue;
+
+        values[i] = HalfToFloat( noiseValue );
+    }
+    f.close();
+
+    SetValues( size, values );
+    m_LargestAbsoluteValue = Max( fabsf( HalfToFloat( maxNoiseValue ) ), fabsf( HalfToFloat( minNoiseValue ) ) );
+
+    return true;
+}
+
+bool NoiseVolume::Resample( const NoiseVolume& source, uint size )
+{
+    if( size == 0 || (size & (size - 1)) != 0 || source.m_Size == 0 ) return false;
+
+    std::vector<float> values( size * size * size );
+    float largestAbsoluteValue = 0;
+    for(uint z=0 ; z<size ; z++)
+    {
+        for(uint y=0 ; y<size ; y++)
+        {
+            for(uint x=0 ; x<size ; x++)
+            {
+                const Vec3 uvw = (Vec3( (float)x, (float)y, (float)z ) + Vec3( 0.5f )) * (1.0f / size);
+                const float value = source.Sample( uvw );
+                values[(z * size + y) * size + x] = value;
+                largestAbsoluteValue = Max( largestAbsoluteValue, fabsf( value ) );
+            }
+        }
+    }
+
+    SetValues( size, values );
+    m_LargestAbsoluteValue = largestAbsoluteValue;
+    return true;
+}
+
+void NoiseVolume::SetValues( uint size, std::vector<float>& values )
+{
+    m_Size = size;
+    m_Mask = size - 1;
+    m_Values.swap( values );
+
+    m_Layout = kNoiseLayoutLinear;
+    for(uint axis=0 ; axis<3 ; axis++)
+    {
+        m_AxisOffsets[axis].resize( size );
+        for(uint i=0 ; i<size ; i++) m_AxisOffsets[axis][i] = i << (axis * Log2( size ));
+    }
+
+    float minValue = m_Values[0], maxValue = m_Values[0];
+    double sumAbsoluteValues = 0;
+    for(size_t i=0 ; i<m_Values.size() ; i++)
+    {
+        minValue = Min( minValue, m_Values[i] );
+        maxValue = Max( maxValue, m_Values[i] );
+        sumAbsoluteValues += fabsf( m_Values[i] );
+    }
+    m_MeanAbsoluteValue = (float)(sumAbsoluteValues / m_Values.size());
+
+    // Widen the range to include zero and snap the bias to a whole number of
+    //  quantisation steps, so that zero is one of the 256 levels.
+    minValue = Min( minValue, 0.0f );
+    maxValue = Max( maxValue, 0.0f );
+    const float step = Max( maxValue - minValue, 1e-6f ) / 255.0f;
+    const float zeroLevel = floorf( -minValue / step + 0.5f );
+    m_UnormScale = step * 255.0f;
+    m_UnormBias = -zeroLevel * step;
+
+    m_HalfValues.resize( m_Values.size() );
+    m_UnormValues.resize( m_Values.size() );
+    for(size_t i=0 ; i<m_Values.size() ; i++)
+    {
+        m_HalfValues[i] = FloatToHalf( m_Values[i] );
+        m_UnormValues[i] = (uint8_t)Clamp( floorf( m_Values[i] / step + zeroLevel + 0.5f ), 0.0f, 255.0f );
+    }
+
+    m_ValueGradients.clear();
+}
+
+void NoiseVolume::BuildValueGradients()
+{
+    // Every texel of the layout, the padded layout's apron included, from the
+    //  wrapped neighbours either side.  Gradients are per unit of uvw.
+    const uint axisSize = (uint)m_AxisOffsets[0].size();
+    std::vector<uint16_t>( (size_t)axisSize * axisSize * axisSize * 4 ).swap( m_ValueGradients );
+    const float differenceScale = 0.5f * m_Size;
+    for(uint z=0 ; z<axisSize ; z++)
+    {
+        for(uint y=0 ; y<axisSize ; y++)
+        {
+            for(uint x=0 ; x<axisSize ; x++)
+            {
+                const uint wx = x & m_Mask, wy = y & m_Mask, wz = z & m_Mask;
+                const float dx = Fetch( (wx + 1) & m_Mask, wy, wz ) - Fetch( (wx - 1) & m_Mask, wy, wz );
+                const float dy = Fetch( wx, (wy + 1) & m_Mask, wz ) - Fetch( wx, (wy - 1) & m_Mask, wz );
+                const float dz = Fetch( wx, wy, (wz + 1) & m_Mask ) - Fetch( wx, wy, (wz - 1) & m_Mask );
+                uint16_t* pTexel = &m_ValueGradients[(size_t)GetTexelIndex( x, y, z ) * 4];
+                pTexel[0] = FloatToHalf( Fetch( wx, wy, wz ) );
+                pTexel[1] = FloatToHalf( dx * differenceScale );
+                pTexel[2] = FloatToHalf( dy * differenceScale );
+                pTexel[3] = FloatToHalf( dz * differenceScale );
+            }
+        }
+    }
+}
+
+bool NoiseVolume::SetLayout( NoiseVolumeLayout layout )
+{
+    const uint size = m_Size;
+    if( size == 0 || (layout == kNoiseLayoutBricked && size < 4) ) return false;
+    if( layout == m_Layout ) return true;
+
+    const uint sizeShift = Log2( size );
+    const uint paddedSize = size + 1;
+    const uint axisSize = layout == kNoiseLayoutPadded ? paddedSize : size;
+    std::vector<uint32_t> axisOffsets[3];
+    for(uint axis=0 ; axis<3 ; axis++)
+    {
+        axisOffsets[axis].resize( axisSize );
+        for(uint i=0 ; i<axisSize ; i++)
+        {
+            uint32_t offset = 0;
+            if( layout == kNoiseLayoutLinear )
+            {
+                offset = i << (axis * sizeShift);
+            }
+            else if( layout == kNoiseLayoutPadded )
+            {
+                offset = i * (axis == 0 ? 1 : axis == 1 ? paddedSize : paddedSize * paddedSize);
+            }
+            else if( layout == kNoiseLayoutBricked )
+            {
+                // Texel within the brick in the low 6 bits, then the brick.
+                const uint bricksShift = sizeShift - 2;
+                offset = ((i & 3) << (axis * 2)) | ((i >> 2) << (6 + axis * bricksShift));
+            }
+            else
+            {
+                for(uint bit=0 ; bit<sizeShift ; bit++) offset |= ((i >> bit) & 1) << (bit * 3 + axis);
+            }
+            axisOffsets[axis][i] = offset;
+        }
+    }
+
+    // The padded layout's apron is filled with wrapped copies.
+    const size_t numTexels = (size_t)axisSize * axisSize * axisSize;
+    std::vector<float> values( numTexels );
+    std::vector<uint16_t> halfValues( numTexels );
+    std::vector<uint8_t> unormValues( numTexels );
+    for(uint z=0 ; z<axisSize ; z++)
+    {
+        for(uint y=0 ; y<axisSize ; y++)
+        {
+            for(uint x=0 ; x<axisSize ; x++)
+            {
+                const uint from = GetTexelIndex( x & m_Mask, y & m_Mask, z & m_Mask );
+                const uint to = axisOffsets[0][x] + axisOffsets[1][y] + axisOffsets[2][z];
+                values[to] = m_Values[from];
+                halfValues[to] = m_HalfValues[from];
+                unormValues[to] = m_UnormValues[from];
+            }
+        }
+    }
+
+    m_Values.swap( values );
+    m_HalfValues.swap( halfValues );
+    m_UnormValues.swap( unormValues );
+    for(uint axis=0 ; axis<3 ; axis++) m_AxisOffsets[axis].swap( axisOffsets[axis] );
+    m_Layout = layout;
+
+    for(uint corner=0 ; corner<8 ; corner++)
+    {
+        m_CornerOffsets[corner] = m_AxisOffsets[0][corner & 1] + m_AxisOffsets[1][(corner >> 1) & 1] + m_AxisOffsets[2][corner >> 2];
+    }
+
+    // Rebuilt in the new order rather than copied, so that only one copy of the
+    //  biggest array is ever held.
+    if( HasValueGradients() )
+    {
+        std::vector<uint16_t>().swap( m_ValueGradients );
+        BuildValueGradients();
+    }
+    return true;
+}
+
+void NoiseVolume::GetCornerIndices( const Vec3& uvw, uint indices[8], Vec3& t ) const
+{
+    // Texel centres sit at half-texel offsets, as with the D3D sampler.
+    const Vec3 texel = uvw * (float)m_Size - Vec3( 0.5f );
+    const Vec3 base = Floor( texel );
+    t = texel - base;
+
+    const uint x0 = (uint)(int)base.x & m_Mask;
+    const uint y0 = (uint)(int)base.y & m_Mask;
+    const uint z0 = (uint)(int)base.z & m_Mask;
+
+    if( m_Layout == kNoiseLayoutPadded )
+    {
+        const uint index = (z0 * (m_Size + 1) + y0) * (m_Size + 1) + x0;
+        for(uint corner=0 ; corner<8 ; corner++) indices[corner] = index + m_CornerOffsets[corner];
+        return;
+    }
+
+    const uint x1 = (x0 + 1) & m_Mask, y1 = (y0 + 1) & m_Mask, z1 = (z0 + 1) & m_Mask;
+    const uint32_t* pX = &m_AxisOffsets[0][0];
+    const uint32_t* pY = &m_AxisOffsets[1][0];
+    const uint32_t* pZ = &m_AxisOffsets[2][0];
+    const uint row0 = pY[y0] + pZ[z0], row1 = pY[y1] + pZ[z0];
+    const uint row2 = pY[y0] + pZ[z1], row3 = pY[y1] + pZ[z1];
+    indices[0] = row0 + pX[x0]; indices[1] = row0 + pX[x1];
+    indices[2] = row1 + pX[x0]; indices[3] = row1 + pX[x1];
+    indices[4] = row2 + pX[x0]; indices[5] = row2 + pX[x1];
+    indices[6] = row3 + pX[x0]; indices[7] = row3 + pX[x1];
+}
+
+float NoiseVolume::Sample( const Vec3& uvw ) const
+{
+    uint i[8];
+    Vec3 t;
+    GetCornerIndices( uvw, i, t );
+
+    const float* pValues = &m_Values[0];
+    const float c00 = Lerp( pValues[i[0]], pValues[i[1]], t.x );
+    const float c10 = Lerp( pValues[i[2]], pValues[i[3]], t.x );
+    const float c01 = Lerp( pValues[i[4]], pValues[i[5]], t.x );
+    const float c11 = Lerp( pValues[i[6]], pValues[i[7]], t.x );
+
+    return Lerp( Lerp( c00, c10, t.y ), Lerp( c01, c11, t.y ), t.z );
+}
+
+Vec4 NoiseVolume::SampleValueGradient( const Vec3& uvw ) const
+{
+    uint i[8];
+    Vec3 t;
+    GetCornerIndices( uvw, i, t );
+
+    // Two corners' halves per conversion.
+    const uint16_t* pHalves = &m_ValueGradients[0];
+    Vec4 corners[8];
+    for(uint pair=0 ; pair<4 ; pair++)
+    {
+        uint16_t halves[8];
+        memcpy( halves, pHalves + (size_t)i[pair * 2] * 4, 4 * sizeof(uint16_t) );
+        memcpy( halves + 4, pHalves + (size_t)i[pair * 2 + 1] * 4, 4 * sizeof(uint16_t) );
+
+        float c[8];
+        HalfToFloat8( halves, c );
+        corners[pair * 2] = Vec4( c[0], c[1], c[2], c[3] );
+        corners[pair * 2 + 1] = Vec4( c[4], c[5], c[6], c[7] );
+    }
+
+    const Vec4 c00 = Lerp( corners[0], corners[1], t.x );
+    const Vec4 c10 = Lerp( corners[2], corners[3], t.x );
+    const Vec4 c01 = Lerp( corners[4], corners[5], t.x );
+    const Vec4 c11 = Lerp( corners[6], corners[7], t.x );
+
+    return Lerp( Lerp( c00, c10, t.y ), Lerp( c01, c11, t.y ), t.z );
+}
+
+float NoiseVolume::SampleHalf( const Vec3& uvw ) const
+{
+    uint i[8];
+    Vec3 t;
+    GetCornerIndices( uvw, i, t );
+
+    const uint16_t* pHalves = &m_HalfValues[0];
+    const uint16_t corners[8] =
+    {
+        pHalves[i[0]], pHalves[i[1]], pHalves[i[2]], pHalves[i[3]],
+        pHalves[i[4]], pHalves[i[5]], pHalves[i[6]], pHalves[i[7]]
+    };
+
+    float c[8];
+    HalfToFloat8( corners, c );
+
+    const float c00 = Lerp( c[0], c[1], t.x );
+    const float c10 = Lerp( c[2], c[3], t.x );
+    const float c01 = Lerp( c[4], c[5], t.x );
+    const float c11 = Lerp( c[6], c[7], t.x );
+
+    return Lerp( Lerp( c00, c10, t.y ), Lerp( c01, c11, t.y ), t.z );
+}
+
+float NoiseVolume::SampleUnorm8Raw( const Vec3& uvw ) const
+{
+    uint i[8];
+    Vec3 t;
+    GetCornerIndices( uvw, i, t );
+
+    const uint8_t* pUnorms = &m_UnormValues[0];
+    const uint8_t corners[8] =
+    {
+        pUnorms[i[0]], pUnorms[i[1]], pUnorms[i[2]], pUnorms[i[3]],
+        pUnorms[i[4]], pUnorms[i[5]], pUnorms[i[6]], pUnorms[i[7]]
+    };
+
+    float c[8];
+    Unorm8ToFloat8( corners, c );
+
+    const float c00 = Lerp( c[0], c[1], t.x );
+    const float c10 = Lerp( c[2], c[3], t.x );
+    const float c01 = Lerp( c[4], c[5], t.x );
+    const float c11 = Lerp( c[6], c[7], t.x );
+
+    return Lerp( Lerp( c00, c10, t.y ), Lerp( c01, c11, t.y ), t.z );
+}
+
+//--------------------------------------------------------------------------------------
+// Gradient texture
+//--------------------------------------------------------------------------------------
+namespace
+{
+    uint MaskShift( uint mask )
+    {
+        uint shift = 0;
+        while( mask != 0 && (mask & 1) == 0 ) { mask >>= 1; shift++; }
+        return shift;
+    }
+
+    float MaskToUnorm( uint pixel, uint mask )
+    {
+        if( mask == 0 ) return 1.0f;
+        return (float)((pixel & mask) >> MaskShift( mask )) / (float)(mask >> MaskShift( mask ));
+    }
+
+    uint ReadUint( const unsigned char* pData )
+    {
+        return pData[0] | (pData[1] << 8) | (pData[2] << 16) | ((uint)pData[3] << 24);
+    }
+}
+
+GradientTexture::GradientTexture()
+    : m_Width(0)
+    , m_Height(0)
+{
+}
+
+bool GradientTexture::LoadFromFile( const char* pFileName )
+{
+    std::ifstream f( pFileName, std::ios::in | std::ios::binary );
+    if( !f.is_open() ) return false;
+
+    std::vector<unsigned char> file( (std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>() );
+
+    // "DDS " + DDS_HEADER.
+    const uint kHeaderSize = 4 + 124;
+    if( file.size() < kHeaderSize || memcmp( &file[0], "DDS ", 4 ) != 0 ) return false;
+
+    const unsigned char* pHeader = &file[4];
+    const uint height = ReadUint( pHeader + 8 );
+    const uint width = ReadUint( pHeader + 12 );
+    const unsigned char* pPixelFormat = pHeader + 72;
+    const uint fourCC = ReadUint( pPixelFormat + 8 );
+    const uint bitCount = ReadUint( pPixelFormat + 12 );
+    const uint rMask = ReadUint( pPixelFormat + 16 );
+    const uint gMask = ReadUint( pPixelFormat + 20 );
+    const uint bMask = ReadUint( pPixelFormat + 24 );
+    const uint aMask = ReadUint( pPixelFormat + 28 );
+
+    if( fourCC != 0 || bitCount != 32 ) return false;
+    if( file.size() < kHeaderSize + width * height * 4 ) return false;
+
+    m_Width = width;
+    m_Height = height;
+    m_Texels.resize( width * height );
+    for(uint i=0 ; i<width * height ; i++)
+    {
+        const uint pixel = ReadUint( &file[kHeaderSize + i * 4] );
+        m_Texels[i] = Vec4( MaskToUnorm( pixel, rMask ), MaskToUnorm( pixel, gMask ), MaskToUnorm( pixel, bMask ), MaskToUnorm( pixel, aMask ) );
+    }
+
+    return true;
+}
+
+Vec4 GradientTexture::Sample( float u, float v ) const
+{
+    const float x = Clamp( u * m_Width - 0.5f, 0.0f, (float)(m_Width - 1) );
+    const float y = Clamp( v * m_Height - 0.5f, 0.0f, (float)(m_Height - 1) );
+
+    const uint x0 = (uint)x, x1 = x0 + 1 < m_Width ? x0 + 1 : x0;
+    const uint y0 = (uint)y, y1 = y0 + 1 < m_Height ? y0 + 1 : y0;
+    const float tx = x - x0, ty = y - y0;
+
+    const Vec4 top = Lerp( m_Texels[y0 * m_Width + x0], m_Texels[y0 * m_Width + x1], tx );
+    const Vec4 bottom = Lerp( m_Texels[y1 * m_Width + x0], m_Texels[y1 * m_Width + x1], tx );
+    return Lerp( top, bottom, ty );
+}
+
+//--------------------------------------------------------------------------------------
+// Scene textures
+//--------------------------------------------------------------------------------------
+SceneTextures::SceneTextures()
+    : pTransmittanceVolume(nullptr)
+{
+}
+
+bool SceneTextures::Load( const char* pMediaDirectory, ThreadPool* pPool )
+{
+    std::string directory = pMediaDirectory ? pMediaDirectory : "";
+    if( !directory.empty() && directory[directory.size() - 1] != '/' && directory[directory.size() - 1] != '\\' )
+    {
+        directory += "/";
+    }
+
+    if( !noiseVolume.LoadFromFile( (directory + "noise_32x32x32.dat").c_str(), 32 ) ) return false;
+    if( !gradient.LoadFromFile( (directory + "gradient.dds").c_str() ) ) return false;
+
+    if( !blueNoise.Load( (directory + "blue_noise.pgm").c_str() ) || blueNoise.GetSize() != BLUE_NOISE_SIZE )
+    {
+        if( !blueNoise.Generate( BLUE_NOISE_SIZE, pPool ) ) return false;
+    }
+
+    return true;
+}
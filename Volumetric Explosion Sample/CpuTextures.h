@@ -0,0 +1,162 @@
+#ifndef CPU_TEXTURES_H
+#define CPU_TEXTURES_H
+
+//--------------------------------------------------------------------------------------
+// CPU copies of the textures bound to RenderExplosion.hlsli, with samplers that
+//  match BilinearWrappedSampler and BilinearClampedSampler.
+//--------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <vector>
+
+#include "BlueNoise.h"
+#include "CpuMath.h"
+
+class ThreadPool;
+class TransmittanceVolume;
+
+// Texel orders for NoiseVolume.  A trilinear fetch reads a 2x2x2 block, which in
+//  x-major order lies on two rows of two slices, size^2 texels apart; once the
+//  volume outgrows the cache that is four misses.  The swizzled orders keep small
+//  cubes of texels together in memory.
+enum NoiseVolumeLayout
+{
+    kNoiseLayoutLinear,         // x-major, as uploaded to the GPU.
+    kNoiseLayoutBricked,        // 4^3 texel bricks, x-major within and between bricks.
+    kNoiseLayoutMorton,         // The bits of x, y and z interleaved.
+    kNoiseLayoutPadded          // x-major (size+1)^3, the last texel of each row, column and slice
+                                //  repeating the first so the upper corners never need wrapping.
+};
+
+// Parses "linear", "bricked", "morton" or "padded".
+bool ParseNoiseVolumeLayout( const char* pName, NoiseVolumeLayout& layout );
+
+class NoiseVolume
+{
+public:
+    NoiseVolume();
+
+    // Reads the same text file of half-float bit patterns that InitDevice uploads
+    //  to the R16_FLOAT volume.  The size must be a power of two.
+    bool LoadFromFile( const char* pFileName, uint size );
+
+    // Builds a size^3 volume by sampling another one at this volume's texel
+    //  centres, for benchmarking at other sizes.  The size must be a power of two.
+    bool Resample( const NoiseVolume& source, uint size );
+
+    uint GetSize() const { return m_Size; }
+
+    // The value InitDevice feeds into the maximum noise displacement calculation.
+    float GetLargestAbsoluteValue() const { return m_LargestAbsoluteValue; }
+
+    // Mean of the texels' absolute values, what an octave adds to the fractal noise
+    //  on average (g_NoiseMeanAbsValue).
+    float GetMeanAbsoluteValue() const { return m_MeanAbsoluteValue; }
+
+    // Reorders the texels.  Sampling gives the same results in every layout.
+    //  kNoiseLayoutBricked needs a volume of at least 4^3.
+    bool SetLayout( NoiseVolumeLayout layout );
+    NoiseVolumeLayout GetLayout() const { return m_Layout; }
+
+    // Position of texel (x, y, z) in the current layout.
+    uint GetTexelIndex( uint x, uint y, uint z ) const
+    {
+        return m_AxisOffsets[0][x] + m_AxisOffsets[1][y] + m_AxisOffsets[2][z];
+    }
+
+    float Fetch( uint x, uint y, uint z ) const
+    {
+        return m_Values[ GetTexelIndex( x, y, z ) ];
+    }
+
+    // Trilinear filtered lookup with wrap addressing (BilinearWrappedSampler).
+    float Sample( const Vec3& uvw ) const;
+
+    // Sample reading the half texels, as stored in the R16_FLOAT volume, and
+    //  converting the eight corners together after the fetch.  The result is the
+    //  same; the texels take half the cache.
+    float SampleHalf( const Vec3& uvw ) const;
+
+    // Sample from the R8_UNORM copy: the eight texels are filtered as UNORM, as a
+    //  sampler would, and dequantised afterwards with a single multiply-add.
+    float SampleUnorm8( const Vec3& uvw ) const { return SampleUnorm8Raw( uvw ) * m_UnormScale + m_UnormBias; }
+    float SampleUnorm8Raw( const Vec3& uvw ) const;
+
+    // Builds the value+gradient copy that SampleValueGradient reads: RGBA16F texels
+    //  of (value, d/du, d/dv, d/dw), in the current layout.  At 8 bytes a texel it is
+    //  the largest copy, so only the callers that sample it build it, before the
+    //  volume is shared between threads.  Changing the values drops it; changing
+    //  the layout rebuilds it.
+    void BuildValueGradients();
+    bool HasValueGradients() const { return !m_ValueGradients.empty(); }
+
+    // Trilinear filtered lookup from the value+gradient copy, converting the halves
+    //  after the fetch as SampleHalf does.  The gradient is the central difference
+    //  of the neighbouring texels, so the filtered gradient is smooth but only
+    //  approximates the derivative of the filtered value, which jumps at texel
+    //  boundaries.
+    Vec4 SampleValueGradient( const Vec3& uvw ) const;
+
+    // The value+gradient texels for the GPU's RGBA16F copy.  In the volume's layout,
+    //  so only x-major with kNoiseLayoutLinear; BuildValueGradients first.
+    const uint16_t* GetValueGradientTexels() const { return &m_ValueGradients[0]; }
+
+    // The R8_UNORM copy and its dequantisation, value = unorm * scale + bias.  The
+    //  range covers the values' true minimum and maximum, with zero exactly
+    //  representable so abs() in FractalNoiseAtPositionWS folds in the same place.
+    //  The texels are in the volume's layout, so only x-major with kNoiseLayoutLinear.
+    const uint8_t* GetUnormTexels() const { return &m_UnormValues[0]; }
+    float GetUnormScale() const { return m_UnormScale; }
+    float GetUnormBias() const { return m_UnormBias; }
+
+private:
+    void SetValues( uint size, std::vector<float>& values );
+    void GetCornerIndices( const Vec3& uvw, uint indices[8], Vec3& t ) const;
+
+    uint m_Size;
+    uint m_Mask;
+    NoiseVolumeLayout m_Layout;
+    std::vector<uint32_t> m_AxisOffsets[3];     // Every layout's index is a sum of one offset per axis.
+    uint32_t m_CornerOffsets[8];                // kNoiseLayoutPadded: the corners relative to the lowest.
+    float m_LargestAbsoluteValue;
+    float m_MeanAbsoluteValue;
+    std::vector<float> m_Values;
+    std::vector<uint16_t> m_HalfValues;
+    std::vector<uint8_t> m_UnormValues;
+    std::vector<uint16_t> m_ValueGradients;     // Four halves a texel; empty until BuildValueGradients.
+    float m_UnormScale, m_UnormBias;
+};
+
+class GradientTexture
+{
+public:
+    GradientTexture();
+
+    // Minimal DDS reader, enough for the uncompressed 32bpp gradient.dds.
+    bool LoadFromFile( const char* pFileName );
+
+    // Bilinear filtered lookup with clamp addressing (BilinearClampedSampler).
+    Vec4 Sample( float u, float v ) const;
+
+private:
+    uint m_Width, m_Height;
+    std::vector<Vec4> m_Texels;
+};
+
+// Everything read-only that a CPU render of the explosion needs.  Loaded once
+//  and shared between all the frames and threads that render with it.
+struct SceneTextures
+{
+    NoiseVolume noiseVolume;
+    GradientTexture gradient;
+    BlueNoiseMask blueNoise;                            // BLUE_NOISE_SIZE^2, see GetRayStartOffset.
+    const TransmittanceVolume* pTransmittanceVolume;    // Optional, see SelfShadowing.
+
+    SceneTextures();
+
+    // The blue-noise mask is read from blue_noise.pgm if the media directory has
+    //  one of BLUE_NOISE_SIZE (see the blue-noise headless command) and generated,
+    //  on the pool if one is given, otherwise.
+    bool Load( const char* pMediaDirectory, ThreadPool* pPool = nullptr );
+};
+
+#endif // CPU_TEXTURES_H
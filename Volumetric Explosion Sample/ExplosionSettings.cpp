@@ -0,0 +1,138 @@
+#include "ExplosionSettings.h"
+#include "CpuMath.h"
+
+#include <string.h>
+
+bool ParsePrimitiveType( const char* pName, PrimitiveType& primitive )
+{
+    if( strcmp( pName, "sphere" ) == 0 ) primitive = kPrimitiveSphere;
+    else if( strcmp( pName, "cylinder" ) == 0 ) primitive = kPrimitiveCylinder;
+    else if( strcmp( pName, "cone" ) == 0 ) primitive = kPrimitiveCone;
+    else if( strcmp( pName, "torus" ) == 0 ) primitive = kPrimitiveTorus;
+    else if( strcmp( pName, "box" ) == 0 ) primitive = kPrimitiveBox;
+    else return false;
+    return true;
+}
+
+ExplosionSettings::ExplosionSettings()
+    : enableHullShrinking(true)
+    , adaptiveHullShrinking(false)
+    , adaptiveStepping(false)
+    , octaveCulling(false)
+    , ditheredStart(false)
+    , stepSizeScale(1.0f)
+    , edgeSoftness(0.05f)
+    , noiseScale(0.04f)
+    , explosionRadius(4.0f)
+    , displacementAmount(1.75f)
+    , uvScaleBias(2.1f, 0.35f)
+    , noiseAmplitudeFactor(0.4f)
+    , noiseFrequencyFactor(3.0f)
+    , primitive(kPrimitiveSphere)
+    , selfShadowing(0.0f)
+{
+}
+
+OrbitCamera::OrbitCamera()
+    : theta(0)
+    , phi(0)
+    , radius(10)
+{
+}
+
+void ComputeNoiseBounds( float largestAbsoluteNoiseValue, float noiseAmplitudeFactor, float& maxNoiseDisplacement, float& maxSkinThickness )
+{
+    maxNoiseDisplacement = 0;
+    for(uint i=0 ; i<kNumOctaves ; i++)
+    {
+        maxNoiseDisplacement += largestAbsoluteNoiseValue * kNoiseInitialAmplitude * powf(noiseAmplitudeFactor, (float)i);
+    }
+
+    // The skin thickness is the amount of displacement to add to the geometry hull
+    //  after shrinking it around the explosion primitive.
+    maxSkinThickness = 0;
+    for(uint i=kNumHullOctaves ; i<kNumOctaves ; i++)
+    {
+        maxSkinThickness += largestAbsoluteNoiseValue * kNoiseInitialAmplitude * powf(noiseAmplitudeFactor, (float)i);
+    }
+    // Add a little bit extra to account for under-tessellation.  This should be
+    //  fine tuned on a per use basis for best performance.
+    maxSkinThickness += kSkinThicknessBias;
+}
+
+void BuildExplosionParams( const ExplosionSettings& settings, const OrbitCamera& camera, float time, uint width, uint height,
+                           float largestAbsoluteNoiseValue, ExplosionParams& params )
+{
+    OrbitCamera clampedCamera = camera;
+    clampedCamera.phi = Clamp( camera.phi, 0.1f, PI - 0.1f );
+
+    const Vec3 lookAtWS( kEyeLookAtWS );
+    const Vec3 eyePositionWS( clampedCamera.radius * sinf(clampedCamera.phi) * cosf(clampedCamera.theta),
+                              clampedCamera.radius * cosf(clampedCamera.phi),
+                              clampedCamera.radius * sinf(clampedCamera.phi) * sinf(clampedCamera.theta) );
+    const Vec3 eyeForwardWS = Normalize( lookAtWS - eyePositionWS );
+
+    float4x4 viewMatrix, projMatrix;
+    MatrixLookAtLH( eyePositionWS, lookAtWS, Vec3( 0, 1, 0 ), viewMatrix );
+    MatrixPerspectiveFovLH( 60*PI/180, (float)width/height, kNearClip, kFarClip, projMatrix );
+
+    params.g_WorldToViewMatrix = viewMatrix;
+    params.g_ViewToProjectionMatrix = projMatrix;
+    MatrixInverse( projMatrix, params.g_ProjectionToViewMatrix );
+    MatrixMultiply( viewMatrix, projMatrix, params.g_WorldToProjectionMatrix );
+    MatrixInverse( params.g_WorldToProjectionMatrix, params.g_ProjectionToWorldMatrix );
+    MatrixInverse( viewMatrix, params.g_ViewToWorldMatrix );
+
+    const float A = kFarClip / (kFarClip - kNearClip);
+    const float B = (-kFarClip * kNearClip) / (kFarClip - kNearClip);
+    const float C = (kFarClip - kNearClip);
+    const float D = kNearClip;
+
+    float maxNoiseDisplacement, maxSkinThickness;
+    ComputeNoiseBounds( largestAbsoluteNoiseValue, settings.noiseAmplitudeFactor, maxNoiseDisplacement, maxSkinThickness );
+
+    params.g_EyePositionWS = float3( eyePositionWS.x, eyePositionWS.y, eyePositionWS.z );
+    params.g_NoiseAmplitudeFactor = settings.noiseAmplitudeFactor;
+    params.g_EyeForwardWS = float3( eyeForwardWS.x, eyeForwardWS.y, eyeForwardWS.z );
+    params.g_NoiseScale = settings.noiseScale;
+    params.g_ProjectionParams = float4( A, B, C, D );
+    params.g_ScreenParams = float4( (float)width, (float)height, 1.f/width, 1.f/height );
+    params.g_ExplosionPositionWS = kEyeLookAtWS;
+    params.g_ExplosionRadiusWS = settings.explosionRadius;
+    params.g_NoiseAnimationSpeed = kNoiseAnimationSpeed;
+    params.g_Time = time;
+    params.g_EdgeSoftness = settings.edgeSoftness;
+    params.g_NoiseFrequencyFactor = settings.noiseFrequencyFactor;
+    params.g_PrimitiveIdx = settings.primitive;
+    params.g_Opacity = 1.0f;
+    params.g_DisplacementWS = settings.displacementAmount;
+    params.g_StepSizeWS = kStepSize * settings.stepSizeScale;
+    params.g_MaxNumSteps = kMaxNumSteps;
+    params.g_UvScaleBias = settings.uvScaleBias;
+    params.g_NoiseInitialAmplitude = kNoiseInitialAmplitude;
+    params.g_InvMaxNoiseDisplacement = 1.0f/maxNoiseDisplacement;
+    params.g_NumOctaves = kNumOctaves;
+    params.g_SkinThickness = maxSkinThickness;
+    params.g_NumHullOctaves = kNumHullOctaves;
+    params.g_NumHullSteps = !settings.enableHullShrinking ? 0 : settings.adaptiveHullShrinking ? kMaxNumAdaptiveHullSteps : kNumHullSteps;
+    params.g_TessellationFactor = kTessellationFactor;
+    params.g_LightDirectionWS = kLightDirectionWS;
+    params.g_SelfShadowing = settings.selfShadowing;
+
+    // Placed by TransmittanceVolume::BindParams.
+    params.g_TransmittanceMinWS = float3( 0, 0, 0 );
+    params.g_TransmittanceInvSizeWS = 0;
+
+    // Taken from the noise volume by the sample; the CPU evaluator reads the volume itself.
+    params.g_NoiseValueScaleBias = float2( 1, 0 );
+    params.g_NoiseMeanAbsValue = 0;
+
+    params.g_HullConvergenceWS = settings.adaptiveHullShrinking ? kHullConvergenceWS : 0.0f;
+    params.g_AdaptiveStepping = settings.adaptiveStepping ? 1 : 0;
+    params.g_OctaveCulling = settings.octaveCulling ? 1 : 0;
+    params.g_PixelSizePerDepthWS = 2.0f / (projMatrix.m[1][1] * height);
+    params.g_NoiseTexelSizeWS = 1.0f / (kNoiseVolumeSize * settings.noiseScale);
+    params.g_DitheredStart = settings.ditheredStart ? 1 : 0;
+    params.g_StepOpacityScale = settings.stepSizeScale;
+    params.g_DitherPadding = float2( 0, 0 );
+}
@@ -0,0 +1,84 @@
+#ifndef EXPLOSION_SETTINGS_H
+#define EXPLOSION_SETTINGS_H
+
+//--------------------------------------------------------------------------------------
+// Explosion and camera parameters shared by the D3D11 sample and the headless
+//  CPU tools, so that both build exactly the same ExplosionParams.
+//--------------------------------------------------------------------------------------
+#include "Common.h"
+
+// Explosion parameters.
+const float3 kNoiseAnimationSpeed(0.0f, 0.02f, 0.0f);
+const float kNoiseInitialAmplitude = 3.0f;
+const uint kMaxNumSteps = 256;
+const uint kNumHullSteps = 2;
+const uint kMaxNumAdaptiveHullSteps = 8;
+const float kHullConvergenceWS = 0.02f;
+const float kStepSize = 0.04f;
+const uint kNumOctaves = 4;
+const uint kNumHullOctaves = 2;
+const uint kNoiseVolumeSize = 32;
+const float kSkinThicknessBias = 0.6f;
+const float kTessellationFactor = 16;
+const float3 kLightDirectionWS(0.577f, 0.577f, -0.577f);
+
+// Camera variables.
+const uint kResolutionX = 800;
+const uint kResolutionY = 640;
+const float kNearClip = 0.01f;
+const float kFarClip = 20.0f;
+const float3 kEyeLookAtWS = float3(0.0f, 0.0f, 0.0f);
+
+enum PrimitiveType
+{
+    kPrimitiveSphere,
+    kPrimitiveCylinder,
+    kPrimitiveCone,
+    kPrimitiveTorus,
+    kPrimitiveBox
+};
+
+// Parses "sphere", "cylinder", "cone", "torus" or "box".
+bool ParsePrimitiveType( const char* pName, PrimitiveType& primitive );
+
+// The values exposed through the AntTweakBar UI.
+struct ExplosionSettings
+{
+    bool enableHullShrinking;
+    bool adaptiveHullShrinking;     // Shrink-wrap until converged rather than kNumHullSteps times.
+    bool adaptiveStepping;          // Vary the march step with density (AdaptiveStepScale).
+    bool octaveCulling;             // Skip octaves finer than a pixel or behind opaque explosion (SelectNumOctaves).
+    bool ditheredStart;             // Start each pixel's march a blue-noise fraction of a step in.
+    float stepSizeScale;            // March with this multiple of kStepSize, opacity corrected to keep the look.
+    float edgeSoftness;
+    float noiseScale;
+    float explosionRadius;
+    float displacementAmount;
+    float2 uvScaleBias;
+    float noiseAmplitudeFactor;
+    float noiseFrequencyFactor;
+    PrimitiveType primitive;
+    float selfShadowing;            // 0 leaves the explosion unlit.
+
+    ExplosionSettings();
+};
+
+// The orbit camera driven by the mouse in the sample.
+struct OrbitCamera
+{
+    float theta, phi, radius;
+
+    OrbitCamera();
+};
+
+// Calculate the maximum possible displacement from noise based on our fractal
+//  noise parameters, and the skin thickness to add to the shrunk hull.
+void ComputeNoiseBounds( float largestAbsoluteNoiseValue, float noiseAmplitudeFactor, float& maxNoiseDisplacement, float& maxSkinThickness );
+
+// Fills in every field of the constant buffer; the sample and the headless tools
+//  share it.  Phi is clamped away from the poles, but the radius is not limited to
+//  the sample's orbit so the tools can view the explosion from further away.
+void BuildExplosionParams( const ExplosionSettings& settings, const OrbitCamera& camera, float time, uint width, uint height,
+                           float largestAbsoluteNoiseValue, ExplosionParams& params );
+
+#endif // EXPLOSION_SETTINGS_H
@@ -0,0 +1,174 @@
+#include "FrameArena.h"
+
+#include <atomic>
+#include <stdlib.h>
+
+// Smallest block an arena grows to, and the granularity it grows in.
+static const size_t kArenaBlockGranularity = 64 * 1024;
+
+// Allocations are rounded up to this, which is also their alignment.
+static const size_t kArenaAlignment = 16;
+
+//--------------------------------------------------------------------------------------
+// Heap allocation counting.  Replacing the global operator new and delete is the
+//  only way to see the allocations made by the standard library on our behalf, so
+//  it is left to builds of the headless tools that define
+//  EXPLOSION_COUNT_HEAP_ALLOCATIONS; the sample keeps the library's own.
+//--------------------------------------------------------------------------------------
+#ifdef EXPLOSION_COUNT_HEAP_ALLOCATIONS
+
+static std::atomic<uint64_t> s_NumHeapAllocations;
+
+uint64_t GetNumHeapAllocations()
+{
+    return s_NumHeapAllocations;
+}
+
+void* operator new( size_t size, const std::nothrow_t& )
+{
+    s_NumHeapAllocations++;
+    return malloc( size ? size : 1 );
+}
+
+void* operator new( size_t size )
+{
+    void* pMemory = operator new( size, std::nothrow );
+    if( !pMemory ) throw std::bad_alloc();
+    return pMemory;
+}
+
+void* operator new[]( size_t size )
+{
+    return operator new( size );
+}
+
+void* operator new[]( size_t size, const std::nothrow_t& )
+{
+    return operator new( size, std::nothrow );
+}
+
+void operator delete( void* pMemory )
+{
+    free( pMemory );
+}
+
+void operator delete[]( void* pMemory )
+{
+    free( pMemory );
+}
+
+void operator delete( void* pMemory, const std::nothrow_t& )
+{
+    free( pMemory );
+}
+
+void operator delete[]( void* pMemory, const std::nothrow_t& )
+{
+    free( pMemory );
+}
+
+#else
+
+uint64_t GetNumHeapAllocations()
+{
+    return 0;
+}
+
+#endif // EXPLOSION_COUNT_HEAP_ALLOCATIONS
+
+//--------------------------------------------------------------------------------------
+// LinearArena
+//--------------------------------------------------------------------------------------
+LinearArena::LinearArena()
+    : m_pBlock(nullptr)
+    , m_Capacity(0)
+    , m_Used(0)
+    , m_FrameBytes(0)
+    , m_HighWaterMark(0)
+    , m_pOverflow(nullptr)
+{
+}
+
+LinearArena::~LinearArena()
+{
+    FreeOverflowBlocks();
+    ::operator delete( m_pBlock );
+}
+
+void* LinearArena::Allocate( size_t size )
+{
+    size = (size + kArenaAlignment - 1) & ~(kArenaAlignment - 1);
+    m_FrameBytes += size;
+
+    // The heap only promises 8 byte alignment on 32-bit Windows, so align the address.
+    if( m_pBlock )
+    {
+        const size_t padding = (kArenaAlignment - (uintptr_t)(m_pBlock + m_Used) % kArenaAlignment) % kArenaAlignment;
+        if( m_Used + padding + size <= m_Capacity )
+        {
+            void* pMemory = m_pBlock + m_Used + padding;
+            m_Used += padding + size;
+            return pMemory;
+        }
+    }
+
+    // Out of room: a block of its own for this frame, folded into the main block by
+    //  the next Reset.  The memory starts at the first aligned address past the header.
+    OverflowBlock* pOverflow = (OverflowBlock*)::operator new( sizeof(OverflowBlock) + kArenaAlignment + size );
+    pOverflow->pNext = m_pOverflow;
+    m_pOverflow = pOverflow;
+    const uintptr_t start = (uintptr_t)(pOverflow + 1);
+    return (void*)((start + kArenaAlignment - 1) & ~(uintptr_t)(kArenaAlignment - 1));
+}
+
+void LinearArena::Reset()
+{
+    m_HighWaterMark = m_FrameBytes > m_HighWaterMark ? m_FrameBytes : m_HighWaterMark;
+
+    if( m_pOverflow )
+    {
+        FreeOverflowBlocks();
+
+        // Grow with a quarter to spare, so that a frame slightly bigger than this one
+        //  does not overflow again.
+        const size_t capacity = m_FrameBytes + m_FrameBytes / 4;
+        m_Capacity = (capacity + kArenaBlockGranularity - 1) / kArenaBlockGranularity * kArenaBlockGranularity;
+        ::operator delete( m_pBlock );
+        m_pBlock = (char*)::operator new( m_Capacity + kArenaAlignment );
+    }
+
+    m_Used = 0;
+    m_FrameBytes = 0;
+}
+
+void LinearArena::FreeOverflowBlocks()
+{
+    while( m_pOverflow )
+    {
+        OverflowBlock* pNext = m_pOverflow->pNext;
+        ::operator delete( m_pOverflow );
+        m_pOverflow = pNext;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// FrameArenas
+//--------------------------------------------------------------------------------------
+FrameArenas::FrameArenas()
+    : m_NumScratchArenas(0)
+{
+}
+
+void FrameArenas::Prepare( uint numThreads )
+{
+    if( numThreads <= m_NumScratchArenas ) return;
+
+    m_ScratchArenas.reset( new LinearArena[numThreads] );
+    m_NumScratchArenas = numThreads;
+}
+
+void FrameArenas::Reset()
+{
+    m_FrameArena.Reset();
+    for(uint i=0 ; i<m_NumScratchArenas ; i++) m_ScratchArenas[i].Reset();
+}
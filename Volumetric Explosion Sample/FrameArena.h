@@ -0,0 +1,97 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+//--------------------------------------------------------------------------------------
+// Allocators for what the CPU renderer needs only while a frame is rendered: the
+//  per-thread statistics, coarse tiles, hull depths and bins, wavefront queues.
+//
+//  A LinearArena hands out memory by moving an offset through one block and is
+//  rewound when the frame ends.  A frame that needs more than the block holds takes
+//  the rest from overflow blocks, and the next Reset replaces them all with one
+//  block big enough for that frame, so once the frames have settled the renderer
+//  makes no heap allocations at all.
+//
+//  FrameArenas pairs an arena for the frame, used by the thread that renders it,
+//  with a scratch arena for each thread of the pool, used only by that thread.
+//--------------------------------------------------------------------------------------
+#include <memory>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Common.h"
+
+class LinearArena
+{
+public:
+    LinearArena();
+    ~LinearArena();
+
+    // Uninitialised memory, 16 byte aligned.
+    void* Allocate( size_t size );
+
+    // count value-initialised Ts.  Their destructors are never run.
+    template<typename T> T* AllocateArray( size_t count )
+    {
+        T* pArray = (T*)Allocate( count * sizeof(T) );
+        for(size_t i=0 ; i<count ; i++) new( &pArray[i] ) T();
+        return pArray;
+    }
+
+    // Rewinds to empty, first growing the block to hold everything allocated since
+    //  the last Reset if it did not.
+    void Reset();
+
+    size_t GetCapacity() const { return m_Capacity; }
+
+    // Most bytes allocated between two Resets.
+    size_t GetHighWaterMark() const { return m_HighWaterMark; }
+
+private:
+    struct OverflowBlock
+    {
+        OverflowBlock* pNext;
+    };
+
+    void FreeOverflowBlocks();
+
+    char* m_pBlock;
+    size_t m_Capacity;
+    size_t m_Used;
+    size_t m_FrameBytes;                // Allocated since the last Reset, overflow included.
+    size_t m_HighWaterMark;
+    OverflowBlock* m_pOverflow;
+
+    LinearArena( const LinearArena& );
+    LinearArena& operator=( const LinearArena& );
+};
+
+class FrameArenas
+{
+public:
+    FrameArenas();
+
+    // Makes sure there is a scratch arena for each of numThreads threads.
+    void Prepare( uint numThreads );
+
+    LinearArena& GetFrameArena() { return m_FrameArena; }
+    LinearArena& GetScratchArena( uint threadIndex ) { return m_ScratchArenas[threadIndex]; }
+    uint GetNumScratchArenas() const { return m_NumScratchArenas; }
+
+    // Rewinds every arena, at the end of the frame.
+    void Reset();
+
+private:
+    LinearArena m_FrameArena;
+    std::unique_ptr<LinearArena[]> m_ScratchArenas;
+    uint m_NumScratchArenas;
+
+    FrameArenas( const FrameArenas& );
+    FrameArenas& operator=( const FrameArenas& );
+};
+
+// Calls to operator new since the process started, from any thread.  Always 0
+//  unless EXPLOSION_COUNT_HEAP_ALLOCATIONS is defined.
+uint64_t GetNumHeapAllocations();
+
+#endif // FRAME_ARENA_H
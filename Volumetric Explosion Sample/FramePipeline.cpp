@@ -0,0 +1,209 @@
+#include "FramePipeline.h"
+#include "CpuRenderer.h"
+#include "FrameArena.h"
+#include "Headless.h"
+#include "Timer.h"
+#include "TripleBuffer.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+
+// Camera orbit, in radians per second of animation, so consecutive frames differ.
+static const float kOrbitSpeed = 0.5f;
+
+FrameSnapshot::FrameSnapshot( const TransmittanceSettings& transmittanceSettings )
+    : transmittance(transmittanceSettings)
+    , frameIndex(0)
+    , inputSeconds(0)
+{
+}
+
+FrameSimulation::FrameSimulation( const ExplosionSettings& settings, const TransmittanceSettings& transmittanceSettings, const SceneTextures& textures,
+                                  uint width, uint height )
+    : m_Settings(settings)
+    , m_pTextures(&textures)
+    , m_Width(width)
+    , m_Height(height)
+    , m_Time(0)
+    , m_FrameIndex(0)
+    , m_Transmittance(transmittanceSettings)
+    , m_Pool(1)
+{
+}
+
+void FrameSimulation::Step( float frameTime, FrameSnapshot& snapshot )
+{
+    snapshot.inputSeconds = Timer::GetSeconds();
+
+    m_Time += frameTime;
+    m_Camera.theta += kOrbitSpeed * frameTime;
+
+    BuildExplosionParams( m_Settings, m_Camera, m_Time, m_Width, m_Height, m_pTextures->noiseVolume.GetLargestAbsoluteValue(), snapshot.params );
+
+    if( m_Settings.selfShadowing > 0.0f )
+    {
+        uint firstSlice, numSlices;
+        m_Transmittance.Update( snapshot.params, *m_pTextures, m_Pool, firstSlice, numSlices );
+        m_Transmittance.BindParams( snapshot.params );
+    }
+
+    snapshot.transmittance = m_Transmittance;
+    snapshot.frameIndex = m_FrameIndex++;
+}
+
+//--------------------------------------------------------------------------------------
+// Headless command
+//--------------------------------------------------------------------------------------
+namespace
+{
+    struct LatencyStats
+    {
+        uint numFrames;
+        double totalLatency, maxLatency;
+        double seconds;
+
+        LatencyStats() : numFrames(0), totalLatency(0), maxLatency(0), seconds(0) {}
+
+        void Add( double latency )
+        {
+            numFrames++;
+            totalLatency += latency;
+            maxLatency = latency > maxLatency ? latency : maxLatency;
+        }
+
+        void Print( const char* pName, uint numSimulated ) const
+        {
+            printf( "%-10s %8.2f, %15.1f, %14.1f, %9u, %7u\n", pName, numFrames / seconds, 1000.0 * totalLatency / numFrames,
+                    1000.0 * maxLatency, numSimulated, numSimulated - numFrames );
+        }
+    };
+
+    // Renders a snapshot, returning the time from the simulation reading its input
+    //  to the frame being finished.
+    double RenderSnapshot( const CpuRenderer& renderer, const FrameSnapshot& snapshot, const SceneTextures& textures, Image& target, ThreadPool& pool,
+                           FrameArenas& arenas )
+    {
+        SceneTextures frameTextures = textures;
+        frameTextures.pTransmittanceVolume = &snapshot.transmittance;
+        renderer.RenderFrame( snapshot.params, frameTextures, target, &pool, nullptr, &arenas );
+        return Timer::GetSeconds() - snapshot.inputSeconds;
+    }
+}
+
+int PipelineBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint numFrames = commandLine.GetUint( "frames", 30 );
+    const float simulationRate = commandLine.GetFloat( "sim-hz", 0.0f );
+    if( numFrames == 0 || simulationRate < 0.0f )
+    {
+        fprintf( stderr, "Usage: pipeline-bench [-frames 30] [-sim-hz 0] [-shadowing 0.8] [-width 200] [-height 160]\n" );
+        return 1;
+    }
+
+    // Without a fixed simulation rate the simulation runs one frame ahead of the
+    //  renderer, stepping the animation by a nominal 60 Hz.
+    const bool isFixedRate = simulationRate > 0.0f;
+    const float frameTime = isFixedRate ? 1.0f / simulationRate : 1.0f / 60.0f;
+    const uint width = commandLine.GetUint( "width", kResolutionX / 4 );
+    const uint height = commandLine.GetUint( "height", kResolutionY / 4 );
+
+    ExplosionSettings settings;
+    settings.selfShadowing = commandLine.GetFloat( "shadowing", 0.8f );
+    const TransmittanceSettings transmittanceSettings;
+
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+    const CpuRenderer renderer( (CpuRenderSettings()) );
+    Image image;
+    FrameArenas arenas;
+
+    // Serial: simulate, then render, every frame.
+    LatencyStats serialStats;
+    double simulationSeconds = 0;
+    {
+        FrameSimulation simulation( settings, transmittanceSettings, textures, width, height );
+        FrameSnapshot snapshot( transmittanceSettings );
+
+        Timer timer;
+        for(uint i=0 ; i<numFrames ; i++)
+        {
+            Timer stepTimer;
+            simulation.Step( frameTime, snapshot );
+            simulationSeconds += stepTimer.GetElapsedSeconds();
+            serialStats.Add( RenderSnapshot( renderer, snapshot, textures, image, pool, arenas ) );
+        }
+        serialStats.seconds = timer.GetElapsedSeconds();
+    }
+
+    // Pipelined: the simulation runs on another thread, either at its own rate or
+    //  as soon as the renderer has taken the last frame, and the renderer draws
+    //  whatever is newest when it finishes a frame.
+    LatencyStats pipelinedStats;
+    uint numSimulated = 0;
+    {
+        TripleBuffer<FrameSnapshot> snapshots( (FrameSnapshot( transmittanceSettings )) );
+        std::atomic<bool> quit( false );
+
+        Timer timer;
+        std::thread simulationThread( [&]()
+        {
+            FrameSimulation simulation( settings, transmittanceSettings, textures, width, height );
+            double nextStepSeconds = Timer::GetSeconds();
+            while( !quit )
+            {
+                simulation.Step( frameTime, snapshots.GetWriteSlot() );
+                snapshots.Publish();
+                numSimulated++;
+
+                if( !isFixedRate )
+                {
+                    while( snapshots.IsPublishPending() && !quit ) std::this_thread::yield();
+                    continue;
+                }
+
+                nextStepSeconds += frameTime;
+                const double waitSeconds = nextStepSeconds - Timer::GetSeconds();
+                if( waitSeconds > 0.0 )
+                {
+                    std::this_thread::sleep_for( std::chrono::microseconds( (long long)(waitSeconds * 1e6) ) );
+                }
+                else
+                {
+                    nextStepSeconds -= waitSeconds;
+                }
+            }
+        } );
+
+        while( pipelinedStats.numFrames < numFrames )
+        {
+            if( !snapshots.Acquire() )
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            pipelinedStats.Add( RenderSnapshot( renderer, snapshots.GetReadSlot(), textures, image, pool, arenas ) );
+        }
+        pipelinedStats.seconds = timer.GetElapsedSeconds();
+
+        quit = true;
+        simulationThread.join();
+    }
+
+    printf( "%ux%u, %u frames, %u render threads, simulation ", width, height, numFrames, pool.GetNumThreads() );
+    if( isFixedRate ) printf( "at %.0f Hz.\n", simulationRate );
+    else printf( "one frame ahead.\n" );
+    printf( "Mode       frames/s, mean latency ms, max latency ms, simulated, dropped\n" );
+    serialStats.Print( "serial", numFrames );
+    pipelinedStats.Print( "pipelined", numSimulated );
+
+    // With a core to spare for the simulation, a pipelined frame costs the slower of
+    //  the two stages instead of their sum.
+    const double simulationMilliseconds = 1000.0 * simulationSeconds / numFrames;
+    const double renderMilliseconds = 1000.0 * serialStats.seconds / numFrames - simulationMilliseconds;
+    printf( "Simulation step %.2f ms, render %.2f ms: pipelining bound %.2f frames/s given a spare core.\n", simulationMilliseconds, renderMilliseconds,
+            1000.0 / (simulationMilliseconds > renderMilliseconds ? simulationMilliseconds : renderMilliseconds) );
+    return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+//--------------------------------------------------------------------------------------
+// Simulation and rendering on separate threads.  The simulation advances the
+//  animation clock and camera, refreshes the transmittance volume and publishes
+//  the result as a FrameSnapshot through a TripleBuffer; the renderer always draws
+//  the newest snapshot and never touches the simulation's own state, so the next
+//  frame can be simulated while this one is rendered.
+//--------------------------------------------------------------------------------------
+#include "ExplosionSettings.h"
+#include "ThreadPool.h"
+#include "TransmittanceVolume.h"
+
+class CommandLine;
+struct SceneTextures;
+
+// Everything a frame is rendered from.  Written by the simulation, then read only.
+struct FrameSnapshot
+{
+    ExplosionParams params;
+    TransmittanceVolume transmittance;
+    uint frameIndex;
+    double inputSeconds;            // Timer::GetSeconds when the simulation step began.
+
+    explicit FrameSnapshot( const TransmittanceSettings& transmittanceSettings );
+};
+
+class FrameSimulation
+{
+public:
+    FrameSimulation( const ExplosionSettings& settings, const TransmittanceSettings& transmittanceSettings, const SceneTextures& textures,
+                     uint width, uint height );
+
+    // Advances the animation by frameTime seconds and writes the new frame.
+    void Step( float frameTime, FrameSnapshot& snapshot );
+
+    OrbitCamera& GetCamera() { return m_Camera; }
+
+private:
+    ExplosionSettings m_Settings;
+    OrbitCamera m_Camera;
+    const SceneTextures* m_pTextures;
+    uint m_Width, m_Height;
+    float m_Time;
+    uint m_FrameIndex;
+    TransmittanceVolume m_Transmittance;
+    ThreadPool m_Pool;              // Single threaded; the renderer has the cores.
+};
+
+int PipelineBenchMain( const CommandLine& commandLine );
+
+#endif // FRAME_PIPELINE_H
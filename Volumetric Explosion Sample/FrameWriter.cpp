@@ -0,0 +1,662 @@
+#include "FrameWriter.h"
+#include "CpuRenderer.h"
+#include "ExplosionSettings.h"
+#include "FrameArena.h"
+#include "Headless.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <chrono>
+#include <string.h>
+
+// How long an idle writer sleeps before looking at its queue again.
+static const uint kWriterIdleMicroseconds = 1000;
+
+bool ParseFrameFormat( const char* pName, FrameFormat& format )
+{
+    if( strcmp( pName, "ppm" ) == 0 ) format = kFramePpm;
+    else if( strcmp( pName, "png" ) == 0 ) format = kFramePng;
+    else if( strcmp( pName, "exr" ) == 0 ) format = kFrameExr;
+    else if( strcmp( pName, "y4m" ) == 0 ) format = kFrameY4m;
+    else if( strcmp( pName, "raw" ) == 0 ) format = kFrameRaw;
+    else return false;
+    return true;
+}
+
+static const char* GetFrameExtension( FrameFormat format )
+{
+    switch( format )
+    {
+    case kFramePng: return ".png";
+    case kFrameExr: return ".exr";
+    case kFrameY4m: return ".y4m";
+    case kFrameRaw: return ".rgb";
+    default:        return ".ppm";
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Encoders
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // Quantises a channel of ResolveOverBlack as Image::WritePPM does.
+    inline unsigned char ToByte( float value )
+    {
+        return (unsigned char)(Saturate( value ) * 255.0f + 0.5f);
+    }
+
+    void AppendBytes( std::vector<unsigned char>& bytes, const void* pData, size_t size )
+    {
+        const unsigned char* pBytes = (const unsigned char*)pData;
+        bytes.insert( bytes.end(), pBytes, pBytes + size );
+    }
+
+    void AppendString( std::vector<unsigned char>& bytes, const char* pString )
+    {
+        AppendBytes( bytes, pString, strlen( pString ) + 1 );
+    }
+
+    void AppendUint32LE( std::vector<unsigned char>& bytes, uint32_t value )
+    {
+        for(uint i=0 ; i<4 ; i++) bytes.push_back( (unsigned char)(value >> (8 * i)) );
+    }
+
+    void AppendUint64LE( std::vector<unsigned char>& bytes, uint64_t value )
+    {
+        for(uint i=0 ; i<8 ; i++) bytes.push_back( (unsigned char)(value >> (8 * i)) );
+    }
+
+    void AppendFloatLE( std::vector<unsigned char>& bytes, float value )
+    {
+        uint32_t bits;
+        memcpy( &bits, &value, sizeof(bits) );
+        AppendUint32LE( bytes, bits );
+    }
+
+    void AppendUint32BE( std::vector<unsigned char>& bytes, uint32_t value )
+    {
+        for(uint i=0 ; i<4 ; i++) bytes.push_back( (unsigned char)(value >> (24 - 8 * i)) );
+    }
+
+    void AppendRgbRows( const Image& image, std::vector<unsigned char>& bytes )
+    {
+        for(uint y=0 ; y<image.GetHeight() ; y++)
+        {
+            for(uint x=0 ; x<image.GetWidth() ; x++)
+            {
+                const Vec3 colour = ResolveOverBlack( image.At( x, y ) );
+                bytes.push_back( ToByte( colour.x ) );
+                bytes.push_back( ToByte( colour.y ) );
+                bytes.push_back( ToByte( colour.z ) );
+            }
+        }
+    }
+
+    void EncodePpm( const Image& image, std::vector<unsigned char>& bytes )
+    {
+        char header[64];
+        sprintf( header, "P6\n%u %u\n255\n", image.GetWidth(), image.GetHeight() );
+        AppendBytes( bytes, header, strlen( header ) );
+        AppendRgbRows( image, bytes );
+    }
+
+    //----------------------------------------------------------------------------------
+    // PNG.  There is no zlib in the tree, so the image data goes in stored deflate
+    //  blocks: the file is a little bigger than the PPM, but any reader takes it.
+    //----------------------------------------------------------------------------------
+    struct Crc32Table
+    {
+        uint32_t entries[256];
+
+        Crc32Table()
+        {
+            for(uint32_t i=0 ; i<256 ; i++)
+            {
+                uint32_t crc = i;
+                for(uint bit=0 ; bit<8 ; bit++) crc = (crc & 1) ? 0xedb88320u ^ (crc >> 1) : crc >> 1;
+                entries[i] = crc;
+            }
+        }
+    };
+
+    // Built before main, so the writer threads never race to initialise it.
+    const Crc32Table s_Crc32Table;
+
+    uint32_t Crc32( const unsigned char* pData, size_t size )
+    {
+        uint32_t crc = 0xffffffffu;
+        for(size_t i=0 ; i<size ; i++) crc = s_Crc32Table.entries[(crc ^ pData[i]) & 0xff] ^ (crc >> 8);
+        return crc ^ 0xffffffffu;
+    }
+
+    // A chunk is begun with a placeholder length and its type, its data appended, and
+    //  then finished by filling in the length and appending the CRC.
+    size_t BeginPngChunk( std::vector<unsigned char>& bytes, const char* pType )
+    {
+        const size_t chunkStart = bytes.size();
+        AppendUint32BE( bytes, 0 );
+        AppendBytes( bytes, pType, 4 );
+        return chunkStart;
+    }
+
+    void FinishPngChunk( std::vector<unsigned char>& bytes, size_t chunkStart )
+    {
+        const size_t dataSize = bytes.size() - chunkStart - 8;
+        for(uint i=0 ; i<4 ; i++) bytes[chunkStart + i] = (unsigned char)(dataSize >> (24 - 8 * i));
+        AppendUint32BE( bytes, Crc32( &bytes[chunkStart + 4], dataSize + 4 ) );
+    }
+
+    // Writes a zlib stream of stored deflate blocks, splitting the data into blocks
+    //  as it arrives and keeping its Adler-32.
+    class StoredZlibStream
+    {
+    public:
+        StoredZlibStream( std::vector<unsigned char>& bytes, size_t size )
+            : m_Bytes(bytes)
+            , m_Remaining(size)
+            , m_BlockRemaining(0)
+            , m_A(1)
+            , m_B(0)
+        {
+            m_Bytes.push_back( 0x78 );
+            m_Bytes.push_back( 0x01 );
+            if( size == 0 ) BeginBlock();
+        }
+
+        void Put( unsigned char value )
+        {
+            if( m_BlockRemaining == 0 ) BeginBlock();
+            m_Bytes.push_back( value );
+            m_BlockRemaining--;
+            m_Remaining--;
+            m_A = (m_A + value) % 65521;
+            m_B = (m_B + m_A) % 65521;
+        }
+
+        void Finish()
+        {
+            AppendUint32BE( m_Bytes, (m_B << 16) | m_A );
+        }
+
+    private:
+        void BeginBlock()
+        {
+            const uint blockSize = (uint)std::min<size_t>( m_Remaining, 65535 );
+            m_Bytes.push_back( blockSize == m_Remaining ? 1 : 0 );
+            m_Bytes.push_back( (unsigned char)blockSize );
+            m_Bytes.push_back( (unsigned char)(blockSize >> 8) );
+            m_Bytes.push_back( (unsigned char)~blockSize );
+            m_Bytes.push_back( (unsigned char)(~blockSize >> 8) );
+            m_BlockRemaining = blockSize;
+        }
+
+        std::vector<unsigned char>& m_Bytes;
+        size_t m_Remaining;
+        uint m_BlockRemaining;
+        uint32_t m_A, m_B;
+
+        StoredZlibStream( const StoredZlibStream& );
+        StoredZlibStream& operator=( const StoredZlibStream& );
+    };
+
+    void EncodePng( const Image& image, std::vector<unsigned char>& bytes )
+    {
+        static const unsigned char kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        AppendBytes( bytes, kSignature, sizeof(kSignature) );
+
+        size_t chunkStart = BeginPngChunk( bytes, "IHDR" );
+        AppendUint32BE( bytes, image.GetWidth() );
+        AppendUint32BE( bytes, image.GetHeight() );
+        const unsigned char kHeader[5] = { 8, 2, 0, 0, 0 };       // 8-bit RGB, deflate, no interlace.
+        AppendBytes( bytes, kHeader, sizeof(kHeader) );
+        FinishPngChunk( bytes, chunkStart );
+
+        chunkStart = BeginPngChunk( bytes, "IDAT" );
+        StoredZlibStream stream( bytes, (size_t)image.GetHeight() * (1 + image.GetWidth() * 3) );
+        for(uint y=0 ; y<image.GetHeight() ; y++)
+        {
+            stream.Put( 0 );                                // Filter type None.
+            for(uint x=0 ; x<image.GetWidth() ; x++)
+            {
+                const Vec3 colour = ResolveOverBlack( image.At( x, y ) );
+                stream.Put( ToByte( colour.x ) );
+                stream.Put( ToByte( colour.y ) );
+                stream.Put( ToByte( colour.z ) );
+            }
+        }
+        stream.Finish();
+        FinishPngChunk( bytes, chunkStart );
+
+        FinishPngChunk( bytes, BeginPngChunk( bytes, "IEND" ) );
+    }
+
+    //----------------------------------------------------------------------------------
+    // OpenEXR: uncompressed scanlines of 32-bit float A, B, G, R (the channels sorted
+    //  by name).  Colour is premultiplied by alpha, as EXR expects, so it is the
+    //  march output before it is blended over anything.
+    //----------------------------------------------------------------------------------
+    void AppendExrAttribute( std::vector<unsigned char>& bytes, const char* pName, const char* pType, uint32_t size )
+    {
+        AppendString( bytes, pName );
+        AppendString( bytes, pType );
+        AppendUint32LE( bytes, size );
+    }
+
+    void EncodeExr( const Image& image, std::vector<unsigned char>& bytes )
+    {
+        const uint width = image.GetWidth();
+        const uint height = image.GetHeight();
+        static const char* const kChannels[4] = { "A", "B", "G", "R" };
+
+        AppendUint32LE( bytes, 20000630 );                  // Magic number.
+        AppendUint32LE( bytes, 2 );                         // Version 2, single part scanlines.
+
+        AppendExrAttribute( bytes, "channels", "chlist", 4 * 18 + 1 );
+        for(uint c=0 ; c<4 ; c++)
+        {
+            AppendString( bytes, kChannels[c] );
+            AppendUint32LE( bytes, 2 );                     // FLOAT.
+            AppendUint32LE( bytes, 0 );                     // pLinear and reserved.
+            AppendUint32LE( bytes, 1 );                     // x and y sampling.
+            AppendUint32LE( bytes, 1 );
+        }
+        bytes.push_back( 0 );
+
+        AppendExrAttribute( bytes, "compression", "compression", 1 );
+        bytes.push_back( 0 );                               // NO_COMPRESSION.
+        for(uint window=0 ; window<2 ; window++)
+        {
+            AppendExrAttribute( bytes, window == 0 ? "dataWindow" : "displayWindow", "box2i", 16 );
+            AppendUint32LE( bytes, 0 );
+            AppendUint32LE( bytes, 0 );
+            AppendUint32LE( bytes, width - 1 );
+            AppendUint32LE( bytes, height - 1 );
+        }
+        AppendExrAttribute( bytes, "lineOrder", "lineOrder", 1 );
+        bytes.push_back( 0 );                               // INCREASING_Y.
+        AppendExrAttribute( bytes, "pixelAspectRatio", "float", 4 );
+        AppendFloatLE( bytes, 1.0f );
+        AppendExrAttribute( bytes, "screenWindowCenter", "v2f", 8 );
+        AppendFloatLE( bytes, 0.0f );
+        AppendFloatLE( bytes, 0.0f );
+        AppendExrAttribute( bytes, "screenWindowWidth", "float", 4 );
+        AppendFloatLE( bytes, 1.0f );
+        bytes.push_back( 0 );
+
+        // One scanline per block, each a y, a size and the channels' rows in turn.
+        const uint32_t lineBytes = width * 4 * sizeof(float);
+        const uint64_t firstLine = bytes.size() + (uint64_t)height * 8;
+        for(uint y=0 ; y<height ; y++) AppendUint64LE( bytes, firstLine + (uint64_t)y * (8 + lineBytes) );
+
+        for(uint y=0 ; y<height ; y++)
+        {
+            AppendUint32LE( bytes, y );
+            AppendUint32LE( bytes, lineBytes );
+            for(uint c=0 ; c<4 ; c++)
+            {
+                for(uint x=0 ; x<width ; x++)
+                {
+                    const Vec4& pixel = image.At( x, y );
+                    const float value = c == 0 ? pixel.w : c == 1 ? pixel.z * pixel.w : c == 2 ? pixel.y * pixel.w : pixel.x * pixel.w;
+                    AppendFloatLE( bytes, value );
+                }
+            }
+        }
+    }
+
+    //----------------------------------------------------------------------------------
+    // YUV4MPEG2 frame: BT.601 studio range, chroma averaged over 2x2 pixels.
+    //----------------------------------------------------------------------------------
+    void EncodeY4mFrame( const Image& image, std::vector<unsigned char>& bytes )
+    {
+        const uint width = image.GetWidth();
+        const uint height = image.GetHeight();
+        const uint chromaWidth = (width + 1) / 2;
+        const uint chromaHeight = (height + 1) / 2;
+
+        AppendBytes( bytes, "FRAME\n", 6 );
+        const size_t lumaStart = bytes.size();
+        bytes.resize( lumaStart + width * height + 2 * chromaWidth * chromaHeight );
+        unsigned char* pLuma = &bytes[lumaStart];
+        unsigned char* pCb = pLuma + width * height;
+        unsigned char* pCr = pCb + chromaWidth * chromaHeight;
+
+        for(uint y=0 ; y<height ; y++)
+        {
+            for(uint x=0 ; x<width ; x++)
+            {
+                const Vec3 colour = ResolveOverBlack( image.At( x, y ) );
+                const float r = Saturate( colour.x ), g = Saturate( colour.y ), b = Saturate( colour.z );
+                pLuma[y * width + x] = (unsigned char)(16.0f + 65.481f * r + 128.553f * g + 24.966f * b + 0.5f);
+            }
+        }
+
+        for(uint cy=0 ; cy<chromaHeight ; cy++)
+        {
+            for(uint cx=0 ; cx<chromaWidth ; cx++)
+            {
+                Vec3 sum( 0.0f );
+                uint count = 0;
+                for(uint y=cy*2 ; y<std::min( cy * 2 + 2, height ) ; y++)
+                {
+                    for(uint x=cx*2 ; x<std::min( cx * 2 + 2, width ) ; x++)
+                    {
+                        const Vec3 colour = ResolveOverBlack( image.At( x, y ) );
+                        sum = sum + Vec3( Saturate( colour.x ), Saturate( colour.y ), Saturate( colour.z ) );
+                        count++;
+                    }
+                }
+                const Vec3 mean = sum * (1.0f / count);
+                pCb[cy * chromaWidth + cx] = (unsigned char)(128.0f - 37.797f * mean.x - 74.203f * mean.y + 112.0f * mean.z + 0.5f);
+                pCr[cy * chromaWidth + cx] = (unsigned char)(128.0f + 112.0f * mean.x - 93.786f * mean.y - 18.214f * mean.z + 0.5f);
+            }
+        }
+    }
+}
+
+void EncodeFrame( FrameFormat format, const Image& image, std::vector<unsigned char>& bytes )
+{
+    bytes.clear();
+    switch( format )
+    {
+    case kFramePng: EncodePng( image, bytes ); break;
+    case kFrameExr: EncodeExr( image, bytes ); break;
+    case kFrameY4m: EncodeY4mFrame( image, bytes ); break;
+    case kFrameRaw: AppendRgbRows( image, bytes ); break;
+    default:        EncodePpm( image, bytes ); break;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// FrameWriter
+//--------------------------------------------------------------------------------------
+FrameWriterSettings::FrameWriterSettings()
+    : format(kFramePpm)
+    , numWriters(2)
+    , queueCapacity(8)
+    , dropWhenFull(false)
+    , framesPerSecond(30)
+{
+}
+
+FrameWriterStats::FrameWriterStats()
+    : numSubmitted(0)
+    , numWritten(0)
+    , numDropped(0)
+    , numFailed(0)
+    , numStalls(0)
+    , stallSeconds(0)
+    , maxQueueDepth(0)
+    , totalQueueDepth(0)
+    , bytesWritten(0)
+    , writeSeconds(0)
+{
+}
+
+FrameWriter::Writer::Writer( uint numSlots )
+    : slots(numSlots)
+    , filledSlots(numSlots)
+    , freeSlots(numSlots)
+    , numFailed(0)
+    , bytesWritten(0)
+    , writeSeconds(0)
+{
+    for(uint i=0 ; i<numSlots ; i++) freeSlots.Push( i );
+}
+
+FrameWriter::FrameWriter( const FrameWriterSettings& settings, const char* pPrefix )
+    : m_Settings(settings)
+    , m_Prefix(pPrefix)
+    , m_pStream(nullptr)
+    , m_IsFinished(false)
+    , m_NextWriter(0)
+    , m_Quit(false)
+    , m_NumWritten(0)
+    , m_NextStreamFrame(0)
+{
+    if( IsStreamingFormat( m_Settings.format ) ) m_pStream = fopen( (m_Prefix + GetFrameExtension( m_Settings.format )).c_str(), "wb" );
+
+    // The slots are shared out between the writers; the queues never fill before
+    //  the slots run out, so pushing a slot always succeeds.
+    const uint numWriters = m_Settings.numWriters;
+    const uint numSlotsPerWriter = numWriters ? std::max( (m_Settings.queueCapacity + numWriters - 1) / numWriters, 1u ) : 0;
+    for(uint i=0 ; i<numWriters ; i++) m_Writers.push_back( std::unique_ptr<Writer>( new Writer( numSlotsPerWriter ) ) );
+    for(uint i=0 ; i<numWriters ; i++) m_Writers[i]->thread = std::thread( &FrameWriter::WriterMain, this, std::ref( *m_Writers[i] ) );
+}
+
+FrameWriter::~FrameWriter()
+{
+    if( !m_IsFinished ) Finish();
+}
+
+bool FrameWriter::Submit( const Image& image )
+{
+    m_Stats.numSubmitted++;
+    const uint frameIndex = (uint)(m_Stats.numSubmitted - m_Stats.numDropped - 1);
+
+    if( m_Writers.empty() )
+    {
+        Timer timer;
+        m_InlineSlot.image = image;
+        m_InlineSlot.frameIndex = frameIndex;
+        if( !WriteSlot( m_InlineSlot ) ) m_Stats.numFailed++;
+        else m_Stats.bytesWritten += m_InlineSlot.bytes.size();
+        m_Stats.writeSeconds += timer.GetElapsedSeconds();
+        m_NumWritten++;
+        return true;
+    }
+
+    // Frames go round the writers, passing over any whose slots are all in use.
+    const uint numWriters = (uint)m_Writers.size();
+    uint writerIndex = 0, slotIndex = 0;
+    bool isSlotFree = false;
+    for(uint i=0 ; i<numWriters && !isSlotFree ; i++)
+    {
+        writerIndex = (m_NextWriter + i) % numWriters;
+        isSlotFree = m_Writers[writerIndex]->freeSlots.Pop( slotIndex );
+    }
+
+    if( !isSlotFree )
+    {
+        // Full: the writers are more than the queue behind the renderer.
+        if( m_Settings.dropWhenFull )
+        {
+            m_Stats.numDropped++;
+            return false;
+        }
+
+        m_Stats.numStalls++;
+        Timer timer;
+        while( !isSlotFree )
+        {
+            std::this_thread::yield();
+            for(uint i=0 ; i<numWriters && !isSlotFree ; i++)
+            {
+                writerIndex = (m_NextWriter + i) % numWriters;
+                isSlotFree = m_Writers[writerIndex]->freeSlots.Pop( slotIndex );
+            }
+        }
+        m_Stats.stallSeconds += timer.GetElapsedSeconds();
+    }
+
+    Writer& writer = *m_Writers[writerIndex];
+    Slot& slot = writer.slots[slotIndex];
+    slot.image = image;
+    slot.frameIndex = frameIndex;
+    writer.filledSlots.Push( slotIndex );
+    m_NextWriter = (writerIndex + 1) % numWriters;
+
+    const uint queueDepth = GetQueueDepth();
+    m_Stats.maxQueueDepth = std::max( m_Stats.maxQueueDepth, queueDepth );
+    m_Stats.totalQueueDepth += queueDepth;
+    return true;
+}
+
+uint FrameWriter::GetQueueDepth() const
+{
+    return (uint)(m_Stats.numSubmitted - m_Stats.numDropped - m_NumWritten.load( std::memory_order_acquire ));
+}
+
+void FrameWriter::Finish()
+{
+    m_Quit = true;
+    for(size_t i=0 ; i<m_Writers.size() ; i++)
+    {
+        Writer& writer = *m_Writers[i];
+        writer.thread.join();
+        m_Stats.numFailed += writer.numFailed;
+        m_Stats.bytesWritten += writer.bytesWritten;
+        m_Stats.writeSeconds += writer.writeSeconds;
+    }
+    m_Stats.numWritten = m_NumWritten - m_Stats.numFailed;
+
+    if( m_pStream )
+    {
+        if( fclose( m_pStream ) != 0 ) m_Stats.numFailed++;
+        m_pStream = nullptr;
+    }
+    m_IsFinished = true;
+}
+
+void FrameWriter::WriterMain( Writer& writer )
+{
+    for(;;)
+    {
+        // Quit is only read before the queue, so every slot pushed before it was set
+        //  is seen and written.
+        const bool quit = m_Quit;
+        uint slotIndex;
+        if( !writer.filledSlots.Pop( slotIndex ) )
+        {
+            if( quit ) break;
+            std::this_thread::sleep_for( std::chrono::microseconds( kWriterIdleMicroseconds ) );
+            continue;
+        }
+
+        Slot& slot = writer.slots[slotIndex];
+        Timer timer;
+        if( WriteSlot( slot ) ) writer.bytesWritten += slot.bytes.size();
+        else writer.numFailed++;
+        writer.writeSeconds += timer.GetElapsedSeconds();
+
+        m_NumWritten.fetch_add( 1, std::memory_order_release );
+        writer.freeSlots.Push( slotIndex );
+    }
+}
+
+bool FrameWriter::WriteSlot( Slot& slot )
+{
+    EncodeFrame( m_Settings.format, slot.image, slot.bytes );
+    if( IsStreamingFormat( m_Settings.format ) ) return WriteStreamFrame( slot );
+
+    char frameNumber[16];
+    sprintf( frameNumber, "_%05u", slot.frameIndex );
+    const std::string fileName = m_Prefix + frameNumber + GetFrameExtension( m_Settings.format );
+    FILE* pFile = fopen( fileName.c_str(), "wb" );
+    if( !pFile ) return false;
+
+    const bool succeeded = fwrite( &slot.bytes[0], 1, slot.bytes.size(), pFile ) == slot.bytes.size();
+    return fclose( pFile ) == 0 && succeeded;
+}
+
+bool FrameWriter::WriteStreamFrame( const Slot& slot )
+{
+    // The frame before this one may still be with another writer.  Every frame
+    //  before it is further ahead in some writer's queue, so the wait always ends.
+    while( m_NextStreamFrame.load( std::memory_order_acquire ) != slot.frameIndex ) std::this_thread::yield();
+
+    bool succeeded = m_pStream != nullptr;
+    if( succeeded && slot.frameIndex == 0 && m_Settings.format == kFrameY4m )
+    {
+        succeeded = fprintf( m_pStream, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", slot.image.GetWidth(), slot.image.GetHeight(),
+                             m_Settings.framesPerSecond ) > 0;
+    }
+    if( succeeded ) succeeded = fwrite( &slot.bytes[0], 1, slot.bytes.size(), m_pStream ) == slot.bytes.size();
+
+    m_NextStreamFrame.store( slot.frameIndex + 1, std::memory_order_release );
+    return succeeded;
+}
+
+//--------------------------------------------------------------------------------------
+// Headless command
+//--------------------------------------------------------------------------------------
+int CaptureMain( const CommandLine& commandLine )
+{
+    const char* pPrefix = commandLine.GetPositional( 0 );
+    FrameWriterSettings writerSettings;
+    const char* pFormat = commandLine.GetString( "format", "ppm" );
+    const uint numFrames = commandLine.GetUint( "frames", 60 );
+    if( !pPrefix || !ParseFrameFormat( pFormat, writerSettings.format ) || numFrames == 0 )
+    {
+        fprintf( stderr, "Usage: capture <prefix> [-format ppm|png|exr|y4m|raw] [-frames 60] [-writers 2] [-queue 8] [-drop] [-fps 30] [-orbit 0.05]\n" );
+        return 1;
+    }
+
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    writerSettings.numWriters = commandLine.GetUint( "writers", writerSettings.numWriters );
+    writerSettings.queueCapacity = std::max( commandLine.GetUint( "queue", writerSettings.queueCapacity ), 1u );
+    writerSettings.dropWhenFull = commandLine.HasOption( "drop" );
+    writerSettings.framesPerSecond = std::max( commandLine.GetUint( "fps", writerSettings.framesPerSecond ), 1u );
+    const uint width = commandLine.GetUint( "width", kResolutionX / 4 );
+    const uint height = commandLine.GetUint( "height", kResolutionY / 4 );
+    const float orbitPerFrame = commandLine.GetFloat( "orbit", 0.05f );
+
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+    const CpuRenderer renderer( (CpuRenderSettings()) );
+    FrameArenas arenas;
+    Image image;
+
+    printf( "%ux%u, %u frames to %s*%s on %u render threads; %u writers, %u frames queued at most%s\n", width, height, numFrames, pPrefix,
+            GetFrameExtension( writerSettings.format ), pool.GetNumThreads(), writerSettings.numWriters, writerSettings.queueCapacity,
+            writerSettings.dropWhenFull ? ", dropping when full" : "" );
+    printf( "Mode     frames/s, render ms, stalls, stall ms, max depth, mean depth, dropped, written, MB, write MB/s, drain ms\n" );
+
+    // The same orbit written inside the render loop, then through the writer threads;
+    //  the second run overwrites the first run's files.
+    bool succeeded = true;
+    const uint numRuns = writerSettings.numWriters ? 2 : 1;
+    for(uint run=0 ; run<numRuns ; run++)
+    {
+        FrameWriterSettings runSettings = writerSettings;
+        if( run == 0 ) runSettings.numWriters = 0;
+        FrameWriter writer( runSettings, pPrefix );
+
+        OrbitCamera camera;
+        double renderSeconds = 0;
+        Timer loopTimer;
+        for(uint frame=0 ; frame<numFrames ; frame++)
+        {
+            camera.theta = frame * orbitPerFrame;
+            ExplosionParams params;
+            BuildExplosionParams( ExplosionSettings(), camera, 3.3f + frame / (float)runSettings.framesPerSecond, width, height,
+                                  textures.noiseVolume.GetLargestAbsoluteValue(), params );
+
+            Timer renderTimer;
+            renderer.RenderFrame( params, textures, image, &pool, nullptr, &arenas );
+            renderSeconds += renderTimer.GetElapsedSeconds();
+
+            writer.Submit( image );
+        }
+        const double loopSeconds = loopTimer.GetElapsedSeconds();
+
+        Timer drainTimer;
+        writer.Finish();
+        const double drainSeconds = drainTimer.GetElapsedSeconds();
+
+        const FrameWriterStats& stats = writer.GetStats();
+        const double megabytes = stats.bytesWritten / (1024.0 * 1024.0);
+        printf( "%-8s %8.2f, %9.1f, %6llu, %8.1f, %9u, %10.2f, %7llu, %7llu, %6.1f, %10.1f, %8.1f\n", run == 0 ? "inline" : "threaded",
+                numFrames / loopSeconds, 1000.0 * renderSeconds / numFrames, (unsigned long long)stats.numStalls, 1000.0 * stats.stallSeconds,
+                stats.maxQueueDepth, (double)stats.totalQueueDepth / numFrames, (unsigned long long)stats.numDropped,
+                (unsigned long long)stats.numWritten, megabytes, stats.writeSeconds > 0.0 ? megabytes / stats.writeSeconds : 0.0, 1000.0 * drainSeconds );
+        if( stats.numFailed )
+        {
+            fprintf( stderr, "%llu frames could not be written.\n", (unsigned long long)stats.numFailed );
+            succeeded = false;
+        }
+    }
+    return succeeded ? 0 : 1;
+}
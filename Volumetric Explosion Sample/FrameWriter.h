@@ -0,0 +1,140 @@
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+//--------------------------------------------------------------------------------------
+// Output stage for capturing rendered frames without holding up the renderer.
+//  Submit copies the frame into a free slot and hands it to a writer thread
+//  through an SpscQueue; the writer encodes it and writes it out while the next
+//  frame renders.  The render thread only waits when every slot is still queued
+//  or being written, and not even then when frames may be dropped.
+//
+//  Each writer thread owns its slots and a pair of SpscQueues, one carrying
+//  filled slots to it and one returning them once written, so no lock is taken
+//  on either side.  Still images go to a file per frame; the streaming formats
+//  append every frame to one file, each writer waiting its turn after encoding
+//  so the frames land in the order they were submitted.
+//--------------------------------------------------------------------------------------
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Image.h"
+#include "SpscQueue.h"
+
+class CommandLine;
+
+enum FrameFormat
+{
+    kFramePpm,                      // Binary PPM per frame, as Image::WritePPM.
+    kFramePng,                      // 8-bit RGB PNG per frame, stored without compression.
+    kFrameExr,                      // Float RGBA OpenEXR per frame: the march output, premultiplied.
+    kFrameY4m,                      // One YUV4MPEG2 stream, 4:2:0.
+    kFrameRaw                       // One stream of packed 8-bit RGB frames.
+};
+
+bool ParseFrameFormat( const char* pName, FrameFormat& format );
+
+// Whether the format appends every frame to one file.
+inline bool IsStreamingFormat( FrameFormat format ) { return format == kFrameY4m || format == kFrameRaw; }
+
+// Encodes the image as a whole file (or, for the streaming formats, one frame of
+//  the stream) into bytes, reusing its storage.
+void EncodeFrame( FrameFormat format, const Image& image, std::vector<unsigned char>& bytes );
+
+struct FrameWriterSettings
+{
+    FrameFormat format;
+    uint numWriters;                // Writer threads; 0 encodes and writes inside Submit.
+    uint queueCapacity;             // Frames queued or being written, over all writers.
+    bool dropWhenFull;              // Drop frames instead of waiting for a free slot.
+    uint framesPerSecond;           // For the y4m header.
+
+    FrameWriterSettings();
+};
+
+struct FrameWriterStats
+{
+    uint64_t numSubmitted;
+    uint64_t numWritten;
+    uint64_t numDropped;            // Submitted to a full queue with dropWhenFull.
+    uint64_t numFailed;             // Files that could not be written.
+    uint64_t numStalls;             // Submit calls that waited for a slot.
+    double stallSeconds;
+    uint maxQueueDepth;             // Frames queued or being written, just after a Submit.
+    uint64_t totalQueueDepth;       // Summed over Submit calls, for the mean.
+    uint64_t bytesWritten;
+    double writeSeconds;            // Spent encoding and writing, summed over the writers.
+
+    FrameWriterStats();
+};
+
+class FrameWriter
+{
+public:
+    // Still formats write <prefix>_<frame>.<ext>; the streaming ones <prefix>.<ext>.
+    FrameWriter( const FrameWriterSettings& settings, const char* pPrefix );
+    ~FrameWriter();
+
+    // Queues a copy of the image and returns without waiting for it to be written,
+    //  unless the queue is full.  Returns false if the frame was dropped.
+    bool Submit( const Image& image );
+
+    // Frames submitted and not yet written.
+    uint GetQueueDepth() const;
+
+    // Waits for every queued frame to be written and stops the writers.
+    void Finish();
+
+    // Complete once Finish has returned.
+    const FrameWriterStats& GetStats() const { return m_Stats; }
+
+private:
+    struct Slot
+    {
+        Image image;
+        uint frameIndex;
+        std::vector<unsigned char> bytes;
+    };
+
+    struct Writer
+    {
+        std::vector<Slot> slots;
+        SpscQueue<uint> filledSlots;    // Render thread to writer.
+        SpscQueue<uint> freeSlots;      // Writer to render thread.
+        std::thread thread;
+        uint64_t numFailed;
+        uint64_t bytesWritten;
+        double writeSeconds;
+
+        explicit Writer( uint numSlots );
+    };
+
+    void WriterMain( Writer& writer );
+    bool WriteSlot( Slot& slot );
+    bool WriteStreamFrame( const Slot& slot );
+
+    FrameWriterSettings m_Settings;
+    std::string m_Prefix;
+    FILE* m_pStream;
+    bool m_IsFinished;
+
+    std::vector<std::unique_ptr<Writer> > m_Writers;
+    uint m_NextWriter;
+    Slot m_InlineSlot;                  // With no writer threads.
+
+    std::atomic<bool> m_Quit;
+    std::atomic<uint64_t> m_NumWritten;
+    std::atomic<uint> m_NextStreamFrame;
+    FrameWriterStats m_Stats;
+
+    FrameWriter( const FrameWriter& );
+    FrameWriter& operator=( const FrameWriter& );
+};
+
+int CaptureMain( const CommandLine& commandLine );
+
+#endif // FRAME_WRITER_H
@@ -0,0 +1,198 @@
+#include "Headless.h"
+#include "CpuTextures.h"
+#include "BakedVolume.h"
+#include "BatchRenderer.h"
+#include "FramePipeline.h"
+#include "FrameWriter.h"
+#include "HullAnalysis.h"
+#include "ImpostorFlipbook.h"
+#include "RenderThread.h"
+#include "RendererBench.h"
+#include "TransmittanceVolume.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+//--------------------------------------------------------------------------------------
+// Command line parsing
+//--------------------------------------------------------------------------------------
+static bool IsOptionName( const char* pArg )
+{
+    // "-threads" is an option name, "-0.5" is a value.
+    return pArg[0] == '-' && isalpha( (unsigned char)pArg[1] );
+}
+
+CommandLine::CommandLine( int argc, char** argv )
+{
+    for(int i=1 ; i<argc ; i++)
+    {
+        const char* pArg = argv[i];
+        if( IsOptionName( pArg ) )
+        {
+            std::string value;
+            if( i + 1 < argc && !IsOptionName( argv[i + 1] ) ) value = argv[++i];
+            m_Options.push_back( std::make_pair( std::string( pArg + 1 ), value ) );
+        }
+        else if( m_Command.empty() )
+        {
+            m_Command = pArg;
+        }
+        else
+        {
+            m_Positionals.push_back( pArg );
+        }
+    }
+}
+
+const char* CommandLine::GetCommand() const
+{
+    return m_Command.c_str();
+}
+
+const std::string* CommandLine::FindOptionValue( const char* pName ) const
+{
+    for(size_t i=0 ; i<m_Options.size() ; i++)
+    {
+        if( m_Options[i].first == pName ) return &m_Options[i].second;
+    }
+    return nullptr;
+}
+
+bool CommandLine::HasOption( const char* pName ) const
+{
+    return FindOptionValue( pName ) != nullptr;
+}
+
+const char* CommandLine::GetString( const char* pName, const char* pDefault ) const
+{
+    const std::string* pValue = FindOptionValue( pName );
+    return (pValue && !pValue->empty()) ? pValue->c_str() : pDefault;
+}
+
+float CommandLine::GetFloat( const char* pName, float defaultValue ) const
+{
+    const std::string* pValue = FindOptionValue( pName );
+    return (pValue && !pValue->empty()) ? (float)atof( pValue->c_str() ) : defaultValue;
+}
+
+uint CommandLine::GetUint( const char* pName, uint defaultValue ) const
+{
+    const std::string* pValue = FindOptionValue( pName );
+    return (pValue && !pValue->empty()) ? (uint)strtoul( pValue->c_str(), nullptr, 10 ) : defaultValue;
+}
+
+bool LoadSceneTextures( const CommandLine& commandLine, SceneTextures& textures )
+{
+    const char* pMediaDirectory = commandLine.GetString( "media", "" );
+    if( !textures.Load( pMediaDirectory ) )
+    {
+        fprintf( stderr, "Failed to load noise_32x32x32.dat and gradient.dds from '%s'.\n", pMediaDirectory );
+        return false;
+    }
+
+    const char* pLayout = commandLine.GetString( "noise-layout", "linear" );
+    NoiseVolumeLayout layout;
+    if( !ParseNoiseVolumeLayout( pLayout, layout ) || !textures.noiseVolume.SetLayout( layout ) )
+    {
+        fprintf( stderr, "Unknown noise layout '%s'; expected linear, bricked, morton or padded.\n", pLayout );
+        return false;
+    }
+    return true;
+}
+
+bool EnsureDirectory( const char* pPath )
+{
+#ifdef _WIN32
+    return _mkdir( pPath ) == 0 || errno == EEXIST;
+#else
+    return mkdir( pPath, 0755 ) == 0 || errno == EEXIST;
+#endif
+}
+
+//--------------------------------------------------------------------------------------
+// Commands
+//--------------------------------------------------------------------------------------
+struct HeadlessCommand
+{
+    const char* pName;
+    const char* pUsage;
+    int (*pMain)( const CommandLine& commandLine );
+};
+
+static const HeadlessCommand kHeadlessCommands[] =
+{
+    { "batch", "batch <jobfile>             Render a parameter sweep described by a job file.", BatchMain },
+    { "impostor-bake", "impostor-bake <out.flipbook> Bake a flipbook impostor atlas of the animation.", ImpostorBakeMain },
+    { "impostor-bench", "impostor-bench <flipbook>   Compare impostor and ray march cost at several distances.", ImpostorBenchMain },
+    { "volume-bake", "volume-bake <out.volume>    Bake bricked colour/opacity volumes of the animation.", VolumeBakeMain },
+    { "volume-bench", "volume-bench <volume>       Compare baked volume playback with live evaluation.", VolumeBenchMain },
+    { "lighting-bench", "lighting-bench              Time the self-shadowing transmittance volume and lit march.", LightingBenchMain },
+    { "march-bench", "march-bench                 Compare tile and wavefront marching.", MarchBenchMain },
+    { "schedule-bench", "schedule-bench              Compare shared-queue and work-stealing tile scheduling.", ScheduleBenchMain },
+    { "precision-bench", "precision-bench             Compare fp32 and half precision noise over golden scenes.", PrecisionBenchMain },
+    { "quantise-bench", "quantise-bench              Compare the 8-bit noise volume with R16 at several sizes.", QuantiseBenchMain },
+    { "layout-bench", "layout-bench                Time noise fetches in each texel layout.", LayoutBenchMain },
+    { "gradient-bench", "gradient-bench              Compare value+gradient normals with central differences.", GradientBenchMain },
+    { "hull-bench", "hull-bench                  Compare fixed and adaptive hull shrink-wrapping.", HullBenchMain },
+    { "step-bench", "step-bench                  Compare fixed and density-adaptive march steps.", StepBenchMain },
+    { "octave-bench", "octave-bench                Compare all noise octaves with per-step octave culling.", OctaveBenchMain },
+    { "blue-noise", "blue-noise <out.pgm>        Generate the blue-noise mask for dithered ray starts.", BlueNoiseMain },
+    { "dither-bench", "dither-bench                Compare larger march steps with and without dithered starts.", DitherBenchMain },
+    { "coarse-bench", "coarse-bench                Compare per-pixel marching with coarse tile classification.", CoarseBenchMain },
+    { "vrs-bench", "vrs-bench                   Compare full-rate and variable rate shading over an animation.", ShadingRateBenchMain },
+    { "setup-bench", "setup-bench                 Compare per-pixel and per-tile ray setup at three explosion sizes.", RaySetupBenchMain },
+    { "raster-bench", "raster-bench                Rasterise the hull on the CPU and march between its depths.", RasterBenchMain },
+    { "hull-analysis", "hull-analysis               Measure the empty steps and overdraw in the hull's ray intervals.", HullAnalysisMain },
+    { "alloc-bench", "alloc-bench                 Count heap allocations per frame with kept frame arenas.", AllocationBenchMain },
+    { "capture", "capture <prefix>            Render an orbit and write it out on writer threads.", CaptureMain },
+    { "pipeline-bench", "pipeline-bench              Compare serial and pipelined simulation and rendering.", PipelineBenchMain },
+    { "render-thread-stress", "render-thread-stress        Stress the render thread's event queue with synthetic input.", RenderThreadStressMain },
+};
+
+static const HeadlessCommand* FindHeadlessCommand( const char* pName )
+{
+    for(size_t i=0 ; i<sizeof(kHeadlessCommands)/sizeof(kHeadlessCommands[0]) ; i++)
+    {
+        if( strcmp( kHeadlessCommands[i].pName, pName ) == 0 ) return &kHeadlessCommands[i];
+    }
+    return nullptr;
+}
+
+bool IsHeadlessCommand( int argc, char** argv )
+{
+    const CommandLine commandLine( argc, argv );
+    return FindHeadlessCommand( commandLine.GetCommand() ) != nullptr;
+}
+
+int RunHeadless( int argc, char** argv )
+{
+    const CommandLine commandLine( argc, argv );
+    const HeadlessCommand* pCommand = FindHeadlessCommand( commandLine.GetCommand() );
+    if( !pCommand )
+    {
+        fprintf( stderr, "Usage: <exe> <command> [arguments] [-media <dir>] [-threads <n>]\n\nCommands:\n" );
+        for(size_t i=0 ; i<sizeof(kHeadlessCommands)/sizeof(kHeadlessCommands[0]) ; i++)
+        {
+            fprintf( stderr, "  %s\n", kHeadlessCommands[i].pUsage );
+        }
+        return 1;
+    }
+
+    return pCommand->pMain( commandLine );
+}
+
+#ifndef _WIN32
+int main( int argc, char** argv )
+{
+    return RunHeadless( argc, argv );
+}
+#endif
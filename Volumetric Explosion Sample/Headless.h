@@ -0,0 +1,55 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+//--------------------------------------------------------------------------------------
+// Entry point for the headless tools built on the CPU renderer.  On Windows they
+//  are reached through the sample's command line, elsewhere through main().
+//
+//  Usage: <exe> <command> [arguments] [-media <dir>] [-threads <n>]
+//--------------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+
+#include "Common.h"
+
+struct SceneTextures;
+
+class CommandLine
+{
+public:
+    // argv[0] is the program name, as passed to main().
+    CommandLine( int argc, char** argv );
+
+    const char* GetCommand() const;
+
+    // Arguments following the command that are not options or option values.
+    uint GetNumPositionals() const { return (uint)m_Positionals.size(); }
+    const char* GetPositional( uint index ) const { return index < m_Positionals.size() ? m_Positionals[index].c_str() : nullptr; }
+
+    bool HasOption( const char* pName ) const;
+    const char* GetString( const char* pName, const char* pDefault ) const;
+    float GetFloat( const char* pName, float defaultValue ) const;
+    uint GetUint( const char* pName, uint defaultValue ) const;
+
+private:
+    const std::string* FindOptionValue( const char* pName ) const;
+
+    std::string m_Command;
+    std::vector<std::string> m_Positionals;
+    std::vector<std::pair<std::string, std::string> > m_Options;
+};
+
+// Loads the noise volume and gradient from -media (default: working directory),
+//  reporting failures on stderr.
+bool LoadSceneTextures( const CommandLine& commandLine, SceneTextures& textures );
+
+// Creates the output directory for a tool if it does not exist yet.
+bool EnsureDirectory( const char* pPath );
+
+// Returns true if the first argument names a headless command.
+bool IsHeadlessCommand( int argc, char** argv );
+
+// Runs the headless command and returns the process exit code.
+int RunHeadless( int argc, char** argv );
+
+#endif // HEADLESS_H
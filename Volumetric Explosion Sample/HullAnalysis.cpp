@@ -0,0 +1,252 @@
+#include "HullAnalysis.h"
+#include "CpuHull.h"
+#include "CpuRenderer.h"
+#include "ExplosionSettings.h"
+#include "FrameArena.h"
+#include "Headless.h"
+#include "HullRasteriser.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string>
+
+HullAnalysis::HullAnalysis()
+    : width(0)
+    , height(0)
+    , numCovered(0)
+    , numInvisible(0)
+    , numFragments(0)
+    , numSteps(0)
+    , numEmptySteps(0)
+    , milliseconds(0)
+{
+}
+
+void AnalyseHull( const ExplosionEvaluator& evaluator, ThreadPool* pPool, HullAnalysis& analysis )
+{
+    Timer timer;
+
+    const ExplosionParams& params = evaluator.GetParams();
+    const uint width = (uint)params.g_ScreenParams.x;
+    const uint height = (uint)params.g_ScreenParams.y;
+
+    std::vector<HullVertex> vertices;
+    EvaluateHull( evaluator, vertices );
+    LinearArena arena;
+    HullDepthBuffer depths( true );
+    RasteriseHull( params, &vertices[0], (uint)vertices.size(), pPool, depths, arena );
+
+    analysis.width = width;
+    analysis.height = height;
+    analysis.image.Resize( width, height );
+    analysis.overdraw.assign( width * height, 0 );
+    analysis.steps.assign( width * height, 0 );
+    analysis.emptySteps.assign( width * height, 0 );
+
+    // Each covered pixel as CpuRenderer::RenderTile marches it with hullBounds.
+    auto analyseRow = [&]( uint y, uint )
+    {
+        for(uint x=0 ; x<width ; x++)
+        {
+            const uint pixel = y * width + x;
+            analysis.image.At( x, y ) = Vec4( 0.0f );
+            analysis.overdraw[pixel] = depths.GetOverdraw( x, y );
+            if( !depths.IsCovered( x, y ) ) continue;
+
+            const Vec3 rayDirectionWS = GetRayDirectionWS( params, x + 0.5f, y + 0.5f );
+            const float nearD = depths.GetNearD( x, y ) + GetRayStartOffset( evaluator, x, y );
+            uint stepsTaken, emptySteps;
+            analysis.image.At( x, y ) = RayMarchExplosion( evaluator, rayDirectionWS, nearD, depths.GetFarD( x, y ), stepsTaken, nullptr, nullptr, &emptySteps );
+            analysis.steps[pixel] = stepsTaken;
+            analysis.emptySteps[pixel] = emptySteps;
+        }
+    };
+
+    if( pPool )
+    {
+        pPool->ParallelFor( height, analyseRow );
+    }
+    else
+    {
+        for(uint y=0 ; y<height ; y++) analyseRow( y, 0 );
+    }
+
+    analysis.numCovered = analysis.numInvisible = 0;
+    analysis.numFragments = analysis.numSteps = analysis.numEmptySteps = 0;
+    for(uint y=0 ; y<height ; y++)
+    {
+        for(uint x=0 ; x<width ; x++)
+        {
+            const uint pixel = y * width + x;
+            if( depths.IsCovered( x, y ) )
+            {
+                analysis.numCovered++;
+                analysis.numInvisible += analysis.image.At( x, y ).w < kInvisibleAlpha ? 1 : 0;
+            }
+            analysis.numFragments += analysis.overdraw[pixel];
+            analysis.numSteps += analysis.steps[pixel];
+            analysis.numEmptySteps += analysis.emptySteps[pixel];
+        }
+    }
+    analysis.milliseconds = timer.GetElapsedMilliseconds();
+}
+
+//--------------------------------------------------------------------------------------
+// hull-analysis
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // Black through blue, red and yellow to white as t goes from 0 to 1.
+    Vec3 GetHeatColour( float t )
+    {
+        const Vec3 kRamp[] = { Vec3( 0.0f, 0.0f, 0.0f ), Vec3( 0.0f, 0.0f, 1.0f ), Vec3( 1.0f, 0.0f, 0.0f ), Vec3( 1.0f, 1.0f, 0.0f ), Vec3( 1.0f, 1.0f, 1.0f ) };
+        const float position = Saturate( t ) * 4.0f;
+        const uint index = std::min( (uint)position, 3u );
+        const float blend = position - index;
+        return kRamp[index] * (1.0f - blend) + kRamp[index + 1] * blend;
+    }
+
+    // Writes the values as a heatmap scaled to their largest, returning that.
+    uint WriteHeatmap( const std::vector<uint>& values, uint width, uint height, const std::string& fileName )
+    {
+        const uint largest = values.empty() ? 0 : *std::max_element( values.begin(), values.end() );
+        Image heatmap( width, height );
+        for(uint y=0 ; y<height ; y++)
+        {
+            for(uint x=0 ; x<width ; x++) heatmap.At( x, y ) = Vec4( GetHeatColour( largest ? (float)values[y * width + x] / largest : 0.0f ), 1.0f );
+        }
+        if( !heatmap.WritePPM( fileName.c_str() ) ) fprintf( stderr, "Could not write %s\n", fileName.c_str() );
+        return largest;
+    }
+
+    // Pixels the reference shows that the hull's frame loses more than half the alpha of.
+    uint CountClippedPixels( const Image& reference, const Image& image )
+    {
+        uint numClipped = 0;
+        for(uint y=0 ; y<reference.GetHeight() ; y++)
+        {
+            for(uint x=0 ; x<reference.GetWidth() ; x++) numClipped += reference.At( x, y ).w - image.At( x, y ).w > 0.5f ? 1 : 0;
+        }
+        return numClipped;
+    }
+
+    float GetPsnr( const Image& reference, const Image& image )
+    {
+        double sum = 0;
+        for(uint y=0 ; y<reference.GetHeight() ; y++)
+        {
+            for(uint x=0 ; x<reference.GetWidth() ; x++)
+            {
+                const Vec4 d = reference.At( x, y ) - image.At( x, y );
+                sum += d.x * d.x + d.y * d.y + d.z * d.z + d.w * d.w;
+            }
+        }
+        const double rmsError = sqrt( sum / (4.0 * reference.GetWidth() * reference.GetHeight()) );
+        return rmsError > 0.0 ? (float)(20.0 * log10( 1.0 / rmsError )) : 999.0f;
+    }
+
+    void PrintSweepRow( const char* pLabel, const HullAnalysis& analysis, const Image& reference )
+    {
+        printf( "  %-10s %11.1f, %9.1f%%, %9u, %8.2f, %7u, %5.1f\n", pLabel, analysis.numCovered ? (double)analysis.numSteps / analysis.numCovered : 0.0,
+                analysis.numSteps ? 100.0 * analysis.numEmptySteps / analysis.numSteps : 0.0, analysis.numInvisible,
+                analysis.numCovered ? (double)analysis.numFragments / analysis.numCovered : 0.0, CountClippedPixels( reference, analysis.image ),
+                GetPsnr( reference, analysis.image ) );
+    }
+}
+
+int HullAnalysisMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    ExplosionSettings settings;
+    const char* pPrimitive = commandLine.GetString( "primitive", "sphere" );
+    if( !ParsePrimitiveType( pPrimitive, settings.primitive ) )
+    {
+        fprintf( stderr, "Unknown primitive '%s'; expected sphere, cylinder, cone, torus or box.\n", pPrimitive );
+        return 1;
+    }
+
+    OrbitCamera camera;
+    camera.phi = PI * 0.5f;
+    camera.radius = commandLine.GetFloat( "radius", camera.radius );
+
+    ExplosionParams params;
+    BuildExplosionParams( settings, camera, commandLine.GetFloat( "time", 3.3f ), commandLine.GetUint( "width", kResolutionX / 4 ),
+                          commandLine.GetUint( "height", kResolutionY / 4 ), textures.noiseVolume.GetLargestAbsoluteValue(), params );
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+
+    // The bounding sphere's frame, which no skin thickness or tessellation clips.
+    const CpuRenderer renderer( (CpuRenderSettings()) );
+    Image reference;
+    RenderStats referenceStats;
+    renderer.RenderFrame( params, textures, reference, &pool, &referenceStats );
+
+    HullAnalysis analysis;
+    AnalyseHull( ExplosionEvaluator( params, textures ), &pool, analysis );
+
+    const uint numPixels = analysis.width * analysis.height;
+    uint maxOverdraw = 0;
+    for(uint i=0 ; i<numPixels ; i++) maxOverdraw = std::max( maxOverdraw, analysis.overdraw[i] );
+
+    printf( "%s at %ux%u, time %.2f, camera radius %.1f: skin thickness %.3f (bias %.2f), tessellation %.0f\n", pPrimitive, analysis.width, analysis.height,
+            params.g_Time, camera.radius, params.g_SkinThickness, kSkinThicknessBias, params.g_TessellationFactor );
+    printf( "Covered pixels:      %u of %u (%.1f%%)\n", analysis.numCovered, numPixels, 100.0 * analysis.numCovered / numPixels );
+    printf( "Invisible:           %u covered pixels end below alpha %.4f (%.1f%%)\n", analysis.numInvisible, kInvisibleAlpha,
+            analysis.numCovered ? 100.0 * analysis.numInvisible / analysis.numCovered : 0.0 );
+    printf( "Overdraw:            %.2f triangles per covered pixel, at most %u\n", analysis.numCovered ? (double)analysis.numFragments / analysis.numCovered : 0.0,
+            maxOverdraw );
+    printf( "March steps:         %llu, %.1f per covered pixel (bounding sphere: %llu)\n", (unsigned long long)analysis.numSteps,
+            analysis.numCovered ? (double)analysis.numSteps / analysis.numCovered : 0.0, (unsigned long long)referenceStats.numSteps );
+    printf( "Past the soft edge:  %llu steps with edgeFade zero (%.1f%%)\n", (unsigned long long)analysis.numEmptySteps,
+            analysis.numSteps ? 100.0 * analysis.numEmptySteps / analysis.numSteps : 0.0 );
+    printf( "Clipped:             %u pixels lose more than half their alpha to the hull (PSNR %.1f)\n", CountClippedPixels( reference, analysis.image ),
+            GetPsnr( reference, analysis.image ) );
+    printf( "Analysis took %.1f ms on %u threads.\n", analysis.milliseconds, pool.GetNumThreads() );
+
+    // Wasted steps against clipping as the skin and tessellation change.
+    printf( "\nSweeps against the bounding sphere's frame (clipped: pixels losing more than half their alpha):\n" );
+    printf( "  %-10s steps/pixel, edgeFade 0, invisible, overdraw, clipped,  PSNR\n", "bias" );
+    const float kBiases[] = { 0.0f, 0.15f, 0.3f, 0.45f, 0.6f, 0.9f, 1.2f };
+    for(size_t i=0 ; i<sizeof(kBiases)/sizeof(kBiases[0]) ; i++)
+    {
+        ExplosionParams sweepParams = params;
+        sweepParams.g_SkinThickness += kBiases[i] - kSkinThicknessBias;
+        HullAnalysis sweep;
+        AnalyseHull( ExplosionEvaluator( sweepParams, textures ), &pool, sweep );
+
+        char label[32];
+        sprintf( label, "%.2f%s", kBiases[i], kBiases[i] == kSkinThicknessBias ? "*" : "" );
+        PrintSweepRow( label, sweep, reference );
+    }
+
+    printf( "  %-10s steps/pixel, edgeFade 0, invisible, overdraw, clipped,  PSNR\n", "factor" );
+    const float kFactors[] = { 4.0f, 8.0f, 16.0f, 32.0f, 64.0f };
+    for(size_t i=0 ; i<sizeof(kFactors)/sizeof(kFactors[0]) ; i++)
+    {
+        ExplosionParams sweepParams = params;
+        sweepParams.g_TessellationFactor = kFactors[i];
+        HullAnalysis sweep;
+        AnalyseHull( ExplosionEvaluator( sweepParams, textures ), &pool, sweep );
+
+        char label[32];
+        sprintf( label, "%.0f%s", kFactors[i], kFactors[i] == kTessellationFactor ? "*" : "" );
+        PrintSweepRow( label, sweep, reference );
+    }
+    printf( "  (* the sample's setting)\n" );
+
+    const char* pOutput = commandLine.GetString( "output", nullptr );
+    if( pOutput )
+    {
+        const std::string output( pOutput );
+        const uint maxSteps = WriteHeatmap( analysis.steps, analysis.width, analysis.height, output + "_steps.ppm" );
+        const uint maxEmptySteps = WriteHeatmap( analysis.emptySteps, analysis.width, analysis.height, output + "_empty.ppm" );
+        WriteHeatmap( analysis.overdraw, analysis.width, analysis.height, output + "_overdraw.ppm" );
+        analysis.image.WritePPM( (output + "_frame.ppm").c_str() );
+        printf( "\nHeatmaps scaled to %u steps, %u steps past the soft edge and %u triangles per pixel.\n", maxSteps, maxEmptySteps, maxOverdraw );
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+#ifndef HULL_ANALYSIS_H
+#define HULL_ANALYSIS_H
+
+//--------------------------------------------------------------------------------------
+// How well the hull from RenderExplosionDS fits the explosion: of the interval
+//  [nearD, farD] it hands each pixel, how much actually holds density.  The hull is
+//  rasterised with HullRasteriser, counting the triangles over every pixel, and
+//  each covered pixel is marched as RenderExplosionPS would, counting the steps
+//  past the soft edge (edgeFade zero), which only cost time.
+//
+//  g_SkinThickness (kSkinThicknessBias on top of the noise bound) and
+//  g_TessellationFactor trade those wasted steps against pixels the hull clips.
+//--------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <vector>
+
+#include "CpuExplosion.h"
+#include "Image.h"
+
+class CommandLine;
+class ThreadPool;
+
+// Alpha below which a pixel shows nothing: half an 8-bit step.
+const float kInvisibleAlpha = 0.5f / 255.0f;
+
+struct HullAnalysis
+{
+    uint width, height;
+    Image image;                        // The frame marched between the hull's depths.
+    std::vector<uint> overdraw;         // Hull triangles over each pixel.
+    std::vector<uint> steps;            // March steps per pixel.
+    std::vector<uint> emptySteps;       // Of those, steps past the soft edge.
+
+    uint numCovered;                    // Pixels the hull covers.
+    uint numInvisible;                  // Covered pixels whose march ends below kInvisibleAlpha.
+    uint64_t numFragments;              // Sum of overdraw.
+    uint64_t numSteps, numEmptySteps;
+    double milliseconds;
+
+    HullAnalysis();
+};
+
+// Rasterises and marches the hull for the frame in g_ScreenParams, rows of pixels
+//  spread across the pool when one is given.
+void AnalyseHull( const ExplosionEvaluator& evaluator, ThreadPool* pPool, HullAnalysis& analysis );
+
+int HullAnalysisMain( const CommandLine& commandLine );
+
+#endif // HULL_ANALYSIS_H
@@ -0,0 +1,362 @@
+#include "HullRasteriser.h"
+#include "FrameArena.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <math.h>
+
+// Triangles each binning job sets up.
+static const uint kTrianglesPerJob = 64;
+
+namespace
+{
+    struct ScreenVertex
+    {
+        float x, y;                         // Pixels, y down.
+        float invW;                         // 1 / view depth, for perspective correct interpolation.
+        float nearOverW, farOverW;
+        bool isValid;                       // In front of the near plane.
+    };
+
+    // Edge function i, A x + B y + C at the pixel centre (x, y), is the opposite
+    //  vertex's barycentric weight times twice the area: positive inside.
+    struct RasterTriangle
+    {
+        float edgeA[3], edgeB[3], edgeC[3];
+        float invW[3], nearOverW[3], farOverW[3];
+        uint x0, y0, x1, y1;                // Pixel bounds, [x0, x1) x [y0, y1).
+    };
+
+    bool SetUpTriangle( const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2, uint width, uint height, RasterTriangle& triangle )
+    {
+        if( !v0.isValid || !v1.isValid || !v2.isValid ) return false;
+
+        const ScreenVertex* pVertices[3] = { &v0, &v1, &v2 };
+        const float doubleArea = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+        if( doubleArea == 0.0f ) return false;
+
+        // Either winding: the sheet can fold over, and folds still bound rays.
+        const float scale = 1.0f / doubleArea;
+        for(uint i=0 ; i<3 ; i++)
+        {
+            const ScreenVertex& a = *pVertices[(i + 1) % 3];
+            const ScreenVertex& b = *pVertices[(i + 2) % 3];
+            triangle.edgeA[i] = (a.y - b.y) * scale;
+            triangle.edgeB[i] = (b.x - a.x) * scale;
+            triangle.edgeC[i] = (a.x * b.y - b.x * a.y) * scale;
+            triangle.invW[i] = pVertices[i]->invW;
+            triangle.nearOverW[i] = pVertices[i]->nearOverW;
+            triangle.farOverW[i] = pVertices[i]->farOverW;
+        }
+
+        const float minX = Min( Min( v0.x, v1.x ), v2.x ), maxX = Max( Max( v0.x, v1.x ), v2.x );
+        const float minY = Min( Min( v0.y, v1.y ), v2.y ), maxY = Max( Max( v0.y, v1.y ), v2.y );
+        if( maxX < 0.5f || maxY < 0.5f || minX >= width - 0.5f || minY >= height - 0.5f ) return false;
+
+        // Pixels whose centres can fall inside.
+        triangle.x0 = (uint)Max( ceilf( minX - 0.5f ), 0.0f );
+        triangle.y0 = (uint)Max( ceilf( minY - 0.5f ), 0.0f );
+        triangle.x1 = std::min( (uint)floorf( maxX - 0.5f ) + 1, width );
+        triangle.y1 = std::min( (uint)floorf( maxY - 0.5f ) + 1, height );
+        return triangle.x0 < triangle.x1 && triangle.y0 < triangle.y1;
+    }
+
+    // Fills [x0, x1) x [y0, y1) of the triangle's bounds, returning the pixels covered.
+    //  The four-wide groups are aligned to 4 pixels, and so never cross a bin edge
+    //  (bins are a multiple of 4 wide); the group at the right edge of the buffer is
+    //  written lane by lane, so nothing outside [x0, x1) changes.
+    uint RasteriseTriangle( const RasterTriangle& triangle, uint x0, uint y0, uint x1, uint y1, HullDepthBuffer& depths )
+    {
+        uint numCovered = 0;
+
+#if CPU_MATH_SSE2
+        const __m128 laneOffsets = _mm_setr_ps( 0.5f, 1.5f, 2.5f, 3.5f );
+        __m128 edgeA[3], edgeStep[3], invW[3], nearOverW[3], farOverW[3];
+        for(uint i=0 ; i<3 ; i++)
+        {
+            edgeA[i] = _mm_set1_ps( triangle.edgeA[i] );
+            edgeStep[i] = _mm_set1_ps( triangle.edgeA[i] * 4.0f );
+            invW[i] = _mm_set1_ps( triangle.invW[i] );
+            nearOverW[i] = _mm_set1_ps( triangle.nearOverW[i] );
+            farOverW[i] = _mm_set1_ps( triangle.farOverW[i] );
+        }
+        const __m128 zero = _mm_setzero_ps();
+        const __m128i laneIndices = _mm_setr_epi32( 0, 1, 2, 3 );
+        const uint xStart = x0 & ~3u;
+        const uint width = depths.GetWidth();
+
+        for(uint y=y0 ; y<y1 ; y++)
+        {
+            float* pNearRow = depths.GetNearRow( y );
+            float* pFarRow = depths.GetFarRow( y );
+            uint* pOverdrawRow = depths.GetOverdrawRow( y );
+
+            __m128 edge[3];
+            for(uint i=0 ; i<3 ; i++)
+            {
+                const float rowStart = triangle.edgeB[i] * (y + 0.5f) + triangle.edgeC[i] + triangle.edgeA[i] * xStart;
+                edge[i] = _mm_add_ps( _mm_set1_ps( rowStart ), _mm_mul_ps( edgeA[i], laneOffsets ) );
+            }
+
+            for(uint x=xStart ; x<x1 ; x+=4)
+            {
+                __m128 inside = _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( edge[0], zero ), _mm_cmpge_ps( edge[1], zero ) ), _mm_cmpge_ps( edge[2], zero ) );
+                if( x < x0 )
+                {
+                    inside = _mm_andnot_ps( _mm_castsi128_ps( _mm_cmplt_epi32( laneIndices, _mm_set1_epi32( (int)(x0 - x) ) ) ), inside );
+                }
+                if( x + 4 > x1 )
+                {
+                    inside = _mm_and_ps( inside, _mm_castsi128_ps( _mm_cmplt_epi32( laneIndices, _mm_set1_epi32( (int)(x1 - x) ) ) ) );
+                }
+
+                const int insideMask = _mm_movemask_ps( inside );
+                if( insideMask )
+                {
+                    // The edge functions are the barycentric weights.
+                    const __m128 w = _mm_add_ps( _mm_add_ps( _mm_mul_ps( edge[0], invW[0] ), _mm_mul_ps( edge[1], invW[1] ) ), _mm_mul_ps( edge[2], invW[2] ) );
+                    const __m128 invInterpolatedW = _mm_div_ps( _mm_set1_ps( 1.0f ), w );
+                    const __m128 nearD = _mm_mul_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( edge[0], nearOverW[0] ), _mm_mul_ps( edge[1], nearOverW[1] ) ),
+                                                                 _mm_mul_ps( edge[2], nearOverW[2] ) ), invInterpolatedW );
+                    const __m128 farD = _mm_mul_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( edge[0], farOverW[0] ), _mm_mul_ps( edge[1], farOverW[1] ) ),
+                                                                _mm_mul_ps( edge[2], farOverW[2] ) ), invInterpolatedW );
+
+                    if( x + 4 <= width )
+                    {
+                        const __m128 oldNear = _mm_loadu_ps( pNearRow + x );
+                        const __m128 oldFar = _mm_loadu_ps( pFarRow + x );
+                        _mm_storeu_ps( pNearRow + x, _mm_or_ps( _mm_and_ps( inside, _mm_min_ps( oldNear, nearD ) ), _mm_andnot_ps( inside, oldNear ) ) );
+                        _mm_storeu_ps( pFarRow + x, _mm_or_ps( _mm_and_ps( inside, _mm_max_ps( oldFar, farD ) ), _mm_andnot_ps( inside, oldFar ) ) );
+                    }
+                    else
+                    {
+                        float nearLanes[4], farLanes[4];
+                        _mm_storeu_ps( nearLanes, nearD );
+                        _mm_storeu_ps( farLanes, farD );
+                        for(uint lane=0 ; lane<4 ; lane++)
+                        {
+                            if( !((insideMask >> lane) & 1) ) continue;
+                            pNearRow[x + lane] = Min( pNearRow[x + lane], nearLanes[lane] );
+                            pFarRow[x + lane] = Max( pFarRow[x + lane], farLanes[lane] );
+                        }
+                    }
+
+                    for(uint lane=0 ; lane<4 ; lane++)
+                    {
+                        const uint isInside = (insideMask >> lane) & 1;
+                        numCovered += isInside;
+                        if( pOverdrawRow && isInside ) pOverdrawRow[x + lane]++;
+                    }
+                }
+
+                for(uint i=0 ; i<3 ; i++) edge[i] = _mm_add_ps( edge[i], edgeStep[i] );
+            }
+        }
+#else
+        for(uint y=y0 ; y<y1 ; y++)
+        {
+            float* pNearRow = depths.GetNearRow( y );
+            float* pFarRow = depths.GetFarRow( y );
+            uint* pOverdrawRow = depths.GetOverdrawRow( y );
+            for(uint x=x0 ; x<x1 ; x++)
+            {
+                float edge[3];
+                for(uint i=0 ; i<3 ; i++) edge[i] = triangle.edgeB[i] * (y + 0.5f) + triangle.edgeC[i] + triangle.edgeA[i] * (x + 0.5f);
+                if( edge[0] < 0.0f || edge[1] < 0.0f || edge[2] < 0.0f ) continue;
+
+                const float w = edge[0] * triangle.invW[0] + edge[1] * triangle.invW[1] + edge[2] * triangle.invW[2];
+                const float nearD = (edge[0] * triangle.nearOverW[0] + edge[1] * triangle.nearOverW[1] + edge[2] * triangle.nearOverW[2]) / w;
+                const float farD = (edge[0] * triangle.farOverW[0] + edge[1] * triangle.farOverW[1] + edge[2] * triangle.farOverW[2]) / w;
+                pNearRow[x] = Min( pNearRow[x], nearD );
+                pFarRow[x] = Max( pFarRow[x], farD );
+                if( pOverdrawRow ) pOverdrawRow[x]++;
+                numCovered++;
+            }
+        }
+#endif
+
+        return numCovered;
+    }
+}
+
+HullDepthBuffer::HullDepthBuffer( bool countOverdraw )
+    : m_Width(0)
+    , m_Height(0)
+    , m_CountOverdraw(countOverdraw)
+    , m_pNearD(nullptr)
+    , m_pFarD(nullptr)
+    , m_pOverdraw(nullptr)
+{
+}
+
+void HullDepthBuffer::Reset( uint width, uint height, LinearArena& arena )
+{
+    m_Width = width;
+    m_Height = height;
+
+    const uint numPixels = width * height;
+    m_pNearD = (float*)arena.Allocate( numPixels * sizeof(float) );
+    m_pFarD = (float*)arena.Allocate( numPixels * sizeof(float) );
+    std::fill( m_pNearD, m_pNearD + numPixels, FLT_MAX );
+    std::fill( m_pFarD, m_pFarD + numPixels, -FLT_MAX );
+    m_pOverdraw = m_CountOverdraw ? arena.AllocateArray<uint>( numPixels ) : nullptr;
+}
+
+RasterStats::RasterStats()
+    : numTriangles(0)
+    , numSkipped(0)
+    , numBehindNear(0)
+    , numBinEntries(0)
+    , numFragments(0)
+    , milliseconds(0)
+{
+}
+
+bool RasteriseHull( const ExplosionParams& params, const HullVertex* pVertices, uint numVertices, ThreadPool* pPool, HullDepthBuffer& depths, LinearArena& arena,
+                    RasterStats* pStats )
+{
+    Timer timer;
+
+    const uint width = (uint)params.g_ScreenParams.x;
+    const uint height = (uint)params.g_ScreenParams.y;
+    depths.Reset( width, height, arena );
+
+    // The patch is square: EvaluateHull's rows of numSegments+1 vertices.
+    const uint numSegments = (uint)(sqrtf( (float)numVertices ) + 0.5f) - 1;
+    if( numVertices == 0 || (numSegments + 1) * (numSegments + 1) != numVertices )
+    {
+        if( pStats ) *pStats = RasterStats();
+        return numVertices == 0;
+    }
+
+    ScreenVertex* pScreenVertices = arena.AllocateArray<ScreenVertex>( numVertices );
+    uint numBehindNear = 0;
+    for(uint i=0 ; i<numVertices ; i++)
+    {
+        const Vec4 posPS = Transform( params.g_WorldToProjectionMatrix, Vec4( pVertices[i].frontPosWS, 1.0f ) );
+        ScreenVertex& vertex = pScreenVertices[i];
+        vertex.isValid = posPS.w >= params.g_ProjectionParams.w;
+        numBehindNear += vertex.isValid ? 0 : 1;
+        const float invW = vertex.isValid ? 1.0f / posPS.w : 0.0f;
+        vertex.x = (posPS.x * invW * 0.5f + 0.5f) * width;
+        vertex.y = (0.5f - posPS.y * invW * 0.5f) * height;
+        vertex.invW = invW;
+        vertex.nearOverW = pVertices[i].nearD * invW;
+        vertex.farOverW = pVertices[i].farD * invW;
+    }
+
+    const uint numTriangles = numSegments * numSegments * 2;
+    const uint numBinsX = (width + kRasterBinSize - 1) / kRasterBinSize;
+    const uint numBinsY = (height + kRasterBinSize - 1) / kRasterBinSize;
+    const uint numBins = numBinsX * numBinsY;
+    const uint numJobs = (numTriangles + kTrianglesPerJob - 1) / kTrianglesPerJob;
+
+    // Set up and count: each job owns a run of triangles and a count per bin, so
+    //  binning needs no locks.
+    RasterTriangle* pTriangles = arena.AllocateArray<RasterTriangle>( numTriangles );
+    uint8_t* pIsVisible = arena.AllocateArray<uint8_t>( numTriangles );
+    uint* pJobBinCounts = arena.AllocateArray<uint>( numJobs * numBins );
+    auto setUpTriangles = [&]( uint job, uint )
+    {
+        for(uint t=job*kTrianglesPerJob ; t<std::min( (job + 1) * kTrianglesPerJob, numTriangles ) ; t++)
+        {
+            const uint quad = t / 2, quadX = quad % numSegments, quadY = quad / numSegments;
+            const uint v00 = quadY * (numSegments + 1) + quadX, v10 = v00 + 1, v01 = v00 + numSegments + 1, v11 = v01 + 1;
+            const bool isFirst = (t & 1) == 0;
+
+            RasterTriangle& triangle = pTriangles[t];
+            if( !SetUpTriangle( pScreenVertices[v00], isFirst ? pScreenVertices[v10] : pScreenVertices[v11], isFirst ? pScreenVertices[v11] : pScreenVertices[v01],
+                                width, height, triangle ) )
+            {
+                continue;
+            }
+            pIsVisible[t] = 1;
+
+            for(uint binY=triangle.y0/kRasterBinSize ; binY<=(triangle.y1 - 1)/kRasterBinSize ; binY++)
+            {
+                for(uint binX=triangle.x0/kRasterBinSize ; binX<=(triangle.x1 - 1)/kRasterBinSize ; binX++) pJobBinCounts[job * numBins + binY * numBinsX + binX]++;
+            }
+        }
+    };
+
+    // Lay the bins out one after another, each holding its triangles job by job, so
+    //  that they keep submission order.  The counts become each job's write cursor.
+    uint* pBinStarts = arena.AllocateArray<uint>( numBins + 1 );
+    uint* pBinEntries = nullptr;
+    auto layOutBins = [&]()
+    {
+        uint numEntries = 0;
+        for(uint bin=0 ; bin<numBins ; bin++)
+        {
+            pBinStarts[bin] = numEntries;
+            for(uint job=0 ; job<numJobs ; job++)
+            {
+                const uint count = pJobBinCounts[job * numBins + bin];
+                pJobBinCounts[job * numBins + bin] = numEntries;
+                numEntries += count;
+            }
+        }
+        pBinStarts[numBins] = numEntries;
+        pBinEntries = arena.AllocateArray<uint>( numEntries );
+    };
+
+    auto binTriangles = [&]( uint job, uint )
+    {
+        for(uint t=job*kTrianglesPerJob ; t<std::min( (job + 1) * kTrianglesPerJob, numTriangles ) ; t++)
+        {
+            if( !pIsVisible[t] ) continue;
+            const RasterTriangle& triangle = pTriangles[t];
+            for(uint binY=triangle.y0/kRasterBinSize ; binY<=(triangle.y1 - 1)/kRasterBinSize ; binY++)
+            {
+                for(uint binX=triangle.x0/kRasterBinSize ; binX<=(triangle.x1 - 1)/kRasterBinSize ; binX++)
+                {
+                    pBinEntries[pJobBinCounts[job * numBins + binY * numBinsX + binX]++] = t;
+                }
+            }
+        }
+    };
+
+    // Fill: bins share no pixels, and RasteriseTriangle touches none outside its bin.
+    uint64_t* pBinFragments = arena.AllocateArray<uint64_t>( numBins );
+    auto rasteriseBin = [&]( uint bin, uint )
+    {
+        const uint x0 = (bin % numBinsX) * kRasterBinSize, y0 = (bin / numBinsX) * kRasterBinSize;
+        const uint x1 = std::min( x0 + kRasterBinSize, width ), y1 = std::min( y0 + kRasterBinSize, height );
+        for(uint i=pBinStarts[bin] ; i<pBinStarts[bin + 1] ; i++)
+        {
+            const RasterTriangle& triangle = pTriangles[pBinEntries[i]];
+            pBinFragments[bin] += RasteriseTriangle( triangle, std::max( triangle.x0, x0 ), std::max( triangle.y0, y0 ), std::min( triangle.x1, x1 ),
+                                                     std::min( triangle.y1, y1 ), depths );
+        }
+    };
+
+    if( pPool )
+    {
+        pPool->ParallelFor( numJobs, setUpTriangles );
+        layOutBins();
+        pPool->ParallelFor( numJobs, binTriangles );
+        pPool->ParallelFor( numBins, rasteriseBin );
+    }
+    else
+    {
+        for(uint job=0 ; job<numJobs ; job++) setUpTriangles( job, 0 );
+        layOutBins();
+        for(uint job=0 ; job<numJobs ; job++) binTriangles( job, 0 );
+        for(uint bin=0 ; bin<numBins ; bin++) rasteriseBin( bin, 0 );
+    }
+
+    if( pStats )
+    {
+        RasterStats stats;
+        stats.numTriangles = numTriangles;
+        for(uint t=0 ; t<numTriangles ; t++) stats.numSkipped += pIsVisible[t] ? 0 : 1;
+        stats.numBehindNear = numBehindNear;
+        stats.numBinEntries = pBinStarts[numBins];
+        for(uint bin=0 ; bin<numBins ; bin++) stats.numFragments += pBinFragments[bin];
+        stats.milliseconds = timer.GetElapsedMilliseconds();
+        *pStats = stats;
+    }
+
+    return numBehindNear == 0;
+}
@@ -0,0 +1,85 @@
+#ifndef HULL_RASTERISER_H
+#define HULL_RASTERISER_H
+
+//--------------------------------------------------------------------------------------
+// Software rasteriser for the tessellated hull, so that the CPU renderer can march
+//  between the depths RenderExplosionDS hands the pixel shader instead of the
+//  analytic bounding sphere.
+//
+//  The (g_TessellationFactor+1)^2 front vertices of EvaluateHull are projected and
+//  split into two triangles per quad, each carrying the vertex's near and far view
+//  depths.  Triangles are set up and binned into kRasterBinSize^2 pixel bins in
+//  parallel, then the bins are filled in parallel, with the edge functions
+//  evaluated for four pixels at a time with SSE2.  Every pixel keeps the nearest
+//  near depth and the furthest far depth of all the triangles covering it, so where
+//  the shrink-wrapped sheet folds over itself the interval is the union rather than
+//  whichever fragment the depth test would have kept.  Pixel centres on an edge
+//  count as inside both triangles that share it, so there are no cracks.
+//
+//  Everything, the depths included, lives in a LinearArena for the frame.
+//--------------------------------------------------------------------------------------
+#include <float.h>
+#include <stdint.h>
+
+#include "CpuHull.h"
+
+class LinearArena;
+class ThreadPool;
+
+// A multiple of 4, so the rasteriser's four-pixel groups never straddle two bins.
+const uint kRasterBinSize = 32;
+
+// The near and far view depths the rasterised hull gives every pixel.
+class HullDepthBuffer
+{
+public:
+    // With countOverdraw, also counts the triangles covering each pixel.
+    explicit HullDepthBuffer( bool countOverdraw = false );
+
+    // Resizes, in the arena, and marks every pixel uncovered.  The depths are
+    //  valid until the arena is reset.
+    void Reset( uint width, uint height, LinearArena& arena );
+
+    uint GetWidth() const { return m_Width; }
+    uint GetHeight() const { return m_Height; }
+
+    bool IsCovered( uint x, uint y ) const { return m_pNearD[y * m_Width + x] != FLT_MAX; }
+    float GetNearD( uint x, uint y ) const { return m_pNearD[y * m_Width + x]; }
+    float GetFarD( uint x, uint y ) const { return m_pFarD[y * m_Width + x]; }
+    uint GetOverdraw( uint x, uint y ) const { return m_pOverdraw ? m_pOverdraw[y * m_Width + x] : 0; }
+
+    // Rows of depths, unpadded.  RasteriseTriangle writes the last group of a row
+    //  lane by lane rather than four at once.
+    float* GetNearRow( uint y ) { return m_pNearD + y * m_Width; }
+    float* GetFarRow( uint y ) { return m_pFarD + y * m_Width; }
+    uint* GetOverdrawRow( uint y ) { return m_pOverdraw ? m_pOverdraw + y * m_Width : nullptr; }
+
+private:
+    uint m_Width, m_Height;
+    bool m_CountOverdraw;
+    float* m_pNearD;
+    float* m_pFarD;
+    uint* m_pOverdraw;
+};
+
+struct RasterStats
+{
+    uint numTriangles;
+    uint numSkipped;            // Degenerate, off screen, or with a vertex behind the near plane.
+    uint numBehindNear;         // Vertices behind the near plane.
+    uint numBinEntries;         // Triangle-bin pairs after binning.
+    uint64_t numFragments;      // Pixels covered, counted once per triangle.
+    double milliseconds;
+
+    RasterStats();
+};
+
+// Rasterises the front sheet of the hull vertices (row by row, as EvaluateHull
+//  returns them) for the frame in g_ScreenParams.  The depths, triangles and bins
+//  are allocated from the arena.  Triangles are not clipped, so those reaching
+//  behind the near plane are dropped; returns false if there were any, when the
+//  depths leave uncovered pixels that the hull covers and should not be used.
+bool RasteriseHull( const ExplosionParams& params, const HullVertex* pVertices, uint numVertices, ThreadPool* pPool, HullDepthBuffer& depths, LinearArena& arena,
+                    RasterStats* pStats = nullptr );
+
+#endif // HULL_RASTERISER_H
@@ -0,0 +1,79 @@
+#include "Image.h"
+
+#include <stdio.h>
+
+Image::Image()
+    : m_Width(0)
+    , m_Height(0)
+{
+}
+
+Image::Image( uint width, uint height )
+    : m_Width(0)
+    , m_Height(0)
+{
+    Resize( width, height );
+}
+
+void Image::Resize( uint width, uint height )
+{
+    m_Width = width;
+    m_Height = height;
+    m_Pixels.resize( width * height );
+}
+
+void Image::Clear( const Vec4& colour )
+{
+    for(size_t i=0 ; i<m_Pixels.size() ; i++) m_Pixels[i] = colour;
+}
+
+void Image::BlitScaled( const Image& source, uint x, uint y, uint width, uint height )
+{
+    for(uint dy=0 ; dy<height && y + dy<m_Height ; dy++)
+    {
+        const uint sy0 = dy * source.m_Height / height;
+        uint sy1 = (dy + 1) * source.m_Height / height;
+        if( sy1 <= sy0 ) sy1 = sy0 + 1;
+        if( sy1 > source.m_Height ) sy1 = source.m_Height;
+
+        for(uint dx=0 ; dx<width && x + dx<m_Width ; dx++)
+        {
+            const uint sx0 = dx * source.m_Width / width;
+            uint sx1 = (dx + 1) * source.m_Width / width;
+            if( sx1 <= sx0 ) sx1 = sx0 + 1;
+            if( sx1 > source.m_Width ) sx1 = source.m_Width;
+
+            Vec4 sum( 0.0f );
+            for(uint sy=sy0 ; sy<sy1 ; sy++)
+            {
+                for(uint sx=sx0 ; sx<sx1 ; sx++) sum = sum + source.At( sx, sy );
+            }
+            At( x + dx, y + dy ) = sum * (1.0f / ((sx1 - sx0) * (sy1 - sy0)));
+        }
+    }
+}
+
+bool Image::WritePPM( const char* pFileName ) const
+{
+    FILE* pFile = fopen( pFileName, "wb" );
+    if( !pFile ) return false;
+
+    fprintf( pFile, "P6\n%u %u\n255\n", m_Width, m_Height );
+
+    std::vector<unsigned char> row( m_Width * 3 );
+    for(uint y=0 ; y<m_Height ; y++)
+    {
+        for(uint x=0 ; x<m_Width ; x++)
+        {
+            const Vec3 colour = ResolveOverBlack( At( x, y ) );
+            row[x * 3 + 0] = (unsigned char)(Saturate( colour.x ) * 255.0f + 0.5f);
+            row[x * 3 + 1] = (unsigned char)(Saturate( colour.y ) * 255.0f + 0.5f);
+            row[x * 3 + 2] = (unsigned char)(Saturate( colour.z ) * 255.0f + 0.5f);
+        }
+        fwrite( &row[0], 1, row.size(), pFile );
+    }
+
+    const bool succeeded = ferror( pFile ) == 0;
+    fclose( pFile );
+    return succeeded;
+}
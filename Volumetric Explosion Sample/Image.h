@@ -0,0 +1,46 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+//--------------------------------------------------------------------------------------
+// Floating point RGBA image written by the CPU renderer.  Pixels hold the raw
+//  output of the ray march (RenderExplosionPS), before it is blended into the
+//  back buffer.
+//--------------------------------------------------------------------------------------
+#include <vector>
+
+#include "CpuMath.h"
+
+class Image
+{
+public:
+    Image();
+    Image( uint width, uint height );
+
+    void Resize( uint width, uint height );
+    void Clear( const Vec4& colour );
+
+    uint GetWidth() const { return m_Width; }
+    uint GetHeight() const { return m_Height; }
+
+    Vec4& At( uint x, uint y ) { return m_Pixels[y * m_Width + x]; }
+    const Vec4& At( uint x, uint y ) const { return m_Pixels[y * m_Width + x]; }
+
+    // Box filters the source into the given rectangle of this image.
+    void BlitScaled( const Image& source, uint x, uint y, uint width, uint height );
+
+    // Writes a binary PPM showing the image as the sample would present it: blended
+    //  with g_pOverBlendState over the black clear colour.
+    bool WritePPM( const char* pFileName ) const;
+
+private:
+    uint m_Width, m_Height;
+    std::vector<Vec4> m_Pixels;
+};
+
+// The sample's back buffer colour for a pixel: SRC_ALPHA / INV_SRC_ALPHA over black.
+inline Vec3 ResolveOverBlack( const Vec4& pixel )
+{
+    return pixel.xyz() * pixel.w;
+}
+
+#endif // IMAGE_H
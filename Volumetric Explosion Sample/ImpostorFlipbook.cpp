@@ -0,0 +1,473 @@
+#include "ImpostorFlipbook.h"
+#include "CpuRenderer.h"
+#include "Headless.h"
+#include "Image.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static const char kFlipbookMagic[4] = { 'E', 'X', 'F', 'B' };
+static const uint kFlipbookVersion = 1;
+
+// The sample's vertical field of view, which the bake cameras share.
+static const float kBakeFovY = 60*PI/180;
+
+ImpostorBakeSettings::ImpostorBakeSettings()
+    : cellSize(64)
+    , numFrames(32)
+    , timeStart(0.0f)
+    , timeEnd(16.0f)
+    , numViews(8)
+    , viewPhi(PI * 0.5f)
+{
+}
+
+ImpostorFlipbook::ImpostorFlipbook()
+    : m_CellSize(0)
+    , m_NumFrames(0)
+    , m_Columns(0)
+    , m_Rows(0)
+    , m_TimeStart(0)
+    , m_TimeEnd(0)
+    , m_BoundingRadiusWS(0)
+    , m_BakeDistanceWS(0)
+    , m_HalfExtentWS(0)
+{
+}
+
+//--------------------------------------------------------------------------------------
+// Serialisation
+//--------------------------------------------------------------------------------------
+namespace
+{
+    template<typename T> bool WriteValue( FILE* pFile, const T& value ) { return fwrite( &value, sizeof(T), 1, pFile ) == 1; }
+    template<typename T> bool ReadValue( FILE* pFile, T& value ) { return fread( &value, sizeof(T), 1, pFile ) == 1; }
+}
+
+bool ImpostorFlipbook::Save( const char* pFileName ) const
+{
+    FILE* pFile = fopen( pFileName, "wb" );
+    if( !pFile ) return false;
+
+    bool succeeded = fwrite( kFlipbookMagic, 1, 4, pFile ) == 4;
+    succeeded = succeeded && WriteValue( pFile, kFlipbookVersion );
+    succeeded = succeeded && WriteValue( pFile, m_CellSize );
+    succeeded = succeeded && WriteValue( pFile, m_NumFrames );
+    succeeded = succeeded && WriteValue( pFile, (uint)m_ViewDirections.size() );
+    succeeded = succeeded && WriteValue( pFile, m_Columns );
+    succeeded = succeeded && WriteValue( pFile, m_Rows );
+    succeeded = succeeded && WriteValue( pFile, m_TimeStart );
+    succeeded = succeeded && WriteValue( pFile, m_TimeEnd );
+    succeeded = succeeded && WriteValue( pFile, m_BoundingRadiusWS );
+    succeeded = succeeded && WriteValue( pFile, m_BakeDistanceWS );
+    succeeded = succeeded && WriteValue( pFile, m_HalfExtentWS );
+    for(size_t i=0 ; i<m_ViewDirections.size() && succeeded ; i++)
+    {
+        succeeded = WriteValue( pFile, m_ViewDirections[i] );
+    }
+    succeeded = succeeded && fwrite( &m_Colour[0], 1, m_Colour.size(), pFile ) == m_Colour.size();
+    succeeded = succeeded && fwrite( &m_Depth[0], 1, m_Depth.size(), pFile ) == m_Depth.size();
+
+    fclose( pFile );
+    return succeeded;
+}
+
+bool ImpostorFlipbook::Load( const char* pFileName )
+{
+    FILE* pFile = fopen( pFileName, "rb" );
+    if( !pFile ) return false;
+
+    char magic[4];
+    uint version = 0, numViews = 0;
+    bool succeeded = fread( magic, 1, 4, pFile ) == 4 && memcmp( magic, kFlipbookMagic, 4 ) == 0;
+    succeeded = succeeded && ReadValue( pFile, version ) && version == kFlipbookVersion;
+    succeeded = succeeded && ReadValue( pFile, m_CellSize );
+    succeeded = succeeded && ReadValue( pFile, m_NumFrames );
+    succeeded = succeeded && ReadValue( pFile, numViews );
+    succeeded = succeeded && ReadValue( pFile, m_Columns );
+    succeeded = succeeded && ReadValue( pFile, m_Rows );
+    succeeded = succeeded && ReadValue( pFile, m_TimeStart );
+    succeeded = succeeded && ReadValue( pFile, m_TimeEnd );
+    succeeded = succeeded && ReadValue( pFile, m_BoundingRadiusWS );
+    succeeded = succeeded && ReadValue( pFile, m_BakeDistanceWS );
+    succeeded = succeeded && ReadValue( pFile, m_HalfExtentWS );
+    succeeded = succeeded && numViews > 0 && m_NumFrames > 0 && m_Columns * m_Rows >= numViews * m_NumFrames;
+
+    if( succeeded )
+    {
+        m_ViewDirections.resize( numViews );
+        for(uint i=0 ; i<numViews && succeeded ; i++) succeeded = ReadValue( pFile, m_ViewDirections[i] );
+
+        m_Colour.resize( GetAtlasWidth() * GetAtlasHeight() * 4 );
+        m_Depth.resize( GetAtlasWidth() * GetAtlasHeight() );
+        succeeded = succeeded && fread( &m_Colour[0], 1, m_Colour.size(), pFile ) == m_Colour.size();
+        succeeded = succeeded && fread( &m_Depth[0], 1, m_Depth.size(), pFile ) == m_Depth.size();
+    }
+
+    fclose( pFile );
+    if( !succeeded )
+    {
+        m_ViewDirections.clear();
+        m_Colour.clear();
+        m_Depth.clear();
+    }
+    return succeeded;
+}
+
+//--------------------------------------------------------------------------------------
+// Playback
+//--------------------------------------------------------------------------------------
+uint ImpostorFlipbook::SelectView( const Vec3& directionToEyeWS ) const
+{
+    uint bestView = 0;
+    float bestDot = -2.0f;
+    for(uint i=0 ; i<m_ViewDirections.size() ; i++)
+    {
+        const float d = Dot( m_ViewDirections[i], directionToEyeWS );
+        if( d > bestDot )
+        {
+            bestDot = d;
+            bestView = i;
+        }
+    }
+    return bestView;
+}
+
+void ImpostorFlipbook::SelectFrames( float time, uint& frame0, uint& frame1, float& blend ) const
+{
+    // The frames are spaced so that the last one blends back into the first.
+    float phase = (time - m_TimeStart) / (m_TimeEnd - m_TimeStart);
+    phase -= floorf( phase );
+
+    const float frame = phase * m_NumFrames;
+    frame0 = (uint)frame % m_NumFrames;
+    frame1 = (frame0 + 1) % m_NumFrames;
+    blend = frame - floorf( frame );
+}
+
+float4 ImpostorFlipbook::GetCellScaleBias( uint view, uint frame ) const
+{
+    const uint cell = view * m_NumFrames + frame;
+    const float invAtlasWidth = 1.0f / GetAtlasWidth();
+    const float invAtlasHeight = 1.0f / GetAtlasHeight();
+
+    return float4( (m_CellSize - 1) * invAtlasWidth,
+                   (m_CellSize - 1) * invAtlasHeight,
+                   ((cell % m_Columns) * m_CellSize + 0.5f) * invAtlasWidth,
+                   ((cell / m_Columns) * m_CellSize + 0.5f) * invAtlasHeight );
+}
+
+void ImpostorFlipbook::BuildImpostorParams( const ExplosionParams& params, float time, ImpostorParams& impostorParams ) const
+{
+    const Vec3 centreWS( params.g_ExplosionPositionWS );
+    const Vec3 eyeWS( params.g_EyePositionWS );
+    const Vec3 forwardWS( params.g_EyeForwardWS );
+
+    uint frame0, frame1;
+    float blend;
+    SelectFrames( time, frame0, frame1, blend );
+    const uint view = SelectView( Normalize( eyeWS - centreWS ) );
+
+    // The quad faces the camera, so its axes are the camera's.
+    const float4x4& worldToView = params.g_WorldToViewMatrix;
+    const Vec3 rightWS( worldToView.m[0][0], worldToView.m[1][0], worldToView.m[2][0] );
+    const Vec3 upWS( worldToView.m[0][1], worldToView.m[1][1], worldToView.m[2][1] );
+
+    impostorParams.g_ImpostorWorldToProjectionMatrix = params.g_WorldToProjectionMatrix;
+    impostorParams.g_ImpostorCentreWS = params.g_ExplosionPositionWS;
+    impostorParams.g_ImpostorHalfExtentWS = m_HalfExtentWS;
+    impostorParams.g_ImpostorRightWS = float3( rightWS.x, rightWS.y, rightWS.z );
+    impostorParams.g_ImpostorFrameBlend = blend;
+    impostorParams.g_ImpostorUpWS = float3( upWS.x, upWS.y, upWS.z );
+    impostorParams.g_ImpostorNearDepthVS = Dot( centreWS - eyeWS, forwardWS ) - m_BoundingRadiusWS;
+    impostorParams.g_ImpostorFrame0ScaleBias = GetCellScaleBias( view, frame0 );
+    impostorParams.g_ImpostorFrame1ScaleBias = GetCellScaleBias( view, frame1 );
+    impostorParams.g_ImpostorProjectionParams = params.g_ProjectionParams;
+    impostorParams.g_ImpostorDepthRangeVS = 2.0f * m_BoundingRadiusWS;
+    impostorParams.g_ImpostorPadding = float3( 0, 0, 0 );
+}
+
+Vec4 ImpostorFlipbook::SampleColour( float u, float v ) const
+{
+    const uint width = GetAtlasWidth(), height = GetAtlasHeight();
+    const float x = Clamp( u * width - 0.5f, 0.0f, (float)(width - 1) );
+    const float y = Clamp( v * height - 0.5f, 0.0f, (float)(height - 1) );
+    const uint x0 = (uint)x, x1 = x0 + 1 < width ? x0 + 1 : x0;
+    const uint y0 = (uint)y, y1 = y0 + 1 < height ? y0 + 1 : y0;
+    const float tx = x - x0, ty = y - y0;
+
+    const uint8_t* p00 = &m_Colour[(y0 * width + x0) * 4];
+    const uint8_t* p10 = &m_Colour[(y0 * width + x1) * 4];
+    const uint8_t* p01 = &m_Colour[(y1 * width + x0) * 4];
+    const uint8_t* p11 = &m_Colour[(y1 * width + x1) * 4];
+
+    float result[4];
+    for(uint c=0 ; c<4 ; c++)
+    {
+        const float top = Lerp( p00[c], p10[c], tx );
+        const float bottom = Lerp( p01[c], p11[c], tx );
+        result[c] = Lerp( top, bottom, ty ) * (1.0f / 255.0f);
+    }
+    return Vec4( result[0], result[1], result[2], result[3] );
+}
+
+float ImpostorFlipbook::SampleDepth( float u, float v ) const
+{
+    const uint width = GetAtlasWidth(), height = GetAtlasHeight();
+    const float x = Clamp( u * width - 0.5f, 0.0f, (float)(width - 1) );
+    const float y = Clamp( v * height - 0.5f, 0.0f, (float)(height - 1) );
+    const uint x0 = (uint)x, x1 = x0 + 1 < width ? x0 + 1 : x0;
+    const uint y0 = (uint)y, y1 = y0 + 1 < height ? y0 + 1 : y0;
+    const float tx = x - x0, ty = y - y0;
+
+    const float top = Lerp( m_Depth[y0 * width + x0], m_Depth[y0 * width + x1], tx );
+    const float bottom = Lerp( m_Depth[y1 * width + x0], m_Depth[y1 * width + x1], tx );
+    return Lerp( top, bottom, ty ) * (1.0f / 255.0f);
+}
+
+//--------------------------------------------------------------------------------------
+// Baking
+//--------------------------------------------------------------------------------------
+bool ImpostorFlipbook::Bake( const ExplosionSettings& settings, const SceneTextures& textures, const ImpostorBakeSettings& bakeSettings, ThreadPool& pool )
+{
+    if( bakeSettings.cellSize == 0 || bakeSettings.numFrames == 0 || bakeSettings.numViews == 0 ) return false;
+
+    const float largestAbsoluteNoiseValue = textures.noiseVolume.GetLargestAbsoluteValue();
+
+    // Frame the bounding sphere exactly in the bake camera's field of view.
+    ExplosionParams referenceParams;
+    BuildExplosionParams( settings, OrbitCamera(), bakeSettings.timeStart, bakeSettings.cellSize, bakeSettings.cellSize, largestAbsoluteNoiseValue, referenceParams );
+    m_BoundingRadiusWS = GetExplosionBoundingRadius( referenceParams );
+    m_BakeDistanceWS = m_BoundingRadiusWS / sinf( kBakeFovY * 0.5f );
+    m_HalfExtentWS = m_BakeDistanceWS * tanf( kBakeFovY * 0.5f );
+
+    const uint numCells = bakeSettings.numViews * bakeSettings.numFrames;
+    m_CellSize = bakeSettings.cellSize;
+    m_NumFrames = bakeSettings.numFrames;
+    m_Columns = (uint)ceilf( sqrtf( (float)numCells ) );
+    m_Rows = (numCells + m_Columns - 1) / m_Columns;
+    m_TimeStart = bakeSettings.timeStart;
+    m_TimeEnd = bakeSettings.timeEnd;
+
+    m_ViewDirections.resize( bakeSettings.numViews );
+    m_Colour.assign( GetAtlasWidth() * GetAtlasHeight() * 4, 0 );
+    m_Depth.assign( GetAtlasWidth() * GetAtlasHeight(), 255 );
+
+    const uint atlasWidth = GetAtlasWidth();
+    pool.ParallelFor( numCells, [&]( uint cell, uint )
+    {
+        const uint view = cell / m_NumFrames;
+        const uint frame = cell % m_NumFrames;
+
+        OrbitCamera camera;
+        camera.theta = 2.0f * PI * view / bakeSettings.numViews;
+        camera.phi = bakeSettings.viewPhi;
+        camera.radius = m_BakeDistanceWS;
+        const float time = Lerp( m_TimeStart, m_TimeEnd, (float)frame / m_NumFrames );
+
+        ExplosionParams params;
+        BuildExplosionParams( settings, camera, time, m_CellSize, m_CellSize, largestAbsoluteNoiseValue, params );
+        const ExplosionEvaluator evaluator( params, textures );
+
+        if( frame == 0 )
+        {
+            m_ViewDirections[view] = Normalize( Vec3( params.g_EyePositionWS ) - Vec3( params.g_ExplosionPositionWS ) );
+        }
+
+        const uint cellX = (cell % m_Columns) * m_CellSize;
+        const uint cellY = (cell / m_Columns) * m_CellSize;
+        const float nearDepth = m_BakeDistanceWS - m_BoundingRadiusWS;
+
+        for(uint y=0 ; y<m_CellSize ; y++)
+        {
+            for(uint x=0 ; x<m_CellSize ; x++)
+            {
+                const Vec3 rayDirectionWS = GetRayDirectionWS( params, x + 0.5f, y + 0.5f );
+
+                float nearD, farD;
+                if( !GetAnalyticRayInterval( params, rayDirectionWS, nearD, farD ) ) continue;
+
+                uint stepsTaken;
+                float depth;
+                const Vec4 colour = RayMarchExplosion( evaluator, rayDirectionWS, nearD, farD, stepsTaken, &depth );
+
+                const uint texel = (cellY + y) * atlasWidth + cellX + x;
+                m_Colour[texel * 4 + 0] = (uint8_t)(Saturate( colour.x ) * 255.0f + 0.5f);
+                m_Colour[texel * 4 + 1] = (uint8_t)(Saturate( colour.y ) * 255.0f + 0.5f);
+                m_Colour[texel * 4 + 2] = (uint8_t)(Saturate( colour.z ) * 255.0f + 0.5f);
+                m_Colour[texel * 4 + 3] = (uint8_t)(Saturate( colour.w ) * 255.0f + 0.5f);
+                m_Depth[texel] = (uint8_t)(Saturate( (depth - nearDepth) / (2.0f * m_BoundingRadiusWS) ) * 255.0f + 0.5f);
+            }
+        }
+    } );
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// CPU version of RenderImpostorVS/PS
+//--------------------------------------------------------------------------------------
+uint DrawImpostor( const ImpostorFlipbook& flipbook, const ExplosionParams& params, const ImpostorParams& impostorParams, Image& target )
+{
+    const Vec3 centreWS( impostorParams.g_ImpostorCentreWS );
+    const Vec3 rightWS( impostorParams.g_ImpostorRightWS );
+    const Vec3 upWS( impostorParams.g_ImpostorUpWS );
+    const Vec3 eyeWS( params.g_EyePositionWS );
+    const float halfExtent = impostorParams.g_ImpostorHalfExtentWS;
+
+    // Screen rectangle of the quad (the rasteriser's job on the GPU).
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+    for(uint corner=0 ; corner<4 ; corner++)
+    {
+        const float sx = (corner & 1) ? 1.0f : -1.0f;
+        const float sy = (corner & 2) ? 1.0f : -1.0f;
+        const Vec3 cornerWS = centreWS + rightWS * (sx * halfExtent) + upWS * (sy * halfExtent);
+        const Vec4 posPS = Transform( impostorParams.g_ImpostorWorldToProjectionMatrix, Vec4( cornerWS, 1.0f ) );
+        if( posPS.w <= 0.0f ) return 0;
+
+        const float px = (posPS.x / posPS.w * 0.5f + 0.5f) * target.GetWidth();
+        const float py = (0.5f - posPS.y / posPS.w * 0.5f) * target.GetHeight();
+        minX = Min( minX, px ); maxX = Max( maxX, px );
+        minY = Min( minY, py ); maxY = Max( maxY, py );
+    }
+
+    const uint x0 = (uint)Clamp( floorf( minX ), 0.0f, (float)target.GetWidth() );
+    const uint x1 = (uint)Clamp( ceilf( maxX ), 0.0f, (float)target.GetWidth() );
+    const uint y0 = (uint)Clamp( floorf( minY ), 0.0f, (float)target.GetHeight() );
+    const uint y1 = (uint)Clamp( ceilf( maxY ), 0.0f, (float)target.GetHeight() );
+
+    // The quad lies in the plane of constant view depth through the centre, and our ray
+    //  directions have a view depth of one, so every ray meets it at the same parameter.
+    const float centreDepth = Dot( centreWS - eyeWS, Vec3( params.g_EyeForwardWS ) );
+    const float invSize = 0.5f / halfExtent;
+    const float4& cell0 = impostorParams.g_ImpostorFrame0ScaleBias;
+    const float4& cell1 = impostorParams.g_ImpostorFrame1ScaleBias;
+
+    uint numPixels = 0;
+    for(uint y=y0 ; y<y1 ; y++)
+    {
+        for(uint x=x0 ; x<x1 ; x++)
+        {
+            const Vec3 offsetWS = eyeWS + GetRayDirectionWS( params, x + 0.5f, y + 0.5f ) * centreDepth - centreWS;
+            const float u = Dot( offsetWS, rightWS ) * invSize + 0.5f;
+            const float v = 0.5f - Dot( offsetWS, upWS ) * invSize;
+            if( u < 0.0f || u > 1.0f || v < 0.0f || v > 1.0f ) continue;
+
+            const Vec4 colour0 = flipbook.SampleColour( u * cell0.x + cell0.z, v * cell0.y + cell0.w );
+            const Vec4 colour1 = flipbook.SampleColour( u * cell1.x + cell1.z, v * cell1.y + cell1.w );
+            target.At( x, y ) = Lerp( colour0, colour1, impostorParams.g_ImpostorFrameBlend );
+            numPixels++;
+        }
+    }
+    return numPixels;
+}
+
+//--------------------------------------------------------------------------------------
+// Headless commands
+//--------------------------------------------------------------------------------------
+int ImpostorBakeMain( const CommandLine& commandLine )
+{
+    const char* pFileName = commandLine.GetPositional( 0 );
+    if( !pFileName )
+    {
+        fprintf( stderr, "Usage: impostor-bake <out.flipbook> [-cell 64] [-frames 32] [-views 8] [-phi 90] [-start 0] [-end 16]\n" );
+        return 1;
+    }
+
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    ImpostorBakeSettings bakeSettings;
+    bakeSettings.cellSize = commandLine.GetUint( "cell", bakeSettings.cellSize );
+    bakeSettings.numFrames = commandLine.GetUint( "frames", bakeSettings.numFrames );
+    bakeSettings.numViews = commandLine.GetUint( "views", bakeSettings.numViews );
+    bakeSettings.viewPhi = commandLine.GetFloat( "phi", bakeSettings.viewPhi * 180.0f / PI ) * PI / 180.0f;
+    bakeSettings.timeStart = commandLine.GetFloat( "start", bakeSettings.timeStart );
+    bakeSettings.timeEnd = commandLine.GetFloat( "end", bakeSettings.timeEnd );
+
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+
+    Timer timer;
+    ImpostorFlipbook flipbook;
+    if( !flipbook.Bake( ExplosionSettings(), textures, bakeSettings, pool ) || !flipbook.Save( pFileName ) )
+    {
+        fprintf( stderr, "Failed to bake %s.\n", pFileName );
+        return 1;
+    }
+    const double seconds = timer.GetElapsedSeconds();
+
+    // A preview of the colour atlas next to the flipbook.
+    Image preview( flipbook.GetAtlasWidth(), flipbook.GetAtlasHeight() );
+    for(uint y=0 ; y<preview.GetHeight() ; y++)
+    {
+        for(uint x=0 ; x<preview.GetWidth() ; x++)
+        {
+            const uint8_t* pTexel = flipbook.GetColourAtlas() + (y * preview.GetWidth() + x) * 4;
+            preview.At( x, y ) = Vec4( pTexel[0], pTexel[1], pTexel[2], pTexel[3] ) * (1.0f / 255.0f);
+        }
+    }
+    const std::string previewFileName = std::string( pFileName ) + ".ppm";
+    preview.WritePPM( previewFileName.c_str() );
+
+    const uint numCells = bakeSettings.numViews * bakeSettings.numFrames;
+    printf( "Baked %u views x %u frames of %ux%u into a %ux%u atlas (%.1f KB) in %.2fs (%.1f ms per cell) on %u threads.\n",
+            bakeSettings.numViews, bakeSettings.numFrames, bakeSettings.cellSize, bakeSettings.cellSize,
+            flipbook.GetAtlasWidth(), flipbook.GetAtlasHeight(), flipbook.GetAtlasWidth() * flipbook.GetAtlasHeight() * 5 / 1024.0,
+            seconds, seconds * 1000.0 / numCells, pool.GetNumThreads() );
+    return 0;
+}
+
+int ImpostorBenchMain( const CommandLine& commandLine )
+{
+    const char* pFileName = commandLine.GetPositional( 0 );
+    ImpostorFlipbook flipbook;
+    if( !pFileName || !flipbook.Load( pFileName ) )
+    {
+        fprintf( stderr, "Usage: impostor-bench <file.flipbook> [-time 3.3] [-repeat 100]\n" );
+        return 1;
+    }
+
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const float time = commandLine.GetFloat( "time", 3.3f );
+    uint numRepeats = commandLine.GetUint( "repeat", 100 );
+    if( numRepeats == 0 ) numRepeats = 1;
+    const CpuRenderer renderer( (CpuRenderSettings()) );
+
+    printf( "Camera distance, coverage, pixels, ray march ms, impostor us, speed-up\n" );
+
+    const float distances[] = { 10.0f, 20.0f, 40.0f, 80.0f, 160.0f };
+    for(size_t i=0 ; i<sizeof(distances)/sizeof(distances[0]) ; i++)
+    {
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+        camera.radius = distances[i];
+
+        ExplosionParams params;
+        BuildExplosionParams( ExplosionSettings(), camera, time, kResolutionX, kResolutionY, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+
+        Image image;
+        RenderStats stats;
+        renderer.RenderFrame( params, textures, image, nullptr, &stats );
+
+        ImpostorParams impostorParams;
+        flipbook.BuildImpostorParams( params, time, impostorParams );
+
+        image.Clear( Vec4( 0.0f ) );
+        uint numPixels = 0;
+        Timer timer;
+        for(uint r=0 ; r<numRepeats ; r++)
+        {
+            numPixels = DrawImpostor( flipbook, params, impostorParams, image );
+        }
+        const double impostorMicroseconds = timer.GetElapsedMilliseconds() * 1000.0 / numRepeats;
+
+        printf( "%6.1f, %7.4f%%, %7u, %9.2f, %9.1f, %7.0fx\n", distances[i], GetExplosionScreenCoverage( params ) * 100.0f,
+                numPixels, stats.milliseconds, impostorMicroseconds, stats.milliseconds * 1000.0 / Max( (float)impostorMicroseconds, 0.001f ) );
+    }
+    return 0;
+}
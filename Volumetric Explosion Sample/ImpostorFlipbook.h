@@ -0,0 +1,93 @@
+#ifndef IMPOSTOR_FLIPBOOK_H
+#define IMPOSTOR_FLIPBOOK_H
+
+//--------------------------------------------------------------------------------------
+// Flipbook impostors for distant explosions.  The CPU renderer bakes the explosion's
+//  animation (a sweep of g_Time) from a ring of view directions into an RGBA8 atlas
+//  of ray march output plus an R8 atlas of approximate depth.  Once the explosion's
+//  screen coverage drops below a threshold the sample draws a camera facing quad
+//  that blends the two baked frames either side of the current time instead of
+//  tessellating the hull and marching the volume (RenderImpostorVS/PS).
+//
+//  The bake is only valid for the explosion settings it was made with.
+//--------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <vector>
+
+#include "ExplosionSettings.h"
+#include "CpuMath.h"
+
+class CommandLine;
+class Image;
+class ThreadPool;
+struct SceneTextures;
+
+struct ImpostorBakeSettings
+{
+    uint cellSize;
+    uint numFrames;
+    float timeStart, timeEnd;
+    uint numViews;              // Spread evenly around a ring about the y axis...
+    float viewPhi;              // ...at this polar angle (radians, as OrbitCamera::phi).
+
+    ImpostorBakeSettings();
+};
+
+class ImpostorFlipbook
+{
+public:
+    ImpostorFlipbook();
+
+    bool Save( const char* pFileName ) const;
+    bool Load( const char* pFileName );
+
+    bool IsEmpty() const { return m_Colour.empty(); }
+
+    uint GetNumViews() const { return (uint)m_ViewDirections.size(); }
+    uint GetNumFrames() const { return m_NumFrames; }
+    uint GetAtlasWidth() const { return m_Columns * m_CellSize; }
+    uint GetAtlasHeight() const { return m_Rows * m_CellSize; }
+    const uint8_t* GetColourAtlas() const { return &m_Colour[0]; }
+    const uint8_t* GetDepthAtlas() const { return &m_Depth[0]; }
+
+    // The baked view whose direction (from the explosion towards the camera) is closest.
+    uint SelectView( const Vec3& directionToEyeWS ) const;
+
+    // Looping frame pair and blend weight for an animation time.
+    void SelectFrames( float time, uint& frame0, uint& frame1, float& blend ) const;
+
+    // Atlas uv = cell uv * scaleBias.xy + scaleBias.zw, inset by half a texel so
+    //  bilinear filtering never reads a neighbouring cell.
+    float4 GetCellScaleBias( uint view, uint frame ) const;
+
+    // The shader constants for drawing the impostor with the camera in params.
+    void BuildImpostorParams( const ExplosionParams& params, float time, ImpostorParams& impostorParams ) const;
+
+    // Bilinear filtered fetches (BilinearClampedSampler) from the atlases.
+    Vec4 SampleColour( float u, float v ) const;
+    float SampleDepth( float u, float v ) const;
+
+    // Renders every view/frame cell of the flipbook, cells spread across the pool.
+    bool Bake( const ExplosionSettings& settings, const SceneTextures& textures, const ImpostorBakeSettings& bakeSettings, ThreadPool& pool );
+
+private:
+    uint m_CellSize;
+    uint m_NumFrames;
+    uint m_Columns, m_Rows;
+    float m_TimeStart, m_TimeEnd;
+    float m_BoundingRadiusWS;   // Depth 0..1 covers the bounding sphere, seen from...
+    float m_BakeDistanceWS;     // ...the bake camera at this distance from the centre.
+    float m_HalfExtentWS;       // Half size of a cell at the explosion's centre.
+    std::vector<Vec3> m_ViewDirections;
+    std::vector<uint8_t> m_Colour;
+    std::vector<uint8_t> m_Depth;
+};
+
+// RenderImpostorVS/PS on the CPU: draws the impostor into the image, which holds pixel
+//  shader output like the CpuRenderer's.  Returns the number of pixels shaded.
+uint DrawImpostor( const ImpostorFlipbook& flipbook, const ExplosionParams& params, const ImpostorParams& impostorParams, Image& target );
+
+int ImpostorBakeMain( const CommandLine& commandLine );
+int ImpostorBenchMain( const CommandLine& commandLine );
+
+#endif // IMPOSTOR_FLIPBOOK_H
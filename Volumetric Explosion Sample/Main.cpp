@@ -15,10 +15,21 @@
 #include <DirectXPackedVector.h>
 #include <directxcolors.h>
 #include <fstream>
+#include <string>
+#include <vector>
 #include <DDSTextureLoader.h>
 #include <AntTweakBar.h>
+#include <shellapi.h>
+#include <stdio.h>
 
 #include "Common.h"
+#include "ExplosionSettings.h"
+#include "CpuRenderer.h"
+#include "Headless.h"
+#include "ImpostorFlipbook.h"
+#include "RenderThread.h"
+#include "ThreadPool.h"
+#include "TransmittanceVolume.h"
 
 using namespace DirectX;
 using namespace DirectX::PackedVector;
@@ -40,6 +51,8 @@ ID3D11RenderTargetView* g_pRenderTargetView = nullptr;
 
 ID3D11Buffer*               g_pExplosionParamsCB = nullptr;
 ID3D11ShaderResourceView*   g_pNoiseVolumeSRV = nullptr;
+ID3D11ShaderResourceView*   g_pNoiseVolumeUnormSRV = nullptr;
+ID3D11ShaderResourceView*   g_pNoiseValueGradientSRV = nullptr;
 ID3D11ShaderResourceView*   g_pGradientSRV = nullptr;
 ID3D11VertexShader*         g_pRenderExplosionVS = nullptr;
 ID3D11HullShader*           g_pRenderExplosionHS = nullptr;
@@ -49,43 +62,38 @@ ID3D11InputLayout*          g_pExplosionLayout = nullptr;
 ID3D11SamplerState*         g_pSamplerClampedLinear = nullptr;
 ID3D11SamplerState*         g_pSamplerWrappedLinear = nullptr;
 
+ID3D11Buffer*               g_pImpostorParamsCB = nullptr;
+ID3D11ShaderResourceView*   g_pImpostorColourSRV = nullptr;
+ID3D11ShaderResourceView*   g_pImpostorDepthSRV = nullptr;
+ID3D11VertexShader*         g_pRenderImpostorVS = nullptr;
+ID3D11PixelShader*          g_pRenderImpostorPS = nullptr;
+
+ID3D11Texture3D*            g_pTransmittanceVolume = nullptr;
+ID3D11ShaderResourceView*   g_pTransmittanceVolumeSRV = nullptr;
+
+ID3D11ShaderResourceView*   g_pBlueNoiseSRV = nullptr;
+
 ID3D11DepthStencilState*    g_pTestWriteDepth = nullptr;
 ID3D11BlendState*           g_pOverBlendState = nullptr;
  
-// Explosion parameters. 
-const XMFLOAT3 kNoiseAnimationSpeed(0.0f, 0.02f, 0.0f);
-const float kNoiseInitialAmplitude = 3.0f;
-const UINT kMaxNumSteps = 256;
-const UINT kNumHullSteps = 2;
-const float kStepSize = 0.04f;
-const UINT kNumOctaves = 4;
-const UINT kNumHullOctaves = 2;
-const float kSkinThicknessBias = 0.6f;
-const float kTessellationFactor = 16;
-float g_MaxSkinThickness;
-float g_MaxNoiseDisplacement;
-static bool g_EnableHullShrinking = true;
-static float g_EdgeSoftness = 0.05f;
-static float g_NoiseScale = 0.04f;
-static float g_ExplosionRadius = 4.0f;
-static float g_DisplacementAmount = 1.75f;
-static XMFLOAT2 g_UvScaleBias(2.1f, 0.35f);
-static float g_NoiseAmplitudeFactor = 0.4f;
-static float g_NoiseFrequencyFactor = 3.0f;
-
-// Camera variables.
-const UINT kResolutionX = 800;
-const UINT kResolutionY = 640;
-const float kNearClip = 0.01f;
-const float kFarClip = 20.0f;
-const XMFLOAT3 kEyeLookAtWS = XMFLOAT3(0.0f, 0.0f, 0.0f);
-XMFLOAT3 g_EyePositionWS;
-XMFLOAT3 g_EyeForwardWS;
-XMMATRIX g_WorldToProjectionMatrix, g_ProjectionToWorldMatrix, g_InvProjMatrix, g_ViewToWorldMatrix;
-XMFLOAT4X4 g_ViewMatrix, g_ProjMatrix;
-XMFLOAT4 g_ProjectionParams;
+// Explosion parameters.  The tweakable ones are the render thread's ExplosionSettings
+//  (the constants live in ExplosionSettings.h); these only affect the GPU path.
+static bool g_QuantisedNoise = false;
+ExplosionParams g_ExplosionParams;
+
+// Self-shadowing variables.  The transmittance volume is built on the CPU from
+//  its own copy of the scene textures.
+SceneTextures g_SceneTextures;
+ThreadPool* g_pThreadPool = nullptr;
+TransmittanceVolume* g_pTransmittance = nullptr;
+
+// Impostor variables.  The flipbook is optional; bake it with the impostor-bake
+//  headless command.
+ImpostorFlipbook g_ImpostorFlipbook;
+static float g_ImpostorCoverageThreshold = 0.02f;
+
+// Camera variables.  The camera itself is the render thread's OrbitCamera.
 POINT g_LastMousePos;
-float g_CameraTheta = 0, g_CameraPhi = 0, g_CameraRadius = 10;
 
 // Timer Variables
 __int64 g_CounterStart = 0;
@@ -94,14 +102,10 @@ double g_ElapsedTime = 0.0;
 
 TwBar* g_pUI;
 
-enum PrimitiveType
-{
-    kPrimitiveSphere,
-    kPrimitiveCylinder,
-    kPrimitiveCone,
-    kPrimitiveTorus,
-    kPrimitiveBox
-} g_Primitive = kPrimitiveSphere;
+// The render thread owns the device context, the UI and the camera; the window's
+//  thread only forwards input to it.
+RenderThread* g_pRenderThread = nullptr;
+const UINT kRenderEventQueueCapacity = 1024;
 
 //--------------------------------------------------------------------------------------
 // Forward declarations
@@ -111,22 +115,108 @@ HRESULT InitDevice();
 void InitUI();
 void CleanupDevice();
 LRESULT CALLBACK    WndProc( HWND, UINT, WPARAM, LPARAM );
-void Render();
+void Render( const ExplosionSettings& settings, const OrbitCamera& camera );
 void StartTimer();
 double GetTime();
 void OnMouseDown(int x, int y);
-void OnMouseUp();
 void OnMouseMove(WPARAM btnState, int x, int y);
-void UpdateViewMatrix();
+HRESULT InitImpostor();
+HRESULT InitTransmittanceVolume();
+HRESULT InitBlueNoise();
+HRESULT InitQuantisedNoiseVolume();
+HRESULT InitValueGradientVolume();
+int RunHeadlessFromCommandLine( LPWSTR lpCmdLine );
+
+//--------------------------------------------------------------------------------------
+// The Win32 message loop, run on the thread that created the window.
+//--------------------------------------------------------------------------------------
+class WindowsPlatformLoop : public IPlatformLoop
+{
+public:
+    WindowsPlatformLoop() : m_ExitCode(0) {}
+
+    virtual bool PumpEvents( RenderThread& )
+    {
+        MSG msg = {0};
+        if( GetMessage( &msg, nullptr, 0, 0 ) <= 0 )
+        {
+            m_ExitCode = (int)msg.wParam;
+            return false;
+        }
+
+        TranslateMessage( &msg );
+        DispatchMessage( &msg );
+        return true;
+    }
+
+    int GetExitCode() const { return m_ExitCode; }
+
+private:
+    int m_ExitCode;
+};
 
 //--------------------------------------------------------------------------------------
-// Entry point to the program. Initializes everything and goes into a message processing 
-// loop. Idle time is used to render the scene.
+// Everything on the render thread: the UI, input handling and drawing.
+//--------------------------------------------------------------------------------------
+class D3DFrameRenderer : public IFrameRenderer
+{
+public:
+    virtual void OnRenderThreadStart()
+    {
+        TwInit(TW_DIRECT3D11, g_pd3dDevice);
+        TwWindowSize(kResolutionX, kResolutionY);
+
+        InitUI();
+    }
+
+    // Window messages forwarded by WndProc.  The UI gets first refusal, as before.
+    virtual void OnPlatformEvent( const RenderEvent& event )
+    {
+        const UINT message = event.id;
+        const WPARAM wParam = (WPARAM)event.data0;
+        const LPARAM lParam = (LPARAM)event.data1;
+
+        if( TwEventWin(g_hWnd, message, wParam, lParam) ) return;
+
+        switch( message )
+        {
+        case WM_LBUTTONDOWN:
+        case WM_MBUTTONDOWN:
+        case WM_RBUTTONDOWN:
+            OnMouseDown(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+            break;
+        case WM_MOUSEMOVE:
+            OnMouseMove(wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+            break;
+        }
+    }
+
+    virtual void RenderFrame( const ExplosionSettings& settings, const OrbitCamera& camera )
+    {
+        // Update scene timer
+        g_ElapsedTime = GetTime();
+
+        Render( settings, camera );
+    }
+
+    virtual void OnRenderThreadStop()
+    {
+        TwTerminate();
+    }
+};
+
+//--------------------------------------------------------------------------------------
+// Entry point to the program. Initializes everything, starts the render thread and
+// goes into a message processing loop.
 //--------------------------------------------------------------------------------------
 int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow )
 {
     UNREFERENCED_PARAMETER( hPrevInstance );
-    UNREFERENCED_PARAMETER( lpCmdLine );
+
+    // Headless tools (batch rendering etc.) run on the CPU renderer and exit.
+    const int headlessResult = RunHeadlessFromCommandLine( lpCmdLine );
+    if( headlessResult >= 0 )
+        return headlessResult;
 
     if( FAILED( InitWindow( hInstance, nCmdShow ) ) )
         return 0;
@@ -139,37 +229,61 @@ int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 
     StartTimer();
 
-    TwInit(TW_DIRECT3D11, g_pd3dDevice);
-    TwWindowSize(kResolutionX, kResolutionY);
-    
-    InitUI();
+    // Render continuously on the render thread while this thread waits for
+    //  messages; RunPlatformLoop returns once the render thread has stopped.
+    D3DFrameRenderer frameRenderer;
+    RenderThread renderThread( frameRenderer, kRenderEventQueueCapacity, ExplosionSettings(), OrbitCamera() );
+    g_pRenderThread = &renderThread;
+    renderThread.Start();
 
-    // Main message loop
-    MSG msg = {0};
-    while( WM_QUIT != msg.message )
-    {
-        if( PeekMessage( &msg, nullptr, 0, 0, PM_REMOVE ) )
-        {
-            TranslateMessage( &msg );
-            DispatchMessage( &msg );
-        }
-        else
-        {
-            // Update scene timer
-            g_ElapsedTime = GetTime();
+    WindowsPlatformLoop platformLoop;
+    renderThread.RunPlatformLoop( platformLoop );
+    g_pRenderThread = nullptr;
 
-            Render();
-        }
+    CleanupDevice();
+
+    return platformLoop.GetExitCode();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Runs a headless CPU tool if the command line names one.  Returns its exit code, 
+// or -1 to carry on and start the interactive sample.
+//--------------------------------------------------------------------------------------
+int RunHeadlessFromCommandLine( LPWSTR lpCmdLine )
+{
+    if( !lpCmdLine || !lpCmdLine[0] )
+        return -1;
+
+    int argc = 0;
+    LPWSTR* argvW = CommandLineToArgvW( GetCommandLineW(), &argc );
+    if( !argvW )
+        return -1;
+
+    std::vector<std::string> args( argc );
+    std::vector<char*> argv( argc );
+    for( int i = 0; i < argc; i++ )
+    {
+        const int length = WideCharToMultiByte( CP_UTF8, 0, argvW[i], -1, nullptr, 0, nullptr, nullptr );
+        args[i].resize( length );
+        WideCharToMultiByte( CP_UTF8, 0, argvW[i], -1, &args[i][0], length, nullptr, nullptr );
+        argv[i] = &args[i][0];
     }
+    LocalFree( argvW );
 
-    TwTerminate();
+    if( !IsHeadlessCommand( argc, &argv[0] ) )
+        return -1;
 
-    CleanupDevice();
+    // We are a windows subsystem application, so borrow the console of whoever launched us for the report.
+    if( AttachConsole( ATTACH_PARENT_PROCESS ) || AllocConsole() )
+    {
+        freopen( "CONOUT$", "w", stdout );
+        freopen( "CONOUT$", "w", stderr );
+    }
 
-    return ( int )msg.wParam;
+    return RunHeadless( argc, &argv[0] );
 }
 
-
 //--------------------------------------------------------------------------------------
 // Register class and create window
 //--------------------------------------------------------------------------------------
@@ -409,7 +523,6 @@ HRESULT InitDevice()
     hr = g_pd3dDevice->CreateSamplerState( &sampDesc, &g_pSamplerWrappedLinear );
     if( FAILED( hr ) ) return hr;
 
-    HALF maxNoiseValue = 0, minNoiseValue = 0xFFFF;
     HALF noiseValues[32*32*32] = { 0 };
     std::fstream f;
     f.open("noise_32x32x32.dat", std::ios::in);
@@ -419,10 +532,6 @@ HRESULT InitDevice()
         {
             HALF noiseValue;
             f >> noiseValue;
-
-            maxNoiseValue = max(maxNoiseValue, noiseValue);
-            minNoiseValue = min(minNoiseValue, noiseValue);
-
             noiseValues[i] = noiseValue;
         }
         f.close();
@@ -455,6 +564,16 @@ HRESULT InitDevice()
     hr = CreateDDSTextureFromFile( g_pd3dDevice, L"gradient.dds", nullptr, &g_pGradientSRV );
     if( FAILED( hr ) ) return hr;
 
+    if( FAILED( hr = InitImpostor() ) ) return hr;
+
+    if( FAILED( hr = InitTransmittanceVolume() ) ) return hr;
+
+    if( FAILED( hr = InitQuantisedNoiseVolume() ) ) return hr;
+
+    if( FAILED( hr = InitValueGradientVolume() ) ) return hr;
+
+    if( FAILED( hr = InitBlueNoise() ) ) return hr;
+
     D3D11_DEPTH_STENCIL_DESC dsDesc;
     ZeroMemory( &dsDesc, sizeof(dsDesc) );
     dsDesc.DepthEnable = true;
@@ -480,41 +599,271 @@ HRESULT InitDevice()
     hr = g_pd3dDevice->CreateBlendState( &bsDesc, &g_pOverBlendState );
     if( FAILED( hr ) ) return hr;
 
+    return S_OK;
+}
 
-    // Calculate the maximum possible displacement from noise based on our 
-    //  fractal noise parameters.  This is used to ensure our explosion primitive 
-    //  fits in our base sphere.
-    float largestAbsoluteNoiseValue = max( abs( XMConvertHalfToFloat( maxNoiseValue ) ), abs( XMConvertHalfToFloat( minNoiseValue ) ) );
-    g_MaxNoiseDisplacement = 0;
-    for(UINT i=0 ; i<kNumOctaves ; i++)
-    {
-        g_MaxNoiseDisplacement += largestAbsoluteNoiseValue * kNoiseInitialAmplitude * powf(g_NoiseAmplitudeFactor, (float)i);
-    }
 
-    // Calculate the skin thickness, which is amount of displacement to add 
-    //  to the geometry hull after shrinking it around the explosion primitive.
-    g_MaxSkinThickness = 0;
-    for(UINT i=kNumHullOctaves ; i<kNumOctaves ; i++)
-    {
-        g_MaxSkinThickness += largestAbsoluteNoiseValue * kNoiseInitialAmplitude * powf(g_NoiseAmplitudeFactor, (float)i);
-    }
-    // Add a little bit extra to account for under-tessellation.  This should be
-    //  fine tuned on a per use basis for best performance.
-    g_MaxSkinThickness += kSkinThicknessBias;
+//--------------------------------------------------------------------------------------
+// Create the self-shadowing transmittance volume and the thread pool that fills it
+//--------------------------------------------------------------------------------------
+HRESULT InitTransmittanceVolume()
+{
+    HRESULT hr = S_OK;
 
-    XMStoreFloat4x4( &g_ProjMatrix, XMMatrixPerspectiveFovLH( 60*PI/180, (float)kResolutionX/kResolutionY, kNearClip, kFarClip ) );
-    XMVECTOR det;
-    g_InvProjMatrix = XMMatrixInverse( &det, XMLoadFloat4x4 (&g_ProjMatrix ) );
+    g_pThreadPool = new ThreadPool( 0 );
 
-    const float A = kFarClip / (kFarClip - kNearClip);
-    const float B = (-kFarClip * kNearClip) / (kFarClip - kNearClip);
-    const float C = (kFarClip - kNearClip);
-    const float D = kNearClip;
-    g_ProjectionParams = XMFLOAT4( A, B, C, D );
+    if( !g_SceneTextures.Load( "", g_pThreadPool ) ) return E_FAIL;
+    g_pTransmittance = new TransmittanceVolume( TransmittanceSettings() );
 
-    UpdateViewMatrix();
+    const UINT resolution = g_pTransmittance->GetResolution();
 
-    return S_OK;
+    D3D11_TEXTURE3D_DESC texDesc;
+    ZeroMemory( &texDesc, sizeof(texDesc) );
+    texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    texDesc.Format = DXGI_FORMAT_R8_UNORM;
+    texDesc.Width = resolution;
+    texDesc.Height = resolution;
+    texDesc.Depth = resolution;
+    texDesc.MipLevels = 1;
+    texDesc.Usage = D3D11_USAGE_DEFAULT;
+
+    D3D11_SUBRESOURCE_DATA initialData;
+    initialData.pSysMem = g_pTransmittance->GetSlice( 0 );
+    initialData.SysMemPitch = resolution;
+    initialData.SysMemSlicePitch = resolution * resolution;
+
+    hr = g_pd3dDevice->CreateTexture3D( &texDesc, &initialData, &g_pTransmittanceVolume );
+    if( FAILED( hr ) ) return hr;
+
+    return g_pd3dDevice->CreateShaderResourceView( g_pTransmittanceVolume, nullptr, &g_pTransmittanceVolumeSRV );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Create the 8-bit copy of the noise volume, quantised by the CPU copy loaded in
+// InitTransmittanceVolume.  It takes half the memory and bandwidth of the R16 volume.
+//--------------------------------------------------------------------------------------
+HRESULT InitQuantisedNoiseVolume()
+{
+    HRESULT hr = S_OK;
+
+    const NoiseVolume& noiseVolume = g_SceneTextures.noiseVolume;
+    const UINT size = noiseVolume.GetSize();
+
+    D3D11_TEXTURE3D_DESC texDesc;
+    ZeroMemory( &texDesc, sizeof(texDesc) );
+    texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    texDesc.Format = DXGI_FORMAT_R8_UNORM;
+    texDesc.Width = size;
+    texDesc.Height = size;
+    texDesc.Depth = size;
+    texDesc.MipLevels = 1;
+    texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+
+    D3D11_SUBRESOURCE_DATA initialData;
+    initialData.pSysMem = noiseVolume.GetUnormTexels();
+    initialData.SysMemPitch = size;
+    initialData.SysMemSlicePitch = size * size;
+
+    ID3D11Texture3D* pNoiseVolume = nullptr;
+    hr = g_pd3dDevice->CreateTexture3D( &texDesc, &initialData, &pNoiseVolume );
+    if( FAILED( hr ) ) return hr;
+
+    hr = g_pd3dDevice->CreateShaderResourceView( pNoiseVolume, nullptr, &g_pNoiseVolumeUnormSRV );
+    pNoiseVolume->Release();
+
+    return hr;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Create the RGBA16F value+gradient copy of the noise volume that
+// FractalNoiseAndGradientAtPositionWS reads, built from the CPU copy.
+//--------------------------------------------------------------------------------------
+HRESULT InitValueGradientVolume()
+{
+    HRESULT hr = S_OK;
+
+    NoiseVolume& noiseVolume = g_SceneTextures.noiseVolume;
+    noiseVolume.BuildValueGradients();
+    const UINT size = noiseVolume.GetSize();
+
+    D3D11_TEXTURE3D_DESC texDesc;
+    ZeroMemory( &texDesc, sizeof(texDesc) );
+    texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    texDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+    texDesc.Width = size;
+    texDesc.Height = size;
+    texDesc.Depth = size;
+    texDesc.MipLevels = 1;
+    texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+
+    D3D11_SUBRESOURCE_DATA initialData;
+    initialData.pSysMem = noiseVolume.GetValueGradientTexels();
+    initialData.SysMemPitch = size * 8;
+    initialData.SysMemSlicePitch = size * size * 8;
+
+    ID3D11Texture3D* pValueGradientVolume = nullptr;
+    hr = g_pd3dDevice->CreateTexture3D( &texDesc, &initialData, &pValueGradientVolume );
+    if( FAILED( hr ) ) return hr;
+
+    hr = g_pd3dDevice->CreateShaderResourceView( pValueGradientVolume, nullptr, &g_pNoiseValueGradientSRV );
+    pValueGradientVolume->Release();
+
+    return hr;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Create the blue-noise mask texture for dithered ray starts, from the mask loaded
+// or generated on the thread pool in InitTransmittanceVolume.
+//--------------------------------------------------------------------------------------
+HRESULT InitBlueNoise()
+{
+    HRESULT hr = S_OK;
+
+    const BlueNoiseMask& blueNoise = g_SceneTextures.blueNoise;
+    const UINT size = blueNoise.GetSize();
+
+    D3D11_TEXTURE2D_DESC texDesc;
+    ZeroMemory( &texDesc, sizeof(texDesc) );
+    texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    texDesc.Format = DXGI_FORMAT_R8_UNORM;
+    texDesc.Width = size;
+    texDesc.Height = size;
+    texDesc.MipLevels = 1;
+    texDesc.ArraySize = 1;
+    texDesc.SampleDesc.Count = 1;
+    texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+
+    D3D11_SUBRESOURCE_DATA initialData;
+    initialData.pSysMem = blueNoise.GetTexels();
+    initialData.SysMemPitch = size;
+    initialData.SysMemSlicePitch = size * size;
+
+    ID3D11Texture2D* pBlueNoise = nullptr;
+    hr = g_pd3dDevice->CreateTexture2D( &texDesc, &initialData, &pBlueNoise );
+    if( FAILED( hr ) ) return hr;
+
+    hr = g_pd3dDevice->CreateShaderResourceView( pBlueNoise, nullptr, &g_pBlueNoiseSRV );
+    pBlueNoise->Release();
+
+    return hr;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Load the flipbook impostor, if one has been baked, and create its resources
+//--------------------------------------------------------------------------------------
+HRESULT InitImpostor()
+{
+    HRESULT hr = S_OK;
+
+    if( !g_ImpostorFlipbook.Load( "explosion.flipbook" ) ) return S_OK;
+
+    ID3DBlob* pVSBlob = nullptr;
+    if( FAILED( hr = D3DReadFileToBlob( L"RenderImpostorVS.cso", &pVSBlob ) ) ) return hr;
+    hr = g_pd3dDevice->CreateVertexShader( pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, &g_pRenderImpostorVS );
+    pVSBlob->Release();
+    if( FAILED( hr ) ) return hr;
+
+    ID3DBlob* pPSBlob = nullptr;
+    if( FAILED( hr = D3DReadFileToBlob( L"RenderImpostorPS.cso", &pPSBlob ) ) ) return hr;
+    hr = g_pd3dDevice->CreatePixelShader( pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize(), nullptr, &g_pRenderImpostorPS );
+    pPSBlob->Release();
+    if( FAILED( hr ) ) return hr;
+
+    D3D11_BUFFER_DESC bd;
+    ZeroMemory( &bd, sizeof(bd) );
+    bd.Usage = D3D11_USAGE_DYNAMIC;
+    bd.ByteWidth = sizeof( ImpostorParams );
+    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    hr = g_pd3dDevice->CreateBuffer( &bd, nullptr, &g_pImpostorParamsCB );
+    if( FAILED( hr ) ) return hr;
+
+    D3D11_TEXTURE2D_DESC texDesc;
+    ZeroMemory( &texDesc, sizeof(texDesc) );
+    texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    texDesc.Width = g_ImpostorFlipbook.GetAtlasWidth();
+    texDesc.Height = g_ImpostorFlipbook.GetAtlasHeight();
+    texDesc.MipLevels = 1;
+    texDesc.ArraySize = 1;
+    texDesc.SampleDesc.Count = 1;
+    texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+
+    D3D11_SUBRESOURCE_DATA initialData;
+    initialData.pSysMem = g_ImpostorFlipbook.GetColourAtlas();
+    initialData.SysMemPitch = texDesc.Width * 4;
+    initialData.SysMemSlicePitch = 0;
+
+    ID3D11Texture2D* pColourAtlas = nullptr;
+    hr = g_pd3dDevice->CreateTexture2D( &texDesc, &initialData, &pColourAtlas );
+    if( FAILED( hr ) ) return hr;
+    hr = g_pd3dDevice->CreateShaderResourceView( pColourAtlas, nullptr, &g_pImpostorColourSRV );
+    pColourAtlas->Release();
+    if( FAILED( hr ) ) return hr;
+
+    texDesc.Format = DXGI_FORMAT_R8_UNORM;
+    initialData.pSysMem = g_ImpostorFlipbook.GetDepthAtlas();
+    initialData.SysMemPitch = texDesc.Width;
+
+    ID3D11Texture2D* pDepthAtlas = nullptr;
+    hr = g_pd3dDevice->CreateTexture2D( &texDesc, &initialData, &pDepthAtlas );
+    if( FAILED( hr ) ) return hr;
+    hr = g_pd3dDevice->CreateShaderResourceView( pDepthAtlas, nullptr, &g_pImpostorDepthSRV );
+    pDepthAtlas->Release();
+
+    return hr;
+}
+
+// The tweak bar edits the render thread's settings through parameter events; the
+//  client data is the RenderParameter.  AntTweakBar calls these on the render
+//  thread, from TwEventWin and TwDraw.
+static RenderParameter GetClientParameter( void* pClientData )
+{
+    return (RenderParameter)(UINT_PTR)pClientData;
+}
+
+static void TW_CALL SetFloatParameter( const void* pValue, void* pClientData )
+{
+    g_pRenderThread->ApplyParameter( GetClientParameter( pClientData ), *(const float*)pValue );
+}
+
+static void TW_CALL GetFloatParameter( void* pValue, void* pClientData )
+{
+    *(float*)pValue = GetRenderParameter( g_pRenderThread->GetSettings(), GetClientParameter( pClientData ) );
+}
+
+static void TW_CALL SetBoolParameter( const void* pValue, void* pClientData )
+{
+    g_pRenderThread->ApplyParameter( GetClientParameter( pClientData ), *(const bool*)pValue ? 1.0f : 0.0f );
+}
+
+static void TW_CALL GetBoolParameter( void* pValue, void* pClientData )
+{
+    *(bool*)pValue = GetRenderParameter( g_pRenderThread->GetSettings(), GetClientParameter( pClientData ) ) > 0.5f;
+}
+
+static void TW_CALL SetEnumParameter( const void* pValue, void* pClientData )
+{
+    g_pRenderThread->ApplyParameter( GetClientParameter( pClientData ), (float)*(const int*)pValue );
+}
+
+static void TW_CALL GetEnumParameter( void* pValue, void* pClientData )
+{
+    *(int*)pValue = (int)GetRenderParameter( g_pRenderThread->GetSettings(), GetClientParameter( pClientData ) );
+}
+
+static void AddFloatParameter( const char* pName, RenderParameter parameter, const char* pDef )
+{
+    TwAddVarCB(g_pUI, pName, TW_TYPE_FLOAT, SetFloatParameter, GetFloatParameter, (void*)(UINT_PTR)parameter, pDef);
+}
+
+static void AddBoolParameter( const char* pName, RenderParameter parameter )
+{
+    TwAddVarCB(g_pUI, pName, TW_TYPE_BOOLCPP, SetBoolParameter, GetBoolParameter, (void*)(UINT_PTR)parameter, "");
 }
 
 void InitUI()
@@ -523,15 +872,36 @@ void InitUI()
     TwDefine(" GLOBAL help='Realistic Volumetric Explosions in Games\nGPU Pro 6\nAlex Dunn - 23/12/2014 \n\nHold the LMB and move the mouse to rotate the scene.\n\n' "); // Message added to the help bar.
     int barSize[2] = {210, 180};
     TwSetParam(g_pUI, NULL, "size", TW_PARAM_INT32, 2, barSize);
-    TwAddVarRW(g_pUI, "Use Tight Hull", TW_TYPE_BOOL8, &g_EnableHullShrinking, "");
-    TwAddVarRW(g_pUI, "Edge Softness", TW_TYPE_FLOAT, &g_EdgeSoftness, "min=0 max=1 step=0.001");
-    TwAddVarRW(g_pUI, "Radius", TW_TYPE_FLOAT, &g_ExplosionRadius, "min=0 max=8 step=0.01");
-    TwAddVarRW(g_pUI, "Displacement", TW_TYPE_FLOAT, &g_DisplacementAmount, "min=0 max=8 step=0.01");
-    TwAddVarRW(g_pUI, "Amplitude Factor", TW_TYPE_FLOAT, &g_NoiseAmplitudeFactor, "min=0 max=10 step=0.01");
-    TwAddVarRW(g_pUI, "Frequency Factor", TW_TYPE_FLOAT, &g_NoiseFrequencyFactor, "min=0 max=10 step=0.01");
-    TwAddVarRW(g_pUI, "Noise Scale", TW_TYPE_FLOAT, &g_NoiseScale, "min=0 max=1 step=0.001");
-    TwAddVarRW(g_pUI, "UV Scale", TW_TYPE_FLOAT, &g_UvScaleBias.x, "min=-10 max=10 step=0.01");
-    TwAddVarRW(g_pUI, "UV Bias", TW_TYPE_FLOAT, &g_UvScaleBias.y, "min=-10 max=10 step=0.01");
+    const TwEnumVal primitives[] =
+    {
+        { kPrimitiveSphere, "Sphere" },
+        { kPrimitiveCylinder, "Cylinder" },
+        { kPrimitiveCone, "Cone" },
+        { kPrimitiveTorus, "Torus" },
+        { kPrimitiveBox, "Box" }
+    };
+    const TwType primitiveType = TwDefineEnum("PrimitiveType", primitives, ARRAYSIZE(primitives));
+    TwAddVarCB(g_pUI, "Primitive", primitiveType, SetEnumParameter, GetEnumParameter, (void*)(UINT_PTR)kParameterPrimitive, "");
+    AddBoolParameter("Use Tight Hull", kParameterHullShrinking);
+    AddBoolParameter("Adaptive Hull", kParameterAdaptiveHull);
+    AddBoolParameter("Adaptive Steps", kParameterAdaptiveSteps);
+    AddBoolParameter("Octave Culling", kParameterOctaveCulling);
+    AddBoolParameter("Dithered Start", kParameterDitheredStart);
+    AddFloatParameter("Step Scale", kParameterStepScale, "min=1 max=4 step=0.1");
+    AddFloatParameter("Edge Softness", kParameterEdgeSoftness, "min=0 max=1 step=0.001");
+    AddFloatParameter("Radius", kParameterExplosionRadius, "min=0 max=8 step=0.01");
+    AddFloatParameter("Displacement", kParameterDisplacement, "min=0 max=8 step=0.01");
+    AddFloatParameter("Amplitude Factor", kParameterAmplitudeFactor, "min=0 max=10 step=0.01");
+    AddFloatParameter("Frequency Factor", kParameterFrequencyFactor, "min=0 max=10 step=0.01");
+    AddFloatParameter("Noise Scale", kParameterNoiseScale, "min=0 max=1 step=0.001");
+    AddFloatParameter("UV Scale", kParameterUvScale, "min=-10 max=10 step=0.01");
+    AddFloatParameter("UV Bias", kParameterUvBias, "min=-10 max=10 step=0.01");
+    AddFloatParameter("Self Shadowing", kParameterSelfShadowing, "min=0 max=1 step=0.01");
+    TwAddVarRW(g_pUI, "8-bit Noise", TW_TYPE_BOOL8, &g_QuantisedNoise, "");
+    if( !g_ImpostorFlipbook.IsEmpty() )
+    {
+        TwAddVarRW(g_pUI, "Impostor Coverage", TW_TYPE_FLOAT, &g_ImpostorCoverageThreshold, "min=0 max=1 step=0.001");
+    }
 }
 
 //--------------------------------------------------------------------------------------
@@ -543,6 +913,8 @@ void CleanupDevice()
 
     if( g_pExplosionParamsCB ) g_pExplosionParamsCB->Release();
     if( g_pNoiseVolumeSRV ) g_pNoiseVolumeSRV->Release();
+    if( g_pNoiseVolumeUnormSRV ) g_pNoiseVolumeUnormSRV->Release();
+    if( g_pNoiseValueGradientSRV ) g_pNoiseValueGradientSRV->Release();
     if( g_pGradientSRV ) g_pGradientSRV->Release();
     if( g_pRenderExplosionVS ) g_pRenderExplosionVS->Release();
     if( g_pRenderExplosionHS ) g_pRenderExplosionHS->Release();
@@ -551,6 +923,16 @@ void CleanupDevice()
     if( g_pExplosionLayout ) g_pExplosionLayout->Release();
     if( g_pSamplerClampedLinear ) g_pSamplerClampedLinear->Release();
     if( g_pSamplerWrappedLinear ) g_pSamplerWrappedLinear->Release();
+    if( g_pImpostorParamsCB ) g_pImpostorParamsCB->Release();
+    if( g_pImpostorColourSRV ) g_pImpostorColourSRV->Release();
+    if( g_pImpostorDepthSRV ) g_pImpostorDepthSRV->Release();
+    if( g_pRenderImpostorVS ) g_pRenderImpostorVS->Release();
+    if( g_pRenderImpostorPS ) g_pRenderImpostorPS->Release();
+    if( g_pTransmittanceVolume ) g_pTransmittanceVolume->Release();
+    if( g_pTransmittanceVolumeSRV ) g_pTransmittanceVolumeSRV->Release();
+    if( g_pBlueNoiseSRV ) g_pBlueNoiseSRV->Release();
+    delete g_pTransmittance;
+    delete g_pThreadPool;
     if( g_pTestWriteDepth ) g_pTestWriteDepth->Release();
     if( g_pOverBlendState ) g_pOverBlendState->Release();
 
@@ -567,10 +949,20 @@ void CleanupDevice()
 //--------------------------------------------------------------------------------------
 // Called every time the application receives a message
 //--------------------------------------------------------------------------------------
-LRESULT CALLBACK WndProc( HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam )
+static void PostWindowMessage( UINT message, WPARAM wParam, LPARAM lParam )
 {
-    if( TwEventWin(hWnd, message, wParam, lParam) ) return 0;
+    if( !g_pRenderThread || !g_pRenderThread->IsRunning() ) return;
+
+    RenderEvent event = {};
+    event.type = kRenderEventPlatform;
+    event.id = message;
+    event.data0 = (uint64_t)wParam;
+    event.data1 = (uint64_t)lParam;
+    g_pRenderThread->PostEvent( event );
+}
 
+LRESULT CALLBACK WndProc( HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam )
+{
     PAINTSTRUCT ps;
     HDC hdc;
 
@@ -581,23 +973,40 @@ LRESULT CALLBACK WndProc( HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam
         EndPaint( hWnd, &ps );
         break;
 
+    // The render thread presents to the window, so stop it before the window
+    //  goes; RunPlatformLoop's own Stop then has nothing left to do.
+    case WM_CLOSE:
+        if( g_pRenderThread ) g_pRenderThread->Stop();
+        DestroyWindow( hWnd );
+        break;
+
     case WM_DESTROY:
         PostQuitMessage( 0 );
         break;
 
+    // Input is handled on the render thread, which owns the UI and the camera.
+    //  Mouse capture has to be taken here, on the window's thread.
     case WM_LBUTTONDOWN:
     case WM_MBUTTONDOWN:
     case WM_RBUTTONDOWN:
-        OnMouseDown(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+        SetCapture(hWnd);
+        PostWindowMessage( message, wParam, lParam );
         return 0;
     case WM_LBUTTONUP:
     case WM_MBUTTONUP:
     case WM_RBUTTONUP:
-        OnMouseUp();
+        ReleaseCapture();
+        PostWindowMessage( message, wParam, lParam );
         return 0;
     case WM_MOUSEMOVE:
-        OnMouseMove(wParam, GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+    case WM_MOUSEWHEEL:
+        PostWindowMessage( message, wParam, lParam );
         return 0;
+    case WM_KEYDOWN:
+    case WM_KEYUP:
+    case WM_CHAR:
+        PostWindowMessage( message, wParam, lParam );
+        return DefWindowProc( hWnd, message, wParam, lParam );
 
         // Note that this tutorial does not handle resizing (WM_SIZE) requests,
         // so we created the window without the resize border.
@@ -630,117 +1039,76 @@ void OnMouseDown(int x, int y)
 {
     g_LastMousePos.x = x;
     g_LastMousePos.y = y;
-
-    SetCapture(g_hWnd);
-}
-
-void OnMouseUp()
-{
-    ReleaseCapture();
 }
 
+// Drags that the UI didn't take orbit and zoom the render thread's camera.
 void OnMouseMove(WPARAM btnState, int x, int y)
 {
-    bool updateMatrices = false;
+    RenderEvent event = {};
 
     if( (btnState & MK_LBUTTON) != 0 )
     {
-        float dx = XMConvertToRadians(0.25f * (float)(x - g_LastMousePos.x));
-        float dy = XMConvertToRadians(0.25f * (float)(y - g_LastMousePos.y));
-
-        g_CameraTheta -= dx;
-        g_CameraPhi   -= dy;
-
-        updateMatrices = true;
+        event.type = kRenderEventOrbitCamera;
+        event.x = -XMConvertToRadians(0.25f * (float)(x - g_LastMousePos.x));
+        event.y = -XMConvertToRadians(0.25f * (float)(y - g_LastMousePos.y));
+        g_pRenderThread->ApplyEvent( event );
     }
     else if( (btnState & MK_RBUTTON) != 0 )
     {
         float dx = 0.1f * (float)(x - g_LastMousePos.x);
         float dy = 0.1f * (float)(y - g_LastMousePos.y);
 
-        g_CameraRadius += dx - dy;
-
-        updateMatrices = true;
+        event.type = kRenderEventZoomCamera;
+        event.x = dx - dy;
+        g_pRenderThread->ApplyEvent( event );
     }
 
     g_LastMousePos.x = x;
     g_LastMousePos.y = y;
-
-    if(updateMatrices)
-    {
-        UpdateViewMatrix();
-    }
 }
 
-void UpdateViewMatrix()
+void UpdateExplosionParams(ID3D11DeviceContext* const pContext, const ExplosionSettings& settings, const OrbitCamera& camera)
 {
-    g_CameraRadius = max(g_CameraRadius, 1.0f);
-    g_CameraRadius = min(g_CameraRadius, 20.0f);
-
-    g_CameraPhi = max(g_CameraPhi, 0.1f);
-    g_CameraPhi = min(g_CameraPhi, PI - 0.1f);
-
-    float x = g_CameraRadius * sinf(g_CameraPhi) * cosf(g_CameraTheta);
-    float y = g_CameraRadius * cosf(g_CameraPhi);
-    float z = g_CameraRadius * sinf(g_CameraPhi) * sinf(g_CameraTheta);
+    // Kept on the CPU as well, to decide whether to draw the impostor.
+    const NoiseVolume& noiseVolume = g_SceneTextures.noiseVolume;
+    BuildExplosionParams( settings, camera, (float)g_ElapsedTime, kResolutionX, kResolutionY, noiseVolume.GetLargestAbsoluteValue(), g_ExplosionParams );
 
-    g_EyePositionWS = XMFLOAT3(x, y, z);
+    // The GPU samples the volume itself, possibly quantised, rather than evaluating
+    //  it as the CPU does.
+    g_ExplosionParams.g_NoiseValueScaleBias = g_QuantisedNoise ? float2( noiseVolume.GetUnormScale(), noiseVolume.GetUnormBias() ) : float2( 1, 0 );
+    g_ExplosionParams.g_NoiseMeanAbsValue = noiseVolume.GetMeanAbsoluteValue();
 
-    XMStoreFloat4x4(&g_ViewMatrix, XMMatrixLookAtLH(XMLoadFloat3(&g_EyePositionWS), XMLoadFloat3(&kEyeLookAtWS), XMLoadFloat3(&XMFLOAT3(0, 1, 0))));
-    XMStoreFloat3( &g_EyeForwardWS, XMVector3Normalize( XMVectorSubtract( XMLoadFloat3(&kEyeLookAtWS), XMLoadFloat3(&g_EyePositionWS) ) ) );
+    // Refresh a few slices of the transmittance volume with this frame's explosion.
+    if( settings.selfShadowing > 0 )
+    {
+        UINT firstSlice, numSlices;
+        g_pTransmittance->Update( g_ExplosionParams, g_SceneTextures, *g_pThreadPool, firstSlice, numSlices );
 
-    g_WorldToProjectionMatrix = XMMatrixMultiply( XMLoadFloat4x4(&g_ViewMatrix), XMLoadFloat4x4(&g_ProjMatrix) );
+        const UINT resolution = g_pTransmittance->GetResolution();
+        const D3D11_BOX box = { 0, 0, firstSlice, resolution, resolution, firstSlice + numSlices };
+        pContext->UpdateSubresource( g_pTransmittanceVolume, 0, &box, g_pTransmittance->GetSlice( firstSlice ), resolution, resolution * resolution );
+    }
+    g_pTransmittance->BindParams( g_ExplosionParams );
 
-    XMVECTOR det;
-    g_ProjectionToWorldMatrix = XMMatrixInverse( &det, g_WorldToProjectionMatrix);
-    g_ViewToWorldMatrix = XMMatrixInverse( &det, XMLoadFloat4x4( &g_ViewMatrix ) );
+    D3D11_MAPPED_SUBRESOURCE MappedSubResource;
+    pContext->Map( g_pExplosionParamsCB, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource );
+    *(ExplosionParams *)MappedSubResource.pData = g_ExplosionParams;
+    pContext->Unmap( g_pExplosionParamsCB, 0 );
 }
 
-void UpdateExplosionParams(ID3D11DeviceContext* const pContext)
+void UpdateImpostorParams(ID3D11DeviceContext* const pContext)
 {
     D3D11_MAPPED_SUBRESOURCE MappedSubResource;
-    pContext->Map( g_pExplosionParamsCB, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource );
-    {
-        ((ExplosionParams *)MappedSubResource.pData)->g_WorldToViewMatrix = g_ViewMatrix;
-        ((ExplosionParams *)MappedSubResource.pData)->g_ViewToProjectionMatrix = g_ProjMatrix;
-        XMStoreFloat4x4( &((ExplosionParams *)MappedSubResource.pData)->g_ProjectionToViewMatrix, g_InvProjMatrix );
-        XMStoreFloat4x4( &((ExplosionParams *)MappedSubResource.pData)->g_WorldToProjectionMatrix, g_WorldToProjectionMatrix );
-        XMStoreFloat4x4( &((ExplosionParams *)MappedSubResource.pData)->g_ProjectionToWorldMatrix, g_ProjectionToWorldMatrix );
-        XMStoreFloat4x4( &((ExplosionParams *)MappedSubResource.pData)->g_ViewToWorldMatrix, g_ViewToWorldMatrix );
-        ((ExplosionParams *)MappedSubResource.pData)->g_EyePositionWS = g_EyePositionWS;
-        ((ExplosionParams *)MappedSubResource.pData)->g_NoiseAmplitudeFactor = g_NoiseAmplitudeFactor;
-        ((ExplosionParams *)MappedSubResource.pData)->g_EyeForwardWS = g_EyeForwardWS;
-        ((ExplosionParams *)MappedSubResource.pData)->g_NoiseScale = g_NoiseScale;
-        ((ExplosionParams *)MappedSubResource.pData)->g_ProjectionParams = g_ProjectionParams;
-        ((ExplosionParams *)MappedSubResource.pData)->g_ScreenParams = XMFLOAT4((FLOAT)kResolutionX, (FLOAT)kResolutionY, 1.f/kResolutionX, 1.f/kResolutionY);
-        ((ExplosionParams *)MappedSubResource.pData)->g_ExplosionPositionWS = kEyeLookAtWS;
-        ((ExplosionParams *)MappedSubResource.pData)->g_ExplosionRadiusWS = g_ExplosionRadius;
-        ((ExplosionParams *)MappedSubResource.pData)->g_NoiseAnimationSpeed = kNoiseAnimationSpeed;
-        ((ExplosionParams *)MappedSubResource.pData)->g_Time = (float)g_ElapsedTime;
-        ((ExplosionParams *)MappedSubResource.pData)->g_EdgeSoftness = g_EdgeSoftness;
-        ((ExplosionParams *)MappedSubResource.pData)->g_NoiseFrequencyFactor = g_NoiseFrequencyFactor;
-        ((ExplosionParams *)MappedSubResource.pData)->g_PrimitiveIdx = g_Primitive;
-        ((ExplosionParams *)MappedSubResource.pData)->g_Opacity = 1.0f;
-        ((ExplosionParams *)MappedSubResource.pData)->g_DisplacementWS = g_DisplacementAmount;
-        ((ExplosionParams *)MappedSubResource.pData)->g_StepSizeWS = kStepSize;
-        ((ExplosionParams *)MappedSubResource.pData)->g_MaxNumSteps = kMaxNumSteps;
-        ((ExplosionParams *)MappedSubResource.pData)->g_UvScaleBias = g_UvScaleBias;
-        ((ExplosionParams *)MappedSubResource.pData)->g_NoiseInitialAmplitude = kNoiseInitialAmplitude;
-        ((ExplosionParams *)MappedSubResource.pData)->g_InvMaxNoiseDisplacement = 1.0f/g_MaxNoiseDisplacement;
-        ((ExplosionParams *)MappedSubResource.pData)->g_NumOctaves = kNumOctaves;
-        ((ExplosionParams *)MappedSubResource.pData)->g_SkinThickness = g_MaxSkinThickness;
-        ((ExplosionParams *)MappedSubResource.pData)->g_NumHullOctaves = kNumHullOctaves;
-        ((ExplosionParams *)MappedSubResource.pData)->g_NumHullSteps = g_EnableHullShrinking ? kNumHullSteps : 0;
-        ((ExplosionParams *)MappedSubResource.pData)->g_TessellationFactor = kTessellationFactor;
-    }
-    pContext->Unmap( g_pExplosionParamsCB, 0 );
+    pContext->Map( g_pImpostorParamsCB, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedSubResource );
+    g_ImpostorFlipbook.BuildImpostorParams( g_ExplosionParams, (float)g_ElapsedTime, *(ImpostorParams *)MappedSubResource.pData );
+    pContext->Unmap( g_pImpostorParamsCB, 0 );
 }
 
 
 //--------------------------------------------------------------------------------------
 // Render a frame
 //--------------------------------------------------------------------------------------
-void Render()
+void Render( const ExplosionSettings& settings, const OrbitCamera& camera )
 {
     g_pImmediateContext->ClearRenderTargetView( g_pRenderTargetView, Colors::Black );
 
@@ -758,29 +1126,62 @@ void Render()
     g_pImmediateContext->OMSetDepthStencilState(g_pTestWriteDepth, 0);
     g_pImmediateContext->OMSetRenderTargets( 1, &g_pRenderTargetView, nullptr );
 
-    g_pImmediateContext->IASetInputLayout( g_pExplosionLayout );
-    g_pImmediateContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST );
+    UpdateExplosionParams( g_pImmediateContext, settings, camera );
 
-    g_pImmediateContext->VSSetShader( g_pRenderExplosionVS, nullptr, 0 );
-    g_pImmediateContext->HSSetShader( g_pRenderExplosionHS, nullptr, 0 );
-    g_pImmediateContext->DSSetShader( g_pRenderExplosionDS, nullptr, 0 );
-    g_pImmediateContext->PSSetShader( g_pRenderExplosionPS, nullptr, 0 );
+    ID3D11SamplerState* const pSamplers[] = { g_pSamplerClampedLinear, g_pSamplerWrappedLinear };
 
-    UpdateExplosionParams( g_pImmediateContext );
+    // Distant explosions cover too few pixels to be worth the tessellation and ray
+    //  march, so play back the baked flipbook instead.
+    if( !g_ImpostorFlipbook.IsEmpty() && GetExplosionScreenCoverage( g_ExplosionParams ) < g_ImpostorCoverageThreshold )
+    {
+        UpdateImpostorParams( g_pImmediateContext );
 
-    ID3D11SamplerState* const pSamplers[] = { g_pSamplerClampedLinear, g_pSamplerWrappedLinear };
-    g_pImmediateContext->DSSetSamplers( S_BILINEAR_CLAMPED_SAMPLER, 2, pSamplers );
-    g_pImmediateContext->PSSetSamplers( S_BILINEAR_CLAMPED_SAMPLER, 2, pSamplers );
+        g_pImmediateContext->IASetInputLayout( nullptr );
+        g_pImmediateContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP );
+
+        g_pImmediateContext->VSSetShader( g_pRenderImpostorVS, nullptr, 0 );
+        g_pImmediateContext->HSSetShader( nullptr, nullptr, 0 );
+        g_pImmediateContext->DSSetShader( nullptr, nullptr, 0 );
+        g_pImmediateContext->PSSetShader( g_pRenderImpostorPS, nullptr, 0 );
 
-    g_pImmediateContext->HSSetConstantBuffers( B_EXPLOSION_PARAMS, 1, &g_pExplosionParamsCB );
-    g_pImmediateContext->DSSetConstantBuffers( B_EXPLOSION_PARAMS, 1, &g_pExplosionParamsCB );
-    g_pImmediateContext->PSSetConstantBuffers( B_EXPLOSION_PARAMS, 1, &g_pExplosionParamsCB );
+        g_pImmediateContext->PSSetSamplers( S_BILINEAR_CLAMPED_SAMPLER, 2, pSamplers );
 
-    g_pImmediateContext->DSSetShaderResources( T_NOISE_VOLUME, 1, &g_pNoiseVolumeSRV );
-    g_pImmediateContext->PSSetShaderResources( T_NOISE_VOLUME, 1, &g_pNoiseVolumeSRV );
-    g_pImmediateContext->PSSetShaderResources( T_GRADIENT_TEX, 1, &g_pGradientSRV );
+        g_pImmediateContext->VSSetConstantBuffers( B_IMPOSTOR_PARAMS, 1, &g_pImpostorParamsCB );
+        g_pImmediateContext->PSSetConstantBuffers( B_IMPOSTOR_PARAMS, 1, &g_pImpostorParamsCB );
 
-    g_pImmediateContext->Draw( 1, 0 );
+        g_pImmediateContext->PSSetShaderResources( T_IMPOSTOR_COLOUR, 1, &g_pImpostorColourSRV );
+        g_pImmediateContext->PSSetShaderResources( T_IMPOSTOR_DEPTH, 1, &g_pImpostorDepthSRV );
+
+        g_pImmediateContext->Draw( 4, 0 );
+    }
+    else
+    {
+        g_pImmediateContext->IASetInputLayout( g_pExplosionLayout );
+        g_pImmediateContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST );
+
+        g_pImmediateContext->VSSetShader( g_pRenderExplosionVS, nullptr, 0 );
+        g_pImmediateContext->HSSetShader( g_pRenderExplosionHS, nullptr, 0 );
+        g_pImmediateContext->DSSetShader( g_pRenderExplosionDS, nullptr, 0 );
+        g_pImmediateContext->PSSetShader( g_pRenderExplosionPS, nullptr, 0 );
+
+        g_pImmediateContext->DSSetSamplers( S_BILINEAR_CLAMPED_SAMPLER, 2, pSamplers );
+        g_pImmediateContext->PSSetSamplers( S_BILINEAR_CLAMPED_SAMPLER, 2, pSamplers );
+
+        g_pImmediateContext->HSSetConstantBuffers( B_EXPLOSION_PARAMS, 1, &g_pExplosionParamsCB );
+        g_pImmediateContext->DSSetConstantBuffers( B_EXPLOSION_PARAMS, 1, &g_pExplosionParamsCB );
+        g_pImmediateContext->PSSetConstantBuffers( B_EXPLOSION_PARAMS, 1, &g_pExplosionParamsCB );
+
+        ID3D11ShaderResourceView* const pNoiseVolumeSRV = g_QuantisedNoise ? g_pNoiseVolumeUnormSRV : g_pNoiseVolumeSRV;
+        g_pImmediateContext->DSSetShaderResources( T_NOISE_VOLUME, 1, &pNoiseVolumeSRV );
+        g_pImmediateContext->PSSetShaderResources( T_NOISE_VOLUME, 1, &pNoiseVolumeSRV );
+        g_pImmediateContext->DSSetShaderResources( T_NOISE_VALUE_GRADIENT_VOLUME, 1, &g_pNoiseValueGradientSRV );
+        g_pImmediateContext->PSSetShaderResources( T_NOISE_VALUE_GRADIENT_VOLUME, 1, &g_pNoiseValueGradientSRV );
+        g_pImmediateContext->PSSetShaderResources( T_GRADIENT_TEX, 1, &g_pGradientSRV );
+        g_pImmediateContext->PSSetShaderResources( T_TRANSMITTANCE_VOLUME, 1, &g_pTransmittanceVolumeSRV );
+        g_pImmediateContext->PSSetShaderResources( T_BLUE_NOISE, 1, &g_pBlueNoiseSRV );
+
+        g_pImmediateContext->Draw( 1, 0 );
+    }
 
     TwDraw();
 
@@ -2,6 +2,9 @@
 
 Texture3D<float>    g_NoiseVolumeRO : register(T_REG(T_NOISE_VOLUME));
 Texture2D<float4>   g_GradientTexRO : register(T_REG(T_GRADIENT_TEX));
+Texture3D<float>    g_TransmittanceVolumeRO : register(T_REG(T_TRANSMITTANCE_VOLUME));
+Texture2D<float>    g_BlueNoiseRO : register(T_REG(T_BLUE_NOISE));
+Texture3D<float4>   g_NoiseValueGradientVolumeRO : register(T_REG(T_NOISE_VALUE_GRADIENT_VOLUME));
 
 struct HS_CONSTANT_DATA_OUTPUT
 {
@@ -18,9 +21,22 @@ struct PS_INPUT
     noperspective float3 rayDirectionWS : RAYDIR;
 };
 
-float Noise( float3 uvw )
+// Set to 1 to sum the noise octaves at minimum 16-bit precision.  The texture
+//  coordinates stay fp32; see the precision-bench headless command for the error.
+#ifndef HALF_PRECISION_NOISE
+#define HALF_PRECISION_NOISE 0
+#endif
+
+#if HALF_PRECISION_NOISE
+typedef min16float noise_float;
+#else
+typedef float noise_float;
+#endif
+
+noise_float Noise( float3 uvw )
 {
-    const float noiseVal = g_NoiseVolumeRO.SampleLevel(BilinearWrappedSampler, uvw, 0);
+    // The 8-bit volume is filtered as UNORM and dequantised once afterwards.
+    const noise_float noiseVal = mad(g_NoiseVolumeRO.SampleLevel(BilinearWrappedSampler, uvw, 0), g_NoiseValueScaleBias.x, g_NoiseValueScaleBias.y);
 
     return noiseVal;	
 }
@@ -30,17 +46,48 @@ float FractalNoiseAtPositionWS( float3 posWS, uint numOctaves )
     const float3 animation = g_NoiseAnimationSpeed * g_Time;
 
     float3 uvw = posWS * g_NoiseScale + animation; 
-    float amplitude = g_NoiseInitialAmplitude;
+    noise_float amplitude = g_NoiseInitialAmplitude;
     
-    float noiseValue = 0;
+    noise_float noiseValue = 0;
     for(uint i=0 ; i<numOctaves ; i++)
     {
         noiseValue += abs(amplitude * Noise( uvw )); 
-        amplitude *= g_NoiseAmplitudeFactor; 
+        amplitude *= (noise_float)g_NoiseAmplitudeFactor; 
+        uvw *= g_NoiseFrequencyFactor;
+    }
+
+    return noiseValue * (noise_float)g_InvMaxNoiseDisplacement; 
+}
+
+// FractalNoiseAtPositionWS and its gradient with respect to posWS, from the RGBA16F
+//  volume of (value, d/du, d/dv, d/dw), so one fetch per octave as for the value
+//  alone.  Always fp32, and never the 8-bit volume.
+float FractalNoiseAndGradientAtPositionWS( float3 posWS, uint numOctaves, out float3 gradientWS )
+{
+    const float3 animation = g_NoiseAnimationSpeed * g_Time;
+
+    float3 uvw = posWS * g_NoiseScale + animation; 
+    float uvwPerWS = g_NoiseScale;
+    float amplitude = g_NoiseInitialAmplitude;
+
+    float noiseValue = 0;
+    float3 gradient = 0;
+    for(uint i=0 ; i<numOctaves ; i++)
+    {
+        const float4 valueGradient = g_NoiseValueGradientVolumeRO.SampleLevel(BilinearWrappedSampler, uvw, 0);
+
+        // d|a n| = a sign(n) dn, and the octave's uvw changes uvwPerWS per world unit.
+        const float signedAmplitude = valueGradient.x < 0 ? -amplitude : amplitude;
+        noiseValue += abs(amplitude * valueGradient.x);
+        gradient += valueGradient.yzw * (signedAmplitude * uvwPerWS);
+
+        amplitude *= g_NoiseAmplitudeFactor;
         uvw *= g_NoiseFrequencyFactor;
+        uvwPerWS *= g_NoiseFrequencyFactor;
     }
 
-    return noiseValue * g_InvMaxNoiseDisplacement; 
+    gradientWS = gradient * g_InvMaxNoiseDisplacement;
+    return noiseValue * g_InvMaxNoiseDisplacement;
 }
 
 float Box( float3 relativePosWS, float3 b )
@@ -107,6 +154,27 @@ float DisplacedPrimitive( float3 posWS, float3 spherePositionWS, float radiusWS,
     return signedDistanceToPrimitive - displacementOut * displacementWS;
 }
 
+// DisplacedPrimitive with the gradient of its distance, the unnormalised surface
+//  normal.  The primitive's own gradient is taken by central differences of the
+//  undisplaced shape, which needs no noise fetches.
+float DisplacedPrimitiveAndGradient( float3 posWS, float3 spherePositionWS, float radiusWS, float displacementWS, uint numOctaves,
+                                     out float displacementOut, out float3 gradientOut )
+{
+    // With no octaves DisplacedPrimitive is the bare shape.
+    const float epsilonWS = radiusWS * 1e-3f + 1e-4f;
+    float unused;
+    const float3 primitiveGradient = float3(
+        DisplacedPrimitive( posWS + float3( epsilonWS, 0, 0 ), spherePositionWS, radiusWS, 0, 0, unused ) - DisplacedPrimitive( posWS - float3( epsilonWS, 0, 0 ), spherePositionWS, radiusWS, 0, 0, unused ),
+        DisplacedPrimitive( posWS + float3( 0, epsilonWS, 0 ), spherePositionWS, radiusWS, 0, 0, unused ) - DisplacedPrimitive( posWS - float3( 0, epsilonWS, 0 ), spherePositionWS, radiusWS, 0, 0, unused ),
+        DisplacedPrimitive( posWS + float3( 0, 0, epsilonWS ), spherePositionWS, radiusWS, 0, 0, unused ) - DisplacedPrimitive( posWS - float3( 0, 0, epsilonWS ), spherePositionWS, radiusWS, 0, 0, unused ) ) * (0.5f / epsilonWS);
+
+    float3 noiseGradient;
+    displacementOut = FractalNoiseAndGradientAtPositionWS( posWS, numOctaves, noiseGradient );
+    gradientOut = primitiveGradient - noiseGradient * displacementWS;
+
+    return DisplacedPrimitive( posWS, spherePositionWS, radiusWS, 0, 0, unused ) - displacementOut * displacementWS;
+}
+
 float4 MapDisplacementToColour( const float displacement, const float2 uvScaleBias )
 {
     float texcoord = saturate( mad(displacement, uvScaleBias.x, uvScaleBias.y) );
@@ -121,10 +189,33 @@ float4 MapDisplacementToColour( const float displacement, const float2 uvScaleBi
     return colour;
 }
 
-float4 SceneFunction( const float3 posWS, const float3 spherePositionWS, const float radiusWS, const float displacementWS, const float2 uvScaleBias )
+// Mean fractal noise of octaves [numOctaves, g_NumOctaves).
+float SkippedOctavesDisplacement( const uint numOctaves )
+{
+    float amplitude = g_NoiseInitialAmplitude * pow( g_NoiseAmplitudeFactor, numOctaves );
+    float sumAmplitudes = 0;
+    for(uint i=numOctaves ; i<g_NumOctaves ; i++)
+    {
+        sumAmplitudes += amplitude;
+        amplitude *= g_NoiseAmplitudeFactor;
+    }
+
+    return sumAmplitudes * g_NoiseMeanAbsValue * g_InvMaxNoiseDisplacement;
+}
+
+float4 SceneFunction( const float3 posWS, const float3 spherePositionWS, const float radiusWS, const float displacementWS, const float2 uvScaleBias, const uint numOctaves, out float distance )
 {
     float displacementOut;
-    float distance = DisplacedPrimitive( posWS, spherePositionWS, radiusWS, displacementWS, g_NumOctaves, displacementOut );
+    distance = DisplacedPrimitive( posWS, spherePositionWS, radiusWS, displacementWS, numOctaves, displacementOut );
+
+    // Stand in for any octaves skipped by SelectNumOctaves with their mean, so that
+    //  culling does not pull the surface in.
+    if( numOctaves < g_NumOctaves )
+    {
+        const float skippedDisplacement = SkippedOctavesDisplacement( numOctaves );
+        displacementOut += skippedDisplacement;
+        distance -= skippedDisplacement * displacementWS;
+    }
     float4 colour = MapDisplacementToColour( displacementOut, uvScaleBias );
 
     // Rather than just using a binary in/out metric, we smooth the edge of the volume using a smoothstep so that we get soft edges.
@@ -133,7 +224,78 @@ float4 SceneFunction( const float3 posWS, const float3 spherePositionWS, const f
     return colour * float4( 1..xxx, edgeFade );
 }
 
+float4 SceneFunction( const float3 posWS, const float3 spherePositionWS, const float radiusWS, const float displacementWS, const float2 uvScaleBias, out float distance )
+{
+    return SceneFunction( posWS, spherePositionWS, radiusWS, displacementWS, uvScaleBias, g_NumOctaves, distance );
+}
+
+float4 SceneFunction( const float3 posWS, const float3 spherePositionWS, const float radiusWS, const float displacementWS, const float2 uvScaleBias )
+{
+    float distance;
+    return SceneFunction( posWS, spherePositionWS, radiusWS, displacementWS, uvScaleBias, distance );
+}
+
+// Octaves worth fetching for a step at viewDepth on a ray that has accumulated
+//  alpha.  An octave whose texels are smaller than the pixel's footprint only adds
+//  aliasing, and one whose amplitude, scaled by the light still reaching the eye
+//  through the ray, is below OCTAVE_CULL_MIN_CONTRIBUTION cannot be seen.  Both
+//  only shrink with each octave, so the first culled octave ends the sum.
+uint SelectNumOctaves( const float viewDepth, const float alpha )
+{
+    if( !g_OctaveCulling ) return g_NumOctaves;
+
+    const float footprintWS = viewDepth * g_PixelSizePerDepthWS;
+    float texelSizeWS = g_NoiseTexelSizeWS;
+    float contribution = 1 - alpha / g_Opacity;
+
+    uint numOctaves = 1;
+    while( numOctaves < g_NumOctaves )
+    {
+        texelSizeWS /= g_NoiseFrequencyFactor;
+        contribution *= g_NoiseAmplitudeFactor;
+        if( texelSizeWS < footprintWS || contribution < OCTAVE_CULL_MIN_CONTRIBUTION ) break;
+        numOctaves++;
+    }
+    return numOctaves;
+}
+
+// Length of the next adaptive step as a multiple of g_StepSizeWS.  Outside the edge
+//  band nothing is visible for at least the distance to it, less whatever the
+//  noise's slope takes away, so part of that distance is skipped.  Inside the band
+//  the steps are shortened to resolve the fade, and once the ray is nearly opaque
+//  they grow again since little of what lies behind will show.
+float AdaptiveStepScale( const float distance, const float alpha )
+{
+    const float edgeOuter = 0.5f + g_EdgeSoftness;
+    const float edgeInner = 0.5f - g_EdgeSoftness;
+    if( distance > edgeOuter )
+    {
+        return clamp( (distance - edgeOuter) * ADAPTIVE_EMPTY_STEP_FRACTION / g_StepSizeWS, 1, ADAPTIVE_MAX_STEP_SCALE );
+    }
+    if( distance > edgeInner )
+    {
+        return ADAPTIVE_MIN_STEP_SCALE;
+    }
+    return lerp( 1, ADAPTIVE_MAX_STEP_SCALE, saturate( (alpha / g_Opacity - ADAPTIVE_OPAQUE_ALPHA) / (1 - ADAPTIVE_OPAQUE_ALPHA) ) );
+}
+
+// Opacity of a sample taken for g_StepSizeWS, stretched over stepScale times that.
+float AdjustAlphaForStep( const float alpha, const float stepScale )
+{
+    return 1 - pow( 1 - alpha, stepScale );
+}
+
 float4 Blend( const float4 src, const float4 dst )
 {
     return mad(float4(dst.rgb, 1), mad(dst.a, -src.a, dst.a), src);
+}
+
+// Fraction of the light reaching posWS, looked up in the transmittance volume the
+//  CPU refreshes a few slices at a time, rather than marching towards the light.
+float SelfShadowing( const float3 posWS )
+{
+    const float3 uvw = (posWS - g_TransmittanceMinWS) * g_TransmittanceInvSizeWS;
+    const float transmittance = g_TransmittanceVolumeRO.SampleLevel(BilinearClampedSampler, uvw, 0);
+
+    return lerp( 1, transmittance, g_SelfShadowing );
 }
\ No newline at end of file
@@ -16,13 +16,20 @@ PS_INPUT main(HS_CONSTANT_DATA_OUTPUT input, float2 UV : SV_DomainLocation, cons
     // First get the front world space position of the hull.
     float3 frontNormDir = dir;
     float3 frontPosWS = mul(g_ViewToWorldMatrix, float4(frontNormDir, 0)).xyz * g_ExplosionRadiusWS + g_ExplosionPositionWS;
-    float3 frontDirWS = normalize(frontPosWS);
-    // Then perform the shrink wrapping step using sphere tracing.
+    float3 frontDirWS = normalize(frontPosWS - g_ExplosionPositionWS);
+    // Then perform the shrink wrapping step using sphere tracing.  In adaptive mode
+    //  (g_HullConvergenceWS > 0) g_NumHullSteps is only a cap: stop once the steps
+    //  are short enough, or before one that is longer than the last, which would
+    //  be moving away from the surface.
+    float lastFrontDist = 1e30f;
     for(uint i=0 ; i<g_NumHullSteps ; i++)
     {
         float displacementOut; // na
         float dist = DisplacedPrimitive(frontPosWS, g_ExplosionPositionWS.xyz, innerRadius, g_DisplacementWS, g_NumHullOctaves, displacementOut);
+        if(g_HullConvergenceWS > 0 && abs(dist) > lastFrontDist) break;
         frontPosWS -= frontDirWS * dist;
+        if(abs(dist) < g_HullConvergenceWS) break;
+        lastFrontDist = abs(dist);
     }
     frontPosWS += frontDirWS * g_SkinThickness;
     float4 frontPosVS = mul(g_WorldToViewMatrix, float4(frontPosWS, 1));
@@ -31,12 +38,17 @@ PS_INPUT main(HS_CONSTANT_DATA_OUTPUT input, float2 UV : SV_DomainLocation, cons
     // Then repeat the process for the back faces.
     float3 backNormDir = dir * float3(1, 1, -1);
     float3 backPosWS = mul(g_ViewToWorldMatrix, float4(backNormDir, 0)).xyz * g_ExplosionRadiusWS + g_ExplosionPositionWS;
-    float3 backDirWS = normalize(frontPosWS);
+    // Shrink towards the centre along the back vertex's own radius.
+    float3 backDirWS = normalize(backPosWS - g_ExplosionPositionWS);
+    float lastBackDist = 1e30f;
     for(uint j=0 ; j<g_NumHullSteps ; j++)
     {
         float displacementOut; // na
         float dist = DisplacedPrimitive(backPosWS, g_ExplosionPositionWS.xyz, innerRadius, g_DisplacementWS, g_NumHullOctaves, displacementOut);
+        if(g_HullConvergenceWS > 0 && abs(dist) > lastBackDist) break;
         backPosWS -= backDirWS * dist;
+        if(abs(dist) < g_HullConvergenceWS) break;
+        lastBackDist = abs(dist);
     }
     backPosWS += backDirWS * g_SkinThickness;
     float4 backPosVS = mul(g_WorldToViewMatrix, float4(backPosWS, 1));
@@ -5,6 +5,13 @@ float4 main(PS_INPUT i) : SV_TARGET
     const float3 rayDirectionWS = i.rayDirectionWS;
     float nearD = i.rayHitNearFar.x, farD = i.rayHitNearFar.y;
 
+    // Rays starting exactly on the hull line their steps up into slices; push each
+    //  one in by its own fraction of a step to turn the slices into fine noise.
+    if( g_DitheredStart )
+    {
+        nearD += g_StepSizeWS * g_BlueNoiseRO.Load( int3( uint2( i.PosPS.xy ) & (BLUE_NOISE_SIZE - 1), 0 ) );
+    }
+
     float4 output = 0..xxxx;
 
     const float3 startWS = mad(rayDirectionWS, nearD, g_EyePositionWS.xyz);
@@ -16,10 +23,46 @@ float4 main(PS_INPUT i) : SV_TARGET
 
     float3 posWS = startWS;
 
+    if( g_AdaptiveStepping )
+    {
+        const float intervalD = farD - nearD;
+        float marchedD = 0;
+        uint adaptiveStepsTaken = 0;
+        while( marchedD < intervalD && adaptiveStepsTaken++ < g_MaxNumSteps && output.a < g_Opacity )
+        {
+            float distance;
+            const uint numOctaves = SelectNumOctaves( nearD + marchedD, output.a );
+            float4 colour = SceneFunction( posWS, g_ExplosionPositionWS.xyz, innerRadius, g_DisplacementWS, g_UvScaleBias, numOctaves, distance );
+            if( g_SelfShadowing > 0 )
+            {
+                colour.rgb *= SelfShadowing( posWS );
+            }
+
+            const float stepScale = AdaptiveStepScale( distance, output.a );
+            colour.a = AdjustAlphaForStep( colour.a, stepScale * g_StepOpacityScale );
+            output = Blend( output, colour );
+
+            posWS += stepAmountWS * stepScale;
+            marchedD += g_StepSizeWS * stepScale;
+        }
+
+        return output * float4( 1..xxx, g_Opacity );
+    }
+
     float stepsTaken = 0;
     while( stepsTaken++ < numSteps && output.a < g_Opacity )
     {
-        float4 colour = SceneFunction( posWS, g_ExplosionPositionWS.xyz, innerRadius, g_DisplacementWS, g_UvScaleBias );
+        float distance;
+        const uint numOctaves = SelectNumOctaves( mad(stepsTaken - 1, g_StepSizeWS, nearD), output.a );
+        float4 colour = SceneFunction( posWS, g_ExplosionPositionWS.xyz, innerRadius, g_DisplacementWS, g_UvScaleBias, numOctaves, distance );
+        if( g_SelfShadowing > 0 )
+        {
+            colour.rgb *= SelfShadowing( posWS );
+        }
+        if( g_StepOpacityScale != 1 )
+        {
+            colour.a = AdjustAlphaForStep( colour.a, g_StepOpacityScale );
+        }
         output = Blend( output, colour );
         
         posWS += stepAmountWS;
@@ -0,0 +1,10 @@
+#include "Common.h"
+
+Texture2D<float4>   g_ImpostorColourTexRO : register(T_REG(T_IMPOSTOR_COLOUR));
+Texture2D<float>    g_ImpostorDepthTexRO : register(T_REG(T_IMPOSTOR_DEPTH));
+
+struct IMPOSTOR_PS_INPUT
+{
+    float4 PosPS : SV_Position;
+    float2 uv : TEXCOORD0;
+};
@@ -0,0 +1,21 @@
+#include "RenderImpostor.hlsli"
+
+float4 main( IMPOSTOR_PS_INPUT i, out float depth : SV_Depth ) : SV_TARGET
+{
+    const float2 uv0 = mad( i.uv, g_ImpostorFrame0ScaleBias.xy, g_ImpostorFrame0ScaleBias.zw );
+    const float2 uv1 = mad( i.uv, g_ImpostorFrame1ScaleBias.xy, g_ImpostorFrame1ScaleBias.zw );
+
+    // Interpolating between the baked frames either side of g_Time hides the
+    //  flipbook's coarse time step.
+    const float4 colour = lerp( g_ImpostorColourTexRO.Sample( BilinearClampedSampler, uv0 ),
+                                g_ImpostorColourTexRO.Sample( BilinearClampedSampler, uv1 ), g_ImpostorFrameBlend );
+
+    const float depth01 = lerp( g_ImpostorDepthTexRO.Sample( BilinearClampedSampler, uv0 ),
+                                g_ImpostorDepthTexRO.Sample( BilinearClampedSampler, uv1 ), g_ImpostorFrameBlend );
+
+    // Back to a device depth using the same A, B terms as g_ProjectionParams.
+    const float viewDepth = max( mad( depth01, g_ImpostorDepthRangeVS, g_ImpostorNearDepthVS ), g_ImpostorProjectionParams.w );
+    depth = g_ImpostorProjectionParams.x + g_ImpostorProjectionParams.y / viewDepth;
+
+    return colour;
+}
@@ -0,0 +1,16 @@
+#include "RenderImpostor.hlsli"
+
+// Expands SV_VertexID 0..3 into a camera facing quad (drawn as a triangle strip with
+//  no vertex buffer) centred on the explosion.
+IMPOSTOR_PS_INPUT main( uint vertexId : SV_VertexID )
+{
+    const float2 corner = float2( vertexId & 1, vertexId >> 1 );
+    const float2 offset = mad( corner, 2, -1 ) * g_ImpostorHalfExtentWS;
+
+    const float3 posWS = g_ImpostorCentreWS + g_ImpostorRightWS * offset.x + g_ImpostorUpWS * offset.y;
+
+    IMPOSTOR_PS_INPUT o;
+    o.PosPS = mul( float4( posWS, 1 ), g_ImpostorWorldToProjectionMatrix );
+    o.uv = float2( corner.x, 1 - corner.y );
+    return o;
+}
@@ -0,0 +1,387 @@
+#include "RenderThread.h"
+#include "CpuRenderer.h"
+#include "FrameArena.h"
+#include "Headless.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <stdio.h>
+
+bool ApplyRenderEvent( const RenderEvent& event, ExplosionSettings& settings, OrbitCamera& camera )
+{
+    switch( event.type )
+    {
+    case kRenderEventSetParameter:
+        switch( event.id )
+        {
+        case kParameterHullShrinking:   settings.enableHullShrinking = event.x > 0.5f; break;
+        case kParameterEdgeSoftness:    settings.edgeSoftness = event.x; break;
+        case kParameterNoiseScale:      settings.noiseScale = event.x; break;
+        case kParameterExplosionRadius: settings.explosionRadius = event.x; break;
+        case kParameterDisplacement:    settings.displacementAmount = event.x; break;
+        case kParameterUvScale:         settings.uvScaleBias.x = event.x; break;
+        case kParameterUvBias:          settings.uvScaleBias.y = event.x; break;
+        case kParameterAmplitudeFactor: settings.noiseAmplitudeFactor = event.x; break;
+        case kParameterFrequencyFactor: settings.noiseFrequencyFactor = event.x; break;
+        case kParameterPrimitive:       settings.primitive = (PrimitiveType)(uint)event.x; break;
+        case kParameterSelfShadowing:   settings.selfShadowing = event.x; break;
+        case kParameterAdaptiveHull:    settings.adaptiveHullShrinking = event.x > 0.5f; break;
+        case kParameterAdaptiveSteps:   settings.adaptiveStepping = event.x > 0.5f; break;
+        case kParameterOctaveCulling:   settings.octaveCulling = event.x > 0.5f; break;
+        case kParameterDitheredStart:   settings.ditheredStart = event.x > 0.5f; break;
+        case kParameterStepScale:       settings.stepSizeScale = event.x; break;
+        }
+        return true;
+
+    case kRenderEventOrbitCamera:
+        camera.theta += event.x;
+        camera.phi = Clamp( camera.phi + event.y, 0.1f, PI - 0.1f );
+        return true;
+
+    case kRenderEventZoomCamera:
+        camera.radius = Clamp( camera.radius + event.x, 1.0f, 20.0f );
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+float GetRenderParameter( const ExplosionSettings& settings, RenderParameter parameter )
+{
+    switch( parameter )
+    {
+    case kParameterHullShrinking:   return settings.enableHullShrinking ? 1.0f : 0.0f;
+    case kParameterEdgeSoftness:    return settings.edgeSoftness;
+    case kParameterNoiseScale:      return settings.noiseScale;
+    case kParameterExplosionRadius: return settings.explosionRadius;
+    case kParameterDisplacement:    return settings.displacementAmount;
+    case kParameterUvScale:         return settings.uvScaleBias.x;
+    case kParameterUvBias:          return settings.uvScaleBias.y;
+    case kParameterAmplitudeFactor: return settings.noiseAmplitudeFactor;
+    case kParameterFrequencyFactor: return settings.noiseFrequencyFactor;
+    case kParameterPrimitive:       return (float)settings.primitive;
+    case kParameterSelfShadowing:   return settings.selfShadowing;
+    case kParameterAdaptiveHull:    return settings.adaptiveHullShrinking ? 1.0f : 0.0f;
+    case kParameterAdaptiveSteps:   return settings.adaptiveStepping ? 1.0f : 0.0f;
+    case kParameterOctaveCulling:   return settings.octaveCulling ? 1.0f : 0.0f;
+    case kParameterDitheredStart:   return settings.ditheredStart ? 1.0f : 0.0f;
+    case kParameterStepScale:       return settings.stepSizeScale;
+    default:                        return 0.0f;
+    }
+}
+
+RenderThreadStats::RenderThreadStats()
+    : numEvents(0)
+    , numFrames(0)
+    , numProducerStalls(0)
+    , maxQueueDepth(0)
+    , numSequenceErrors(0)
+{
+}
+
+RenderThread::RenderThread( IFrameRenderer& renderer, uint queueCapacity, const ExplosionSettings& settings, const OrbitCamera& camera )
+    : m_Renderer(renderer)
+    , m_Events(queueCapacity)
+    , m_NextSequence(0)
+    , m_Settings(settings)
+    , m_Camera(camera)
+    , m_NumProducerStalls(0)
+{
+}
+
+RenderThread::~RenderThread()
+{
+    Stop();
+}
+
+void RenderThread::Start()
+{
+    m_Thread = std::thread( &RenderThread::ThreadMain, this );
+}
+
+void RenderThread::Stop()
+{
+    if( !m_Thread.joinable() ) return;
+
+    RenderEvent event = {};
+    event.type = kRenderEventQuit;
+    PostEvent( event );
+
+    m_Thread.join();
+    m_Stats.numProducerStalls = m_NumProducerStalls;
+}
+
+void RenderThread::RunPlatformLoop( IPlatformLoop& loop )
+{
+    while( loop.PumpEvents( *this ) ) {}
+    Stop();
+}
+
+void RenderThread::PostEvent( const RenderEvent& event )
+{
+    RenderEvent numberedEvent = event;
+    numberedEvent.sequence = m_NextSequence++;
+
+    if( m_Events.Push( numberedEvent ) ) return;
+
+    // Full: the renderer is a frame behind the input.  Waiting is better than
+    //  dropping events, which would leave the two sides' state out of step.
+    m_NumProducerStalls++;
+    while( !m_Events.Push( numberedEvent ) ) std::this_thread::yield();
+}
+
+void RenderThread::PostParameter( RenderParameter parameter, float value )
+{
+    RenderEvent event = {};
+    event.type = kRenderEventSetParameter;
+    event.id = parameter;
+    event.x = value;
+    PostEvent( event );
+}
+
+void RenderThread::ApplyEvent( const RenderEvent& event )
+{
+    ApplyRenderEvent( event, m_Settings, m_Camera );
+}
+
+void RenderThread::ApplyParameter( RenderParameter parameter, float value )
+{
+    RenderEvent event = {};
+    event.type = kRenderEventSetParameter;
+    event.id = parameter;
+    event.x = value;
+    ApplyEvent( event );
+}
+
+void RenderThread::ThreadMain()
+{
+    m_Renderer.OnRenderThreadStart();
+
+    uint expectedSequence = 0;
+    bool quit = false;
+    while( !quit )
+    {
+        const uint queueDepth = m_Events.GetSize();
+        m_Stats.maxQueueDepth = queueDepth > m_Stats.maxQueueDepth ? queueDepth : m_Stats.maxQueueDepth;
+
+        RenderEvent event;
+        while( !quit && m_Events.Pop( event ) )
+        {
+            m_Stats.numEvents++;
+            if( event.sequence != expectedSequence ) m_Stats.numSequenceErrors++;
+            expectedSequence = event.sequence + 1;
+
+            if( event.type == kRenderEventQuit )
+            {
+                quit = true;
+            }
+            else if( !ApplyRenderEvent( event, m_Settings, m_Camera ) )
+            {
+                m_Renderer.OnPlatformEvent( event );
+            }
+        }
+
+        if( !quit )
+        {
+            m_Renderer.RenderFrame( m_Settings, m_Camera );
+            m_Stats.numFrames++;
+        }
+    }
+
+    m_Renderer.OnRenderThreadStop();
+}
+
+//--------------------------------------------------------------------------------------
+// Headless command
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // xorshift32, so every run posts the same events.
+    class EventRandom
+    {
+    public:
+        explicit EventRandom( uint32_t seed ) : m_State(seed ? seed : 1) {}
+
+        uint32_t Next()
+        {
+            m_State ^= m_State << 13;
+            m_State ^= m_State >> 17;
+            m_State ^= m_State << 5;
+            return m_State;
+        }
+
+        float NextFloat( float lo, float hi ) { return lo + (hi - lo) * (Next() >> 8) * (1.0f / 16777216.0f); }
+
+    private:
+        uint32_t m_State;
+    };
+
+    // Stands in for the window's message loop, posting bursts of random input as
+    //  fast as the queue takes them and keeping its own copy of the resulting state.
+    class SyntheticPlatformLoop : public IPlatformLoop
+    {
+    public:
+        SyntheticPlatformLoop( uint64_t numEvents, uint maxBurst, uint32_t seed )
+            : m_NumEventsLeft(numEvents)
+            , m_MaxBurst(maxBurst)
+            , m_Random(seed)
+            , m_NumPlatformEvents(0)
+        {
+        }
+
+        virtual bool PumpEvents( RenderThread& renderThread )
+        {
+            uint burst = 1 + m_Random.Next() % m_MaxBurst;
+            for(; burst>0 && m_NumEventsLeft>0 ; burst--, m_NumEventsLeft--)
+            {
+                RenderEvent event = {};
+                const uint kind = m_Random.Next() % 20;
+                if( kind < 12 )
+                {
+                    event.type = kRenderEventSetParameter;
+                    event.id = m_Random.Next() % kNumRenderParameters;
+                    event.x = event.id == kParameterPrimitive ? (float)(m_Random.Next() % (kPrimitiveBox + 1)) : m_Random.NextFloat( 0.0f, 2.0f );
+                }
+                else if( kind < 17 )
+                {
+                    event.type = kRenderEventOrbitCamera;
+                    event.x = m_Random.NextFloat( -0.05f, 0.05f );
+                    event.y = m_Random.NextFloat( -0.05f, 0.05f );
+                }
+                else if( kind < 19 )
+                {
+                    event.type = kRenderEventZoomCamera;
+                    event.x = m_Random.NextFloat( -0.5f, 0.5f );
+                }
+                else
+                {
+                    event.type = kRenderEventPlatform;
+                    event.id = m_Random.Next();
+                    event.data0 = m_NumPlatformEvents++;
+                }
+
+                ApplyRenderEvent( event, m_Settings, m_Camera );
+                renderThread.PostEvent( event );
+            }
+            return m_NumEventsLeft > 0;
+        }
+
+        const ExplosionSettings& GetSettings() const { return m_Settings; }
+        const OrbitCamera& GetCamera() const { return m_Camera; }
+        uint64_t GetNumPlatformEvents() const { return m_NumPlatformEvents; }
+
+    private:
+        uint64_t m_NumEventsLeft;
+        uint m_MaxBurst;
+        EventRandom m_Random;
+        ExplosionSettings m_Settings;
+        OrbitCamera m_Camera;
+        uint64_t m_NumPlatformEvents;
+    };
+
+    // Renders every frame on the CPU at a small size, and checks the platform
+    //  events arrive in the order they were posted.
+    class StressFrameRenderer : public IFrameRenderer
+    {
+    public:
+        StressFrameRenderer( const SceneTextures& textures, uint width, uint height )
+            : m_pTextures(&textures)
+            , m_Renderer(CpuRenderSettings())
+            , m_Width(width)
+            , m_Height(height)
+            , m_NumPlatformEvents(0)
+            , m_NumPlatformErrors(0)
+        {
+        }
+
+        virtual void OnPlatformEvent( const RenderEvent& event )
+        {
+            if( event.data0 != m_NumPlatformEvents ) m_NumPlatformErrors++;
+            m_NumPlatformEvents++;
+        }
+
+        virtual void RenderFrame( const ExplosionSettings& settings, const OrbitCamera& camera )
+        {
+            if( m_Width == 0 || m_Height == 0 ) return;
+
+            ExplosionParams params;
+            BuildExplosionParams( settings, camera, 3.3f, m_Width, m_Height, m_pTextures->noiseVolume.GetLargestAbsoluteValue(), params );
+            m_Renderer.RenderFrame( params, *m_pTextures, m_Image, nullptr, nullptr, &m_Arenas );
+        }
+
+        uint64_t GetNumPlatformEvents() const { return m_NumPlatformEvents; }
+        uint64_t GetNumPlatformErrors() const { return m_NumPlatformErrors; }
+
+    private:
+        const SceneTextures* m_pTextures;
+        CpuRenderer m_Renderer;
+        FrameArenas m_Arenas;
+        uint m_Width, m_Height;
+        Image m_Image;
+        uint64_t m_NumPlatformEvents;
+        uint64_t m_NumPlatformErrors;
+    };
+
+    bool IsSameState( const ExplosionSettings& a, const OrbitCamera& cameraA, const ExplosionSettings& b, const OrbitCamera& cameraB )
+    {
+        return a.enableHullShrinking == b.enableHullShrinking && a.adaptiveHullShrinking == b.adaptiveHullShrinking &&
+               a.adaptiveStepping == b.adaptiveStepping && a.octaveCulling == b.octaveCulling && a.ditheredStart == b.ditheredStart &&
+               a.stepSizeScale == b.stepSizeScale &&
+               a.edgeSoftness == b.edgeSoftness && a.noiseScale == b.noiseScale &&
+               a.explosionRadius == b.explosionRadius && a.displacementAmount == b.displacementAmount &&
+               a.uvScaleBias.x == b.uvScaleBias.x && a.uvScaleBias.y == b.uvScaleBias.y &&
+               a.noiseAmplitudeFactor == b.noiseAmplitudeFactor && a.noiseFrequencyFactor == b.noiseFrequencyFactor &&
+               a.primitive == b.primitive && a.selfShadowing == b.selfShadowing &&
+               cameraA.theta == cameraB.theta && cameraA.phi == cameraB.phi && cameraA.radius == cameraB.radius;
+    }
+}
+
+int RenderThreadStressMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint64_t numEvents = commandLine.GetUint( "events", 1000000 );
+    const uint numRuns = commandLine.GetUint( "runs", 4 );
+    const uint maxBurst = commandLine.GetUint( "burst", 64 );
+    if( numRuns == 0 || maxBurst == 0 )
+    {
+        fprintf( stderr, "Usage: render-thread-stress [-events 1000000] [-runs 4] [-burst 64] [-capacity 256] [-width 16] [-height 12]\n" );
+        return 1;
+    }
+    const uint capacity = commandLine.GetUint( "capacity", 256 );
+    const uint width = commandLine.GetUint( "width", 16 );
+    const uint height = commandLine.GetUint( "height", 12 );
+
+    printf( "%u runs of %llu events, bursts of up to %u, queue of %u, %ux%u frames.\n", numRuns, (unsigned long long)numEvents, maxBurst,
+            RenderEventQueue( capacity ).GetCapacity(), width, height );
+    printf( "Run,  events/s, frames, events/frame, max depth, stalls, errors, state\n" );
+
+    bool isPass = true;
+    for(uint run=0 ; run<numRuns ; run++)
+    {
+        SyntheticPlatformLoop loop( numEvents, maxBurst, 0x9E3779B9u + run );
+        StressFrameRenderer renderer( textures, width, height );
+        RenderThread renderThread( renderer, capacity, ExplosionSettings(), OrbitCamera() );
+
+        Timer timer;
+        renderThread.Start();
+        renderThread.RunPlatformLoop( loop );
+        const double seconds = timer.GetElapsedSeconds();
+
+        const RenderThreadStats& stats = renderThread.GetStats();
+        const uint64_t numErrors = stats.numSequenceErrors + renderer.GetNumPlatformErrors() +
+                                   (renderer.GetNumPlatformEvents() != loop.GetNumPlatformEvents() ? 1 : 0) +
+                                   (stats.numEvents != numEvents + 1 ? 1 : 0);
+        const bool isSameState = IsSameState( renderThread.GetSettings(), renderThread.GetCamera(), loop.GetSettings(), loop.GetCamera() );
+        isPass = isPass && numErrors == 0 && isSameState;
+
+        printf( "%3u, %9.0f, %6llu, %12.1f, %9u, %6llu, %6llu, %s\n", run, stats.numEvents / seconds, (unsigned long long)stats.numFrames,
+                (double)stats.numEvents / Max( (float)stats.numFrames, 1.0f ), stats.maxQueueDepth, (unsigned long long)stats.numProducerStalls,
+                (unsigned long long)numErrors, isSameState ? "match" : "MISMATCH" );
+    }
+
+    printf( "%s\n", isPass ? "PASS" : "FAIL" );
+    return isPass ? 0 : 1;
+}
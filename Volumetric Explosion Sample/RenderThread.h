@@ -0,0 +1,159 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+//--------------------------------------------------------------------------------------
+// Dedicated render thread.  The thread that owns the window only pumps the
+//  platform's messages (an IPlatformLoop) and posts what the renderer needs to
+//  know as RenderEvents through an SpscQueue; the render thread drains the queue
+//  before every frame and applies the events to its own copy of the settings, so
+//  a slow frame never holds up input and no state is shared between the two.
+//
+//  Events that aren't parameter or camera changes, e.g. raw window messages for
+//  the UI, are passed to the IFrameRenderer on the render thread as they arrive.
+//--------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <thread>
+
+#include "ExplosionSettings.h"
+#include "SpscQueue.h"
+
+class CommandLine;
+
+enum RenderEventType
+{
+    kRenderEventSetParameter,       // id = RenderParameter, x = new value.
+    kRenderEventOrbitCamera,        // x, y = change in theta and phi, radians.
+    kRenderEventZoomCamera,         // x = change in radius.
+    kRenderEventPlatform,           // id, data0, data1 = the platform's message.
+    kRenderEventQuit
+};
+
+enum RenderParameter
+{
+    kParameterHullShrinking,        // 0 or 1.
+    kParameterEdgeSoftness,
+    kParameterNoiseScale,
+    kParameterExplosionRadius,
+    kParameterDisplacement,
+    kParameterUvScale,
+    kParameterUvBias,
+    kParameterAmplitudeFactor,
+    kParameterFrequencyFactor,
+    kParameterPrimitive,            // A PrimitiveType.
+    kParameterSelfShadowing,
+    kParameterAdaptiveHull,         // 0 or 1.
+    kParameterAdaptiveSteps,        // 0 or 1.
+    kParameterOctaveCulling,        // 0 or 1.
+    kParameterDitheredStart,        // 0 or 1.
+    kParameterStepScale,
+    kNumRenderParameters
+};
+
+struct RenderEvent
+{
+    RenderEventType type;
+    uint id;
+    float x, y;
+    uint64_t data0, data1;
+    uint sequence;                  // Numbered by RenderThread::PostEvent.
+};
+
+typedef SpscQueue<RenderEvent> RenderEventQueue;
+
+// Applies a parameter or camera event, clamping the camera to the sample's orbit.
+//  Returns false for the other event types.
+bool ApplyRenderEvent( const RenderEvent& event, ExplosionSettings& settings, OrbitCamera& camera );
+
+// The value a kRenderEventSetParameter event would have set, so a UI can show it.
+float GetRenderParameter( const ExplosionSettings& settings, RenderParameter parameter );
+
+class RenderThread;
+
+// The window's message loop.  Runs on the thread that created the window.
+class IPlatformLoop
+{
+public:
+    virtual ~IPlatformLoop() {}
+
+    // Handles pending messages, posting events to renderThread, and returns false
+    //  once the application should quit.  May block waiting for messages.
+    virtual bool PumpEvents( RenderThread& renderThread ) = 0;
+};
+
+// Everything that happens on the render thread.
+class IFrameRenderer
+{
+public:
+    virtual ~IFrameRenderer() {}
+
+    virtual void OnRenderThreadStart() {}
+    virtual void OnPlatformEvent( const RenderEvent& /*event*/ ) {}
+    virtual void RenderFrame( const ExplosionSettings& settings, const OrbitCamera& camera ) = 0;
+    virtual void OnRenderThreadStop() {}
+};
+
+struct RenderThreadStats
+{
+    uint64_t numEvents;             // Consumed by the render thread.
+    uint64_t numFrames;
+    uint64_t numProducerStalls;     // PostEvent calls that found the queue full.
+    uint maxQueueDepth;             // Seen by the render thread before draining.
+    uint numSequenceErrors;         // Events lost, repeated or reordered; always 0.
+
+    RenderThreadStats();
+};
+
+class RenderThread
+{
+public:
+    RenderThread( IFrameRenderer& renderer, uint queueCapacity, const ExplosionSettings& settings, const OrbitCamera& camera );
+    ~RenderThread();
+
+    void Start();
+
+    // Posts kRenderEventQuit and waits for the render thread to finish.  Does
+    //  nothing if it isn't running, so the platform can stop it early, e.g. before
+    //  its window is destroyed.
+    void Stop();
+    bool IsRunning() const { return m_Thread.joinable(); }
+
+    // Calls loop.PumpEvents on this thread until it returns false, then stops.
+    void RunPlatformLoop( IPlatformLoop& loop );
+
+    // Producer side: queues an event, yielding while the queue is full.
+    void PostEvent( const RenderEvent& event );
+    void PostParameter( RenderParameter parameter, float value );
+
+    // Render thread side: applies a parameter or camera event raised while handling
+    //  a platform event, e.g. by the UI, before the next frame is rendered.  The
+    //  queue only runs the other way, so these don't go through it.
+    void ApplyEvent( const RenderEvent& event );
+    void ApplyParameter( RenderParameter parameter, float value );
+
+    // The render thread's state; only to be read on the render thread, or once it
+    //  has stopped.
+    const RenderThreadStats& GetStats() const { return m_Stats; }
+    const ExplosionSettings& GetSettings() const { return m_Settings; }
+    const OrbitCamera& GetCamera() const { return m_Camera; }
+
+private:
+    void ThreadMain();
+
+    IFrameRenderer& m_Renderer;
+    RenderEventQueue m_Events;
+    std::thread m_Thread;
+    uint m_NextSequence;            // Producer side.
+
+    // Render thread side.
+    ExplosionSettings m_Settings;
+    OrbitCamera m_Camera;
+    RenderThreadStats m_Stats;
+    uint64_t m_NumProducerStalls;   // Producer side, merged into m_Stats by Stop.
+
+    RenderThread( const RenderThread& );
+    RenderThread& operator=( const RenderThread& );
+};
+
+int RenderThreadStressMain( const CommandLine& commandLine );
+
+#endif // RENDER_THREAD_H
@@ -0,0 +1,1467 @@
+#include "RendererBench.h"
+#include "CoarseTiles.h"
+#include "CpuHull.h"
+#include "CpuRenderer.h"
+#include "ExplosionSettings.h"
+#include "FrameArena.h"
+#include "Headless.h"
+#include "HullRasteriser.h"
+#include "ThreadPool.h"
+#include "TileScheduler.h"
+#include "Timer.h"
+#include "VariableRate.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+// The frame every benchmark renders, adjustable from the command line.
+static void BuildBenchParams( const CommandLine& commandLine, const SceneTextures& textures, ExplosionParams& params )
+{
+    OrbitCamera camera;
+    camera.phi = PI * 0.5f;
+    camera.radius = commandLine.GetFloat( "radius", camera.radius );
+
+    BuildExplosionParams( ExplosionSettings(), camera, commandLine.GetFloat( "time", 3.3f ), commandLine.GetUint( "width", kResolutionX ),
+                          commandLine.GetUint( "height", kResolutionY ), textures.noiseVolume.GetLargestAbsoluteValue(), params );
+}
+
+static float GetMaxDifference( const Image& a, const Image& b )
+{
+    float maxDifference = 0;
+    for(uint y=0 ; y<a.GetHeight() ; y++)
+    {
+        for(uint x=0 ; x<a.GetWidth() ; x++)
+        {
+            const Vec4 difference = a.At( x, y ) - b.At( x, y );
+            maxDifference = Max( maxDifference, Max( Max( fabsf( difference.x ), fabsf( difference.y ) ), Max( fabsf( difference.z ), fabsf( difference.w ) ) ) );
+        }
+    }
+    return maxDifference;
+}
+
+static void PrintMarchStats( const char* pName, uint simdWidth, const RenderStats& stats, float maxDifference )
+{
+    printf( "%-10s %5u, %9.2f, %8.2f, %11.1f%%, %9.2g\n", pName, simdWidth, stats.milliseconds,
+            stats.numSteps / (stats.milliseconds * 1000.0), 100.0 * stats.numSteps / Max( (float)stats.numLaneSlots, 1.0f ), maxDifference );
+}
+
+int MarchBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    ExplosionParams params;
+    BuildBenchParams( commandLine, textures, params );
+
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+
+    CpuRenderSettings settings;
+    settings.tileSize = commandLine.GetUint( "tile", settings.tileSize );
+    settings.stepsPerRound = commandLine.GetUint( "round", settings.stepsPerRound );
+
+    printf( "%ux%u on %u threads, %u steps per wavefront round.\n", (uint)params.g_ScreenParams.x, (uint)params.g_ScreenParams.y,
+            pool.GetNumThreads(), settings.stepsPerRound );
+    printf( "Mode       width,        ms, Msteps/s, lane usage, max error\n" );
+
+    const uint simdWidths[] = { 4, 8, 16 };
+    for(size_t i=0 ; i<sizeof(simdWidths)/sizeof(simdWidths[0]) ; i++)
+    {
+        settings.simdWidth = simdWidths[i];
+
+        Image tileImage, wavefrontImage;
+        RenderStats tileStats, wavefrontStats;
+
+        settings.marchMode = kMarchTiles;
+        CpuRenderer( settings ).RenderFrame( params, textures, tileImage, &pool, &tileStats );
+
+        settings.marchMode = kMarchWavefront;
+        CpuRenderer( settings ).RenderFrame( params, textures, wavefrontImage, &pool, &wavefrontStats );
+
+        PrintMarchStats( "tiles", settings.simdWidth, tileStats, 0.0f );
+        PrintMarchStats( "wavefront", settings.simdWidth, wavefrontStats, GetMaxDifference( tileImage, wavefrontImage ) );
+    }
+    return 0;
+}
+
+// List schedules tiles of the given costs onto numThreads threads in order, each
+//  going to the thread that frees up first, and returns the time the last finishes.
+static uint64_t SimulateMakespan( const std::vector<uint64_t>& tileCosts, uint numThreads )
+{
+    std::vector<uint64_t> threadEnds( numThreads, 0 );
+    for(size_t i=0 ; i<tileCosts.size() ; i++)
+    {
+        *std::min_element( threadEnds.begin(), threadEnds.end() ) += tileCosts[i];
+    }
+    return *std::max_element( threadEnds.begin(), threadEnds.end() );
+}
+
+int ScheduleBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    // The scheduler predicts each frame from the one before, so it is measured on
+    //  the second of two consecutive animation frames.
+    ExplosionParams previousParams, params;
+    BuildBenchParams( commandLine, textures, params );
+    previousParams = params;
+    previousParams.g_Time -= commandLine.GetFloat( "dt", 1.0f / 60.0f );
+
+    const uint maxThreads = commandLine.GetUint( "max-threads", 64 );
+    const CpuRenderer renderer( (CpuRenderSettings()) );
+    const uint tileSize = renderer.GetSettings().tileSize;
+
+    printf( "%ux%u, %u hardware threads; work stealing predicted from t=%.3f.\n", (uint)params.g_ScreenParams.x, (uint)params.g_ScreenParams.y,
+            ThreadPool::GetHardwareThreadCount(), previousParams.g_Time );
+    printf( "Measured: threads, shared ms, stealing ms, tiles, steals,  idle\n" );
+
+    TileScheduler scheduler;
+    for(uint numThreads=1 ; numThreads<=maxThreads ; numThreads*=2)
+    {
+        ThreadPool pool( numThreads );
+
+        Image image;
+        RenderStats sharedStats, stealingStats;
+        renderer.RenderFrame( params, textures, image, &pool, &sharedStats );
+
+        SchedulerStats schedulerStats;
+        scheduler.Reset();
+        scheduler.RenderFrame( renderer, previousParams, textures, image, pool, nullptr, nullptr );
+        scheduler.RenderFrame( renderer, params, textures, image, pool, &stealingStats, &schedulerStats );
+
+        printf( "          %7u, %9.2f, %11.2f, %5u, %6u, %4.1f%%\n", numThreads, sharedStats.milliseconds, stealingStats.milliseconds,
+                schedulerStats.numItems, schedulerStats.numSteals, schedulerStats.GetIdlePercentage() );
+    }
+
+    // The same comparison independent of this machine's core count: the cells' real
+    //  costs (pixels plus steps) in the measured frame, list scheduled as the shared
+    //  queue hands out fixed tiles in raster order, and as the stealing scheduler's
+    //  plan from the previous frame, heaviest first.
+    const uint numCellsX = scheduler.GetNumCellsX();
+    const uint numCellsY = scheduler.GetNumCellsY();
+    const uint tileCells = Max( tileSize / kCostCellSize, 1.0f );
+
+    std::vector<uint64_t> sharedCosts;
+    for(uint cellY=0 ; cellY<numCellsY ; cellY+=tileCells)
+    {
+        for(uint cellX=0 ; cellX<numCellsX ; cellX+=tileCells)
+        {
+            sharedCosts.push_back( scheduler.GetCellCost( cellX, cellY, Min( cellX + tileCells, numCellsX ), Min( cellY + tileCells, numCellsY ) ) );
+        }
+    }
+    const uint64_t totalCost = scheduler.GetCellCost( 0, 0, numCellsX, numCellsY );
+
+    printf( "Simulated (cost = pixels + steps, %llu total, %ux%u shared tiles):\n", (unsigned long long)totalCost, tileSize, tileSize );
+    printf( "  threads, shared speed-up,  idle, stealing speed-up,  idle\n" );
+
+    // Plan from the previous frame, then cost the plan with the measured frame.
+    TileScheduler planner;
+    {
+        ThreadPool pool( 0 );
+        Image image;
+        planner.RenderFrame( renderer, previousParams, textures, image, pool, nullptr, nullptr );
+    }
+
+    for(uint numThreads=1 ; numThreads<=maxThreads ; numThreads*=2)
+    {
+        std::vector<ScheduledTile> plan;
+        planner.PlanFrame( (uint)params.g_ScreenParams.x, (uint)params.g_ScreenParams.y, numThreads, plan );
+
+        std::vector<uint64_t> stealingCosts( plan.size() );
+        for(size_t i=0 ; i<plan.size() ; i++)
+        {
+            stealingCosts[i] = scheduler.GetCellCost( plan[i].cellX0, plan[i].cellY0, plan[i].cellX1, plan[i].cellY1 );
+        }
+
+        const uint64_t sharedMakespan = SimulateMakespan( sharedCosts, numThreads );
+        const uint64_t stealingMakespan = SimulateMakespan( stealingCosts, numThreads );
+        printf( "  %7u, %16.2f, %4.1f%%, %18.2f, %4.1f%%\n", numThreads,
+                (double)totalCost / sharedMakespan, 100.0 * (1.0 - (double)totalCost / ((double)sharedMakespan * numThreads)),
+                (double)totalCost / stealingMakespan, 100.0 * (1.0 - (double)totalCost / ((double)stealingMakespan * numThreads)) );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Noise precision
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // Scenes the half precision paths are checked against: every primitive at
+    //  two points in the animation, plus a close-up where errors are magnified.
+    struct GoldenScene
+    {
+        const char* pName;
+        PrimitiveType primitive;
+        float time;
+        float cameraRadius;
+    };
+
+    const GoldenScene kGoldenScenes[] =
+    {
+        { "sphere",         kPrimitiveSphere,   1.0f, 10.0f },
+        { "sphere-late",    kPrimitiveSphere,   6.0f, 10.0f },
+        { "sphere-close",   kPrimitiveSphere,   3.3f,  5.0f },
+        { "cylinder",       kPrimitiveCylinder, 3.3f, 10.0f },
+        { "cone",           kPrimitiveCone,     3.3f, 10.0f },
+        { "torus",          kPrimitiveTorus,    3.3f, 10.0f },
+        { "box",            kPrimitiveBox,      3.3f, 10.0f },
+    };
+
+    // Root mean square difference over all four channels.
+    float GetRmsDifference( const Image& a, const Image& b )
+    {
+        double sum = 0;
+        for(uint y=0 ; y<a.GetHeight() ; y++)
+        {
+            for(uint x=0 ; x<a.GetWidth() ; x++)
+            {
+                const Vec4 d = a.At( x, y ) - b.At( x, y );
+                sum += d.x * d.x + d.y * d.y + d.z * d.z + d.w * d.w;
+            }
+        }
+        return (float)sqrt( sum / (4.0 * a.GetWidth() * a.GetHeight()) );
+    }
+}
+
+int PrecisionBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint width = commandLine.GetUint( "width", kResolutionX / 4 );
+    const uint height = commandLine.GetUint( "height", kResolutionY / 4 );
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+
+    CpuRenderSettings settings;
+    const char* kPrecisionNames[] = { "fp32", "half texels", "half" };
+
+    printf( "%ux%u, F16C %s.\n", width, height, CPU_MATH_F16C ? "enabled" : "disabled (software conversion)" );
+    printf( "Scene,          fp32 ms, texels ms, half ms, texels err, half max err, half rms,  PSNR, step delta\n" );
+
+    double totalMilliseconds[3] = { 0, 0, 0 };
+    float worstMaxError = 0, worstRmsError = 0;
+    for(size_t i=0 ; i<sizeof(kGoldenScenes)/sizeof(kGoldenScenes[0]) ; i++)
+    {
+        const GoldenScene& scene = kGoldenScenes[i];
+
+        ExplosionSettings explosionSettings;
+        explosionSettings.primitive = scene.primitive;
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+        camera.radius = scene.cameraRadius;
+
+        ExplosionParams params;
+        BuildExplosionParams( explosionSettings, camera, scene.time, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+
+        Image images[3];
+        RenderStats stats[3];
+        for(uint precision=0 ; precision<3 ; precision++)
+        {
+            settings.noisePrecision = (NoisePrecision)precision;
+            CpuRenderer( settings ).RenderFrame( params, textures, images[precision], &pool, &stats[precision] );
+            totalMilliseconds[precision] += stats[precision].milliseconds;
+        }
+
+        const float texelsError = GetMaxDifference( images[kNoisePrecisionFloat], images[kNoisePrecisionHalfTexels] );
+        const float maxError = GetMaxDifference( images[kNoisePrecisionFloat], images[kNoisePrecisionHalf] );
+        const float rmsError = GetRmsDifference( images[kNoisePrecisionFloat], images[kNoisePrecisionHalf] );
+        const float psnr = rmsError > 0.0f ? 20.0f * log10f( 1.0f / rmsError ) : 999.0f;
+        worstMaxError = Max( worstMaxError, maxError );
+        worstRmsError = Max( worstRmsError, rmsError );
+
+        printf( "%-13s %8.2f, %9.2f, %7.2f, %10.2g, %12.4f, %8.5f, %5.1f, %+9.3f%%\n", scene.pName, stats[0].milliseconds, stats[1].milliseconds,
+                stats[2].milliseconds, texelsError, maxError, rmsError, psnr,
+                100.0 * ((double)stats[2].numSteps / (double)stats[0].numSteps - 1.0) );
+    }
+
+    printf( "Total ms: " );
+    for(uint precision=0 ; precision<3 ; precision++) printf( "%s %.1f%s", kPrecisionNames[precision], totalMilliseconds[precision], precision < 2 ? ", " : "\n" );
+    printf( "Worst half error: max %.4f, rms %.5f\n", worstMaxError, worstRmsError );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Noise quantisation
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // Noise lookups in the order a march makes them: short runs of steps along
+    //  random rays, each step fetching every octave at its own frequency.
+    void BuildNoiseAccessPattern( const ExplosionParams& params, uint numRays, std::vector<Vec3>& uvws )
+    {
+        const uint kStepsPerRay = 64;
+        const float stepUvw = params.g_StepSizeWS * params.g_NoiseScale;
+
+        uint32_t state = 12345;
+        auto random = [&]() -> float
+        {
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) * (1.0f / 16777216.0f);
+        };
+
+        uvws.clear();
+        uvws.reserve( numRays * kStepsPerRay * params.g_NumOctaves );
+        for(uint ray=0 ; ray<numRays ; ray++)
+        {
+            const Vec3 start( random(), random(), random() );
+            const Vec3 direction = Normalize( Vec3( random() - 0.5f, random() - 0.5f, random() - 0.5f ) );
+            for(uint step=0 ; step<kStepsPerRay ; step++)
+            {
+                Vec3 uvw = start + direction * (step * stepUvw);
+                for(uint octave=0 ; octave<params.g_NumOctaves ; octave++)
+                {
+                    uvws.push_back( uvw );
+                    uvw *= params.g_NoiseFrequencyFactor;
+                }
+            }
+        }
+    }
+
+    // Nanoseconds per lookup, the best of a few passes to ride out other load.
+    template <typename SampleFunction>
+    double TimeNoiseFetches( const std::vector<Vec3>& uvws, SampleFunction sample, float& checksum, uint numPasses = 3 )
+    {
+        double bestSeconds = 0;
+        for(uint pass=0 ; pass<numPasses ; pass++)
+        {
+            Timer timer;
+            float sum = 0;
+            for(size_t i=0 ; i<uvws.size() ; i++) sum += sample( uvws[i] );
+            checksum += sum;
+
+            const double seconds = timer.GetElapsedSeconds();
+            bestSeconds = (pass == 0 || seconds < bestSeconds) ? seconds : bestSeconds;
+        }
+        return bestSeconds * 1e9 / uvws.size();
+    }
+}
+
+int QuantiseBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint maxSize = commandLine.GetUint( "max-size", 256 );
+    const uint width = commandLine.GetUint( "width", kResolutionX / 4 );
+    const uint height = commandLine.GetUint( "height", kResolutionY / 4 );
+
+    ExplosionParams params;
+    BuildExplosionParams( ExplosionSettings(), OrbitCamera(), 3.3f, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+
+    const NoiseVolume& loadedVolume = textures.noiseVolume;
+    printf( "8-bit noise: value = unorm * %.6f %+.6f (step %.6f)\n", loadedVolume.GetUnormScale(), loadedVolume.GetUnormBias(),
+            loadedVolume.GetUnormScale() / 255.0f );
+
+    // Fetch cost at several volume sizes, all holding the same noise.
+    std::vector<Vec3> uvws;
+    BuildNoiseAccessPattern( params, commandLine.GetUint( "rays", 4096 ), uvws );
+
+    printf( "Size,  R32F MB, ns/fetch,  R16F MB, ns/fetch,  R8 MB, ns/fetch, R8 max error\n" );
+    float checksum = 0;
+    for(uint size=loadedVolume.GetSize() ; size<=maxSize ; size*=2)
+    {
+        NoiseVolume volume;
+        if( size == loadedVolume.GetSize() ) volume = loadedVolume;
+        else volume.Resample( loadedVolume, size );
+
+        const double floatNs = TimeNoiseFetches( uvws, [&]( const Vec3& uvw ) { return volume.Sample( uvw ); }, checksum );
+        const double halfNs = TimeNoiseFetches( uvws, [&]( const Vec3& uvw ) { return volume.SampleHalf( uvw ); }, checksum );
+        const double unormNs = TimeNoiseFetches( uvws, [&]( const Vec3& uvw ) { return volume.SampleUnorm8( uvw ); }, checksum );
+
+        // Filtering is linear, so the largest error is at the texels themselves.
+        float maxError = 0;
+        for(uint i=0 ; i<size ; i++)
+        {
+            const Vec3 uvw = (Vec3( (float)i, (float)(i * 7 % size), (float)(i * 13 % size) ) + Vec3( 0.5f )) * (1.0f / size);
+            maxError = Max( maxError, fabsf( volume.SampleUnorm8( uvw ) - volume.Sample( uvw ) ) );
+        }
+
+        const double numTexels = (double)size * size * size;
+        printf( "%4u, %8.2f, %8.2f, %8.2f, %8.2f, %6.2f, %8.2f, %12.5f\n", size, numTexels * 4 / 1048576.0, floatNs, numTexels * 2 / 1048576.0, halfNs,
+                numTexels / 1048576.0, unormNs, maxError );
+    }
+
+    // Whole frames over the golden scenes with the loaded volume.
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+    CpuRenderSettings settings;
+
+    printf( "Scene,          fp32 ms, R8 ms, max error,  rms error,  PSNR\n" );
+    for(size_t i=0 ; i<sizeof(kGoldenScenes)/sizeof(kGoldenScenes[0]) ; i++)
+    {
+        const GoldenScene& scene = kGoldenScenes[i];
+
+        ExplosionSettings explosionSettings;
+        explosionSettings.primitive = scene.primitive;
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+        camera.radius = scene.cameraRadius;
+        BuildExplosionParams( explosionSettings, camera, scene.time, width, height, loadedVolume.GetLargestAbsoluteValue(), params );
+
+        Image floatImage, unormImage;
+        RenderStats floatStats, unormStats;
+        settings.noisePrecision = kNoisePrecisionFloat;
+        CpuRenderer( settings ).RenderFrame( params, textures, floatImage, &pool, &floatStats );
+        settings.noisePrecision = kNoisePrecisionUnorm8Texels;
+        CpuRenderer( settings ).RenderFrame( params, textures, unormImage, &pool, &unormStats );
+
+        const float rmsError = GetRmsDifference( floatImage, unormImage );
+        printf( "%-13s %8.2f, %5.0f, %9.4f, %10.5f, %5.1f\n", scene.pName, floatStats.milliseconds, unormStats.milliseconds,
+                GetMaxDifference( floatImage, unormImage ), rmsError, rmsError > 0.0f ? 20.0f * log10f( 1.0f / rmsError ) : 999.0f );
+    }
+
+    printf( "(checksum %g)\n", checksum );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Noise volume layouts
+//--------------------------------------------------------------------------------------
+int LayoutBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint maxSize = commandLine.GetUint( "max-size", 256 );
+    const uint width = commandLine.GetUint( "width", kResolutionX / 8 );
+    const uint height = commandLine.GetUint( "height", kResolutionY / 8 );
+    const size_t maxFetches = commandLine.GetUint( "max-fetches", 8 << 20 );
+
+    // Real lookups: every noise fetch made while marching the golden scenes, in
+    //  the order a single thread makes them.
+    std::vector<Vec3> traceUvws;
+    const NoiseVolume& loadedVolume = textures.noiseVolume;
+    CpuRenderer renderer( (CpuRenderSettings()) );
+    for(size_t i=0 ; i<sizeof(kGoldenScenes)/sizeof(kGoldenScenes[0]) && traceUvws.size()<maxFetches ; i++)
+    {
+        const GoldenScene& scene = kGoldenScenes[i];
+
+        ExplosionSettings explosionSettings;
+        explosionSettings.primitive = scene.primitive;
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+        camera.radius = scene.cameraRadius;
+        ExplosionParams params;
+        BuildExplosionParams( explosionSettings, camera, scene.time, width, height, loadedVolume.GetLargestAbsoluteValue(), params );
+
+        ExplosionEvaluator evaluator( params, textures );
+        evaluator.SetNoiseTrace( &traceUvws );
+        Image image;
+        image.Resize( width, height );
+        RenderStats stats;
+        renderer.RenderTile( evaluator, 0, 0, width, height, image, stats );
+    }
+    if( traceUvws.size() > maxFetches ) traceUvws.resize( maxFetches );
+
+    // The synthetic pattern from quantise-bench, for comparison.
+    ExplosionParams params;
+    BuildExplosionParams( ExplosionSettings(), OrbitCamera(), 3.3f, width, height, loadedVolume.GetLargestAbsoluteValue(), params );
+    std::vector<Vec3> rayUvws;
+    BuildNoiseAccessPattern( params, commandLine.GetUint( "rays", 4096 ), rayUvws );
+
+    printf( "%u traced fetches from %ux%u frames, %u synthetic\n", (uint)traceUvws.size(), width, height, (uint)rayUvws.size() );
+    printf( "ns per fp32 fetch (trace / synthetic rays)\n" );
+    printf( "Size,      linear,     bricked,      morton,      padded, max difference\n" );
+
+    const NoiseVolumeLayout kLayouts[] = { kNoiseLayoutLinear, kNoiseLayoutBricked, kNoiseLayoutMorton, kNoiseLayoutPadded };
+    const char* const kLayoutNames[] = { "linear", "bricked", "morton", "padded" };
+    float checksum = 0;
+    for(uint size=loadedVolume.GetSize() ; size<=maxSize ; size*=2)
+    {
+        NoiseVolume volume;
+        volume.Resample( loadedVolume, size );
+
+        // The order only moves texels, so every layout must return the same values.
+        std::vector<float> linearValues( Min( (uint)traceUvws.size(), 65536u ) );
+        for(size_t i=0 ; i<linearValues.size() ; i++) linearValues[i] = volume.Sample( traceUvws[i] );
+
+        printf( "%4u", size );
+        float maxDifference = 0;
+        for(uint layout=0 ; layout<sizeof(kLayouts)/sizeof(kLayouts[0]) ; layout++)
+        {
+            volume.SetLayout( kLayouts[layout] );
+            for(size_t i=0 ; i<linearValues.size() ; i++) maxDifference = Max( maxDifference, fabsf( volume.Sample( traceUvws[i] ) - linearValues[i] ) );
+
+            const double traceNs = TimeNoiseFetches( traceUvws, [&]( const Vec3& uvw ) { return volume.Sample( uvw ); }, checksum );
+            const double rayNs = TimeNoiseFetches( rayUvws, [&]( const Vec3& uvw ) { return volume.Sample( uvw ); }, checksum );
+            printf( ", %5.2f/%5.2f", traceNs, rayNs );
+        }
+        printf( ", %g\n", maxDifference );
+    }
+
+    // The fetch kernel alone: a few thousand traced lookups into the 32^3 volume,
+    //  all in L1, so that addressing is all that differs.  The layouts take turns
+    //  over many rounds so that all of them see the same machine.
+    const uint kNumLayouts = sizeof(kLayouts) / sizeof(kLayouts[0]);
+    const std::vector<Vec3> kernelUvws( traceUvws.begin(), traceUvws.begin() + Min( (uint)traceUvws.size(), 4096u ) );
+    std::vector<NoiseVolume> volumes( kNumLayouts, loadedVolume );
+    std::vector<double> floatNs( kNumLayouts, 1e9 ), halfNs( kNumLayouts, 1e9 );
+    for(uint round=0 ; round<50 ; round++)
+    {
+        for(uint layout=0 ; layout<kNumLayouts ; layout++)
+        {
+            const NoiseVolume& volume = volumes[layout];
+            if( round == 0 ) volumes[layout].SetLayout( kLayouts[layout] );
+            floatNs[layout] = std::min( floatNs[layout], TimeNoiseFetches( kernelUvws, [&]( const Vec3& uvw ) { return volume.Sample( uvw ); }, checksum, 10 ) );
+            halfNs[layout] = std::min( halfNs[layout], TimeNoiseFetches( kernelUvws, [&]( const Vec3& uvw ) { return volume.SampleHalf( uvw ); }, checksum, 10 ) );
+        }
+    }
+    printf( "Kernel, ns per fetch:  " );
+    for(uint layout=0 ; layout<kNumLayouts ; layout++)
+    {
+        printf( "%s%s %.2f (half %.2f)", layout > 0 ? ", " : "", kLayoutNames[layout], floatNs[layout], halfNs[layout] );
+    }
+    printf( "\n" );
+
+    printf( "(checksum %g)\n", checksum );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Surface normals
+//--------------------------------------------------------------------------------------
+int GradientBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+    textures.noiseVolume.BuildValueGradients();
+
+    const uint numPoints = commandLine.GetUint( "points", 20000 );
+
+    printf( "Normals at %u points in each scene's displacement shell\n", numPoints );
+    float totalChecksum = 0;
+    printf( "Scene,         differences ns, value+gradient ns, speed-up, mean error, 95%% error, max error (degrees)\n" );
+    for(size_t i=0 ; i<sizeof(kGoldenScenes)/sizeof(kGoldenScenes[0]) ; i++)
+    {
+        const GoldenScene& scene = kGoldenScenes[i];
+
+        ExplosionSettings explosionSettings;
+        explosionSettings.primitive = scene.primitive;
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+        camera.radius = scene.cameraRadius;
+        ExplosionParams params;
+        BuildExplosionParams( explosionSettings, camera, scene.time, kResolutionX, kResolutionY, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+
+        const ExplosionEvaluator evaluator( params, textures );
+        const Vec3& centreWS = evaluator.GetExplosionPositionWS();
+        const float innerRadius = evaluator.GetInnerRadius();
+        const float displacementWS = params.g_DisplacementWS;
+        const uint numOctaves = params.g_NumOctaves;
+
+        // Points between the undisplaced shape and its fully displaced bound.
+        uint32_t state = 4321;
+        auto random = [&]() -> float
+        {
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) * (1.0f / 16777216.0f);
+        };
+        std::vector<Vec3> points( numPoints );
+        for(uint point=0 ; point<numPoints ; point++)
+        {
+            const Vec3 direction = Normalize( Vec3( random() - 0.5f, random() - 0.5f, random() - 0.5f ) );
+            points[point] = centreWS + direction * (innerRadius + displacementWS * random());
+        }
+
+        // A quarter of a texel of the finest octave.
+        float finestUvwPerWS = params.g_NoiseScale;
+        for(uint octave=1 ; octave<numOctaves ; octave++) finestUvwPerWS *= params.g_NoiseFrequencyFactor;
+        const float epsilonWS = 0.25f / (textures.noiseVolume.GetSize() * finestUvwPerWS);
+
+        // Central differences: six more DisplacedPrimitive calls for every normal.
+        std::vector<Vec3> differenceNormals( numPoints );
+        float checksum = 0;
+        Timer differenceTimer;
+        for(uint point=0 ; point<numPoints ; point++)
+        {
+            const Vec3& p = points[point];
+            float displacement;
+            checksum += evaluator.DisplacedPrimitive( p, centreWS, innerRadius, displacementWS, numOctaves, displacement );
+            differenceNormals[point] = Vec3(
+                evaluator.DisplacedPrimitive( p + Vec3( epsilonWS, 0, 0 ), centreWS, innerRadius, displacementWS, numOctaves, displacement ) -
+                evaluator.DisplacedPrimitive( p - Vec3( epsilonWS, 0, 0 ), centreWS, innerRadius, displacementWS, numOctaves, displacement ),
+                evaluator.DisplacedPrimitive( p + Vec3( 0, epsilonWS, 0 ), centreWS, innerRadius, displacementWS, numOctaves, displacement ) -
+                evaluator.DisplacedPrimitive( p - Vec3( 0, epsilonWS, 0 ), centreWS, innerRadius, displacementWS, numOctaves, displacement ),
+                evaluator.DisplacedPrimitive( p + Vec3( 0, 0, epsilonWS ), centreWS, innerRadius, displacementWS, numOctaves, displacement ) -
+                evaluator.DisplacedPrimitive( p - Vec3( 0, 0, epsilonWS ), centreWS, innerRadius, displacementWS, numOctaves, displacement ) );
+        }
+        const double differenceNs = differenceTimer.GetElapsedSeconds() * 1e9 / numPoints;
+
+        std::vector<Vec3> gradientNormals( numPoints );
+        Timer gradientTimer;
+        for(uint point=0 ; point<numPoints ; point++)
+        {
+            float displacement;
+            checksum += evaluator.DisplacedPrimitiveAndGradient( points[point], centreWS, innerRadius, displacementWS, numOctaves, displacement, gradientNormals[point] );
+        }
+        const double gradientNs = gradientTimer.GetElapsedSeconds() * 1e9 / numPoints;
+
+        std::vector<float> errorDegrees( numPoints );
+        double sumErrorDegrees = 0;
+        for(uint point=0 ; point<numPoints ; point++)
+        {
+            const float cosine = Dot( Normalize( differenceNormals[point] ), Normalize( gradientNormals[point] ) );
+            errorDegrees[point] = acosf( Clamp( cosine, -1.0f, 1.0f ) ) * (180.0f / PI);
+            sumErrorDegrees += errorDegrees[point];
+        }
+        std::sort( errorDegrees.begin(), errorDegrees.end() );
+
+        printf( "%-13s %15.0f, %17.0f, %7.2fx, %10.2f, %9.2f, %9.2f\n", scene.pName, differenceNs, gradientNs, differenceNs / gradientNs,
+                sumErrorDegrees / numPoints, errorDegrees[numPoints * 95 / 100], errorDegrees[numPoints - 1] );
+        totalChecksum += checksum;
+    }
+
+    printf( "(checksum %g)\n", totalChecksum );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Hull shrink-wrapping
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // Telemetry for one half (front or back) of the hull's vertices.
+    struct HullHalfSummary
+    {
+        std::vector<uint> stepHistogram;    // Vertices by iterations taken.
+        uint numUnconverged;                // Vertices left g_HullConvergenceWS or more from the surface.
+        uint numEvaluations;                // DisplacedPrimitive calls, as in the shader.
+        double meanResidual, maxResidual;
+
+        void Reset( uint maxSteps )
+        {
+            stepHistogram.assign( maxSteps + 1, 0 );
+            numUnconverged = numEvaluations = 0;
+            meanResidual = maxResidual = 0;
+        }
+
+        void Add( uint steps, float residual, float convergenceWS )
+        {
+            stepHistogram[steps]++;
+            numEvaluations += steps;
+            numUnconverged += residual >= convergenceWS ? 1 : 0;
+            meanResidual += residual;
+            maxResidual = residual > maxResidual ? residual : maxResidual;
+        }
+    };
+
+    struct HullSummary
+    {
+        HullHalfSummary front, back;
+        double meanInterval;                // farD - nearD.
+        double meanMarchSteps;              // Steps RenderExplosionPS would take over that interval.
+    };
+
+    void SummariseHull( const ExplosionEvaluator& evaluator, float convergenceWS, bool legacyBackDirection, HullSummary& summary )
+    {
+        const ExplosionParams& params = evaluator.GetParams();
+        std::vector<HullVertex> vertices;
+        EvaluateHull( evaluator, vertices, legacyBackDirection );
+
+        summary.front.Reset( evaluator.GetParams().g_NumHullSteps );
+        summary.back.Reset( evaluator.GetParams().g_NumHullSteps );
+        summary.meanInterval = summary.meanMarchSteps = 0;
+        for(size_t i=0 ; i<vertices.size() ; i++)
+        {
+            const HullVertex& vertex = vertices[i];
+            summary.front.Add( vertex.numFrontSteps, vertex.frontResidual, convergenceWS );
+            summary.back.Add( vertex.numBackSteps, vertex.backResidual, convergenceWS );
+            summary.meanInterval += vertex.farD - vertex.nearD;
+            summary.meanMarchSteps += Clamp( (vertex.farD - vertex.nearD) / params.g_StepSizeWS, 0.0f, (float)params.g_MaxNumSteps );
+        }
+        summary.front.meanResidual /= vertices.size();
+        summary.back.meanResidual /= vertices.size();
+        summary.meanInterval /= vertices.size();
+        summary.meanMarchSteps /= vertices.size();
+    }
+
+    void PrintHullHalf( const char* pName, const HullHalfSummary& half )
+    {
+        printf( "  %-15s %11u, %11u, %13.4f, %12.4f,  steps", pName, half.numEvaluations, half.numUnconverged, half.meanResidual, half.maxResidual );
+        for(size_t steps=1 ; steps<half.stepHistogram.size() ; steps++) printf( " %u:%u", (uint)steps, half.stepHistogram[steps] );
+        printf( "\n" );
+    }
+}
+
+int HullBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint maxSteps = commandLine.GetUint( "max-steps", kMaxNumAdaptiveHullSteps );
+    const float convergenceWS = commandLine.GetFloat( "epsilon", kHullConvergenceWS );
+
+    printf( "Hull of %u vertices, fixed %u steps against adaptive (|dist| < %g, at most %u)\n", (uint)((kTessellationFactor + 1) * (kTessellationFactor + 1)),
+            kNumHullSteps, convergenceWS, maxSteps );
+    printf( "                  evaluations, unconverged, mean residual, max residual\n" );
+    for(size_t i=0 ; i<sizeof(kGoldenScenes)/sizeof(kGoldenScenes[0]) ; i++)
+    {
+        const GoldenScene& scene = kGoldenScenes[i];
+
+        ExplosionSettings explosionSettings;
+        explosionSettings.primitive = scene.primitive;
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+        camera.radius = scene.cameraRadius;
+
+        ExplosionParams fixedParams;
+        BuildExplosionParams( explosionSettings, camera, scene.time, kResolutionX, kResolutionY, textures.noiseVolume.GetLargestAbsoluteValue(), fixedParams );
+        ExplosionParams adaptiveParams = fixedParams;
+        adaptiveParams.g_NumHullSteps = maxSteps;
+        adaptiveParams.g_HullConvergenceWS = convergenceWS;
+
+        // The back half as the shader used to shrink it, along normalize(frontPosWS).
+        HullSummary legacyFixed, fixed, legacyAdaptive, adaptive;
+        SummariseHull( ExplosionEvaluator( fixedParams, textures ), convergenceWS, true, legacyFixed );
+        SummariseHull( ExplosionEvaluator( fixedParams, textures ), convergenceWS, false, fixed );
+        SummariseHull( ExplosionEvaluator( adaptiveParams, textures ), convergenceWS, true, legacyAdaptive );
+        SummariseHull( ExplosionEvaluator( adaptiveParams, textures ), convergenceWS, false, adaptive );
+
+        printf( "%s:\n", scene.pName );
+        printf( "  mean interval   %.4f legacy fixed, %.4f fixed (%+.2f%%), %.4f legacy adaptive, %.4f adaptive (%+.2f%% on legacy fixed)\n",
+                legacyFixed.meanInterval, fixed.meanInterval, 100.0 * (fixed.meanInterval / legacyFixed.meanInterval - 1.0),
+                legacyAdaptive.meanInterval, adaptive.meanInterval, 100.0 * (adaptive.meanInterval / legacyFixed.meanInterval - 1.0) );
+        printf( "  mean steps      %.1f legacy fixed, %.1f fixed (%+.2f%%), %.1f legacy adaptive, %.1f adaptive (%+.2f%% on legacy fixed)\n",
+                legacyFixed.meanMarchSteps, fixed.meanMarchSteps, 100.0 * (fixed.meanMarchSteps / legacyFixed.meanMarchSteps - 1.0),
+                legacyAdaptive.meanMarchSteps, adaptive.meanMarchSteps, 100.0 * (adaptive.meanMarchSteps / legacyFixed.meanMarchSteps - 1.0) );
+        PrintHullHalf( "fixed front", fixed.front );
+        PrintHullHalf( "legacy back", legacyFixed.back );
+        PrintHullHalf( "fixed back", fixed.back );
+        PrintHullHalf( "adaptive front", adaptive.front );
+        PrintHullHalf( "legacy back", legacyAdaptive.back );
+        PrintHullHalf( "adaptive back", adaptive.back );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Adaptive stepping
+//--------------------------------------------------------------------------------------
+int StepBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint width = commandLine.GetUint( "width", kResolutionX / 4 );
+    const uint height = commandLine.GetUint( "height", kResolutionY / 4 );
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+    const CpuRenderer renderer( (CpuRenderSettings()) );
+
+    printf( "%ux%u, fixed steps against adaptive\n", width, height );
+    printf( "Scene,         fixed steps/ray, adaptive steps/ray, change, fixed ms, adaptive ms, max error, rms error,  PSNR\n" );
+    for(size_t i=0 ; i<sizeof(kGoldenScenes)/sizeof(kGoldenScenes[0]) ; i++)
+    {
+        const GoldenScene& scene = kGoldenScenes[i];
+
+        ExplosionSettings explosionSettings;
+        explosionSettings.primitive = scene.primitive;
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+        camera.radius = scene.cameraRadius;
+
+        ExplosionParams params;
+        BuildExplosionParams( explosionSettings, camera, scene.time, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+        Image fixedImage;
+        RenderStats fixedStats;
+        renderer.RenderFrame( params, textures, fixedImage, &pool, &fixedStats );
+
+        explosionSettings.adaptiveStepping = true;
+        BuildExplosionParams( explosionSettings, camera, scene.time, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+        Image adaptiveImage;
+        RenderStats adaptiveStats;
+        renderer.RenderFrame( params, textures, adaptiveImage, &pool, &adaptiveStats );
+
+        const double fixedStepsPerRay = fixedStats.numRays ? (double)fixedStats.numSteps / fixedStats.numRays : 0.0;
+        const double adaptiveStepsPerRay = adaptiveStats.numRays ? (double)adaptiveStats.numSteps / adaptiveStats.numRays : 0.0;
+        const float rmsError = GetRmsDifference( fixedImage, adaptiveImage );
+        printf( "%-13s %15.1f, %18.1f, %+5.1f%%, %8.1f, %11.1f, %9.4f, %9.5f, %5.1f\n", scene.pName, fixedStepsPerRay, adaptiveStepsPerRay,
+                fixedStepsPerRay > 0.0 ? 100.0 * (adaptiveStepsPerRay / fixedStepsPerRay - 1.0) : 0.0, fixedStats.milliseconds, adaptiveStats.milliseconds,
+                GetMaxDifference( fixedImage, adaptiveImage ), rmsError, rmsError > 0.0f ? 20.0f * log10f( 1.0f / rmsError ) : 999.0f );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Octave culling
+//--------------------------------------------------------------------------------------
+int OctaveBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint width = commandLine.GetUint( "width", kResolutionX / 4 );
+    const uint height = commandLine.GetUint( "height", kResolutionY / 4 );
+    const bool adaptiveStepping = commandLine.HasOption( "adaptive" );
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+    const CpuRenderer renderer( (CpuRenderSettings()) );
+
+    printf( "%ux%u, %s steps, all %u octaves against culled octaves\n", width, height, adaptiveStepping ? "adaptive" : "fixed", kNumOctaves );
+    printf( "Scene,         octaves/pixel, culled/pixel, octaves/step, change, all ms, culled ms, max error, rms error,  PSNR\n" );
+    for(size_t i=0 ; i<sizeof(kGoldenScenes)/sizeof(kGoldenScenes[0]) ; i++)
+    {
+        const GoldenScene& scene = kGoldenScenes[i];
+
+        ExplosionSettings explosionSettings;
+        explosionSettings.primitive = scene.primitive;
+        explosionSettings.adaptiveStepping = adaptiveStepping;
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+        camera.radius = scene.cameraRadius;
+
+        ExplosionParams params;
+        BuildExplosionParams( explosionSettings, camera, scene.time, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+        Image allImage;
+        RenderStats allStats;
+        renderer.RenderFrame( params, textures, allImage, &pool, &allStats );
+
+        explosionSettings.octaveCulling = true;
+        BuildExplosionParams( explosionSettings, camera, scene.time, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+        Image culledImage;
+        RenderStats culledStats;
+        renderer.RenderFrame( params, textures, culledImage, &pool, &culledStats );
+
+        const double allPerPixel = (double)allStats.numOctaves / Max( (float)allStats.numPixels, 1.0f );
+        const double culledPerPixel = (double)culledStats.numOctaves / Max( (float)culledStats.numPixels, 1.0f );
+        const double culledPerStep = (double)culledStats.numOctaves / Max( (float)culledStats.numSteps, 1.0f );
+        const float rmsError = GetRmsDifference( allImage, culledImage );
+        printf( "%-13s %13.1f, %12.1f, %12.2f, %+5.1f%%, %6.1f, %9.1f, %9.4f, %9.5f, %5.1f\n", scene.pName, allPerPixel, culledPerPixel, culledPerStep,
+                allPerPixel > 0.0 ? 100.0 * (culledPerPixel / allPerPixel - 1.0) : 0.0, allStats.milliseconds, culledStats.milliseconds,
+                GetMaxDifference( allImage, culledImage ), rmsError, rmsError > 0.0f ? 20.0f * log10f( 1.0f / rmsError ) : 999.0f );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Dithered ray starts
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // (2r+1)^2 box filter, clamped at the borders.  Dither noise sits at high
+    //  frequencies, blue noise almost entirely, so the error left after filtering
+    //  is the part the eye sees from a normal viewing distance.
+    void BoxFilter( const Image& source, int radius, Image& filtered )
+    {
+        const int width = (int)source.GetWidth(), height = (int)source.GetHeight();
+        filtered.Resize( width, height );
+        for(int y=0 ; y<height ; y++)
+        {
+            for(int x=0 ; x<width ; x++)
+            {
+                Vec4 sum( 0.0f );
+                float weight = 0;
+                for(int dy=-radius ; dy<=radius ; dy++)
+                {
+                    for(int dx=-radius ; dx<=radius ; dx++)
+                    {
+                        if( x + dx < 0 || x + dx >= width || y + dy < 0 || y + dy >= height ) continue;
+                        sum = sum + source.At( x + dx, y + dy );
+                        weight += 1.0f;
+                    }
+                }
+                filtered.At( x, y ) = sum * (1.0f / weight);
+            }
+        }
+    }
+
+    float GetPsnr( float rmsError )
+    {
+        return rmsError > 0.0f ? 20.0f * log10f( 1.0f / rmsError ) : 999.0f;
+    }
+}
+
+int DitherBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint width = commandLine.GetUint( "width", kResolutionX / 4 );
+    const uint height = commandLine.GetUint( "height", kResolutionY / 4 );
+    const int filterRadius = (int)commandLine.GetUint( "filter", 1 );
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+    const CpuRenderer renderer( (CpuRenderSettings()) );
+
+    Timer timer;
+    BlueNoiseMask blueNoise;
+    blueNoise.Generate( BLUE_NOISE_SIZE, &pool );
+    printf( "%ux%u blue-noise mask generated in %.1f ms on %u threads\n", BLUE_NOISE_SIZE, BLUE_NOISE_SIZE, timer.GetElapsedMilliseconds(), pool.GetNumThreads() );
+
+    // The mask's own texels in a random order, so that only the spectrum differs.
+    BlueNoiseMask whiteNoise;
+    whiteNoise.GenerateWhiteNoise( BLUE_NOISE_SIZE, 1 );
+
+    struct DitherMode
+    {
+        const char* pName;
+        const BlueNoiseMask* pMask;
+    };
+    const DitherMode kDitherModes[] = { { "none", nullptr }, { "white", &whiteNoise }, { "blue", &blueNoise } };
+    const float kStepScales[] = { 2.0f, 2.5f, 3.0f };
+
+    printf( "%ux%u, against undithered kStepSize; filtered PSNR after a %dx%d box filter\n", width, height, 2 * filterRadius + 1, 2 * filterRadius + 1 );
+    printf( "Scene,         step, dither, steps/ray,     ms, max error,  PSNR, filtered PSNR\n" );
+    for(size_t i=0 ; i<sizeof(kGoldenScenes)/sizeof(kGoldenScenes[0]) ; i++)
+    {
+        const GoldenScene& scene = kGoldenScenes[i];
+
+        ExplosionSettings explosionSettings;
+        explosionSettings.primitive = scene.primitive;
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+        camera.radius = scene.cameraRadius;
+
+        ExplosionParams params;
+        BuildExplosionParams( explosionSettings, camera, scene.time, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+        Image referenceImage, filteredReference;
+        RenderStats referenceStats;
+        renderer.RenderFrame( params, textures, referenceImage, &pool, &referenceStats );
+        BoxFilter( referenceImage, filterRadius, filteredReference );
+        printf( "%-13s %4.1fx, %6s, %9.1f, %6.1f\n", scene.pName, 1.0f, "none",
+                referenceStats.numRays ? (double)referenceStats.numSteps / referenceStats.numRays : 0.0, referenceStats.milliseconds );
+
+        for(size_t s=0 ; s<sizeof(kStepScales)/sizeof(kStepScales[0]) ; s++)
+        {
+            for(size_t m=0 ; m<sizeof(kDitherModes)/sizeof(kDitherModes[0]) ; m++)
+            {
+                const DitherMode& mode = kDitherModes[m];
+                if( mode.pMask ) textures.blueNoise = *mode.pMask;
+
+                explosionSettings.stepSizeScale = kStepScales[s];
+                explosionSettings.ditheredStart = mode.pMask != nullptr;
+                BuildExplosionParams( explosionSettings, camera, scene.time, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+
+                Image image, filteredImage;
+                RenderStats stats;
+                renderer.RenderFrame( params, textures, image, &pool, &stats );
+                BoxFilter( image, filterRadius, filteredImage );
+
+                printf( "%-13s %4.1fx, %6s, %9.1f, %6.1f, %9.4f, %5.1f, %13.1f\n", scene.pName, kStepScales[s], mode.pName,
+                        stats.numRays ? (double)stats.numSteps / stats.numRays : 0.0, stats.milliseconds, GetMaxDifference( referenceImage, image ),
+                        GetPsnr( GetRmsDifference( referenceImage, image ) ), GetPsnr( GetRmsDifference( filteredReference, filteredImage ) ) );
+            }
+        }
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Coarse tile classification
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // The class each tile should have had, from the reference frame: empty if no
+    //  pixel has any alpha, opaque if every pixel reaches kCoarseOpaqueAlpha.
+    CoarseTileClass GetTrueTileClass( const Image& reference, uint tileX, uint tileY, float opacity )
+    {
+        const uint x0 = tileX * kCoarseTileSize, x1 = std::min( x0 + kCoarseTileSize, reference.GetWidth() );
+        const uint y0 = tileY * kCoarseTileSize, y1 = std::min( y0 + kCoarseTileSize, reference.GetHeight() );
+
+        bool isEmpty = true, isOpaque = true;
+        for(uint y=y0 ; y<y1 ; y++)
+        {
+            for(uint x=x0 ; x<x1 ; x++)
+            {
+                const float alpha = reference.At( x, y ).w;
+                isEmpty = isEmpty && alpha == 0.0f;
+                isOpaque = isOpaque && alpha >= kCoarseOpaqueAlpha * opacity;
+            }
+        }
+        return isEmpty ? kCoarseTileEmpty : isOpaque ? kCoarseTileOpaque : kCoarseTileComplex;
+    }
+}
+
+int CoarseBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint width = commandLine.GetUint( "width", kResolutionX / 4 );
+    const uint height = commandLine.GetUint( "height", kResolutionY / 4 );
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+
+    const CpuRenderer renderer( (CpuRenderSettings()) );
+    CpuRenderSettings coarseSettings;
+    coarseSettings.coarseTiles = true;
+    const CpuRenderer coarseRenderer( coarseSettings );
+
+    printf( "%ux%u, %ux%u tiles, one coarse ray of %u octaves per tile against marching every pixel\n", width, height, kCoarseTileSize, kCoarseTileSize, kNumHullOctaves );
+    printf( "Tiles are empty/opaque/complex.  Correct: tiles given their true class; unsafe: empty or opaque tiles that are not.\n" );
+    printf( "Scene,         predicted, true,        correct, unsafe, steps/pixel, coarse/pixel, full ms, coarse ms, classify ms, saved, max error,  PSNR\n" );
+    for(size_t i=0 ; i<sizeof(kGoldenScenes)/sizeof(kGoldenScenes[0]) ; i++)
+    {
+        const GoldenScene& scene = kGoldenScenes[i];
+
+        ExplosionSettings explosionSettings;
+        explosionSettings.primitive = scene.primitive;
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+        camera.radius = scene.cameraRadius;
+
+        ExplosionParams params;
+        BuildExplosionParams( explosionSettings, camera, scene.time, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+        Image fullImage;
+        RenderStats fullStats;
+        renderer.RenderFrame( params, textures, fullImage, &pool, &fullStats );
+
+        Image coarseImage;
+        RenderStats coarseStats;
+        coarseRenderer.RenderFrame( params, textures, coarseImage, &pool, &coarseStats );
+
+        // The classification on its own, for its share of the frame.
+        const ExplosionEvaluator evaluator( params, textures, coarseSettings.noisePrecision );
+        LinearArena arena;
+        CoarseTileMap coarseTiles;
+        Timer timer;
+        coarseTiles.Classify( evaluator, &pool, arena );
+        const double classifyMilliseconds = timer.GetElapsedMilliseconds();
+
+        uint predicted[3] = { 0, 0, 0 }, actual[3] = { 0, 0, 0 };
+        uint numCorrect = 0, numUnsafe = 0;
+        for(uint tileY=0 ; tileY<coarseTiles.GetNumTilesY() ; tileY++)
+        {
+            for(uint tileX=0 ; tileX<coarseTiles.GetNumTilesX() ; tileX++)
+            {
+                const CoarseTileClass tileClass = coarseTiles.GetTile( tileX, tileY ).tileClass;
+                const CoarseTileClass trueClass = GetTrueTileClass( fullImage, tileX, tileY, params.g_Opacity );
+                predicted[tileClass]++;
+                actual[trueClass]++;
+                if( tileClass == trueClass ) numCorrect++;
+                else if( tileClass != kCoarseTileComplex ) numUnsafe++;
+            }
+        }
+        const uint numTiles = coarseTiles.GetNumTilesX() * coarseTiles.GetNumTilesY();
+
+        char predictedText[32], actualText[32];
+        sprintf( predictedText, "%u/%u/%u", predicted[kCoarseTileEmpty], predicted[kCoarseTileOpaque], predicted[kCoarseTileComplex] );
+        sprintf( actualText, "%u/%u/%u", actual[kCoarseTileEmpty], actual[kCoarseTileOpaque], actual[kCoarseTileComplex] );
+        printf( "%-13s %9s, %-11s %6.1f%%, %6u, %5.1f->%5.1f, %12.2f, %7.1f, %9.1f, %11.2f, %+4.0f%%, %9.4f, %5.1f\n", scene.pName, predictedText, actualText,
+                100.0 * numCorrect / numTiles, numUnsafe, (double)fullStats.numSteps / fullStats.numPixels, (double)coarseStats.numSteps / coarseStats.numPixels,
+                (double)coarseTiles.GetNumCoarseSteps() / coarseStats.numPixels, fullStats.milliseconds, coarseStats.milliseconds, classifyMilliseconds,
+                100.0 * (coarseStats.milliseconds / fullStats.milliseconds - 1.0), GetMaxDifference( fullImage, coarseImage ),
+                GetPsnr( GetRmsDifference( fullImage, coarseImage ) ) );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Variable rate shading
+//--------------------------------------------------------------------------------------
+int ShadingRateBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint width = commandLine.GetUint( "width", kResolutionX / 4 );
+    const uint height = commandLine.GetUint( "height", kResolutionY / 4 );
+    const uint numFrames = std::max( commandLine.GetUint( "frames", 8 ), 2u );
+    const float orbitPerFrame = commandLine.GetFloat( "orbit", 0.01f );
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+
+    const CpuRenderer renderer( (CpuRenderSettings()) );
+    ShadingRateSettings rateSettings;
+    rateSettings.halfRateContrast = commandLine.GetFloat( "half", rateSettings.halfRateContrast );
+    rateSettings.quarterRateContrast = commandLine.GetFloat( "quarter", rateSettings.quarterRateContrast );
+    rateSettings.edgeThreshold = commandLine.GetFloat( "edge", rateSettings.edgeThreshold );
+
+    printf( "%ux%u, %u frames at 30 Hz orbiting %.3f radians a frame; the first, marched in full, is left out\n", width, height, numFrames, orbitPerFrame );
+    printf( "Scene,         rays/frame, vrs rays/frame, change, 1x1/2x2/4x4 tiles, edge pixels, full ms, vrs ms, max error,  PSNR\n" );
+    for(size_t i=0 ; i<sizeof(kGoldenScenes)/sizeof(kGoldenScenes[0]) ; i++)
+    {
+        const GoldenScene& scene = kGoldenScenes[i];
+
+        ExplosionSettings explosionSettings;
+        explosionSettings.primitive = scene.primitive;
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+        camera.radius = scene.cameraRadius;
+
+        VariableRateRenderer rateRenderer( CpuRenderSettings(), rateSettings );
+        RenderStats fullTotals, rateTotals;
+        ShadingRateStats rateStatTotals;
+        double sumSquaredError = 0;
+        float maxError = 0;
+        for(uint frame=0 ; frame<numFrames ; frame++)
+        {
+            camera.theta = frame * orbitPerFrame;
+            ExplosionParams params;
+            BuildExplosionParams( explosionSettings, camera, scene.time + frame / 30.0f, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+
+            Image fullImage, rateImage;
+            RenderStats fullStats, rateStats;
+            ShadingRateStats shadingRateStats;
+            renderer.RenderFrame( params, textures, fullImage, &pool, &fullStats );
+            rateRenderer.RenderFrame( params, textures, rateImage, &pool, &rateStats, &shadingRateStats );
+            if( frame == 0 ) continue;
+
+            fullTotals.Accumulate( fullStats );
+            rateTotals.Accumulate( rateStats );
+            for(uint r=0 ; r<3 ; r++) rateStatTotals.numTiles[r] += shadingRateStats.numTiles[r];
+            rateStatTotals.numEdgePixels += shadingRateStats.numEdgePixels;
+
+            const float rmsError = GetRmsDifference( fullImage, rateImage );
+            sumSquaredError += rmsError * rmsError;
+            maxError = Max( maxError, GetMaxDifference( fullImage, rateImage ) );
+        }
+
+        const uint numMeasured = numFrames - 1;
+        char tilesText[32];
+        sprintf( tilesText, "%u/%u/%u", rateStatTotals.numTiles[0] / numMeasured, rateStatTotals.numTiles[1] / numMeasured, rateStatTotals.numTiles[2] / numMeasured );
+        printf( "%-13s %10.0f, %14.0f, %+5.1f%%, %17s, %11.0f, %7.1f, %6.1f, %9.4f, %5.1f\n", scene.pName, (double)fullTotals.numRays / numMeasured,
+                (double)rateTotals.numRays / numMeasured, fullTotals.numRays ? 100.0 * ((double)rateTotals.numRays / fullTotals.numRays - 1.0) : 0.0, tilesText,
+                (double)rateStatTotals.numEdgePixels / numMeasured, fullTotals.milliseconds / numMeasured, rateTotals.milliseconds / numMeasured, maxError,
+                GetPsnr( (float)sqrt( sumSquaredError / numMeasured ) ) );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Tile ray setup
+//--------------------------------------------------------------------------------------
+int RaySetupBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint width = commandLine.GetUint( "width", kResolutionX / 2 );
+    const uint height = commandLine.GetUint( "height", kResolutionY / 2 );
+    const uint numRepeats = std::max( commandLine.GetUint( "repeat", 20 ), 1u );
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+
+    CpuRenderSettings pixelSettings;
+    pixelSettings.tileRaySetup = false;
+    const CpuRenderer pixelRenderer( pixelSettings );
+    const CpuRenderer tileRenderer( (CpuRenderSettings()) );
+    const uint tileSize = tileRenderer.GetSettings().tileSize;
+
+    struct SizeCase
+    {
+        const char* pName;
+        float cameraRadius;
+    };
+    const SizeCase kSizeCases[] = { { "small", 60.0f }, { "medium", 16.0f }, { "full-screen", 6.0f } };
+
+    printf( "%ux%u, %ux%u tiles; setup timed on one thread over %u repeats, frames on %u threads\n", width, height, tileSize, tileSize, numRepeats, pool.GetNumThreads() );
+    printf( "Explosion,   coverage,   rays, pixel setup ms, tile setup ms, removed, frame share, mismatched rays, pixel frame ms, tile frame ms, max difference\n" );
+    for(size_t i=0 ; i<sizeof(kSizeCases)/sizeof(kSizeCases[0]) ; i++)
+    {
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+        camera.radius = kSizeCases[i].cameraRadius;
+
+        ExplosionParams params;
+        BuildExplosionParams( ExplosionSettings(), camera, 3.3f, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+
+        // Every pixel's GetRayDirectionWS and GetAnalyticRayInterval, as RenderTile did.
+        uint numPixelHits = 0;
+        Timer timer;
+        for(uint r=0 ; r<numRepeats ; r++)
+        {
+            for(uint y=0 ; y<height ; y++)
+            {
+                for(uint x=0 ; x<width ; x++)
+                {
+                    const Vec3 rayDirectionWS = GetRayDirectionWS( params, x + 0.5f, y + 0.5f );
+                    float nearD, farD;
+                    if( GetAnalyticRayInterval( params, rayDirectionWS, nearD, farD ) ) numPixelHits++;
+                }
+            }
+        }
+        const double pixelMilliseconds = timer.GetElapsedMilliseconds() / numRepeats;
+
+        // The tile's interval, then batches of rays for the tiles that pass.
+        uint numTileHits = 0;
+        timer.Reset();
+        for(uint r=0 ; r<numRepeats ; r++)
+        {
+            for(uint y0=0 ; y0<height ; y0+=tileSize)
+            {
+                for(uint x0=0 ; x0<width ; x0+=tileSize)
+                {
+                    const uint x1 = std::min( x0 + tileSize, width ), y1 = std::min( y0 + tileSize, height );
+                    float tileNearD, tileFarD;
+                    if( !GetTileRayInterval( params, x0, y0, x1, y1, tileNearD, tileFarD ) ) continue;
+
+                    RayBatch batch;
+                    for(uint y=y0 ; y<y1 ; y++)
+                    {
+                        for(uint x=x0 ; x<x1 ; x+=kRayBatchSize)
+                        {
+                            numTileHits += SetUpRayBatch( params, x, y, std::min( x1 - x, kRayBatchSize ), batch );
+                        }
+                    }
+                }
+            }
+        }
+        const double tileMilliseconds = timer.GetElapsedMilliseconds() / numRepeats;
+
+        // Rays lost to the tile culling, and rays whose batch setup differs from
+        //  their pixel's, to any bit.
+        uint numMismatched = (numPixelHits - numTileHits) / numRepeats;
+        for(uint y=0 ; y<height ; y++)
+        {
+            for(uint x=0 ; x<width ; x+=kRayBatchSize)
+            {
+                RayBatch batch;
+                const uint count = std::min( width - x, kRayBatchSize );
+                SetUpRayBatch( params, x, y, count, batch );
+                for(uint lane=0 ; lane<count ; lane++)
+                {
+                    const Vec3 rayDirectionWS = GetRayDirectionWS( params, x + lane + 0.5f, y + 0.5f );
+                    float nearD = 0, farD = 0;
+                    const bool isHit = GetAnalyticRayInterval( params, rayDirectionWS, nearD, farD );
+                    const bool isSame = isHit == batch.hits[lane] && rayDirectionWS.x == batch.directionX[lane] && rayDirectionWS.y == batch.directionY[lane] &&
+                                        rayDirectionWS.z == batch.directionZ[lane] && (!isHit || (nearD == batch.nearD[lane] && farD == batch.farD[lane]));
+                    numMismatched += isSame ? 0 : 1;
+                }
+            }
+        }
+
+        Image pixelImage, tileImage;
+        RenderStats pixelStats, tileStats;
+        pixelRenderer.RenderFrame( params, textures, pixelImage, &pool, &pixelStats );
+        tileRenderer.RenderFrame( params, textures, tileImage, &pool, &tileStats );
+
+        printf( "%-11s %8.2f%%, %6u, %14.3f, %13.3f, %6.0f%%, %10.2f%%, %15u, %14.1f, %13.1f, %14.2g\n", kSizeCases[i].pName, GetExplosionScreenCoverage( params ) * 100.0f,
+                numPixelHits / numRepeats, pixelMilliseconds, tileMilliseconds, 100.0 * (1.0 - tileMilliseconds / pixelMilliseconds),
+                100.0 * pixelMilliseconds / (pixelStats.milliseconds * pool.GetNumThreads()), numMismatched, pixelStats.milliseconds, tileStats.milliseconds,
+                GetMaxDifference( pixelImage, tileImage ) );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Hull rasterisation
+//--------------------------------------------------------------------------------------
+int RasterBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint width = commandLine.GetUint( "width", kResolutionX / 4 );
+    const uint height = commandLine.GetUint( "height", kResolutionY / 4 );
+    const uint numRepeats = std::max( commandLine.GetUint( "repeat", 20 ), 1u );
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+
+    const CpuRenderer analyticRenderer( (CpuRenderSettings()) );
+    CpuRenderSettings hullSettings;
+    hullSettings.hullBounds = true;
+    const CpuRenderer hullRenderer( hullSettings );
+
+    printf( "%ux%u, %u triangles in %ux%u bins on %u threads, rasterisation timed over %u repeats\n", width, height,
+            (uint)(kTessellationFactor * kTessellationFactor * 2), kRasterBinSize, kRasterBinSize, pool.GetNumThreads(), numRepeats );
+    printf( "Covered pixels and mean view depth interval over them, bounding sphere against hull.  Frame ms include the hull.\n" );
+    printf( "Clipped: pixels whose alpha the hull loses more than half of.\n" );
+    printf( "Scene,         hull ms, raster ms, bin entries, covered sphere/hull, interval sphere/hull, steps/pixel,   sphere ms, hull ms, clipped, max difference,  PSNR\n" );
+    for(size_t i=0 ; i<sizeof(kGoldenScenes)/sizeof(kGoldenScenes[0]) ; i++)
+    {
+        const GoldenScene& scene = kGoldenScenes[i];
+
+        ExplosionSettings explosionSettings;
+        explosionSettings.primitive = scene.primitive;
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+        camera.radius = scene.cameraRadius;
+
+        ExplosionParams params;
+        BuildExplosionParams( explosionSettings, camera, scene.time, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+        const ExplosionEvaluator evaluator( params, textures, hullSettings.noisePrecision );
+
+        std::vector<HullVertex> vertices;
+        Timer timer;
+        EvaluateHull( evaluator, vertices );
+        const double hullMilliseconds = timer.GetElapsedMilliseconds();
+
+        // The last repeat's depths are kept for the comparison below.
+        LinearArena arena;
+        HullDepthBuffer depths;
+        RasterStats rasterStats;
+        double rasterMilliseconds = 0;
+        for(uint r=0 ; r<numRepeats ; r++)
+        {
+            arena.Reset();
+            RasteriseHull( params, &vertices[0], (uint)vertices.size(), &pool, depths, arena, &rasterStats );
+            rasterMilliseconds += rasterStats.milliseconds;
+        }
+        rasterMilliseconds /= numRepeats;
+
+        // How much tighter the hull is than the sphere, pixel by pixel.
+        uint numSphereCovered = 0, numHullCovered = 0;
+        double sphereInterval = 0, hullInterval = 0;
+        for(uint y=0 ; y<height ; y++)
+        {
+            for(uint x=0 ; x<width ; x++)
+            {
+                float nearD, farD;
+                if( GetAnalyticRayInterval( params, GetRayDirectionWS( params, x + 0.5f, y + 0.5f ), nearD, farD ) )
+                {
+                    numSphereCovered++;
+                    sphereInterval += farD - nearD;
+                }
+                if( depths.IsCovered( x, y ) )
+                {
+                    numHullCovered++;
+                    hullInterval += depths.GetFarD( x, y ) - depths.GetNearD( x, y );
+                }
+            }
+        }
+
+        Image analyticImage, hullImage;
+        RenderStats analyticStats, hullStats;
+        analyticRenderer.RenderFrame( params, textures, analyticImage, &pool, &analyticStats );
+        hullRenderer.RenderFrame( params, textures, hullImage, &pool, &hullStats );
+
+        // Pixels the hull cuts visibly short: the shrink-wrapped sheet is only
+        //  interpolated between vertices, and the GPU loses the same ones.
+        uint numClipped = 0;
+        for(uint y=0 ; y<height ; y++)
+        {
+            for(uint x=0 ; x<width ; x++) numClipped += analyticImage.At( x, y ).w - hullImage.At( x, y ).w > 0.5f ? 1 : 0;
+        }
+
+        char coveredText[32], intervalText[32];
+        sprintf( coveredText, "%u/%u", numSphereCovered, numHullCovered );
+        sprintf( intervalText, "%.3f/%.3f", numSphereCovered ? sphereInterval / numSphereCovered : 0.0, numHullCovered ? hullInterval / numHullCovered : 0.0 );
+        printf( "%-13s %7.2f, %9.3f, %11u, %19s, %20s, %5.1f->%5.1f, %11.1f, %7.1f, %7u, %14.4f, %5.1f\n", scene.pName, hullMilliseconds, rasterMilliseconds,
+                rasterStats.numBinEntries, coveredText, intervalText, (double)analyticStats.numSteps / analyticStats.numPixels,
+                (double)hullStats.numSteps / hullStats.numPixels, analyticStats.milliseconds, hullStats.milliseconds, numClipped,
+                GetMaxDifference( analyticImage, hullImage ),
+                GetPsnr( GetRmsDifference( analyticImage, hullImage ) ) );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Frame allocations
+//--------------------------------------------------------------------------------------
+namespace
+{
+    enum AllocationCase
+    {
+        kAllocationTiles,
+        kAllocationWavefront,
+        kAllocationCoarse,
+        kAllocationHull,
+        kAllocationScheduler,
+        kAllocationVariableRate
+    };
+
+    struct AllocationCaseInfo
+    {
+        const char* pName;
+        AllocationCase allocationCase;
+    };
+
+    const AllocationCaseInfo kAllocationCases[] =
+    {
+        { "tiles",          kAllocationTiles },
+        { "wavefront",      kAllocationWavefront },
+        { "coarse tiles",   kAllocationCoarse },
+        { "hull bounds",    kAllocationHull },
+        { "work stealing",  kAllocationScheduler },
+        { "variable rate",  kAllocationVariableRate },
+    };
+}
+
+int AllocationBenchMain( const CommandLine& commandLine )
+{
+#ifndef EXPLOSION_COUNT_HEAP_ALLOCATIONS
+    fprintf( stderr, "alloc-bench needs heap allocation counting; build with EXPLOSION_COUNT_HEAP_ALLOCATIONS defined.\n" );
+    return 1;
+#endif
+
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    const uint width = commandLine.GetUint( "width", kResolutionX / 4 );
+    const uint height = commandLine.GetUint( "height", kResolutionY / 4 );
+    const uint numFrames = std::max( commandLine.GetUint( "frames", 12 ), 2u );
+    const float orbitPerFrame = commandLine.GetFloat( "orbit", 0.05f );
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+
+    // The second half of the frames are the steady state: by then the arenas and
+    //  the buffers kept between frames have grown to fit.
+    const uint numWarmUpFrames = numFrames / 2;
+
+    printf( "%ux%u, %u frames orbiting %.3f radians a frame on %u threads; frames %u on are the steady state\n", width, height, numFrames, orbitPerFrame,
+            pool.GetNumThreads(), numWarmUpFrames + 1 );
+    printf( "Heap allocations per frame, with fresh arenas every frame and with the same arenas kept between frames.\n" );
+    printf( "Mode,           fresh, first kept, steady kept, arena KB, scratch KB, frame ms\n" );
+
+    bool isSteadyStateClean = true;
+    for(size_t i=0 ; i<sizeof(kAllocationCases)/sizeof(kAllocationCases[0]) ; i++)
+    {
+        const AllocationCase allocationCase = kAllocationCases[i].allocationCase;
+
+        CpuRenderSettings renderSettings;
+        renderSettings.marchMode = allocationCase == kAllocationWavefront ? kMarchWavefront : kMarchTiles;
+        renderSettings.coarseTiles = allocationCase == kAllocationCoarse;
+        renderSettings.hullBounds = allocationCase == kAllocationHull;
+        const CpuRenderer renderer( renderSettings );
+        TileScheduler scheduler;
+        VariableRateRenderer rateRenderer( renderSettings, ShadingRateSettings() );
+
+        FrameArenas arenas;
+        Image image;
+        OrbitCamera camera;
+        camera.phi = PI * 0.5f;
+
+        uint64_t freshAllocations = 0, firstAllocations = 0, steadyAllocations = 0;
+        double milliseconds = 0;
+        for(uint frame=0 ; frame<numFrames ; frame++)
+        {
+            camera.theta = frame * orbitPerFrame;
+            ExplosionParams params;
+            BuildExplosionParams( ExplosionSettings(), camera, 3.3f + frame / 30.0f, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+
+            // The first frame sizes the image, the history and the arenas.
+            RenderStats stats;
+            const uint64_t allocationsBefore = GetNumHeapAllocations();
+            switch( allocationCase )
+            {
+            case kAllocationScheduler:
+                scheduler.RenderFrame( renderer, params, textures, image, pool, &stats, nullptr );
+                break;
+            case kAllocationVariableRate:
+                rateRenderer.RenderFrame( params, textures, image, &pool, &stats, nullptr );
+                break;
+            default:
+                renderer.RenderFrame( params, textures, image, &pool, &stats, &arenas );
+                break;
+            }
+            const uint64_t numAllocations = GetNumHeapAllocations() - allocationsBefore;
+
+            if( frame == 0 ) firstAllocations = numAllocations;
+            if( frame >= numWarmUpFrames )
+            {
+                steadyAllocations += numAllocations;
+                milliseconds += stats.milliseconds;
+            }
+        }
+
+        // The renderers that keep no state between frames, given fresh arenas.
+        const bool isStateless = allocationCase != kAllocationScheduler && allocationCase != kAllocationVariableRate;
+        if( isStateless )
+        {
+            ExplosionParams params;
+            BuildExplosionParams( ExplosionSettings(), camera, 3.3f, width, height, textures.noiseVolume.GetLargestAbsoluteValue(), params );
+            const uint64_t allocationsBefore = GetNumHeapAllocations();
+            renderer.RenderFrame( params, textures, image, &pool, nullptr );
+            freshAllocations = GetNumHeapAllocations() - allocationsBefore;
+        }
+
+        size_t scratchBytes = 0;
+        for(uint t=0 ; t<arenas.GetNumScratchArenas() ; t++) scratchBytes += arenas.GetScratchArena( t ).GetHighWaterMark();
+
+        const uint numSteadyFrames = numFrames - numWarmUpFrames;
+        char freshText[32];
+        sprintf( freshText, isStateless ? "%llu" : "-", (unsigned long long)freshAllocations );
+        printf( "%-14s %6s, %10llu, %11.1f, %8.1f, %10.1f, %8.1f\n", kAllocationCases[i].pName, freshText, (unsigned long long)firstAllocations,
+                (double)steadyAllocations / numSteadyFrames, isStateless ? arenas.GetFrameArena().GetHighWaterMark() / 1024.0 : 0.0, scratchBytes / 1024.0,
+                milliseconds / numSteadyFrames );
+        if( steadyAllocations != 0 ) isSteadyStateClean = false;
+    }
+
+    printf( isSteadyStateClean ? "Steady state: no heap allocations.\n" : "Steady state: HEAP ALLOCATIONS REMAIN.\n" );
+    return isSteadyStateClean ? 0 : 1;
+}
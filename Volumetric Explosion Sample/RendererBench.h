@@ -0,0 +1,26 @@
+#ifndef RENDERER_BENCH_H
+#define RENDERER_BENCH_H
+
+//--------------------------------------------------------------------------------------
+// Headless benchmarks comparing the CPU renderer's marching and scheduling
+//  strategies on the same frame.
+//--------------------------------------------------------------------------------------
+class CommandLine;
+
+int MarchBenchMain( const CommandLine& commandLine );
+int ScheduleBenchMain( const CommandLine& commandLine );
+int PrecisionBenchMain( const CommandLine& commandLine );
+int QuantiseBenchMain( const CommandLine& commandLine );
+int LayoutBenchMain( const CommandLine& commandLine );
+int GradientBenchMain( const CommandLine& commandLine );
+int HullBenchMain( const CommandLine& commandLine );
+int StepBenchMain( const CommandLine& commandLine );
+int OctaveBenchMain( const CommandLine& commandLine );
+int DitherBenchMain( const CommandLine& commandLine );
+int CoarseBenchMain( const CommandLine& commandLine );
+int ShadingRateBenchMain( const CommandLine& commandLine );
+int RaySetupBenchMain( const CommandLine& commandLine );
+int RasterBenchMain( const CommandLine& commandLine );
+int AllocationBenchMain( const CommandLine& commandLine );
+
+#endif // RENDERER_BENCH_H
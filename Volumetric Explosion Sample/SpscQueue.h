@@ -0,0 +1,74 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+//--------------------------------------------------------------------------------------
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+//  Items live in a ring of power of two size indexed by two free running counters;
+//  the producer only writes the tail and the consumer only writes the head, so
+//  each side needs a single release store per operation and never waits.
+//--------------------------------------------------------------------------------------
+#include <atomic>
+#include <vector>
+
+#include "Common.h"
+
+template <typename T>
+class SpscQueue
+{
+public:
+    // The capacity is rounded up to a power of two.
+    explicit SpscQueue( uint capacity )
+        : m_Head(0)
+        , m_Tail(0)
+    {
+        uint roundedCapacity = 1;
+        while( roundedCapacity < capacity ) roundedCapacity *= 2;
+        m_Items.resize( roundedCapacity );
+        m_Mask = roundedCapacity - 1;
+    }
+
+    uint GetCapacity() const { return m_Mask + 1; }
+
+    // Items queued, exact only when called from one of the two threads while the
+    //  other is idle.
+    uint GetSize() const { return m_Tail.load( std::memory_order_acquire ) - m_Head.load( std::memory_order_acquire ); }
+
+    // Producer side.  Returns false, leaving the queue unchanged, when it is full.
+    bool Push( const T& item )
+    {
+        const uint tail = m_Tail.load( std::memory_order_relaxed );
+        if( tail - m_Head.load( std::memory_order_acquire ) > m_Mask ) return false;
+
+        m_Items[tail & m_Mask] = item;
+        m_Tail.store( tail + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Consumer side.  Returns false when the queue is empty.
+    bool Pop( T& item )
+    {
+        const uint head = m_Head.load( std::memory_order_relaxed );
+        if( m_Tail.load( std::memory_order_acquire ) == head ) return false;
+
+        item = m_Items[head & m_Mask];
+        m_Head.store( head + 1, std::memory_order_release );
+        return true;
+    }
+
+private:
+    std::vector<T> m_Items;
+    uint m_Mask;
+
+    // The counters are kept on separate cache lines so the two threads don't
+    //  invalidate each other's line on every operation.
+    char m_Padding0[64];
+    std::atomic<uint> m_Head;
+    char m_Padding1[64];
+    std::atomic<uint> m_Tail;
+    char m_Padding2[64];
+
+    SpscQueue( const SpscQueue& );
+    SpscQueue& operator=( const SpscQueue& );
+};
+
+#endif // SPSC_QUEUE_H
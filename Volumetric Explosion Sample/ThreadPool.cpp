@@ -0,0 +1,94 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool( uint numThreads )
+    : m_Generation(0)
+    , m_NumBusyWorkers(0)
+    , m_Quit(false)
+    , m_pJob(nullptr)
+    , m_JobCount(0)
+{
+    m_NextIndex = 0;
+
+    if( numThreads == 0 ) numThreads = GetHardwareThreadCount();
+
+    for(uint i=1 ; i<numThreads ; i++)
+    {
+        m_Workers.push_back( std::thread( &ThreadPool::WorkerMain, this, i ) );
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        m_Quit = true;
+    }
+    m_WakeCondition.notify_all();
+
+    for(size_t i=0 ; i<m_Workers.size() ; i++) m_Workers[i].join();
+}
+
+uint ThreadPool::GetHardwareThreadCount()
+{
+    const uint count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+void ThreadPool::ParallelFor( uint count, const std::function<void( uint index, uint threadIndex )>& job )
+{
+    if( count == 0 ) return;
+
+    if( m_Workers.empty() || count == 1 )
+    {
+        for(uint i=0 ; i<count ; i++) job( i, 0 );
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        m_pJob = &job;
+        m_JobCount = count;
+        m_NextIndex = 0;
+        m_NumBusyWorkers = (uint)m_Workers.size();
+        m_Generation++;
+    }
+    m_WakeCondition.notify_all();
+
+    RunJob( 0 );
+
+    std::unique_lock<std::mutex> lock( m_Mutex );
+    while( m_NumBusyWorkers != 0 ) m_DoneCondition.wait( lock );
+    m_pJob = nullptr;
+}
+
+void ThreadPool::WorkerMain( uint threadIndex )
+{
+    uint lastGeneration = 0;
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock( m_Mutex );
+            while( !m_Quit && m_Generation == lastGeneration ) m_WakeCondition.wait( lock );
+            if( m_Quit ) return;
+            lastGeneration = m_Generation;
+        }
+
+        RunJob( threadIndex );
+
+        {
+            std::lock_guard<std::mutex> lock( m_Mutex );
+            if( --m_NumBusyWorkers == 0 ) m_DoneCondition.notify_one();
+        }
+    }
+}
+
+void ThreadPool::RunJob( uint threadIndex )
+{
+    for(;;)
+    {
+        const uint index = m_NextIndex++;
+        if( index >= m_JobCount ) break;
+
+        (*m_pJob)( index, threadIndex );
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+//--------------------------------------------------------------------------------------
+// Fixed size pool of worker threads used by the CPU renderer and the headless
+//  tools.  The calling thread takes part in every job, so a pool created with
+//  N threads starts N-1 workers.
+//--------------------------------------------------------------------------------------
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Common.h"
+
+class ThreadPool
+{
+public:
+    // A thread count of 0 uses one thread per hardware thread.
+    explicit ThreadPool( uint numThreads );
+    ~ThreadPool();
+
+    uint GetNumThreads() const { return (uint)m_Workers.size() + 1; }
+
+    // Calls job( index, threadIndex ) for each index in [0, count) and returns once
+    //  all of them have completed.  Indices are handed out in increasing order.
+    //  Not re-entrant: a job must not call ParallelFor on the same pool.
+    void ParallelFor( uint count, const std::function<void( uint index, uint threadIndex )>& job );
+
+    // The same for any callable.  The std::function only holds a reference to it, so
+    //  a lambda with many captures does not cost a heap allocation per call.
+    template<typename Job> void ParallelFor( uint count, const Job& job )
+    {
+        ParallelFor( count, std::function<void( uint, uint )>( std::cref( job ) ) );
+    }
+
+    static uint GetHardwareThreadCount();
+
+private:
+    void WorkerMain( uint threadIndex );
+    void RunJob( uint threadIndex );
+
+    std::vector<std::thread> m_Workers;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeCondition;
+    std::condition_variable m_DoneCondition;
+    uint m_Generation;
+    uint m_NumBusyWorkers;
+    bool m_Quit;
+
+    const std::function<void( uint, uint )>* m_pJob;
+    uint m_JobCount;
+    std::atomic<uint> m_NextIndex;
+
+    ThreadPool( const ThreadPool& );
+    ThreadPool& operator=( const ThreadPool& );
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,243 @@
+#include "TileScheduler.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <mutex>
+
+// Work items dealt to each thread, so that stealing has something to balance.
+static const uint kItemsPerThread = 8;
+
+SchedulerStats::SchedulerStats()
+    : numItems(0)
+    , numSteals(0)
+    , wallMilliseconds(0)
+    , busyMilliseconds(0)
+    , numThreads(0)
+{
+}
+
+double SchedulerStats::GetIdlePercentage() const
+{
+    if( numThreads == 0 || wallMilliseconds <= 0.0 ) return 0.0;
+    const double idlePercentage = 100.0 * (1.0 - busyMilliseconds / (wallMilliseconds * numThreads));
+    return idlePercentage > 0.0 ? idlePercentage : 0.0;
+}
+
+// A thread's share of the frame's tiles, heaviest first.  The owner pops from the
+//  head and thieves from the tail; nothing is pushed once the frame starts.
+struct TileScheduler::WorkDeque
+{
+    std::mutex mutex;
+    uint* pTileIndices;
+    uint head, tail;
+
+    bool PopHead( uint& tileIndex )
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        if( head == tail ) return false;
+        tileIndex = pTileIndices[head++];
+        return true;
+    }
+
+    bool PopTail( uint& tileIndex )
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        if( head == tail ) return false;
+        tileIndex = pTileIndices[--tail];
+        return true;
+    }
+};
+
+TileScheduler::TileScheduler()
+    : m_Width(0)
+    , m_Height(0)
+    , m_NumCellsX(0)
+    , m_NumCellsY(0)
+    , m_NumDeques(0)
+{
+}
+
+TileScheduler::~TileScheduler()
+{
+}
+
+uint64_t TileScheduler::GetCellCost( uint cellX0, uint cellY0, uint cellX1, uint cellY1 ) const
+{
+    const uint x0 = cellX0 * kCostCellSize, x1 = Min( cellX1 * kCostCellSize, m_Width );
+    const uint y0 = cellY0 * kCostCellSize, y1 = Min( cellY1 * kCostCellSize, m_Height );
+    uint64_t cost = (uint64_t)(x1 - x0) * (y1 - y0);
+
+    if( !m_CellSteps.empty() )
+    {
+        for(uint cellY=cellY0 ; cellY<cellY1 ; cellY++)
+        {
+            for(uint cellX=cellX0 ; cellX<cellX1 ; cellX++) cost += m_CellSteps[cellY * m_NumCellsX + cellX];
+        }
+    }
+    return cost;
+}
+
+void TileScheduler::SplitBlock( uint cellX0, uint cellY0, uint cellSpan, uint64_t targetCost, std::vector<ScheduledTile>& tiles ) const
+{
+    if( cellX0 >= m_NumCellsX || cellY0 >= m_NumCellsY ) return;
+
+    const uint cellX1 = Min( cellX0 + cellSpan, m_NumCellsX );
+    const uint cellY1 = Min( cellY0 + cellSpan, m_NumCellsY );
+    const uint64_t cost = GetCellCost( cellX0, cellY0, cellX1, cellY1 );
+
+    if( cost > targetCost && cellSpan > 1 )
+    {
+        const uint halfSpan = cellSpan / 2;
+        SplitBlock( cellX0, cellY0, halfSpan, targetCost, tiles );
+        SplitBlock( cellX0 + halfSpan, cellY0, halfSpan, targetCost, tiles );
+        SplitBlock( cellX0, cellY0 + halfSpan, halfSpan, targetCost, tiles );
+        SplitBlock( cellX0 + halfSpan, cellY0 + halfSpan, halfSpan, targetCost, tiles );
+        return;
+    }
+
+    ScheduledTile tile;
+    tile.cellX0 = cellX0;
+    tile.cellY0 = cellY0;
+    tile.cellX1 = cellX1;
+    tile.cellY1 = cellY1;
+    tile.predictedCost = cost;
+    tiles.push_back( tile );
+}
+
+void TileScheduler::PlanFrame( uint width, uint height, uint numThreads, std::vector<ScheduledTile>& tiles )
+{
+    // The history is only any use at the resolution it was recorded at.
+    if( width != m_Width || height != m_Height )
+    {
+        m_Width = width;
+        m_Height = height;
+        m_NumCellsX = (width + kCostCellSize - 1) / kCostCellSize;
+        m_NumCellsY = (height + kCostCellSize - 1) / kCostCellSize;
+        m_CellSteps.clear();
+    }
+
+    const uint64_t targetCost = GetCellCost( 0, 0, m_NumCellsX, m_NumCellsY ) / (numThreads * kItemsPerThread) + 1;
+    const uint blockSpan = kCostBlockSize / kCostCellSize;
+
+    // At most one item per cell, so once the list has grown to that it never reallocates.
+    tiles.clear();
+    tiles.reserve( m_NumCellsX * m_NumCellsY );
+    for(uint cellY=0 ; cellY<m_NumCellsY ; cellY+=blockSpan)
+    {
+        for(uint cellX=0 ; cellX<m_NumCellsX ; cellX+=blockSpan) SplitBlock( cellX, cellY, blockSpan, targetCost, tiles );
+    }
+
+    // Ties go in raster order of their corner, which no two items share; std::sort,
+    //  unlike std::stable_sort, needs no buffer.
+    std::sort( tiles.begin(), tiles.end(), []( const ScheduledTile& a, const ScheduledTile& b )
+    {
+        if( a.predictedCost != b.predictedCost ) return a.predictedCost > b.predictedCost;
+        return a.cellY0 != b.cellY0 ? a.cellY0 < b.cellY0 : a.cellX0 < b.cellX0;
+    } );
+}
+
+void TileScheduler::RenderFrame( const CpuRenderer& renderer, const ExplosionParams& params, const SceneTextures& textures, Image& target,
+                                 ThreadPool& pool, RenderStats* pStats, SchedulerStats* pSchedulerStats )
+{
+    Timer timer;
+
+    const uint width = (uint)params.g_ScreenParams.x;
+    const uint height = (uint)params.g_ScreenParams.y;
+    target.Resize( width, height );
+
+    const uint numThreads = pool.GetNumThreads();
+    m_Arenas.Prepare( numThreads );
+    LinearArena& frameArena = m_Arenas.GetFrameArena();
+    std::vector<ScheduledTile>& tiles = m_Tiles;
+    PlanFrame( width, height, numThreads, tiles );
+    const uint numTiles = (uint)tiles.size();
+
+    // Deal the tiles out to whichever deque has the least predicted work so far, so
+    //  every thread starts on one of the heaviest and stealing only evens out the
+    //  prediction's errors.
+    if( numThreads > m_NumDeques )
+    {
+        m_Deques.reset( new WorkDeque[numThreads] );
+        m_NumDeques = numThreads;
+    }
+    WorkDeque* deques = m_Deques.get();
+    uint64_t* dequeCosts = frameArena.AllocateArray<uint64_t>( numThreads );
+    for(uint i=0 ; i<numThreads ; i++)
+    {
+        deques[i].pTileIndices = frameArena.AllocateArray<uint>( numTiles );
+        deques[i].head = deques[i].tail = 0;
+    }
+    for(uint i=0 ; i<numTiles ; i++)
+    {
+        const uint lightest = (uint)(std::min_element( dequeCosts, dequeCosts + numThreads ) - dequeCosts);
+        deques[lightest].pTileIndices[deques[lightest].tail++] = i;
+        dequeCosts[lightest] += tiles[i].predictedCost;
+    }
+
+    const ExplosionEvaluator evaluator( params, textures, renderer.GetSettings().noisePrecision );
+    std::vector<uint>& cellSteps = m_NextCellSteps;
+    cellSteps.assign( m_NumCellsX * m_NumCellsY, 0 );
+    RenderStats* threadStats = frameArena.AllocateArray<RenderStats>( numThreads );
+    double* threadBusyMilliseconds = frameArena.AllocateArray<double>( numThreads );
+    std::atomic<uint> numSteals( 0 );
+
+    // One job per deque; the pool may run two on the same thread if a worker is slow
+    //  to wake, which only means the second deque is started late and stolen from.
+    pool.ParallelFor( numThreads, [&]( uint owner, uint threadIndex )
+    {
+        RenderStats& stats = threadStats[threadIndex];
+
+        for(;;)
+        {
+            uint tileIndex;
+            bool found = deques[owner].PopHead( tileIndex );
+            for(uint i=1 ; i<numThreads && !found ; i++)
+            {
+                found = deques[(owner + i) % numThreads].PopTail( tileIndex );
+                if( found ) numSteals++;
+            }
+            if( !found ) break;
+
+            // Render cell by cell so that the next frame's prediction is exact per cell.
+            Timer tileTimer;
+            const ScheduledTile& tile = tiles[tileIndex];
+            for(uint cellY=tile.cellY0 ; cellY<tile.cellY1 ; cellY++)
+            {
+                for(uint cellX=tile.cellX0 ; cellX<tile.cellX1 ; cellX++)
+                {
+                    const uint x0 = cellX * kCostCellSize;
+                    const uint y0 = cellY * kCostCellSize;
+                    const uint64_t stepsBefore = stats.numSteps;
+                    renderer.RenderTile( evaluator, x0, y0, Min( x0 + kCostCellSize, width ), Min( y0 + kCostCellSize, height ), target, stats );
+                    cellSteps[cellY * m_NumCellsX + cellX] = (uint)(stats.numSteps - stepsBefore);
+                }
+            }
+            threadBusyMilliseconds[threadIndex] += tileTimer.GetElapsedMilliseconds();
+        }
+    } );
+
+    m_CellSteps.swap( cellSteps );
+
+    const double wallMilliseconds = timer.GetElapsedMilliseconds();
+    if( pStats )
+    {
+        RenderStats frameStats;
+        for(uint i=0 ; i<numThreads ; i++) frameStats.Accumulate( threadStats[i] );
+        frameStats.milliseconds = wallMilliseconds;
+        *pStats = frameStats;
+    }
+
+    if( pSchedulerStats )
+    {
+        SchedulerStats schedulerStats;
+        schedulerStats.numItems = numTiles;
+        schedulerStats.numSteals = numSteals;
+        schedulerStats.wallMilliseconds = wallMilliseconds;
+        for(uint i=0 ; i<numThreads ; i++) schedulerStats.busyMilliseconds += threadBusyMilliseconds[i];
+        schedulerStats.numThreads = numThreads;
+        *pSchedulerStats = schedulerStats;
+    }
+
+    m_Arenas.Reset();
+}
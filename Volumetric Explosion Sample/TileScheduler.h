@@ -0,0 +1,96 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+//--------------------------------------------------------------------------------------
+// Work-stealing frame scheduler for the CPU renderer.  March cost varies by orders
+//  of magnitude across the screen (empty background, thin edges, the dense core),
+//  so a fixed grid of tiles handed out in raster order leaves threads idle while
+//  the last expensive tiles finish.
+//
+//  The scheduler remembers the steps taken in every kCostCellSize^2 pixel cell in
+//  the previous frame.  Each frame it splits the screen into work items, from
+//  kCostBlockSize^2 pixels down to a single cell where the predicted cost is high,
+//  sorts them heaviest first and deals them out to per-thread deques.  Threads work
+//  through their own deque from the heavy end and steal from the light end of the
+//  others' once it runs dry.
+//--------------------------------------------------------------------------------------
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "CpuRenderer.h"
+#include "FrameArena.h"
+
+class ThreadPool;
+
+const uint kCostCellSize = 8;
+const uint kCostBlockSize = 64;
+
+struct SchedulerStats
+{
+    uint numItems;
+    uint numSteals;
+    double wallMilliseconds;
+    double busyMilliseconds;    // Summed over all threads.
+    uint numThreads;
+
+    SchedulerStats();
+
+    // Share of the threads' time in the frame not spent rendering.
+    double GetIdlePercentage() const;
+};
+
+// A rectangle of cells, [cellX0, cellX1) x [cellY0, cellY1).
+struct ScheduledTile
+{
+    uint cellX0, cellY0, cellX1, cellY1;
+    uint64_t predictedCost;
+};
+
+class TileScheduler
+{
+public:
+    TileScheduler();
+    ~TileScheduler();
+
+    // Splits a width x height frame into work items for numThreads threads, heaviest
+    //  first.  A cell is predicted to cost one unit per pixel plus one per step it
+    //  took last frame, so without a previous frame tiles are split evenly by area.
+    void PlanFrame( uint width, uint height, uint numThreads, std::vector<ScheduledTile>& tiles );
+
+    // Renders a frame with renderer.RenderTile, cell by cell, and records every
+    //  cell's steps as the prediction for the next frame at the same resolution.
+    void RenderFrame( const CpuRenderer& renderer, const ExplosionParams& params, const SceneTextures& textures, Image& target,
+                      ThreadPool& pool, RenderStats* pStats, SchedulerStats* pSchedulerStats );
+
+    // Steps taken per cell in the last frame, row by row.
+    const std::vector<uint>& GetCellSteps() const { return m_CellSteps; }
+    uint GetNumCellsX() const { return m_NumCellsX; }
+    uint GetNumCellsY() const { return m_NumCellsY; }
+
+    // Forget the previous frame, so the next one is split by pixel count alone.
+    void Reset() { m_CellSteps.clear(); }
+
+    // Pixels in the cells [cellX0, cellX1) x [cellY0, cellY1), plus the steps they took last frame.
+    uint64_t GetCellCost( uint cellX0, uint cellY0, uint cellX1, uint cellY1 ) const;
+
+private:
+    void SplitBlock( uint cellX0, uint cellY0, uint cellSpan, uint64_t targetCost, std::vector<ScheduledTile>& tiles ) const;
+
+    uint m_Width, m_Height;
+    uint m_NumCellsX, m_NumCellsY;
+    std::vector<uint> m_CellSteps;
+
+    // Kept from frame to frame so that, once they have grown, a frame allocates nothing.
+    struct WorkDeque;
+    std::vector<ScheduledTile> m_Tiles;
+    std::vector<uint> m_NextCellSteps;
+    std::unique_ptr<WorkDeque[]> m_Deques;
+    uint m_NumDeques;
+    FrameArenas m_Arenas;
+
+    TileScheduler( const TileScheduler& );
+    TileScheduler& operator=( const TileScheduler& );
+};
+
+#endif // TILE_SCHEDULER_H
@@ -0,0 +1,31 @@
+#include "Timer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+double Timer::GetSeconds()
+{
+    static double s_SecondsPerCount = 0.0;
+    if( s_SecondsPerCount == 0.0 )
+    {
+        LARGE_INTEGER frequencyCount;
+        QueryPerformanceFrequency(&frequencyCount);
+        s_SecondsPerCount = 1.0 / double(frequencyCount.QuadPart);
+    }
+
+    LARGE_INTEGER currentTime;
+    QueryPerformanceCounter(&currentTime);
+    return double(currentTime.QuadPart) * s_SecondsPerCount;
+}
+
+#else
+#include <time.h>
+
+double Timer::GetSeconds()
+{
+    timespec currentTime;
+    clock_gettime( CLOCK_MONOTONIC, &currentTime );
+    return double(currentTime.tv_sec) + double(currentTime.tv_nsec) * 1e-9;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+//--------------------------------------------------------------------------------------
+// High resolution timer for the headless tools.  Uses QueryPerformanceCounter on
+//  Windows, like StartTimer/GetTime in Main.cpp, and a monotonic clock elsewhere.
+//--------------------------------------------------------------------------------------
+class Timer
+{
+public:
+    Timer() { Reset(); }
+
+    void Reset() { m_Start = GetSeconds(); }
+    double GetElapsedSeconds() const { return GetSeconds() - m_Start; }
+    double GetElapsedMilliseconds() const { return GetElapsedSeconds() * 1000.0; }
+
+    static double GetSeconds();
+
+private:
+    double m_Start;
+};
+
+#endif // TIMER_H
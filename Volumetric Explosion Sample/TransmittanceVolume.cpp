@@ -0,0 +1,213 @@
+#include "TransmittanceVolume.h"
+#include "CpuRenderer.h"
+#include "ExplosionSettings.h"
+#include "Headless.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <atomic>
+#include <math.h>
+#include <stdio.h>
+#include <string>
+
+// Light marches stop once this little light is left; it rounds to zero in R8.
+static const float kMinTransmittance = 0.5f / 255.0f;
+
+TransmittanceSettings::TransmittanceSettings()
+    : resolution(32)
+    , slicesPerUpdate(4)
+    , shadowDensity(0.5f)
+{
+}
+
+TransmittanceVolume::TransmittanceVolume( const TransmittanceSettings& settings )
+    : m_Settings(settings)
+    , m_NextSlice(0)
+    , m_MinWS(0.0f)
+    , m_SizeWS(0)
+    , m_LastNumLightSteps(0)
+    , m_Texels(settings.resolution * settings.resolution * settings.resolution, 255)
+{
+}
+
+void TransmittanceVolume::Update( const ExplosionParams& params, const SceneTextures& textures, ThreadPool& pool, uint& firstSlice, uint& numSlices )
+{
+    const uint remainingSlices = m_Settings.resolution - m_NextSlice;
+    firstSlice = m_NextSlice;
+    numSlices = m_Settings.slicesPerUpdate < remainingSlices ? m_Settings.slicesPerUpdate : remainingSlices;
+
+    UpdateSlices( params, textures, pool, firstSlice, numSlices );
+
+    m_NextSlice = (m_NextSlice + numSlices) % m_Settings.resolution;
+}
+
+void TransmittanceVolume::UpdateAll( const ExplosionParams& params, const SceneTextures& textures, ThreadPool& pool )
+{
+    UpdateSlices( params, textures, pool, 0, m_Settings.resolution );
+    m_NextSlice = 0;
+}
+
+void TransmittanceVolume::UpdateSlices( const ExplosionParams& params, const SceneTextures& textures, ThreadPool& pool, uint firstSlice, uint numSlices )
+{
+    // The volume covers the explosion's bounding cube, which only moves when the
+    //  explosion's parameters change.
+    const float boundingRadius = GetExplosionBoundingRadius( params );
+    m_MinWS = Vec3( params.g_ExplosionPositionWS ) - Vec3( boundingRadius );
+    m_SizeWS = 2.0f * boundingRadius;
+
+    // The texture lookups don't need the transmittance volume itself.
+    SceneTextures lightTextures = textures;
+    lightTextures.pTransmittanceVolume = nullptr;
+    const ExplosionEvaluator evaluator( params, lightTextures );
+
+    const uint resolution = m_Settings.resolution;
+    const float cellSizeWS = m_SizeWS / resolution;
+    const Vec3 lightStepWS = Normalize( Vec3( params.g_LightDirectionWS ) ) * cellSizeWS;
+    const float extinctionPerStep = m_Settings.shadowDensity * cellSizeWS;
+    const uint maxLightSteps = (uint)ceilf( resolution * 1.7320508f );
+
+    std::atomic<uint64_t> numLightSteps( 0 );
+
+    pool.ParallelFor( numSlices * resolution, [&]( uint row, uint )
+    {
+        const uint z = firstSlice + row / resolution;
+        const uint y = row % resolution;
+        uint64_t rowLightSteps = 0;
+
+        for(uint x=0 ; x<resolution ; x++)
+        {
+            // March from the texel centre towards the light, starting half a step out
+            //  so the texel doesn't shadow itself, until the ray leaves the bounds.
+            Vec3 posWS = m_MinWS + (Vec3( (float)x, (float)y, (float)z ) + Vec3( 0.5f )) * cellSizeWS + lightStepWS * 0.5f;
+
+            float opticalDepth = 0;
+            for(uint i=0 ; i<maxLightSteps ; i++)
+            {
+                const Vec3 relativePosWS = posWS - m_MinWS;
+                if( relativePosWS.x < 0 || relativePosWS.y < 0 || relativePosWS.z < 0 ||
+                    relativePosWS.x > m_SizeWS || relativePosWS.y > m_SizeWS || relativePosWS.z > m_SizeWS ) break;
+
+                opticalDepth += evaluator.SceneFunction( posWS ).w * extinctionPerStep;
+                rowLightSteps++;
+                if( expf( -opticalDepth ) < kMinTransmittance ) break;
+
+                posWS += lightStepWS;
+            }
+
+            m_Texels[(z * resolution + y) * resolution + x] = (uint8_t)(expf( -opticalDepth ) * 255.0f + 0.5f);
+        }
+
+        numLightSteps += rowLightSteps;
+    } );
+
+    m_LastNumLightSteps = numLightSteps;
+}
+
+void TransmittanceVolume::BindParams( ExplosionParams& params ) const
+{
+    params.g_TransmittanceMinWS = float3( m_MinWS.x, m_MinWS.y, m_MinWS.z );
+    params.g_TransmittanceInvSizeWS = m_SizeWS > 0.0f ? 1.0f / m_SizeWS : 0.0f;
+}
+
+float TransmittanceVolume::Sample( const Vec3& uvw ) const
+{
+    const uint resolution = m_Settings.resolution;
+    const float maxCoord = (float)(resolution - 1);
+    const float x = Clamp( uvw.x * resolution - 0.5f, 0.0f, maxCoord );
+    const float y = Clamp( uvw.y * resolution - 0.5f, 0.0f, maxCoord );
+    const float z = Clamp( uvw.z * resolution - 0.5f, 0.0f, maxCoord );
+
+    const uint x0 = (uint)x, y0 = (uint)y, z0 = (uint)z;
+    const uint x1 = x0 + 1 < resolution ? x0 + 1 : x0;
+    const uint y1 = y0 + 1 < resolution ? y0 + 1 : y0;
+    const uint z1 = z0 + 1 < resolution ? z0 + 1 : z0;
+    const float tx = x - x0, ty = y - y0, tz = z - z0;
+
+    const uint8_t* pTexels = &m_Texels[0];
+    #define TEXEL( X, Y, Z ) (float)pTexels[((Z) * resolution + (Y)) * resolution + (X)]
+    const float c00 = Lerp( TEXEL( x0, y0, z0 ), TEXEL( x1, y0, z0 ), tx );
+    const float c10 = Lerp( TEXEL( x0, y1, z0 ), TEXEL( x1, y1, z0 ), tx );
+    const float c01 = Lerp( TEXEL( x0, y0, z1 ), TEXEL( x1, y0, z1 ), tx );
+    const float c11 = Lerp( TEXEL( x0, y1, z1 ), TEXEL( x1, y1, z1 ), tx );
+    #undef TEXEL
+
+    return Lerp( Lerp( c00, c10, ty ), Lerp( c01, c11, ty ), tz ) * (1.0f / 255.0f);
+}
+
+//--------------------------------------------------------------------------------------
+// Headless command
+//--------------------------------------------------------------------------------------
+int LightingBenchMain( const CommandLine& commandLine )
+{
+    SceneTextures textures;
+    if( !LoadSceneTextures( commandLine, textures ) ) return 1;
+
+    TransmittanceSettings transmittanceSettings;
+    transmittanceSettings.resolution = commandLine.GetUint( "size", transmittanceSettings.resolution );
+    transmittanceSettings.slicesPerUpdate = commandLine.GetUint( "slices", transmittanceSettings.slicesPerUpdate );
+    if( transmittanceSettings.resolution < 2 || transmittanceSettings.slicesPerUpdate == 0 )
+    {
+        fprintf( stderr, "Usage: lighting-bench [-size 32] [-slices 4] [-density 0.5] [-shadowing 0.8] [-time 3.3] [-radius 10] [-output prefix]\n" );
+        return 1;
+    }
+    transmittanceSettings.shadowDensity = commandLine.GetFloat( "density", transmittanceSettings.shadowDensity );
+
+    ExplosionSettings settings;
+    settings.selfShadowing = commandLine.GetFloat( "shadowing", 0.8f );
+
+    OrbitCamera camera;
+    camera.phi = PI * 0.5f;
+    camera.radius = commandLine.GetFloat( "radius", camera.radius );
+
+    ExplosionParams params;
+    BuildExplosionParams( settings, camera, commandLine.GetFloat( "time", 3.3f ), commandLine.GetUint( "width", kResolutionX ),
+                          commandLine.GetUint( "height", kResolutionY ), textures.noiseVolume.GetLargestAbsoluteValue(), params );
+
+    ThreadPool pool( commandLine.GetUint( "threads", 0 ) );
+
+    // Cost of building the whole volume, and of one incremental update.
+    TransmittanceVolume volume( transmittanceSettings );
+    Timer timer;
+    volume.UpdateAll( params, textures, pool );
+    const double fullMilliseconds = timer.GetElapsedMilliseconds();
+    const uint64_t fullLightSteps = volume.GetLastNumLightSteps();
+
+    uint firstSlice, numSlices;
+    timer.Reset();
+    volume.Update( params, textures, pool, firstSlice, numSlices );
+    const double updateMilliseconds = timer.GetElapsedMilliseconds();
+    volume.BindParams( params );
+
+    // The same frame unlit and lit; lighting should only add one fetch per step.
+    const CpuRenderer renderer( (CpuRenderSettings()) );
+    Image unlitImage, litImage;
+    RenderStats unlitStats, litStats;
+
+    ExplosionParams unlitParams = params;
+    unlitParams.g_SelfShadowing = 0.0f;
+    renderer.RenderFrame( unlitParams, textures, unlitImage, &pool, &unlitStats );
+
+    textures.pTransmittanceVolume = &volume;
+    renderer.RenderFrame( params, textures, litImage, &pool, &litStats );
+
+    const uint resolution = transmittanceSettings.resolution;
+    const uint refreshFrames = (resolution + transmittanceSettings.slicesPerUpdate - 1) / transmittanceSettings.slicesPerUpdate;
+    const double lightStepsPerTexel = (double)fullLightSteps / ((double)resolution * resolution * resolution);
+
+    printf( "Transmittance volume %u^3, %u threads.\n", resolution, pool.GetNumThreads() );
+    printf( "Full rebuild:  %8.2f ms (%.1f light steps per texel)\n", fullMilliseconds, lightStepsPerTexel );
+    printf( "Update (%u slices): %8.2f ms, whole volume refreshed every %u frames\n", numSlices, updateMilliseconds, refreshFrames );
+    printf( "Unlit march:   %8.2f ms, %llu steps\n", unlitStats.milliseconds, (unsigned long long)unlitStats.numSteps );
+    printf( "Lit march:     %8.2f ms, %llu steps (%+.1f%%)\n", litStats.milliseconds, (unsigned long long)litStats.numSteps,
+            100.0 * (litStats.milliseconds / unlitStats.milliseconds - 1.0) );
+    printf( "A nested light march at the volume's resolution would take ~%.0f extra SceneFunction calls per frame (%.0fx the main march).\n",
+            litStats.numSteps * lightStepsPerTexel, lightStepsPerTexel );
+
+    const char* pOutput = commandLine.GetString( "output", nullptr );
+    if( pOutput )
+    {
+        unlitImage.WritePPM( (std::string( pOutput ) + "_unlit.ppm").c_str() );
+        litImage.WritePPM( (std::string( pOutput ) + "_lit.ppm").c_str() );
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef TRANSMITTANCE_VOLUME_H
+#define TRANSMITTANCE_VOLUME_H
+
+//--------------------------------------------------------------------------------------
+// Low resolution light transmittance volume for self-shadowing.  Every texel holds
+//  the fraction of light reaching its centre from g_LightDirectionWS, found by
+//  marching SceneFunction's opacity towards the light on the CPU.  The main march
+//  then lights each step with a single fetch (SelfShadowing in RenderExplosion.hlsli)
+//  instead of a nested light march.
+//
+//  Recomputing the whole volume every frame is not necessary for an effect this
+//  soft, so Update refreshes a few z slices per call and wraps around, and the
+//  volume is at most ceil(resolution / slicesPerUpdate) updates out of date.
+//--------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <vector>
+
+#include "CpuMath.h"
+
+class CommandLine;
+class ThreadPool;
+struct SceneTextures;
+
+struct TransmittanceSettings
+{
+    uint resolution;
+    uint slicesPerUpdate;
+    float shadowDensity;        // Extinction per world unit of fully opaque (alpha 1) explosion.
+
+    TransmittanceSettings();
+};
+
+class TransmittanceVolume
+{
+public:
+    explicit TransmittanceVolume( const TransmittanceSettings& settings );
+
+    const TransmittanceSettings& GetSettings() const { return m_Settings; }
+    uint GetResolution() const { return m_Settings.resolution; }
+
+    // R8_UNORM texels, x-major, for uploading slice by slice.
+    const uint8_t* GetSlice( uint z ) const { return &m_Texels[z * m_Settings.resolution * m_Settings.resolution]; }
+
+    // Recomputes the next slicesPerUpdate slices with the explosion in params, rows
+    //  spread across the pool.  Returns the range of slices that changed.
+    void Update( const ExplosionParams& params, const SceneTextures& textures, ThreadPool& pool, uint& firstSlice, uint& numSlices );
+
+    // Recomputes every slice.
+    void UpdateAll( const ExplosionParams& params, const SceneTextures& textures, ThreadPool& pool );
+
+    // Fills in the volume's placement (g_TransmittanceMinWS, g_TransmittanceInvSizeWS).
+    void BindParams( ExplosionParams& params ) const;
+
+    // Trilinear filtered lookup with clamp addressing (BilinearClampedSampler).
+    float Sample( const Vec3& uvw ) const;
+
+    // Light march steps taken by the last Update/UpdateAll, for the benchmarks.
+    uint64_t GetLastNumLightSteps() const { return m_LastNumLightSteps; }
+
+private:
+    void UpdateSlices( const ExplosionParams& params, const SceneTextures& textures, ThreadPool& pool, uint firstSlice, uint numSlices );
+
+    TransmittanceSettings m_Settings;
+    uint m_NextSlice;
+    Vec3 m_MinWS;
+    float m_SizeWS;
+    uint64_t m_LastNumLightSteps;
+    std::vector<uint8_t> m_Texels;
+};
+
+int LightingBenchMain( const CommandLine& commandLine );
+
+#endif // TRANSMITTANCE_VOLUME_H
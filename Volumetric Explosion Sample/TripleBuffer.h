@@ -0,0 +1,67 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+//--------------------------------------------------------------------------------------
+// Lock-free triple buffer for handing whole frames of state from one producer
+//  thread to one consumer thread.  The producer fills its slot and publishes it;
+//  the consumer picks up the most recently published slot whenever it is ready
+//  for another.  Neither side ever waits for the other, and a slot is never
+//  written while the consumer holds it, so what the consumer sees is an immutable
+//  snapshot.  Snapshots published faster than they are consumed are dropped.
+//
+//  The slot shared between the two sides is swapped with a single atomic
+//  exchange, with a bit marking it as published since the consumer last looked.
+//--------------------------------------------------------------------------------------
+#include <atomic>
+#include <vector>
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    explicit TripleBuffer( const T& initial )
+        : m_Slots(3, initial)
+        , m_WriteIndex(0)
+        , m_ReadIndex(1)
+        , m_SharedIndex(2)
+    {
+    }
+
+    // Producer side: fill the slot, then publish it, after which the producer has a
+    //  different slot to fill.
+    T& GetWriteSlot() { return m_Slots[m_WriteIndex]; }
+
+    void Publish()
+    {
+        m_WriteIndex = m_SharedIndex.exchange( m_WriteIndex | kPublishedBit, std::memory_order_acq_rel ) & kIndexMask;
+    }
+
+    // True until the consumer has taken the last published slot, for producers that
+    //  would rather not get more than one frame ahead.
+    bool IsPublishPending() const { return (m_SharedIndex.load( std::memory_order_relaxed ) & kPublishedBit) != 0; }
+
+    // Consumer side: takes the latest published slot if there is one newer than the
+    //  slot held now.  The slot read stays valid until the next successful Acquire.
+    bool Acquire()
+    {
+        if( (m_SharedIndex.load( std::memory_order_relaxed ) & kPublishedBit) == 0 ) return false;
+        m_ReadIndex = m_SharedIndex.exchange( m_ReadIndex, std::memory_order_acq_rel ) & kIndexMask;
+        return true;
+    }
+
+    const T& GetReadSlot() const { return m_Slots[m_ReadIndex]; }
+
+private:
+    static const unsigned kIndexMask = 3;
+    static const unsigned kPublishedBit = 4;
+
+    std::vector<T> m_Slots;
+    unsigned m_WriteIndex;          // Only touched by the producer.
+    unsigned m_ReadIndex;           // Only touched by the consumer.
+    std::atomic<unsigned> m_SharedIndex;
+
+    TripleBuffer( const TripleBuffer& );
+    TripleBuffer& operator=( const TripleBuffer& );
+};
+
+#endif // TRIPLE_BUFFER_H
@@ -0,0 +1,287 @@
+#include "VariableRate.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+// Share of a tile's pixels that must land in it from the last frame for its
+//  contrast to be trusted.
+static const float kMinReprojectedShare = 0.5f;
+
+static float GetLuminance( const Vec3& colour )
+{
+    return Dot( colour, Vec3( 0.2126f, 0.7152f, 0.0722f ) );
+}
+
+// Largest difference, in any channel, between what the pixels would show once
+//  blended, so that colour under no alpha does not count.
+static float GetLargestSpread( const Vec4* pPixels, uint numPixels )
+{
+    Vec4 lo( FLT_MAX ), hi( -FLT_MAX );
+    for(uint i=0 ; i<numPixels ; i++)
+    {
+        const Vec4 shown( ResolveOverBlack( pPixels[i] ), pPixels[i].w );
+        lo = Vec4( Min( lo.x, shown.x ), Min( lo.y, shown.y ), Min( lo.z, shown.z ), Min( lo.w, shown.w ) );
+        hi = Vec4( Max( hi.x, shown.x ), Max( hi.y, shown.y ), Max( hi.z, shown.z ), Max( hi.w, shown.w ) );
+    }
+    return Max( Max( hi.x - lo.x, hi.y - lo.y ), Max( hi.z - lo.z, hi.w - lo.w ) );
+}
+
+ShadingRateSettings::ShadingRateSettings()
+    : halfRateContrast(0.02f)
+    , quarterRateContrast(0.005f)
+    , edgeThreshold(0.03f)
+{
+}
+
+ShadingRateStats::ShadingRateStats()
+    : numFilled(0)
+    , numEdgePixels(0)
+{
+    numTiles[0] = numTiles[1] = numTiles[2] = 0;
+}
+
+VariableRateRenderer::VariableRateRenderer( const CpuRenderSettings& renderSettings, const ShadingRateSettings& settings )
+    : m_RenderSettings(renderSettings)
+    , m_Settings(settings)
+    , m_HasHistory(false)
+{
+}
+
+void VariableRateRenderer::PlanRates( const ExplosionParams& params, uint numTilesX, uint numTilesY )
+{
+    m_TileRates.assign( numTilesX * numTilesY, 1 );
+
+    const uint width = (uint)params.g_ScreenParams.x;
+    const uint height = (uint)params.g_ScreenParams.y;
+    if( !m_HasHistory || m_PreviousImage.GetWidth() != width || m_PreviousImage.GetHeight() != height ) return;
+
+    // Per tile: pixels landed, then sums and sums of squares of luminance and alpha.
+    float* moments = m_Arenas.GetFrameArena().AllocateArray<float>( numTilesX * numTilesY * 5 );
+
+    const Vec3 previousEyeWS( m_PreviousParams.g_EyePositionWS );
+    for(uint y=0 ; y<height ; y++)
+    {
+        for(uint x=0 ; x<width ; x++)
+        {
+            const Vec4& pixel = m_PreviousImage.At( x, y );
+
+            // Only pixels that reached kDepthAlphaThreshold have a depth to move by.
+            float targetX = x + 0.5f, targetY = y + 0.5f;
+            if( pixel.w >= kDepthAlphaThreshold * params.g_Opacity )
+            {
+                const Vec3 posWS = previousEyeWS + GetRayDirectionWS( m_PreviousParams, x + 0.5f, y + 0.5f ) * m_PreviousDepth[y * width + x];
+                const Vec4 posPS = Transform( params.g_WorldToProjectionMatrix, Vec4( posWS, 1.0f ) );
+                if( posPS.w <= 0.0f ) continue;
+
+                targetX = (posPS.x / posPS.w * 0.5f + 0.5f) * width;
+                targetY = (0.5f - posPS.y / posPS.w * 0.5f) * height;
+                if( targetX < 0.0f || targetY < 0.0f || targetX >= width || targetY >= height ) continue;
+            }
+
+            const float luminance = GetLuminance( ResolveOverBlack( pixel ) );
+            float* pMoments = &moments[((uint)targetY / kShadingRateTileSize * numTilesX + (uint)targetX / kShadingRateTileSize) * 5];
+            pMoments[0] += 1.0f;
+            pMoments[1] += luminance;
+            pMoments[2] += luminance * luminance;
+            pMoments[3] += pixel.w;
+            pMoments[4] += pixel.w * pixel.w;
+        }
+    }
+
+    for(uint tileY=0 ; tileY<numTilesY ; tileY++)
+    {
+        for(uint tileX=0 ; tileX<numTilesX ; tileX++)
+        {
+            const float* pMoments = &moments[(tileY * numTilesX + tileX) * 5];
+            const uint tileWidth = std::min( (tileX + 1) * kShadingRateTileSize, width ) - tileX * kShadingRateTileSize;
+            const uint tileHeight = std::min( (tileY + 1) * kShadingRateTileSize, height ) - tileY * kShadingRateTileSize;
+            if( pMoments[0] < kMinReprojectedShare * tileWidth * tileHeight ) continue;
+
+            const float luminanceMean = pMoments[1] / pMoments[0];
+            const float alphaMean = pMoments[3] / pMoments[0];
+            const float luminanceVariance = pMoments[2] / pMoments[0] - luminanceMean * luminanceMean;
+            const float alphaVariance = pMoments[4] / pMoments[0] - alphaMean * alphaMean;
+            const float contrast = sqrtf( Max( Max( luminanceVariance, alphaVariance ), 0.0f ) );
+
+            uint& rate = m_TileRates[tileY * numTilesX + tileX];
+            rate = contrast < m_Settings.quarterRateContrast ? 4 : contrast < m_Settings.halfRateContrast ? 2 : 1;
+        }
+    }
+
+    // Detail drifts in from the neighbours, wisps at the silhouette thinner than
+    //  the gaps between samples, so a tile is marched at no more than twice the
+    //  spacing of the finest tile around it.
+    uint* plannedRates = m_Arenas.GetFrameArena().AllocateArray<uint>( m_TileRates.size() );
+    std::copy( m_TileRates.begin(), m_TileRates.end(), plannedRates );
+    for(uint tileY=0 ; tileY<numTilesY ; tileY++)
+    {
+        for(uint tileX=0 ; tileX<numTilesX ; tileX++)
+        {
+            uint finestRate = 4;
+            for(uint y=(tileY ? tileY - 1 : 0) ; y<=std::min( tileY + 1, numTilesY - 1 ) ; y++)
+            {
+                for(uint x=(tileX ? tileX - 1 : 0) ; x<=std::min( tileX + 1, numTilesX - 1 ) ; x++) finestRate = std::min( finestRate, plannedRates[y * numTilesX + x] );
+            }
+            uint& rate = m_TileRates[tileY * numTilesX + tileX];
+            rate = std::min( rate, finestRate * 2 );
+        }
+    }
+}
+
+void VariableRateRenderer::MarchPixel( const ExplosionEvaluator& evaluator, uint x, uint y, Image& target, RenderStats& stats )
+{
+    const ExplosionParams& params = evaluator.GetParams();
+
+    Vec4& pixel = target.At( x, y );
+    pixel = Vec4( 0.0f );
+    float& depth = m_Depth[y * target.GetWidth() + x];
+    depth = 0.0f;
+
+    const Vec3 rayDirectionWS = GetRayDirectionWS( params, x + 0.5f, y + 0.5f );
+
+    float nearD, farD;
+    if( GetAnalyticRayInterval( params, rayDirectionWS, nearD, farD ) )
+    {
+        nearD += GetRayStartOffset( evaluator, x, y );
+
+        uint stepsTaken, octavesTaken;
+        pixel = RayMarchExplosion( evaluator, rayDirectionWS, nearD, farD, stepsTaken, &depth, &octavesTaken );
+
+        stats.numRays++;
+        stats.numSteps += stepsTaken;
+        stats.numOctaves += octavesTaken;
+    }
+}
+
+void VariableRateRenderer::RenderTile( const ExplosionEvaluator& evaluator, uint x0, uint y0, uint x1, uint y1, uint rate, Image& target, RenderStats& stats,
+                                       ShadingRateStats& rateStats )
+{
+    stats.numPixels += (x1 - x0) * (y1 - y0);
+    rateStats.numTiles[rate == 1 ? 0 : rate == 2 ? 1 : 2]++;
+
+    if( rate == 1 )
+    {
+        for(uint y=y0 ; y<y1 ; y++)
+        {
+            for(uint x=x0 ; x<x1 ; x++) MarchPixel( evaluator, x, y, target, stats );
+        }
+        return;
+    }
+
+    // Every rate'th pixel and the last, so that every other pixel lies between
+    //  samples of its own tile and the edge test sees both sides of it.
+    uint samplesX[kShadingRateTileSize], samplesY[kShadingRateTileSize];
+    const uint numBlocksX = (x1 - x0 - 1 + rate - 1) / rate + 1;
+    const uint numBlocksY = (y1 - y0 - 1 + rate - 1) / rate + 1;
+    for(uint i=0 ; i<numBlocksX ; i++) samplesX[i] = std::min( x0 + i * rate, x1 - 1 );
+    for(uint i=0 ; i<numBlocksY ; i++) samplesY[i] = std::min( y0 + i * rate, y1 - 1 );
+
+    for(uint by=0 ; by<numBlocksY ; by++)
+    {
+        for(uint bx=0 ; bx<numBlocksX ; bx++) MarchPixel( evaluator, samplesX[bx], samplesY[by], target, stats );
+    }
+
+    const uint width = target.GetWidth();
+    for(uint y=y0 ; y<y1 ; y++)
+    {
+        // The samples either side of y, and how far between them it lies.
+        uint by0 = 0;
+        while( by0 + 1 < numBlocksY && samplesY[by0 + 1] <= y ) by0++;
+        const uint by1 = std::min( by0 + 1, numBlocksY - 1 );
+        const float wy = samplesY[by1] > samplesY[by0] ? Saturate( (float)((int)y - (int)samplesY[by0]) / (samplesY[by1] - samplesY[by0]) ) : 0.0f;
+
+        for(uint x=x0 ; x<x1 ; x++)
+        {
+            uint bx0 = 0;
+            while( bx0 + 1 < numBlocksX && samplesX[bx0 + 1] <= x ) bx0++;
+            const uint bx1 = std::min( bx0 + 1, numBlocksX - 1 );
+            if( x == samplesX[bx0] && y == samplesY[by0] ) continue;
+
+            const float wx = samplesX[bx1] > samplesX[bx0] ? Saturate( (float)((int)x - (int)samplesX[bx0]) / (samplesX[bx1] - samplesX[bx0]) ) : 0.0f;
+
+            const Vec4 corners[4] =
+            {
+                target.At( samplesX[bx0], samplesY[by0] ), target.At( samplesX[bx1], samplesY[by0] ),
+                target.At( samplesX[bx0], samplesY[by1] ), target.At( samplesX[bx1], samplesY[by1] )
+            };
+            if( GetLargestSpread( corners, 4 ) > m_Settings.edgeThreshold )
+            {
+                MarchPixel( evaluator, x, y, target, stats );
+                rateStats.numEdgePixels++;
+                continue;
+            }
+
+            target.At( x, y ) = Lerp( Lerp( corners[0], corners[1], wx ), Lerp( corners[2], corners[3], wx ), wy );
+            m_Depth[y * width + x] = Lerp( Lerp( m_Depth[samplesY[by0] * width + samplesX[bx0]], m_Depth[samplesY[by0] * width + samplesX[bx1]], wx ),
+                                           Lerp( m_Depth[samplesY[by1] * width + samplesX[bx0]], m_Depth[samplesY[by1] * width + samplesX[bx1]], wx ), wy );
+            rateStats.numFilled++;
+        }
+    }
+}
+
+void VariableRateRenderer::RenderFrame( const ExplosionParams& params, const SceneTextures& textures, Image& target, ThreadPool* pPool, RenderStats* pStats,
+                                        ShadingRateStats* pRateStats )
+{
+    Timer timer;
+
+    const uint width = (uint)params.g_ScreenParams.x;
+    const uint height = (uint)params.g_ScreenParams.y;
+    target.Resize( width, height );
+    m_Depth.resize( width * height );
+
+    const uint numTilesX = (width + kShadingRateTileSize - 1) / kShadingRateTileSize;
+    const uint numTilesY = (height + kShadingRateTileSize - 1) / kShadingRateTileSize;
+    PlanRates( params, numTilesX, numTilesY );
+
+    const ExplosionEvaluator evaluator( params, textures, m_RenderSettings.noisePrecision );
+
+    const uint numThreads = pPool ? pPool->GetNumThreads() : 1;
+    RenderStats* threadStats = m_Arenas.GetFrameArena().AllocateArray<RenderStats>( numThreads );
+    ShadingRateStats* threadRateStats = m_Arenas.GetFrameArena().AllocateArray<ShadingRateStats>( numThreads );
+
+    auto renderTile = [&]( uint tileIndex, uint threadIndex )
+    {
+        const uint x0 = (tileIndex % numTilesX) * kShadingRateTileSize;
+        const uint y0 = (tileIndex / numTilesX) * kShadingRateTileSize;
+        RenderTile( evaluator, x0, y0, std::min( x0 + kShadingRateTileSize, width ), std::min( y0 + kShadingRateTileSize, height ), m_TileRates[tileIndex],
+                    target, threadStats[threadIndex], threadRateStats[threadIndex] );
+    };
+
+    if( pPool )
+    {
+        pPool->ParallelFor( numTilesX * numTilesY, renderTile );
+    }
+    else
+    {
+        for(uint i=0 ; i<numTilesX * numTilesY ; i++) renderTile( i, 0 );
+    }
+
+    m_HasHistory = true;
+    m_PreviousParams = params;
+    m_PreviousImage = target;
+    m_PreviousDepth.swap( m_Depth );
+
+    if( pStats )
+    {
+        RenderStats frameStats;
+        for(uint i=0 ; i<numThreads ; i++) frameStats.Accumulate( threadStats[i] );
+        frameStats.milliseconds = timer.GetElapsedMilliseconds();
+        *pStats = frameStats;
+    }
+    if( pRateStats )
+    {
+        ShadingRateStats frameRateStats;
+        for(uint i=0 ; i<numThreads ; i++)
+        {
+            for(uint r=0 ; r<3 ; r++) frameRateStats.numTiles[r] += threadRateStats[i].numTiles[r];
+            frameRateStats.numFilled += threadRateStats[i].numFilled;
+            frameRateStats.numEdgePixels += threadRateStats[i].numEdgePixels;
+        }
+        *pRateStats = frameRateStats;
+    }
+
+    m_Arenas.Reset();
+}
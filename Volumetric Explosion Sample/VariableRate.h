@@ -0,0 +1,88 @@
+#ifndef VARIABLE_RATE_H
+#define VARIABLE_RATE_H
+
+//--------------------------------------------------------------------------------------
+// Variable rate shading for the CPU renderer.  Flat parts of the frame (the empty
+//  background, the saturated core) look the same whether every pixel is marched or
+//  one in four or sixteen, so each kShadingRateTileSize^2 tile is given a rate from
+//  how much the last frame varied over it.
+//
+//  The last frame is reprojected into this one: pixels the explosion covers move
+//  with their march depth, the rest stay put.  A tile's contrast is the larger of
+//  the standard deviations of the displayed luminance and of the alpha that land
+//  in it; tiles few pixels land in were disoccluded and get the full rate.
+//
+//  At 2x2 or 4x4 every second or fourth pixel of the tile, and its last, is
+//  marched in each direction and the others are filled bilinearly from the four
+//  samples about them, unless those differ by more than edgeThreshold, in which
+//  case the pixel is on an edge and is marched too.  Samples on the tile's own
+//  border mean that no pixel is extrapolated past what was marched.
+//--------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <vector>
+
+#include "CpuRenderer.h"
+#include "FrameArena.h"
+
+class ThreadPool;
+
+const uint kShadingRateTileSize = 8;
+
+struct ShadingRateSettings
+{
+    float halfRateContrast;     // Tiles below this contrast are marched at 2x2.
+    float quarterRateContrast;  // And below this at 4x4.
+    float edgeThreshold;        // Largest channel difference between samples that is filled across.
+
+    ShadingRateSettings();
+};
+
+struct ShadingRateStats
+{
+    uint numTiles[3];           // Tiles marched at 1x1, 2x2 and 4x4.
+    uint64_t numFilled;         // Pixels interpolated rather than marched.
+    uint64_t numEdgePixels;     // Pixels of coarse tiles marched because they sat on an edge.
+
+    ShadingRateStats();
+};
+
+class VariableRateRenderer
+{
+public:
+    VariableRateRenderer( const CpuRenderSettings& renderSettings, const ShadingRateSettings& settings );
+
+    // Renders a frame with each tile's rate chosen from the last frame rendered,
+    //  every tile at the full rate if there is none at this resolution.  Tiles are
+    //  spread across the pool when one is given.
+    void RenderFrame( const ExplosionParams& params, const SceneTextures& textures, Image& target, ThreadPool* pPool, RenderStats* pStats,
+                      ShadingRateStats* pRateStats );
+
+    // Forget the last frame, so that the next is marched in full.
+    void Reset() { m_HasHistory = false; }
+
+    // Pixels per ray side (1, 2 or 4) of every tile in the last frame, row by row.
+    const std::vector<uint>& GetTileRates() const { return m_TileRates; }
+
+private:
+    void PlanRates( const ExplosionParams& params, uint numTilesX, uint numTilesY );
+    void RenderTile( const ExplosionEvaluator& evaluator, uint x0, uint y0, uint x1, uint y1, uint rate, Image& target, RenderStats& stats,
+                     ShadingRateStats& rateStats );
+    void MarchPixel( const ExplosionEvaluator& evaluator, uint x, uint y, Image& target, RenderStats& stats );
+
+    CpuRenderSettings m_RenderSettings;
+    ShadingRateSettings m_Settings;
+
+    bool m_HasHistory;
+    ExplosionParams m_PreviousParams;
+    Image m_PreviousImage;
+    std::vector<float> m_PreviousDepth;
+
+    std::vector<float> m_Depth;         // This frame's march depth per pixel.
+    std::vector<uint> m_TileRates;
+    FrameArenas m_Arenas;               // Moments, planned rates and per-thread statistics.
+
+    VariableRateRenderer( const VariableRateRenderer& );
+    VariableRateRenderer& operator=( const VariableRateRenderer& );
+};
+
+#endif // VARIABLE_RATE_H